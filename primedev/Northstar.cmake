@@ -102,6 +102,8 @@ add_library(PrimeDLL SHARED
             "game/server/util_server.h"
             "game/server/vscript_server.cpp"
             "game/server/vscript_server.h"
+            "game/shared/vscript_httpcache.cpp"
+            "game/shared/vscript_httpcache.h"
             "game/shared/vscript_shared.cpp"
             "game/shared/vscript_shared.h"
             "gameui/GameConsole.cpp"
@@ -129,10 +131,14 @@ add_library(PrimeDLL SHARED
             "mathlib/vplane.h"
             "mods/audio.cpp"
             "mods/audio.h"
+            "mods/compiled/compiledassetcache.cpp"
+            "mods/compiled/compiledassetcache.h"
             "mods/compiled/kb_act.cpp"
             "mods/compiled/modkeyvalues.cpp"
             "mods/compiled/modpdef.cpp"
             "mods/compiled/modscriptsrson.cpp"
+            "mods/modfileindex.cpp"
+            "mods/modfileindex.h"
             "mods/modmanager.cpp"
             "mods/modmanager.h"
             "mods/modsavefiles.cpp"
@@ -145,6 +151,10 @@ add_library(PrimeDLL SHARED
             "networksystem/netchannel.h"
             "networksystem/atlas.cpp"
             "networksystem/atlas.h"
+            "networksystem/heartbeat.cpp"
+            "networksystem/heartbeat.h"
+            "networksystem/persistencedelta.cpp"
+            "networksystem/persistencedelta.h"
             "originsdk/origin.cpp"
             "originsdk/origin.h"
             "originsdk/overlay.cpp"
@@ -171,6 +181,8 @@ add_library(PrimeDLL SHARED
             "tier0/fasttimer.h"
             "tier0/filestream.cpp"
             "tier0/filestream.h"
+            "tier0/jobsystem.cpp"
+            "tier0/jobsystem.h"
             "tier0/language.cpp"
             "tier0/memstd.cpp"
             "tier0/memstd.h"
@@ -180,6 +192,8 @@ add_library(PrimeDLL SHARED
             "tier0/threadtools.h"
             "tier0/utils.cpp"
             "tier0/utils.h"
+            "tier1/addressprefixtrie.cpp"
+            "tier1/addressprefixtrie.h"
             "tier1/cmd.cpp"
             "tier1/cmd.h"
             "tier1/convar.cpp"
@@ -191,10 +205,15 @@ add_library(PrimeDLL SHARED
             "tier1/keyvalues.cpp"
             "tier1/keyvalues.h"
             "tier1/lzss.cpp"
+            "tier1/lzss.h"
+            "tier1/ratelimiter.cpp"
+            "tier1/ratelimiter.h"
             "tier1/utlmemory.h"
             "tier1/utlvector.h"
             "tier2/curlutils.cpp"
             "tier2/curlutils.h"
+            "tier2/httpclient.cpp"
+            "tier2/httpclient.h"
             "toolframework/itoolentity.h"
             "vgui/vgui_baseui_interface.cpp"
 			"vgui/vgui_baseui_interface.h"
@@ -1,25 +1,7 @@
 #include "mods/audio.h"
 
-#include <random>
-
 const char* pszAudioEventName = nullptr;
 
-template <typename Iter, typename RandomGenerator>
-Iter select_randomly(Iter start, Iter end, RandomGenerator& g)
-{
-	std::uniform_int_distribution<> dis(0, std::distance(start, end) - 1);
-	std::advance(start, dis(g));
-	return start;
-}
-
-template <typename Iter>
-Iter select_randomly(Iter start, Iter end)
-{
-	static std::random_device rd;
-	static std::mt19937 gen(rd());
-	return select_randomly(start, end, gen);
-}
-
 bool ShouldPlayAudioEvent(const char* eventName, const std::shared_ptr<EventOverrideData>& data)
 {
 	std::string eventNameString = eventName;
@@ -71,10 +53,7 @@ bool h_LoadSampleMetadata(void* sample, void* audioBuffer, unsigned int audioBuf
 			// not found
 
 			// try regex
-			for (const auto& item : g_CustomAudioManager.m_loadedAudioOverridesRegex)
-				for (const auto& regexData : item.second->EventIdsRegex)
-					if (std::regex_search(eventName, regexData.second))
-						overrideData = item.second;
+			overrideData = g_CustomAudioManager.FindRegexOverride(eventName);
 
 			if (!overrideData)
 				// not found either
@@ -107,28 +86,12 @@ bool h_LoadSampleMetadata(void* sample, void* audioBuffer, unsigned int audioBuf
 	}
 	else
 	{
-		std::pair<size_t, std::unique_ptr<uint8_t[]>>* dat = NULL;
-
-		switch (overrideData->Strategy)
-		{
-		case AudioSelectionStrategy::RANDOM:
-			dat = &*select_randomly(overrideData->Samples.begin(), overrideData->Samples.end());
-			break;
-		case AudioSelectionStrategy::SEQUENTIAL:
-		default:
-			dat = &overrideData->Samples[overrideData->CurrentIndex++];
-			if (overrideData->CurrentIndex >= overrideData->Samples.size())
-				overrideData->CurrentIndex = 0; // reset back to the first sample entry
-			break;
-		}
+		CAudioSample* pSample = overrideData->TakeNextSample();
 
-		if (!dat)
+		if (!pSample)
 			Warning(eLog::AUDIO, "Could not get sample data from override struct for event %s! Shouldn't happen\n", eventName);
 		else
-		{
-			data = dat->second.get();
-			dataLength = dat->first;
-		}
+			pSample->GetData(data, dataLength);
 	}
 
 	if (!data)
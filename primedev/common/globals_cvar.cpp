@@ -89,19 +89,31 @@ void CVar_InitModule(std::string svModule)
 		CVar_sv_quota_stringcmdspersecond = ConVar::StaticCreate("sv_quota_stringcmdspersecond", "60", FCVAR_GAMEDLL, "How many string commands per second clients are allowed to submit, 0 to disallow all string commands, -1 to disable");
 		Cvar_net_chan_limit_mode = ConVar::StaticCreate("net_chan_limit_mode", "0", FCVAR_GAMEDLL, "The mode for netchan processing limits: 0 = warn, 1 = kick");
 		Cvar_net_chan_limit_msec_per_sec = ConVar::StaticCreate("net_chan_limit_msec_per_sec", "100", FCVAR_GAMEDLL, "Netchannel processing is limited to so many milliseconds, abort connection if exceeding budget");
-		Cvar_sv_querylimit_per_sec = ConVar::StaticCreate("sv_querylimit_per_sec", "15", FCVAR_GAMEDLL, "");
+		Cvar_sv_querylimit_per_sec = ConVar::StaticCreate("sv_querylimit_per_sec", "15", FCVAR_GAMEDLL, "How many connectionless packets per second a single address may send");
+		Cvar_sv_querylimit_burst = ConVar::StaticCreate("sv_querylimit_burst", "15", FCVAR_GAMEDLL, "How many connectionless packets a single address may send at once");
+		Cvar_sv_querylimit_subnet_per_sec = ConVar::StaticCreate("sv_querylimit_subnet_per_sec", "60", FCVAR_GAMEDLL, "How many connectionless packets per second a /24 (IPv4) or /64 (IPv6) may send");
+		Cvar_sv_querylimit_subnet_burst = ConVar::StaticCreate("sv_querylimit_subnet_burst", "120", FCVAR_GAMEDLL, "How many connectionless packets a /24 (IPv4) or /64 (IPv6) may send at once");
+		Cvar_sv_querylimit_timeout = ConVar::StaticCreate("sv_querylimit_timeout", "60", FCVAR_GAMEDLL, "How many seconds an address that went over the connectionless packet limit is ignored for");
 		Cvar_sv_max_chat_messages_per_sec = ConVar::StaticCreate("sv_max_chat_messages_per_sec", "5", FCVAR_GAMEDLL, "");
 		Cvar_sv_antispeedhack_enable = ConVar::StaticCreate("sv_antispeedhack_enable", "0", FCVAR_NONE, "whether to enable antispeedhack protections");
 		Cvar_sv_antispeedhack_maxtickbudget = ConVar::StaticCreate("sv_antispeedhack_maxtickbudget", "64", FCVAR_GAMEDLL, "Maximum number of client-issued usercmd ticks that can be replayed in packet loss conditions");
 		Cvar_sv_antispeedhack_budgetincreasemultiplier = ConVar::StaticCreate("sv_antispeedhack_budgetincreasemultiplier", "1", FCVAR_GAMEDLL, "Increase usercmd processing budget by tickinterval * value per tick");
 
 		Cvar_atlas_hostname = ConVar::StaticCreate("atlas_hostname", "https://northstar.tf", FCVAR_GAMEDLL, "");
+		Cvar_atlas_persistence_coalesce_window = ConVar::StaticCreate("atlas_persistence_coalesce_window", "0.5", FCVAR_GAMEDLL, "Seconds persistence pushes are held so players leaving together are pushed to atlas in one request");
 		// note: clc_SetPlaylistVarOverride is pretty insecure, since it allows for entirely arbitrary playlist var overrides to be sent to the
 		// server, this is somewhat restricted on custom servers to prevent it being done outside of private matches, but ideally it should be
 		// disabled altogether, since the custom menus won't use it anyway this should only really be accepted if you want vanilla client
 		// compatibility
 		Cvar_ns_use_clc_SetPlaylistVarOverride = ConVar::StaticCreate("ns_use_clc_SetPlaylistVarOverride", "0", FCVAR_GAMEDLL, "Whether the server should accept clc_SetPlaylistVarOverride messages");
 
+		Cvar_ns_taskscheduler_frame_budget = ConVar::StaticCreate("ns_taskscheduler_frame_budget", "0", FCVAR_NONE, "Max milliseconds per frame spent running queued native tasks, leftover tasks run next frame. 0 = no limit");
+		Cvar_ns_dedi_log_to_client_level = ConVar::StaticCreate("ns_dedi_log_to_client_level", "0", FCVAR_GAMEDLL, "Lowest log level forwarded to clients by dedi_sendPrintsToClient. 0 = info, 1 = warning, 2 = error");
+		Cvar_ns_dedi_log_to_client_budget = ConVar::StaticCreate("ns_dedi_log_to_client_budget", "1024", FCVAR_GAMEDLL, "Max bytes of log lines sent to each client per frame, the rest waits for later frames");
+		Cvar_ns_http_mod_max_requests = ConVar::StaticCreate("ns_http_mod_max_requests", "4", FCVAR_NONE, "Max script http transfers each mod can have running at once, the rest wait for one to finish. 0 = no limit");
+		Cvar_ns_http_mod_bandwidth = ConVar::StaticCreate("ns_http_mod_bandwidth", "2048", FCVAR_NONE, "Max KB per second each mod's script http transfers can move together. 0 = no limit");
+		Cvar_ns_http_cache_disk = ConVar::StaticCreate("ns_http_cache_disk", "1", FCVAR_NONE, "Whether cached script http responses are also kept in the mod's save folder across sessions");
+
 		// Deprecated
 		Cvar_ns_masterserver_hostname = ConVar::StaticCreate("ns_masterserver_hostname", "Deprecated", FCVAR_NONE, "Deprecated");
 		Cvar_ns_curl_log_enable = ConVar::StaticCreate("ns_curl_log_enable", "Deprecated", FCVAR_NONE, "Deprecated");
@@ -336,11 +348,21 @@ ConVar* CVar_sv_quota_stringcmdspersecond = nullptr;
 ConVar* Cvar_net_chan_limit_mode = nullptr;
 ConVar* Cvar_net_chan_limit_msec_per_sec = nullptr;
 ConVar* Cvar_sv_querylimit_per_sec = nullptr;
+ConVar* Cvar_sv_querylimit_burst = nullptr;
+ConVar* Cvar_sv_querylimit_subnet_per_sec = nullptr;
+ConVar* Cvar_sv_querylimit_subnet_burst = nullptr;
+ConVar* Cvar_sv_querylimit_timeout = nullptr;
 ConVar* Cvar_sv_max_chat_messages_per_sec = nullptr;
 ConVar* Cvar_sv_antispeedhack_enable = nullptr;
 ConVar* Cvar_sv_antispeedhack_maxtickbudget = nullptr;
 ConVar* Cvar_sv_antispeedhack_budgetincreasemultiplier = nullptr;
 ConVar* Cvar_ns_use_clc_SetPlaylistVarOverride = nullptr;
+ConVar* Cvar_ns_taskscheduler_frame_budget = nullptr;
+ConVar* Cvar_ns_dedi_log_to_client_level = nullptr;
+ConVar* Cvar_ns_dedi_log_to_client_budget = nullptr;
+ConVar* Cvar_ns_http_mod_max_requests = nullptr;
+ConVar* Cvar_ns_http_mod_bandwidth = nullptr;
+ConVar* Cvar_ns_http_cache_disk = nullptr;
 ConVar* Cvar_hostdescription = nullptr;
 ConVar* Cvar_hostpassword = nullptr;
 
@@ -353,6 +375,7 @@ ConVar* Cvar_showtriggers = nullptr;
 ConVar* Cvar_show_triggers_filter = nullptr;
 
 ConVar* Cvar_atlas_hostname = nullptr;
+ConVar* Cvar_atlas_persistence_coalesce_window = nullptr;
 
 ConVar* Cvar_hostname = nullptr;
 ConVar* Cvar_hostport = nullptr;
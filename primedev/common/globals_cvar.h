@@ -65,11 +65,21 @@ extern ConVar* CVar_sv_quota_stringcmdspersecond;
 extern ConVar* Cvar_net_chan_limit_mode;
 extern ConVar* Cvar_net_chan_limit_msec_per_sec;
 extern ConVar* Cvar_sv_querylimit_per_sec;
+extern ConVar* Cvar_sv_querylimit_burst;
+extern ConVar* Cvar_sv_querylimit_subnet_per_sec;
+extern ConVar* Cvar_sv_querylimit_subnet_burst;
+extern ConVar* Cvar_sv_querylimit_timeout;
 extern ConVar* Cvar_sv_max_chat_messages_per_sec;
 extern ConVar* Cvar_sv_antispeedhack_enable;
 extern ConVar* Cvar_sv_antispeedhack_maxtickbudget;
 extern ConVar* Cvar_sv_antispeedhack_budgetincreasemultiplier;
 extern ConVar* Cvar_ns_use_clc_SetPlaylistVarOverride;
+extern ConVar* Cvar_ns_taskscheduler_frame_budget;
+extern ConVar* Cvar_ns_dedi_log_to_client_level;
+extern ConVar* Cvar_ns_dedi_log_to_client_budget;
+extern ConVar* Cvar_ns_http_mod_max_requests;
+extern ConVar* Cvar_ns_http_mod_bandwidth;
+extern ConVar* Cvar_ns_http_cache_disk;
 extern ConVar* Cvar_hostdescription;
 extern ConVar* Cvar_hostpassword;
 extern ConVar* Cvar_navmesh_debug_hull;
@@ -80,6 +90,7 @@ extern ConVar* Cvar_showtriggers;
 extern ConVar* Cvar_show_triggers_filter;
 
 extern ConVar* Cvar_atlas_hostname;
+extern ConVar* Cvar_atlas_persistence_coalesce_window;
 
 extern ConVar* Cvar_hostname;
 extern ConVar* Cvar_hostport;
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
 typedef unsigned int uint;
 typedef unsigned char uchar;
 typedef unsigned short ushort;
@@ -14,9 +18,9 @@ typedef unsigned short uint16;
 typedef int int32;
 typedef signed int sint32;
 typedef unsigned int uint32;
-typedef __int64 int64;
-typedef __int64 sint64;
-typedef unsigned __int64 uint64;
+typedef long long int64;
+typedef long long sint64;
+typedef unsigned long long uint64;
 
 typedef unsigned char byte;
 
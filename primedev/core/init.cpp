@@ -3,6 +3,8 @@
 #include "logging/logging.h"
 #include "networksystem/bcrypt.h"
 #include "tier0/taskscheduler.h"
+#include "tier0/jobsystem.h"
+#include "tier2/httpclient.h"
 #include "windows/libsys.h"
 #include "networksystem/atlas.h"
 #include "game/shared/vscript_shared.h"
@@ -17,8 +19,11 @@
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD dwReason, LPVOID lpReserved)
 {
 	NOTE_UNUSED(hModule);
-	NOTE_UNUSED(dwReason);
-	NOTE_UNUSED(lpReserved);
+
+	// lpReserved is set when the process is exiting, the log sink thread is already gone
+	if (dwReason == DLL_PROCESS_DETACH && lpReserved)
+		Log_ShutdownAsync();
+
 	return TRUE;
 }
 
@@ -48,6 +53,9 @@ bool NorthstarPrime_Initilase(LogMsgFn pLogMsg, const char* pszProfile)
 	g_svProfileDir = pszProfile;
 	g_pLogMsg = pLogMsg;
 
+	// Move logging off the calling threads now that we can reach the launcher
+	Log_InitAsync();
+
 	// Get tier0 exports
 	Tier0_Init();
 
@@ -74,6 +82,8 @@ bool NorthstarPrime_Initilase(LogMsgFn pLogMsg, const char* pszProfile)
 
 	g_pTaskScheduler = new CTaskScheduler();
 
+	g_pJobSystem = new CJobSystem();
+
 	g_pModManager = new ModManager();
 
 	// Connect to the LatencyFleX service
@@ -101,6 +111,9 @@ bool NorthstarPrime_Initilase(LogMsgFn pLogMsg, const char* pszProfile)
 	//curl_global_init_mem(CURL_GLOBAL_DEFAULT, _malloc_base, _free_base, _realloc_base, _strdup_base, _calloc_base);
 	curl_global_init(CURL_GLOBAL_ALL);
 
+	// Shared http engine used for all masterserver requests
+	g_pHttpClient = new CHttpClient();
+
 	// run callbacks for any libraries that are already loaded by now
 	CallAllPendingDLLLoadCallbacks();
 	
@@ -115,6 +128,17 @@ const char* NorthstarPrime_GetVersion()
 	return NORTHSTAR_VERSION;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Emits log messages still queued for the sink thread, the launcher
+//          calls this when crashing and before exiting
+// Input  : nTimeoutMs - How long to wait at most, -1 waits forever
+// Output : true if everything was emitted
+//-----------------------------------------------------------------------------
+bool NorthstarPrime_FlushLogs(int nTimeoutMs)
+{
+	return Log_FlushAsync(nTimeoutMs);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Init tier0 exports we use before we can index the whole dll
 //-----------------------------------------------------------------------------
@@ -151,7 +175,7 @@ void Tier0_Init()
 void Bcrypt_Init()
 {
 	if (!InitHMACSHA256())
-		Error(eLog::NS, EXIT_FAILURE, "Failed to initialize bcrypt\n");
+		Error(eLog::NS, EXIT_FAILURE, "Failed to initialize bcrypt, HMAC-SHA256 doesn't match the RFC 4231 test vectors\n");
 
 	if (!VerifyHMACSHA256("test",
 						  "\x88\xcd\x21\x08\xb5\x34\x7d\x97\x3c\xf3\x9c\xdf\x90\x53\xd7\xdd\x42\x70\x48\x76\xd8\xc9\xa9\xbd\x8e\x2d\x16\x82\x59\xd3\xdd"
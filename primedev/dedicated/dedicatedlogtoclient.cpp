@@ -7,37 +7,194 @@
 
 void (*CGameClient__ClientPrintf)(CClient* pClient, const char* fmt, ...);
 
-void DediClientMsg(const char* pszMessage)
+enum class eSendPrintsToClient
 {
-	if (g_pServer == NULL || g_pCVar == NULL)
+	NONE = -1,
+	FIRST,
+	ALL
+};
+
+// What each client slot has been sent
+struct ClientLogState_t
+{
+	LogCursor_t cursor;
+	bool bSubscribed;
+};
+
+static CLogForwardQueue s_LogQueue;
+static std::vector<ClientLogState_t> s_vClientStates;
+static std::string s_svBatch;
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CLogForwardQueue::CLogForwardQueue()
+{
+	m_vLines.resize(MAX_LINES);
+	for (Line_t& line : m_vLines)
+		line.svText.reserve(MAX_LINE_LENGTH + 1);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a line, overwriting the oldest one once the ring is full
+// Input  : eLevel -
+//          *pszMessage -
+//-----------------------------------------------------------------------------
+void CLogForwardQueue::Push(eLogLevel eLevel, const char* pszMessage)
+{
+	size_t nLength = strnlen(pszMessage, MAX_LINE_LENGTH);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Line_t& line = m_vLines[m_nNextLine % MAX_LINES];
+	line.eLevel = eLevel;
+	line.svText.assign(pszMessage, nLength);
+
+	// Lines get concatenated into batches
+	if (line.svText.empty() || line.svText.back() != '\n')
+		line.svText.push_back('\n');
+
+	m_nNextLine++;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Points a cursor past every line queued so far
+// Input  : &cursor -
+//-----------------------------------------------------------------------------
+void CLogForwardQueue::ResetCursor(LogCursor_t& cursor)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	cursor.nNext = m_nNextLine;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Collects the lines a reader hasn't seen yet
+// Input  : &cursor - Advanced past everything that went into the batch
+//          eMinLevel - Lines below this are skipped
+//          nBudget - Max bytes of lines, anything that doesn't fit is left
+//                    for the next batch
+//          &svBatch - Cleared first
+// Output : false if there's nothing to send
+//-----------------------------------------------------------------------------
+bool CLogForwardQueue::BuildBatch(LogCursor_t& cursor, eLogLevel eMinLevel, size_t nBudget, std::string& svBatch)
+{
+	svBatch.clear();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint64_t nOldest = m_nNextLine > MAX_LINES ? m_nNextLine - MAX_LINES : 0;
+	if (cursor.nNext < nOldest)
+	{
+		char szDropped[64];
+		snprintf(szDropped, sizeof(szDropped), "[%llu log lines dropped]\n", static_cast<unsigned long long>(nOldest - cursor.nNext));
+		svBatch += szDropped;
+
+		cursor.nNext = nOldest;
+	}
+
+	size_t nStart = svBatch.size();
+	for (; cursor.nNext < m_nNextLine; cursor.nNext++)
+	{
+		const Line_t& line = m_vLines[cursor.nNext % MAX_LINES];
+		if (line.eLevel < eMinLevel)
+			continue;
+
+		size_t nUsed = svBatch.size() - nStart;
+		if (nUsed + line.svText.size() > nBudget)
+		{
+			// Never let a line stall the reader, it goes out cut if it's the
+			// only thing in the batch
+			if (nUsed || !nBudget)
+				break;
+
+			svBatch.append(line.svText, 0, nBudget - 1);
+			svBatch.push_back('\n');
+			cursor.nNext++;
+			break;
+		}
+
+		svBatch += line.svText;
+	}
+
+	return !svBatch.empty();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a log line for clients, sent out by DediClientMsg_RunFrame
+// Input  : eLevel -
+//          *pszMessage -
+// Note   : Can be called from any thread
+//-----------------------------------------------------------------------------
+void DediClientMsg(eLogLevel eLevel, const char* pszMessage)
+{
+	if (g_pServer == NULL || g_pCVar == NULL || CGameClient__ClientPrintf == NULL)
 		return;
 
 	if (g_pServer->IsDead())
 		return;
 
-	enum class eSendPrintsToClient
-	{
-		NONE = -1,
-		FIRST,
-		ALL
-	};
+	if (!Cvar_dedi_sendPrintsToClient || !Cvar_ns_dedi_log_to_client_level)
+		return;
 
 	eSendPrintsToClient eSendPrints = static_cast<eSendPrintsToClient>(Cvar_dedi_sendPrintsToClient->GetInt());
 	if (eSendPrints == eSendPrintsToClient::NONE)
 		return;
 
-	std::string sLogMessage = FormatA("%s", pszMessage);
-	for (int i = 0; i < g_pServerGlobalVariables->m_nMaxClients; i++)
+	// Filtered lines would only push wanted ones out of the ring
+	if (eLevel < static_cast<eLogLevel>(Cvar_ns_dedi_log_to_client_level->GetInt()))
+		return;
+
+	s_LogQueue.Push(eLevel, pszMessage);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends each subscribed client one message with the lines queued
+//          since its last one
+//-----------------------------------------------------------------------------
+void DediClientMsg_RunFrame()
+{
+	if (g_pServer == NULL || CGameClient__ClientPrintf == NULL)
+		return;
+
+	if (!Cvar_dedi_sendPrintsToClient || !Cvar_ns_dedi_log_to_client_level || !Cvar_ns_dedi_log_to_client_budget)
+		return;
+
+	eSendPrintsToClient eSendPrints = static_cast<eSendPrintsToClient>(Cvar_dedi_sendPrintsToClient->GetInt());
+	eLogLevel eMinLevel = static_cast<eLogLevel>(std::clamp(Cvar_ns_dedi_log_to_client_level->GetInt(), 0, 2));
+
+	// ClientPrintf formats into a fixed size buffer, stay well under it
+	size_t nBudget = static_cast<size_t>(std::clamp(Cvar_ns_dedi_log_to_client_budget->GetInt(), static_cast<int>(CLogForwardQueue::MAX_LINE_LENGTH), 1536));
+
+	int nMaxClients = g_pServerGlobalVariables->m_nMaxClients;
+	if (s_vClientStates.size() < static_cast<size_t>(nMaxClients))
+		s_vClientStates.resize(nMaxClients, {{0}, false});
+
+	bool bFoundFirst = false;
+	for (int i = 0; i < nMaxClients; i++)
 	{
 		CClient* pClient = g_pServer->GetClient(i);
+		ClientLogState_t& state = s_vClientStates[i];
 
-		if (pClient->m_nSignonState >= eSignonState::CONNECTED)
+		bool bConnected = pClient->m_nSignonState >= eSignonState::CONNECTED;
+		bool bSubscribed = bConnected && eSendPrints != eSendPrintsToClient::NONE && !(eSendPrints == eSendPrintsToClient::FIRST && bFoundFirst);
+		bFoundFirst |= bConnected;
+
+		if (!bSubscribed)
 		{
-			CGameClient__ClientPrintf(pClient, sLogMessage.c_str());
+			state.bSubscribed = false;
+			continue;
+		}
 
-			if (eSendPrints == eSendPrintsToClient::FIRST)
-				break;
+		// New subscribers only get lines from now on
+		if (!state.bSubscribed)
+		{
+			s_LogQueue.ResetCursor(state.cursor);
+			state.bSubscribed = true;
+			continue;
 		}
+
+		if (s_LogQueue.BuildBatch(state.cursor, eMinLevel, nBudget, s_svBatch))
+			CGameClient__ClientPrintf(pClient, "%s", s_svBatch.c_str());
 	}
 }
 
@@ -1,3 +1,54 @@
 #pragma once
 
-void DediClientMsg(const char* pszMessage);
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class eLogLevel : int;
+
+//-----------------------------------------------------------------------------
+// Where a reader is in the log ring
+struct LogCursor_t
+{
+	// Sequence number of the next line to read
+	uint64_t nNext;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Log lines waiting to be forwarded
+// Note   : Lines are copied once into a fixed size ring that every reader
+//          walks at its own pace, so the cost of logging doesn't grow with
+//          the reader count. Readers that fall behind the ring skip ahead and
+//          get told how many lines they missed
+//-----------------------------------------------------------------------------
+class CLogForwardQueue
+{
+  public:
+	static constexpr size_t MAX_LINES = 512;
+	// Longer lines get cut, a batch always has room for one line
+	static constexpr size_t MAX_LINE_LENGTH = 512;
+
+	CLogForwardQueue();
+
+	void Push(eLogLevel eLevel, const char* pszMessage);
+
+	void ResetCursor(LogCursor_t& cursor);
+	bool BuildBatch(LogCursor_t& cursor, eLogLevel eMinLevel, size_t nBudget, std::string& svBatch);
+
+  private:
+	struct Line_t
+	{
+		eLogLevel eLevel;
+		std::string svText;
+	};
+
+	std::mutex m_Mutex;
+
+	std::vector<Line_t> m_vLines;
+	// Sequence number the next pushed line gets
+	uint64_t m_nNextLine = 0;
+};
+
+void DediClientMsg(eLogLevel eLevel, const char* pszMessage);
+void DediClientMsg_RunFrame();
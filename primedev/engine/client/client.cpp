@@ -53,6 +53,7 @@ void CClient__Disconnect(CClient* self, uint32_t unknownButAlways1, const char*
 			g_pAtlasServer->PushPersistence(self);
 		}
 
+		g_pAtlasServer->RemovePersistenceSync(self->m_UID);
 		g_pServerLimits->RemovePlayer(self);
 	}
 
@@ -6,6 +6,8 @@
 #include "engine/edict.h"
 #include "originsdk/origin.h"
 #include "tier0/taskscheduler.h"
+#include "dedicated/dedicatedlogtoclient.h"
+#include "mods/modmanager.h"
 
 #include "vscript/vscript.h"
 
@@ -152,6 +154,9 @@ void h_CHostState__FrameUpdate(CHostState* self, double flCurrentTime, float flF
 {
 	o_CHostState__FrameUpdate(self, flCurrentTime, flFrameTime);
 
+	// Pushes of players that left go out even once the server stopped
+	g_pAtlasServer->FlushPersistence(false);
+
 	if (g_pServer->IsActive())
 	{
 		// Only bother with reporting to atas in MP
@@ -162,6 +167,9 @@ void h_CHostState__FrameUpdate(CHostState* self, double flCurrentTime, float flF
 
 		// update limits for frame
 		g_pServerLimits->RunFrame(flCurrentTime, flFrameTime);
+
+		// send log lines queued since last frame
+		DediClientMsg_RunFrame();
 	}
 	else
 	{
@@ -169,6 +177,10 @@ void h_CHostState__FrameUpdate(CHostState* self, double flCurrentTime, float flF
 		g_pAtlasServer->UnregisterSelf();
 	}
 
+	// Assets compiled while loading get one manifest write instead of one each
+	g_pModManager->FlushCompiledAssets();
+
+	g_pTaskScheduler->SetFrameBudget(Cvar_ns_taskscheduler_frame_budget->GetFloat() / 1000.0);
 	g_pTaskScheduler->RunFrame();
 }
 
@@ -53,42 +53,77 @@ void h_CBaseFileSystem__AddSearchPath(IFileSystem* fileSystem, const char* pPath
 	}
 }
 
-void SetNewModSearchPaths(Mod* mod)
+void SetNewModSearchPaths(const CModFileIndex::File_t* pFile)
 {
 	// put our new path to the head if we need to read from a different mod path
 	// in the future we could also determine whether the file we're setting paths for needs a mod dir, or compiled assets
-	if (mod != nullptr)
+	if (!pFile->svSearchPath.empty())
 	{
-		if ((fs::absolute(mod->m_ModDirectory) / MOD_OVERRIDE_DIR).string().compare(sCurrentModPath))
+		if (pFile->svSearchPath.compare(sCurrentModPath))
 		{
 			// NOTE [Fifty]: Possibly put this behind some check
-			// DevMsg(eLog::FS, "Changing mod search path from %s to %s\n", sCurrentModPath.c_str(), mod->m_ModDirectory.string().c_str());
+			// DevMsg(eLog::FS, "Changing mod search path from %s to %s\n", sCurrentModPath.c_str(), pFile->svSearchPath.c_str());
 
-			o_CBaseFileSystem__AddSearchPath(&*g_pFilesystem, (fs::absolute(mod->m_ModDirectory) / MOD_OVERRIDE_DIR).string().c_str(), "GAME", PATH_ADD_TO_HEAD);
-			sCurrentModPath = (fs::absolute(mod->m_ModDirectory) / MOD_OVERRIDE_DIR).string();
+			o_CBaseFileSystem__AddSearchPath(&*g_pFilesystem, pFile->svSearchPath.c_str(), "GAME", PATH_ADD_TO_HEAD);
+			sCurrentModPath = pFile->svSearchPath;
 		}
 	}
 	else // push compiled to head
 		o_CBaseFileSystem__AddSearchPath(&*g_pFilesystem, fs::absolute(GetCompiledAssetsPath()).string().c_str(), "GAME", PATH_ADD_TO_HEAD);
 }
 
+// Paths we recently found no override or compiled asset for, most files the game opens are vanilla
+// and get opened over and over
+struct NegativeCacheEntry_t
+{
+	uint64_t nPathHash;
+	uint32_t nGeneration;
+};
+
+constexpr size_t NEGATIVE_CACHE_SIZE = 64;
+thread_local NegativeCacheEntry_t s_NegativeCache[NEGATIVE_CACHE_SIZE];
+
 bool TryReplaceFile(const char* pPath, bool shouldCompile)
 {
 	if (bReadingOriginalFile)
 		return false;
 
-	if (shouldCompile)
-		g_pModManager->CompileAssetsForFile(pPath);
+	// Entries are only valid for the index they were looked up in, it changes when mods reload or
+	// an asset gets compiled
+	std::shared_ptr<const CModFileIndex> pIndex = g_pModManager->GetModFileIndex();
+	uint32_t nGeneration = pIndex->GetGeneration();
+
+	uint64_t nPathHash = CModFileIndex::HashPath(pPath);
+	NegativeCacheEntry_t& cached = s_NegativeCache[nPathHash & (NEGATIVE_CACHE_SIZE - 1)];
+	if (cached.nPathHash == nPathHash && cached.nGeneration == nGeneration)
+		return false;
 
-	// idk how efficient the lexically normal check is
 	// can't just set all /s in path to \, since some paths aren't in writeable memory
-	auto file = g_pModManager->m_ModFiles.find(g_pModManager->NormaliseModFilePath(fs::path(pPath)));
-	if (file != g_pModManager->m_ModFiles.end())
+	char szNormalised[CModFileIndex::MAX_PATH_LENGTH];
+	std::string_view svNormalised(szNormalised, CModFileIndex::NormalisePath(pPath, szNormalised, sizeof(szNormalised)));
+
+	bool bHasCompiledAsset = false;
+	if (shouldCompile)
+		bHasCompiledAsset = g_pModManager->CompileAssetsForFile(pPath, svNormalised);
+
+	// Compiling may have added an override
+	if (bHasCompiledAsset)
+		pIndex = g_pModManager->GetModFileIndex();
+
+	const CModFileIndex::File_t* pFile = pIndex->Find(svNormalised);
+	if (pFile)
 	{
-		SetNewModSearchPaths(file->second.m_pOwningMod);
+		SetNewModSearchPaths(pFile);
 		return true;
 	}
 
+	// Only remember misses we know compiling can't turn into hits
+	if (shouldCompile && !bHasCompiledAsset)
+	{
+		cached.nPathHash = nPathHash;
+		cached.nGeneration = nGeneration;
+	}
+
 	return false;
 }
 
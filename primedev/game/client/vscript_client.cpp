@@ -196,6 +196,9 @@ SQRESULT Script_NSTryAuthWithServer(HSQUIRRELVM sqvm)
 		g_pAtlasServer->PushPersistence(pClient);
 	}
 
+	// We're leaving, don't wait out the coalesce window
+	g_pAtlasServer->FlushPersistence(true);
+
 	g_pAtlasClient->AuthenticateRemoteGameServer(g_pLocalPlayerUserID, password, g_pAtlasClient->GetRemoteGameServerList().at(serverIndex));
 
 	return SQRESULT_NULL;
@@ -0,0 +1,674 @@
+#include "game/shared/vscript_httpcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <curl/curl.h>
+
+// Start of every disk tier file, bump the version when the layout changes
+static constexpr char DISK_MAGIC[6] = {'N', 'S', 'H', 'C', '1', '\n'};
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns a cached response if it's still fresh
+// Input  : &svKey -
+//          flTime - Plat_FloatTime
+//-----------------------------------------------------------------------------
+CachedHttpResponsePtr CScriptHttpCache::GetFresh(const std::string& svKey, double flTime)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapEntries.find(svKey);
+	if (it == m_mapEntries.end() || it->second->flExpires <= flTime)
+		return nullptr;
+
+	m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, it->second);
+	return it->second->pResponse;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets a stale entry and what a conditional request for it should send
+// Input  : &svKey -
+//          &svETag - Goes into If-None-Match
+//          &svLastModified - Goes into If-Modified-Since
+// Output : nullptr if there's nothing to revalidate, hold on to it until the
+//          conditional request is done so a 304 can still be answered if the
+//          entry gets evicted in the meantime
+//-----------------------------------------------------------------------------
+CachedHttpResponsePtr CScriptHttpCache::GetStale(const std::string& svKey, std::string& svETag, std::string& svLastModified)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapEntries.find(svKey);
+	if (it == m_mapEntries.end() || (it->second->svETag.empty() && it->second->svLastModified.empty()))
+		return nullptr;
+
+	svETag = it->second->svETag;
+	svLastModified = it->second->svLastModified;
+
+	return it->second->pResponse;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stores a 200 response if its headers allow it
+// Input  : &svKey -
+//          &svBody -
+//          &svHeaders - Raw header block curl gave us
+//          flTime - Plat_FloatTime
+//          &diskDir - Disk tier to write it to as well, empty for none
+// Output : true if the disk tier was written to
+//-----------------------------------------------------------------------------
+bool CScriptHttpCache::Store(const std::string& svKey, const std::string& svBody, const std::string& svHeaders, double flTime, const std::filesystem::path& diskDir)
+{
+	Freshness_t freshness = ParseHeaders(svHeaders);
+
+	// Nothing to serve it for or to revalidate it with
+	size_t nSize = svBody.size() + svHeaders.size();
+	bool bStore = freshness.bStore && nSize <= MAX_ENTRY_SIZE && (freshness.flLifetime || !freshness.svETag.empty() || !freshness.svLastModified.empty());
+
+	auto pResponse = std::make_shared<CachedHttpResponse_t>();
+	if (bStore)
+	{
+		pResponse->svBody = svBody;
+		pResponse->svHeaders = svHeaders;
+	}
+
+	double flLifetime = freshness.flLifetime;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto it = m_mapEntries.find(svKey);
+		if (it != m_mapEntries.end())
+			Remove(it->second);
+
+		if (bStore)
+			Insert(svKey, pResponse, freshness, flTime + flLifetime);
+	}
+
+	if (diskDir.empty())
+		return false;
+
+	if (!bStore)
+	{
+		// Don't let an older copy come back next session
+		std::error_code ec;
+		return std::filesystem::remove(GetDiskFile(svKey, diskDir), ec);
+	}
+
+	return WriteDiskEntry(diskDir, svKey, *pResponse, flLifetime);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Handles a 304, the cached response is fresh again
+// Input  : &svKey -
+//          &pStale - What GetStale returned for the conditional request
+//          &svHeaders - Headers of the 304
+//          flTime - Plat_FloatTime
+// Note   : If the entry got evicted while the request was in flight it's put
+//          back from pStale
+//-----------------------------------------------------------------------------
+void CScriptHttpCache::Revalidate(const std::string& svKey, const CachedHttpResponsePtr& pStale, const std::string& svHeaders, double flTime)
+{
+	Freshness_t freshness = ParseHeaders(svHeaders);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapEntries.find(svKey);
+
+	// A newer response got stored in the meantime, that one wins
+	if (it != m_mapEntries.end() && it->second->pResponse != pStale)
+		return;
+
+	if (!freshness.bStore)
+	{
+		if (it != m_mapEntries.end())
+			Remove(it->second);
+		return;
+	}
+
+	if (it == m_mapEntries.end())
+	{
+		// Whatever the 304 doesn't say comes from the response it validated
+		Freshness_t original = ParseHeaders(pStale->svHeaders);
+		if (!freshness.bHasLifetime)
+			freshness.flLifetime = original.flLifetime;
+		if (freshness.svETag.empty())
+			freshness.svETag = std::move(original.svETag);
+		if (freshness.svLastModified.empty())
+			freshness.svLastModified = std::move(original.svLastModified);
+
+		Insert(svKey, pStale, freshness, flTime + freshness.flLifetime);
+		return;
+	}
+
+	Entry_t& entry = *it->second;
+
+	if (freshness.bHasLifetime)
+		entry.flLifetime = freshness.flLifetime;
+	if (!freshness.svETag.empty())
+		entry.svETag = std::move(freshness.svETag);
+	if (!freshness.svLastModified.empty())
+		entry.svLastModified = std::move(freshness.svLastModified);
+
+	entry.flExpires = flTime + entry.flLifetime;
+	m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, it->second);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Brings an entry from the disk tier into memory
+// Input  : &svKey -
+//          &diskDir -
+//          flTime - Plat_FloatTime
+// Output : true if it was loaded, it may be stale
+//-----------------------------------------------------------------------------
+bool CScriptHttpCache::LoadFromDisk(const std::string& svKey, const std::filesystem::path& diskDir, double flTime)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_mapEntries.find(svKey) != m_mapEntries.end())
+			return false;
+	}
+
+	std::ifstream file(GetDiskFile(svKey, diskDir), std::ios::binary);
+	if (!file)
+		return false;
+
+	std::string svData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::string_view svRead(svData);
+
+	auto ReadBytes = [&svRead](void* pOut, size_t nSize)
+	{
+		if (svRead.size() < nSize)
+			return false;
+
+		memcpy(pOut, svRead.data(), nSize);
+		svRead.remove_prefix(nSize);
+		return true;
+	};
+
+	auto ReadString = [&](std::string& svOut)
+	{
+		uint32_t nSize;
+		if (!ReadBytes(&nSize, sizeof(nSize)) || svRead.size() < nSize)
+			return false;
+
+		svOut.assign(svRead.data(), nSize);
+		svRead.remove_prefix(nSize);
+		return true;
+	};
+
+	char szMagic[sizeof(DISK_MAGIC)];
+	std::string svFileKey;
+	int64_t nExpires;
+	double flLifetime;
+	auto pResponse = std::make_shared<CachedHttpResponse_t>();
+
+	if (!ReadBytes(szMagic, sizeof(szMagic)) || memcmp(szMagic, DISK_MAGIC, sizeof(szMagic)) || !ReadString(svFileKey) || !ReadBytes(&nExpires, sizeof(nExpires)) ||
+		!ReadBytes(&flLifetime, sizeof(flLifetime)) || !ReadString(pResponse->svHeaders) || !ReadString(pResponse->svBody) || !svRead.empty())
+		return false;
+
+	// Another key with the same hash
+	if (svFileKey != svKey || pResponse->svBody.size() + pResponse->svHeaders.size() > MAX_ENTRY_SIZE)
+		return false;
+
+	Freshness_t freshness = ParseHeaders(pResponse->svHeaders);
+	freshness.flLifetime = flLifetime;
+
+	// Expiry is stored as wall clock time, Plat_FloatTime starts over every session
+	double flRemaining = static_cast<double>(nExpires - static_cast<int64_t>(time(nullptr)));
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_mapEntries.find(svKey) != m_mapEntries.end())
+		return false;
+
+	Insert(svKey, pResponse, freshness, flTime + flRemaining);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Marks a transfer as in flight, or joins the one that already is
+// Input  : &svKey -
+//          nHandle - Script handle of the request
+//          nContext -
+// Output : true if the request joined another transfer and mustn't make its own
+//-----------------------------------------------------------------------------
+bool CScriptHttpCache::JoinInFlight(const std::string& svKey, int nHandle, ScriptContext nContext)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapInFlight.find(svKey);
+	if (it == m_mapInFlight.end())
+	{
+		m_mapInFlight.emplace(svKey, std::vector<HttpWaiter_t>());
+		return false;
+	}
+
+	it->second.push_back({nHandle, nContext});
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Ends a transfer started through JoinInFlight
+// Input  : &svKey -
+// Output : Requests that joined it and need the same result
+//-----------------------------------------------------------------------------
+std::vector<HttpWaiter_t> CScriptHttpCache::FinishInFlight(const std::string& svKey)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<HttpWaiter_t> vWaiters;
+
+	auto it = m_mapInFlight.find(svKey);
+	if (it != m_mapInFlight.end())
+	{
+		vWaiters = std::move(it->second);
+		m_mapInFlight.erase(it);
+	}
+
+	return vWaiters;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops every cached response
+//-----------------------------------------------------------------------------
+void CScriptHttpCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	m_lstEntries.clear();
+	m_mapEntries.clear();
+	m_nSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Works out how long a response may be served without asking the
+//          server again
+// Input  : &svHeaders - Raw header block, with redirects only the last
+//                       response counts
+//-----------------------------------------------------------------------------
+CScriptHttpCache::Freshness_t CScriptHttpCache::ParseHeaders(const std::string& svHeaders)
+{
+	Freshness_t freshness {true, false, 0.0, "", ""};
+
+	size_t nStart = svHeaders.rfind("\r\nHTTP/");
+	nStart = nStart == std::string::npos ? 0 : nStart + 2;
+
+	// curl ends the block with an empty line, skip it
+	size_t nEnd = svHeaders.size();
+	while (nEnd > nStart && (svHeaders[nEnd - 1] == '\r' || svHeaders[nEnd - 1] == '\n'))
+		nEnd--;
+
+	auto Trim = [](std::string_view svValue)
+	{
+		while (!svValue.empty() && (svValue.front() == ' ' || svValue.front() == '\t'))
+			svValue.remove_prefix(1);
+		while (!svValue.empty() && (svValue.back() == ' ' || svValue.back() == '\t' || svValue.back() == '\r'))
+			svValue.remove_suffix(1);
+		return svValue;
+	};
+
+	auto IEquals = [](std::string_view svA, std::string_view svB)
+	{
+		return svA.size() == svB.size() && std::equal(svA.begin(), svA.end(), svB.begin(), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+	};
+
+	bool bHasMaxAge = false;
+	double flMaxAge = 0.0;
+	double flAge = 0.0;
+	bool bNoCache = false;
+	std::string svDate;
+	std::string svExpires;
+	bool bHasExpires = false;
+
+	std::string_view svBlock(svHeaders.data() + nStart, nEnd - nStart);
+	for (size_t nLine = 0; nLine < svBlock.size();)
+	{
+		size_t nLineEnd = svBlock.find('\n', nLine);
+		if (nLineEnd == std::string_view::npos)
+			nLineEnd = svBlock.size();
+
+		std::string_view svLine = svBlock.substr(nLine, nLineEnd - nLine);
+		nLine = nLineEnd + 1;
+
+		size_t nColon = svLine.find(':');
+		if (nColon == std::string_view::npos)
+			continue;
+
+		std::string_view svName = Trim(svLine.substr(0, nColon));
+		std::string_view svValue = Trim(svLine.substr(nColon + 1));
+
+		if (IEquals(svName, "Cache-Control") || IEquals(svName, "Pragma"))
+		{
+			// Directives are comma separated, max-age may be quoted
+			for (size_t nDirective = 0; nDirective <= svValue.size();)
+			{
+				size_t nComma = svValue.find(',', nDirective);
+				if (nComma == std::string_view::npos)
+					nComma = svValue.size();
+
+				std::string_view svDirective = Trim(svValue.substr(nDirective, nComma - nDirective));
+				nDirective = nComma + 1;
+
+				size_t nEquals = svDirective.find('=');
+				std::string_view svArgument = nEquals == std::string_view::npos ? std::string_view() : Trim(svDirective.substr(nEquals + 1));
+				svDirective = Trim(svDirective.substr(0, nEquals));
+
+				if (IEquals(svDirective, "no-store"))
+				{
+					freshness.bStore = false;
+				}
+				else if (IEquals(svDirective, "no-cache"))
+				{
+					bNoCache = true;
+				}
+				else if (IEquals(svDirective, "max-age"))
+				{
+					if (svArgument.size() >= 2 && svArgument.front() == '"' && svArgument.back() == '"')
+						svArgument = svArgument.substr(1, svArgument.size() - 2);
+
+					bHasMaxAge = true;
+					flMaxAge = std::max(0.0, atof(std::string(svArgument).c_str()));
+				}
+			}
+		}
+		else if (IEquals(svName, "Vary"))
+		{
+			// The key already holds every request header, except * which
+			// depends on things we can't know
+			if (svValue.find('*') != std::string_view::npos)
+				freshness.bStore = false;
+		}
+		else if (IEquals(svName, "Age"))
+		{
+			flAge = std::max(0.0, atof(std::string(svValue).c_str()));
+		}
+		else if (IEquals(svName, "Date"))
+		{
+			svDate = svValue;
+		}
+		else if (IEquals(svName, "Expires"))
+		{
+			svExpires = svValue;
+			bHasExpires = true;
+		}
+		else if (IEquals(svName, "ETag"))
+		{
+			freshness.svETag = svValue;
+		}
+		else if (IEquals(svName, "Last-Modified"))
+		{
+			freshness.svLastModified = svValue;
+		}
+	}
+
+	if (bNoCache)
+	{
+		freshness.bHasLifetime = true;
+		freshness.flLifetime = 0.0;
+	}
+	else if (bHasMaxAge)
+	{
+		freshness.bHasLifetime = true;
+		freshness.flLifetime = std::max(0.0, flMaxAge - flAge);
+	}
+	else if (bHasExpires)
+	{
+		// Measure against the server's clock so ours being off doesn't matter,
+		// an invalid date like "0" means already expired
+		time_t nExpires = curl_getdate(svExpires.c_str(), nullptr);
+		time_t nDate = svDate.empty() ? -1 : curl_getdate(svDate.c_str(), nullptr);
+		if (nDate == -1)
+			nDate = time(nullptr);
+
+		freshness.bHasLifetime = true;
+		freshness.flLifetime = nExpires == -1 ? 0.0 : std::max(0.0, static_cast<double>(nExpires - nDate) - flAge);
+	}
+
+	return freshness;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds an entry, evicting the least recently used ones to make room,
+//          caller holds m_Mutex and made sure the key isn't in use
+// Input  : &svKey -
+//          pResponse -
+//          &freshness -
+//          flExpires - Plat_FloatTime it goes stale at
+//-----------------------------------------------------------------------------
+void CScriptHttpCache::Insert(const std::string& svKey, CachedHttpResponsePtr pResponse, Freshness_t& freshness, double flExpires)
+{
+	size_t nSize = pResponse->svBody.size() + pResponse->svHeaders.size();
+	while (m_nSize + nSize > MAX_SIZE && !m_lstEntries.empty())
+		Remove(std::prev(m_lstEntries.end()));
+
+	Entry_t& entry = m_lstEntries.emplace_front();
+	entry.svKey = svKey;
+	entry.pResponse = std::move(pResponse);
+	entry.svETag = std::move(freshness.svETag);
+	entry.svLastModified = std::move(freshness.svLastModified);
+	entry.flLifetime = freshness.flLifetime;
+	entry.flExpires = flExpires;
+
+	m_mapEntries.emplace(svKey, m_lstEntries.begin());
+	m_nSize += nSize;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes an entry, caller holds m_Mutex
+// Input  : it -
+//-----------------------------------------------------------------------------
+void CScriptHttpCache::Remove(std::list<Entry_t>::iterator it)
+{
+	m_nSize -= it->pResponse->svBody.size() + it->pResponse->svHeaders.size();
+	m_mapEntries.erase(it->svKey);
+	m_lstEntries.erase(it);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the file an entry is kept in on disk
+// Input  : &svKey -
+//          &diskDir -
+//-----------------------------------------------------------------------------
+std::filesystem::path CScriptHttpCache::GetDiskFile(const std::string& svKey, const std::filesystem::path& diskDir)
+{
+	// FNV-1a, the name has to stay the same between sessions and builds
+	uint64_t nHash = 0xCBF29CE484222325ull;
+	for (char c : svKey)
+	{
+		nHash ^= static_cast<uint8_t>(c);
+		nHash *= 0x100000001B3ull;
+	}
+
+	char szName[32];
+	snprintf(szName, sizeof(szName), "%016llx.cache", static_cast<unsigned long long>(nHash));
+
+	return diskDir / szName;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes an entry to the disk tier
+// Input  : &diskDir -
+//          &svKey -
+//          &response -
+//          flRemaining - Seconds it stays fresh for
+// Output : false if it couldn't be written
+//-----------------------------------------------------------------------------
+bool CScriptHttpCache::WriteDiskEntry(const std::filesystem::path& diskDir, const std::string& svKey, const CachedHttpResponse_t& response, double flRemaining)
+{
+	std::string svData(DISK_MAGIC, sizeof(DISK_MAGIC));
+
+	auto WriteBytes = [&svData](const void* pData, size_t nSize) { svData.append(static_cast<const char*>(pData), nSize); };
+	auto WriteString = [&](const std::string& svValue)
+	{
+		uint32_t nSize = static_cast<uint32_t>(svValue.size());
+		WriteBytes(&nSize, sizeof(nSize));
+		svData += svValue;
+	};
+
+	int64_t nExpires = static_cast<int64_t>(time(nullptr)) + static_cast<int64_t>(flRemaining);
+
+	WriteString(svKey);
+	WriteBytes(&nExpires, sizeof(nExpires));
+	WriteBytes(&flRemaining, sizeof(flRemaining));
+	WriteString(response.svHeaders);
+	WriteString(response.svBody);
+
+	std::error_code ec;
+	std::filesystem::create_directories(diskDir, ec);
+	if (ec)
+		return false;
+
+	std::filesystem::path file = GetDiskFile(svKey, diskDir);
+	std::filesystem::path tempFile = file;
+	tempFile += ".tmp";
+
+	TrimDisk(diskDir, file, svData.size());
+
+	{
+		std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+		if (!stream.write(svData.data(), svData.size()))
+		{
+			stream.close();
+			std::filesystem::remove(tempFile, ec);
+			return false;
+		}
+	}
+
+	// Readers only ever see a whole entry
+	std::filesystem::rename(tempFile, file, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempFile, ec);
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Deletes the oldest files of the disk tier until an entry fits
+// Input  : &diskDir -
+//          &replacing - File the entry goes into, its old size doesn't count
+//          nIncoming - Size of the entry
+//-----------------------------------------------------------------------------
+void CScriptHttpCache::TrimDisk(const std::filesystem::path& diskDir, const std::filesystem::path& replacing, size_t nIncoming)
+{
+	struct DiskFile_t
+	{
+		std::filesystem::file_time_type writeTime;
+		uintmax_t nSize;
+		std::filesystem::path path;
+	};
+
+	std::vector<DiskFile_t> vFiles;
+	uintmax_t nTotal = nIncoming;
+
+	std::error_code ec;
+	for (std::filesystem::directory_iterator it(diskDir, ec), end; !ec && it != end; it.increment(ec))
+	{
+		if (!it->is_regular_file(ec) || it->path() == replacing)
+			continue;
+
+		DiskFile_t& diskFile = vFiles.emplace_back();
+		diskFile.path = it->path();
+		diskFile.nSize = it->file_size(ec);
+		diskFile.writeTime = it->last_write_time(ec);
+		nTotal += diskFile.nSize;
+	}
+
+	if (nTotal <= MAX_DISK_SIZE)
+		return;
+
+	std::sort(vFiles.begin(), vFiles.end(), [](const DiskFile_t& a, const DiskFile_t& b) { return a.writeTime < b.writeTime; });
+
+	for (const DiskFile_t& diskFile : vFiles)
+	{
+		if (nTotal <= MAX_DISK_SIZE)
+			break;
+
+		if (std::filesystem::remove(diskFile.path, ec))
+			nTotal -= diskFile.nSize;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes one of a mod's transfer slots, or queues the transfer
+// Input  : &svMod -
+//          nMaxInFlight - Concurrent transfers the mod may have, 0 for no limit
+//          fnStart - Run by whoever releases a slot, if this got queued
+//-----------------------------------------------------------------------------
+eHttpSlot CScriptHttpModLimiter::Acquire(const std::string& svMod, int nMaxInFlight, std::function<void()> fnStart)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Mod_t& mod = m_mapMods[svMod];
+	if (nMaxInFlight <= 0 || mod.nInFlight < nMaxInFlight)
+	{
+		mod.nInFlight++;
+		return eHttpSlot::START;
+	}
+
+	if (mod.dqQueued.size() >= MAX_QUEUED)
+		return eHttpSlot::FULL;
+
+	mod.dqQueued.push_back(std::move(fnStart));
+	return eHttpSlot::QUEUED;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gives up a transfer slot
+// Input  : &svMod -
+// Output : Queued transfer that now owns the slot, the caller has to run it
+//-----------------------------------------------------------------------------
+std::function<void()> CScriptHttpModLimiter::Release(const std::string& svMod)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapMods.find(svMod);
+	if (it == m_mapMods.end())
+		return nullptr;
+
+	Mod_t& mod = it->second;
+	if (!mod.dqQueued.empty())
+	{
+		std::function<void()> fnStart = std::move(mod.dqQueued.front());
+		mod.dqQueued.pop_front();
+		return fnStart;
+	}
+
+	mod.nInFlight--;
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes bytes a transfer moved out of the mod's bandwidth budget
+// Input  : &svMod -
+//          nBytes -
+//          flTime - Plat_FloatTime
+//          flRate - Bytes per second, 0 for no limit
+// Output : Seconds the transfer should wait before moving more
+//-----------------------------------------------------------------------------
+double CScriptHttpModLimiter::Consume(const std::string& svMod, size_t nBytes, double flTime, double flRate)
+{
+	if (flRate <= 0.0)
+		return 0.0;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// A second worth of bytes can go out at once
+	Mod_t& mod = m_mapMods[svMod];
+	if (!mod.bBucketStarted)
+	{
+		mod.flTokens = flRate;
+		mod.flLastUpdate = flTime;
+		mod.bBucketStarted = true;
+	}
+
+	mod.flTokens = std::min(flRate, mod.flTokens + (flTime - mod.flLastUpdate) * flRate);
+	mod.flLastUpdate = flTime;
+	mod.flTokens -= static_cast<double>(nBytes);
+
+	return mod.flTokens < 0.0 ? -mod.flTokens / flRate : 0.0;
+}
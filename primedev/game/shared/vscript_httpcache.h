@@ -0,0 +1,147 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class ScriptContext : int;
+
+//-----------------------------------------------------------------------------
+// Response handed back to script for a cache hit
+struct CachedHttpResponse_t
+{
+	std::string svBody;
+	std::string svHeaders;
+};
+
+// Holding on to a response keeps it alive after it's evicted
+using CachedHttpResponsePtr = std::shared_ptr<const CachedHttpResponse_t>;
+
+//-----------------------------------------------------------------------------
+// Request that joined a transfer already in flight
+struct HttpWaiter_t
+{
+	int nHandle;
+	ScriptContext nContext;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: In memory cache for script GET requests, with an optional disk
+//          tier in the requesting mod's save folder
+// Note   : Follows Cache-Control, Expires, ETag and Last-Modified. Stale
+//          entries with a validator get revalidated with a conditional
+//          request instead of being dropped. Identical GETs made while one
+//          is in flight wait for that transfer instead of starting their own
+//-----------------------------------------------------------------------------
+class CScriptHttpCache
+{
+  public:
+	// Total size of cached bodies and headers
+	static constexpr size_t MAX_SIZE = 16 * 1024 * 1024;
+	// Anything bigger isn't worth evicting everything else for
+	static constexpr size_t MAX_ENTRY_SIZE = 2 * 1024 * 1024;
+	// Size of the disk tier in each mod's save folder, counts against its quota
+	static constexpr size_t MAX_DISK_SIZE = 8 * 1024 * 1024;
+	// Folder the disk tier lives in, inside a mod's save folder
+	static constexpr const char* DISK_FOLDER = "nshttpcache";
+
+	CachedHttpResponsePtr GetFresh(const std::string& svKey, double flTime);
+	CachedHttpResponsePtr GetStale(const std::string& svKey, std::string& svETag, std::string& svLastModified);
+
+	bool Store(const std::string& svKey, const std::string& svBody, const std::string& svHeaders, double flTime, const std::filesystem::path& diskDir);
+	void Revalidate(const std::string& svKey, const CachedHttpResponsePtr& pStale, const std::string& svHeaders, double flTime);
+	bool LoadFromDisk(const std::string& svKey, const std::filesystem::path& diskDir, double flTime);
+
+	bool JoinInFlight(const std::string& svKey, int nHandle, ScriptContext nContext);
+	std::vector<HttpWaiter_t> FinishInFlight(const std::string& svKey);
+
+	void Clear();
+
+	static std::filesystem::path GetDiskFile(const std::string& svKey, const std::filesystem::path& diskDir);
+
+  private:
+	struct Entry_t
+	{
+		std::string svKey;
+		CachedHttpResponsePtr pResponse;
+		std::string svETag;
+		std::string svLastModified;
+
+		double flExpires;
+		// How long the response stays fresh, reused when a 304 doesn't say
+		double flLifetime;
+	};
+
+	struct Freshness_t
+	{
+		bool bStore;
+		bool bHasLifetime;
+		double flLifetime;
+		std::string svETag;
+		std::string svLastModified;
+	};
+
+	static Freshness_t ParseHeaders(const std::string& svHeaders);
+	void Insert(const std::string& svKey, CachedHttpResponsePtr pResponse, Freshness_t& freshness, double flExpires);
+	void Remove(std::list<Entry_t>::iterator it);
+
+	static bool WriteDiskEntry(const std::filesystem::path& diskDir, const std::string& svKey, const CachedHttpResponse_t& response, double flRemaining);
+	static void TrimDisk(const std::filesystem::path& diskDir, const std::filesystem::path& replacing, size_t nIncoming);
+
+	std::mutex m_Mutex;
+
+	// Most recently used at the front
+	std::list<Entry_t> m_lstEntries;
+	std::unordered_map<std::string, std::list<Entry_t>::iterator> m_mapEntries;
+	size_t m_nSize = 0;
+
+	// Key : requests waiting for the transfer in flight, not including the one making it
+	std::unordered_map<std::string, std::vector<HttpWaiter_t>> m_mapInFlight;
+};
+
+//-----------------------------------------------------------------------------
+// Result of CScriptHttpModLimiter::Acquire
+enum class eHttpSlot : int
+{
+	START = 0, // Got a slot, start the transfer now
+	QUEUED = 1, // Starts once one of the mod's transfers finishes
+	FULL = 2 // Mod has too many requests waiting, drop it
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Per mod concurrency and bandwidth limits for script http
+// Note   : A mod over its concurrency limit has its transfers queued, each
+//          finished transfer hands its slot to the next one. Bandwidth is a
+//          token bucket of bytes per mod shared by all its transfers, a
+//          transfer that runs the bucket dry waits until it refills
+//-----------------------------------------------------------------------------
+class CScriptHttpModLimiter
+{
+  public:
+	// Requests a mod may have waiting for a slot
+	static constexpr size_t MAX_QUEUED = 64;
+
+	eHttpSlot Acquire(const std::string& svMod, int nMaxInFlight, std::function<void()> fnStart);
+	std::function<void()> Release(const std::string& svMod);
+	double Consume(const std::string& svMod, size_t nBytes, double flTime, double flRate);
+
+  private:
+	struct Mod_t
+	{
+		int nInFlight = 0;
+		std::deque<std::function<void()>> dqQueued;
+
+		double flTokens = 0.0;
+		double flLastUpdate = 0.0;
+		bool bBucketStarted = false;
+	};
+
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, Mod_t> m_mapMods;
+};
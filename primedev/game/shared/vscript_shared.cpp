@@ -10,6 +10,11 @@
 #include "originsdk/origin.h"
 #include "tier2/curlutils.h"
 #include "tier0/taskscheduler.h"
+#include "tier0/jobsystem.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 
 // void NSSaveFile( string file, string data )
 SQRESULT Script_NSSaveFile(HSQUIRRELVM sqvm)
@@ -40,13 +45,13 @@ SQRESULT Script_NSSaveFile(HSQUIRRELVM sqvm)
 	// this actually allows mods to go over the limit, but not by much
 	// the limit is to prevent mods from taking gigabytes of space,
 	// this ain't a cloud service.
-	if (GetSizeOfFolderContentsMinusFile(dir, fileName) + content.length() > MAX_FOLDER_SIZE)
+	if (g_pSaveFolderQuota->GetFolderSizeMinusFile(dir, fileName) + content.length() > MAX_FOLDER_SIZE)
 	{
 		sq_raiseerror(sqvm, FormatA("The mod %s has reached the maximum folder size.\n\nAsk the mod developer to optimize their data usage, or increase the maximum folder size using the -maxfoldersize launch parameter.", mod->Name.c_str()).c_str());
 		return SQRESULT_ERROR;
 	}
 
-	g_pSaveFileManager->SaveFileAsync(dir / fileName, content);
+	g_pSaveFileManager->SaveFileAsync(dir, fileName, content);
 
 	return SQRESULT_NULL;
 }
@@ -72,9 +77,8 @@ SQRESULT Script_NSSaveJSONFile(HSQUIRRELVM sqvm)
 	// Note - this cannot be done in the async func since the table may get garbage collected.
 	// This means that especially large tables may still clog up the system.
 
-	nlohmann::json jsContent;
-	CScriptJson::EncodeJsonTable(sqvm->_stackOfCurrentFunction[2]._VAL.asTable, jsContent);
-	std::string svContent = jsContent.dump(4);
+	std::string svContent;
+	CScriptJson::EncodeJson(sqvm->_stackOfCurrentFunction[2]._VAL.asTable, svContent, 4);
 
 	if (ContainsInvalidChars(svContent))
 	{
@@ -86,13 +90,13 @@ SQRESULT Script_NSSaveJSONFile(HSQUIRRELVM sqvm)
 	// this actually allows mods to go over the limit, but not by much
 	// the limit is to prevent mods from taking gigabytes of space,
 	// this ain't a cloud service.
-	if (GetSizeOfFolderContentsMinusFile(dir, fileName) + svContent.length() > MAX_FOLDER_SIZE)
+	if (g_pSaveFolderQuota->GetFolderSizeMinusFile(dir, fileName) + svContent.length() > MAX_FOLDER_SIZE)
 	{
 		sq_raiseerror(sqvm, FormatA("The mod %s has reached the maximum folder size.\n\nAsk the mod developer to optimize their data usage, or increase the maximum folder size using the -maxfoldersize launch parameter.", mod->Name.c_str()).c_str());
 		return SQRESULT_ERROR;
 	}
 
-	g_pSaveFileManager->SaveFileAsync(dir / fileName, svContent);
+	g_pSaveFileManager->SaveFileAsync(dir, fileName, svContent);
 
 	return SQRESULT_NULL;
 }
@@ -115,7 +119,7 @@ SQRESULT Script_NS_InternalLoadFile(HSQUIRRELVM sqvm)
 		return SQRESULT_ERROR;
 	}
 
-	sq_pushinteger(sqvm, g_pSaveFileManager->LoadFileAsync(dir / fileName, (ScriptContext)sqvm->sharedState->cSquirrelVM->vmContext));
+	sq_pushinteger(sqvm, g_pSaveFileManager->LoadFileAsync(dir, fileName, (ScriptContext)sqvm->sharedState->cSquirrelVM->vmContext));
 
 	return SQRESULT_NOTNULL;
 }
@@ -192,7 +196,7 @@ SQRESULT Script_NSDeleteFile(HSQUIRRELVM sqvm)
 		return SQRESULT_ERROR;
 	}
 
-	g_pSaveFileManager->DeleteFileAsync(dir / fileName);
+	g_pSaveFileManager->DeleteFileAsync(dir, fileName);
 	return SQRESULT_NOTNULL;
 }
 
@@ -268,7 +272,6 @@ SQRESULT Script_NSIsFolder(HSQUIRRELVM sqvm)
 	}
 }
 
-// side note, expensive.
 SQRESULT Script_NSGetTotalSpaceRemaining(HSQUIRRELVM sqvm)
 {
 	Mod* mod = sq_getcallingmod(sqvm);
@@ -279,7 +282,7 @@ SQRESULT Script_NSGetTotalSpaceRemaining(HSQUIRRELVM sqvm)
 	}
 
 	fs::path dir = g_svSavePath / fs::path(mod->m_ModDirectory).filename();
-	sq_pushinteger(sqvm, (MAX_FOLDER_SIZE - GetSizeOfFolder(dir)) / 1024);
+	sq_pushinteger(sqvm, (MAX_FOLDER_SIZE - g_pSaveFolderQuota->GetFolderSize(dir)) / 1024);
 	return SQRESULT_NOTNULL;
 }
 
@@ -451,17 +454,12 @@ SQRESULT Script_DecodeJSON(HSQUIRRELVM sqvm)
 	const char* pJson = sq_getstring(sqvm, 1);
 	const bool bFatalParseErrors = sq_getbool(sqvm, 2);
 
-	nlohmann::json jsObj;
-
-	try
-	{
-		jsObj = nlohmann::json::parse(pJson);
-	}
-	catch (const std::exception& ex)
+	std::string svError;
+	if (!CScriptJson::DecodeJson(sqvm, pJson, svError))
 	{
 		sq_newtable(sqvm);
 
-		std::string svError = FormatA("Failed parsing json file: encountered parse error: %s", ex.what());
+		svError = FormatA("Failed parsing json file: encountered parse error: %s", svError.c_str());
 
 		if (bFatalParseErrors)
 		{
@@ -473,18 +471,15 @@ SQRESULT Script_DecodeJSON(HSQUIRRELVM sqvm)
 		return SQRESULT_NOTNULL;
 	}
 
-	CScriptJson::DecodeJson(sqvm, jsObj);
-
 	return SQRESULT_NOTNULL;
 }
 
 SQRESULT Script_EncodeJSON(HSQUIRRELVM sqvm)
 {
-	nlohmann::json jsObj;
-	CScriptJson::EncodeJsonTable(sqvm->_stackOfCurrentFunction[1]._VAL.asTable, jsObj);
+	std::string svObj;
+	CScriptJson::EncodeJson(sqvm->_stackOfCurrentFunction[1]._VAL.asTable, svObj);
 
-	std::string svObj = jsObj.dump();
-	sq_pushstring(sqvm, svObj.c_str(), -1);
+	sq_pushstring(sqvm, svObj.c_str(), static_cast<SQInteger>(svObj.size()));
 	return SQRESULT_NOTNULL;
 }
 
@@ -609,7 +604,24 @@ SQRESULT Script_NS_InternalMakeHttpRequest(HSQUIRRELVM sqvm)
 	request.nTimeout = sq_getinteger(sqvm, 7);
 	request.svUserAgent = sq_getstring(sqvm, 8);
 
-	int handle = g_pScriptHttp->MakeHttpRequest(request, (ScriptContext)sqvm->sharedState->cSquirrelVM->vmContext);
+	// Mods go through the wrappers in Northstar.Custom, the one making the request
+	// is the first mod further up the stack that doesn't own the wrapper
+	Mod* pWrapperMod = sq_getcallingmod(sqvm);
+	Mod* pMod = pWrapperMod;
+	for (int depth = 1; depth + 1 < sqvm->_callstacksize; depth++)
+	{
+		Mod* pCaller = sq_getcallingmod(sqvm, depth);
+		if (pCaller && pCaller != pWrapperMod)
+		{
+			pMod = pCaller;
+			break;
+		}
+	}
+
+	std::string svMod = pMod ? pMod->Name : std::string();
+	fs::path saveDir = pMod ? g_svSavePath / fs::path(pMod->m_ModDirectory).filename() : fs::path();
+
+	int handle = g_pScriptHttp->MakeHttpRequest(request, (ScriptContext)sqvm->sharedState->cSquirrelVM->vmContext, svMod, saveDir);
 	sq_pushinteger(sqvm, handle);
 	return SQRESULT_NOTNULL;
 }
@@ -627,727 +639,1430 @@ SQRESULT Script_NSIsLocalHttpAllowed(HSQUIRRELVM sqvm)
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Decodes a json object into a sq table
-// Input  : *sqvm -
-//          &jsObj -
+// Purpose: nlohmann sax handler that pushes values onto the squirrel stack as
+//          they are parsed
+// Note   : Every open container sits on the stack, in objects with the key of
+//          the value being parsed under it. A finished value goes into its
+//          parent with sq_newslot or sq_arrayappend
 //-----------------------------------------------------------------------------
-void CScriptJson::DecodeJson(HSQUIRRELVM sqvm, nlohmann::json& jsObj)
+class CScriptJsonDecoder
 {
-	// FIXME [Fifty]: This is stupid, make the sq func return a var so we dont have to do this
-	if (jsObj.type() == nlohmann::json::value_t::array)
+  public:
+	CScriptJsonDecoder(HSQUIRRELVM sqvm)
+		: m_sqvm(sqvm), m_bHasRoot(false), m_bRootArray(false)
 	{
-		sq_newtable(sqvm);
-		sq_pushstring(sqvm, "RootArray", -1);
-		DecodeArray(sqvm, jsObj);
-		sq_newslot(sqvm, -3, false);
 	}
-	else
+
+	bool null()
 	{
-		DecodeTable(sqvm, jsObj);
+		// Squirrel tables can't hold null, the key is dropped like before
+		return true;
 	}
-}
-
-//-----------------------------------------------------------------------------
-// Purpose: Decodes a json object into a sq table
-// Input  : *sqvm -
-//          &jsObj -
-//-----------------------------------------------------------------------------
-void CScriptJson::DecodeTable(HSQUIRRELVM sqvm, nlohmann::json& jsObj)
-{
-	sq_newtable(sqvm);
 
-	for (auto& js : jsObj.items())
+	bool boolean(bool bValue)
 	{
-		switch (js.value().type())
+		if (BeginValue())
 		{
-		case nlohmann::json::value_t::boolean:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			sq_pushbool(sqvm, js.value().get<bool>());
-			sq_newslot(sqvm, -3, false);
-			break;
-		case nlohmann::json::value_t::string:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			sq_pushstring(sqvm, js.value().get<std::string>().c_str(), -1);
-			sq_newslot(sqvm, -3, false);
-			break;
-		case nlohmann::json::value_t::number_integer:
-		case nlohmann::json::value_t::number_unsigned:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			sq_pushinteger(sqvm, js.value().get<int>());
-			sq_newslot(sqvm, -3, false);
-			break;
-		case nlohmann::json::value_t::number_float:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			sq_pushfloat(sqvm, js.value().get<float>());
-			sq_newslot(sqvm, -3, false);
-			break;
-		case nlohmann::json::value_t::object:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			DecodeTable(sqvm, js.value());
-			sq_newslot(sqvm, -3, false);
-			break;
-		case nlohmann::json::value_t::array:
-			sq_pushstring(sqvm, js.key().c_str(), -1);
-			DecodeArray(sqvm, js.value());
-			sq_newslot(sqvm, -3, false);
-			break;
+			sq_pushbool(m_sqvm, bValue);
+			EndValue();
 		}
+
+		return true;
 	}
-}
 
-//-----------------------------------------------------------------------------
-// Purpose: Decodes a json object into a sq array
-// Input  : *sqvm -
-//          &jsObj -
-//-----------------------------------------------------------------------------
-void CScriptJson::DecodeArray(HSQUIRRELVM sqvm, nlohmann::json& jsObj)
-{
-	sq_newarray(sqvm, 0);
+	bool number_integer(nlohmann::json::number_integer_t nValue)
+	{
+		if (BeginValue())
+		{
+			sq_pushinteger(m_sqvm, static_cast<int>(nValue));
+			EndValue();
+		}
+
+		return true;
+	}
 
-	for (auto& js : jsObj)
+	bool number_unsigned(nlohmann::json::number_unsigned_t nValue)
 	{
-		switch (js.type())
+		if (BeginValue())
 		{
-		case nlohmann::json::value_t::boolean:
-			sq_pushbool(sqvm, js.get<bool>());
-			sq_arrayappend(sqvm, -2);
-			break;
-		case nlohmann::json::value_t::string:
-			sq_pushstring(sqvm, js.get<std::string>().c_str(), -1);
-			sq_arrayappend(sqvm, -2);
-			break;
-		case nlohmann::json::value_t::number_integer:
-		case nlohmann::json::value_t::number_unsigned:
-			sq_pushinteger(sqvm, js.get<int>());
-			sq_arrayappend(sqvm, -2);
-			break;
-		case nlohmann::json::value_t::number_float:
-			sq_pushfloat(sqvm, js.get<float>());
-			sq_arrayappend(sqvm, -2);
-			break;
-		case nlohmann::json::value_t::object:
-			DecodeTable(sqvm, js);
-			sq_arrayappend(sqvm, -2);
-			break;
+			sq_pushinteger(m_sqvm, static_cast<int>(nValue));
+			EndValue();
 		}
+
+		return true;
 	}
-}
 
-//-----------------------------------------------------------------------------
-// Purpose: Encodes json represented as a sq table into a json obj
-// Input  : *pTable -
-//          &jsObj -
-//-----------------------------------------------------------------------------
-void CScriptJson::EncodeJsonTable(SQTable* pTable, nlohmann::json& jsObj)
-{
-	for (int i = 0; i < pTable->_numOfNodes; i++)
+	bool number_float(nlohmann::json::number_float_t flValue, const nlohmann::json::string_t& svString)
 	{
-		SQTable::_HashNode* node = &pTable->_nodes[i];
+		NOTE_UNUSED(svString);
+
+		if (BeginValue())
+		{
+			sq_pushfloat(m_sqvm, static_cast<float>(flValue));
+			EndValue();
+		}
 
-		nlohmann::json jsTable;
-		nlohmann::json jsArray;
+		return true;
+	}
 
-		if (node->key._Type == OT_STRING)
+	bool string(nlohmann::json::string_t& svValue)
+	{
+		if (BeginValue())
 		{
-			switch (node->val._Type)
-			{
-			case OT_STRING:
-				jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, node->val._VAL.asString->_val));
-				break;
-			case OT_INTEGER:
-				jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, node->val._VAL.asInteger));
-				break;
-			case OT_FLOAT:
-				jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, node->val._VAL.asFloat));
-				break;
-			case OT_BOOL:
-				if (node->val._VAL.asInteger)
-					jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, true));
-				else
-					jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, false));
-				break;
-			case OT_TABLE:
-				EncodeJsonTable(node->val._VAL.asTable, jsTable);
-				jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, jsTable));
-				break;
-			case OT_ARRAY:
-				EncodeJsonArray(node->val._VAL.asArray, jsArray);
-				jsObj.push_back(nlohmann::json::object_t::value_type(node->key._VAL.asString->_val, jsArray));
-				break;
-			default:
-				Warning(eLog::NS, "CScriptJson::EncodeJsonTable: squirrel type %s not supported\n", SQ_GetTypeAsString(node->val._Type));
-				break;
-			}
+			sq_pushstring(m_sqvm, svValue.c_str(), static_cast<SQInteger>(svValue.size()));
+			EndValue();
 		}
+
+		return true;
 	}
-}
 
-//-----------------------------------------------------------------------------
-// Purpose: Encodes json represented as a sq array into a json obj
-// Input  : *pArray -
-//          &jsObj -
-//-----------------------------------------------------------------------------
-void CScriptJson::EncodeJsonArray(SQArray* pArray, nlohmann::json& jsObj)
-{
-	for (int i = 0; i < pArray->_usedSlots; i++)
+	bool binary(nlohmann::json::binary_t& binValue)
 	{
-		SQObject* node = &pArray->_values[i];
+		// Only produced by the binary formats
+		NOTE_UNUSED(binValue);
+		return true;
+	}
 
-		nlohmann::json jsTable;
-		nlohmann::json jsArray;
+	bool start_object(size_t nElements)
+	{
+		NOTE_UNUSED(nElements);
 
-		switch (node->_Type)
+		if (!m_bHasRoot)
 		{
-		case OT_STRING:
-			jsObj.push_back(node->_VAL.asString->_val);
-			break;
-		case OT_INTEGER:
-			jsObj.push_back(node->_VAL.asInteger);
-			break;
-		case OT_FLOAT:
-			jsObj.push_back(node->_VAL.asInteger);
-			break;
-		case OT_BOOL:
-			if (node->_VAL.asInteger)
-				jsObj.push_back(true);
-			else
-				jsObj.push_back(false);
-			break;
-		case OT_TABLE:
-			EncodeJsonTable(node->_VAL.asTable, jsTable);
-			jsObj.push_back(jsTable);
-			break;
-		case OT_ARRAY:
-			EncodeJsonArray(node->_VAL.asArray, jsArray);
-			jsObj.push_back(jsArray);
-			break;
-		default:
-			Warning(eLog::NS, "CScriptJson::EncodeJsonArray: squirrel type %s not supported\n", SQ_GetTypeAsString(node->_Type));
+			m_bHasRoot = true;
+			sq_newtable(m_sqvm);
+		}
+		else if (!BeginValue())
+		{
+			return true;
+		}
+		else
+		{
+			sq_newtable(m_sqvm);
 		}
-	}
-}
 
-//-----------------------------------------------------------------------------
-// Purpose:
-//-----------------------------------------------------------------------------
-CScriptHttp::CScriptHttp()
-{
-	m_bIsHttpDisabled = CommandLine()->FindParm("-disablehttprequests");
-	m_bIsLocalHttpAllowed = CommandLine()->FindParm("-allowlocalhttp");
-}
+		m_vIsArray.push_back(false);
+		return true;
+	}
 
-//-----------------------------------------------------------------------------
-// Purpose:
-//-----------------------------------------------------------------------------
-bool CScriptHttp::IsHttpDestinationHostAllowed(const std::string& host, std::string& outHostname, std::string& outAddress, std::string& outPort)
-{
-	CURLU* url = curl_url();
-	if (!url)
+	bool key(nlohmann::json::string_t& svKey)
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to call curl_url() for http request.\n");
-		return false;
+		m_svKey = svKey;
+		return true;
 	}
 
-	if (curl_url_set(url, CURLUPART_URL, host.c_str(), CURLU_DEFAULT_SCHEME) != CURLUE_OK)
+	bool end_object()
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to parse destination URL for http request.\n");
+		m_vIsArray.pop_back();
+		if (!m_vIsArray.empty())
+			EndValue();
 
-		curl_url_cleanup(url);
-		return false;
+		return true;
 	}
 
-	char* urlHostname = nullptr;
-	if (curl_url_get(url, CURLUPART_HOST, &urlHostname, 0) != CURLUE_OK)
+	bool start_array(size_t nElements)
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to parse hostname from destination URL for http request.\n");
+		NOTE_UNUSED(nElements);
 
-		curl_url_cleanup(url);
-		return false;
+		// FIXME [Fifty]: This is stupid, make the sq func return a var so we dont have to do this
+		if (!m_bHasRoot)
+		{
+			m_bHasRoot = true;
+			m_bRootArray = true;
+
+			sq_newtable(m_sqvm);
+			sq_pushstring(m_sqvm, "RootArray", -1);
+		}
+		else if (!BeginValue())
+		{
+			return true;
+		}
+
+		sq_newarray(m_sqvm, 0);
+
+		m_vIsArray.push_back(true);
+		return true;
 	}
 
-	char* urlScheme = nullptr;
-	if (curl_url_get(url, CURLUPART_SCHEME, &urlScheme, CURLU_DEFAULT_SCHEME) != CURLUE_OK)
+	bool end_array()
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to parse scheme from destination URL for http request.\n");
+		m_vIsArray.pop_back();
+		if (!m_vIsArray.empty())
+			EndValue();
+		else if (m_bRootArray)
+			sq_newslot(m_sqvm, -3, false);
 
-		curl_url_cleanup(url);
-		curl_free(urlHostname);
-		return false;
+		return true;
 	}
 
-	char* urlPort = nullptr;
-	if (curl_url_get(url, CURLUPART_PORT, &urlPort, CURLU_DEFAULT_PORT) != CURLUE_OK)
+	bool parse_error(size_t nPosition, const std::string& svLastToken, const nlohmann::detail::exception& ex)
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to parse port from destination URL for http request.\n");
+		NOTE_UNUSED(nPosition);
+		NOTE_UNUSED(svLastToken);
 
-		curl_url_cleanup(url);
-		curl_free(urlHostname);
-		curl_free(urlScheme);
+		m_svError = ex.what();
 		return false;
 	}
 
-	// Resolve the hostname into an address.
-	addrinfo* result;
-	addrinfo hints;
-	std::memset(&hints, 0, sizeof(addrinfo));
-	hints.ai_family = AF_UNSPEC;
-
-	if (getaddrinfo(urlHostname, urlScheme, &hints, &result) != 0)
+	// Json that isn't an object or array gives an empty table
+	bool HasRoot() const
 	{
-		Error(eLog::NS, NO_ERROR, "Failed to resolve http request destination %s using getaddrinfo().\n", urlHostname);
+		return m_bHasRoot;
+	}
 
-		curl_url_cleanup(url);
-		curl_free(urlHostname);
-		curl_free(urlScheme);
-		curl_free(urlPort);
-		return false;
+	const std::string& GetError() const
+	{
+		return m_svError;
 	}
 
-	bool bFoundIPv6 = false;
-	sockaddr_in* sockaddr_ipv4 = nullptr;
-	for (addrinfo* info = result; info; info = info->ai_next)
+  private:
+	//-----------------------------------------------------------------------------
+	// Purpose: Pushes the key if the value goes into an object
+	// Output : false if the value isn't inside a container and should be dropped
+	//-----------------------------------------------------------------------------
+	bool BeginValue()
 	{
-		if (info->ai_family == AF_INET)
-		{
-			sockaddr_ipv4 = (sockaddr_in*)info->ai_addr;
-			break;
-		}
+		if (m_vIsArray.empty())
+			return false;
+
+		if (!m_vIsArray.back())
+			sq_pushstring(m_sqvm, m_svKey.c_str(), static_cast<SQInteger>(m_svKey.size()));
+
+		return true;
+	}
 
-		bFoundIPv6 = bFoundIPv6 || info->ai_family == AF_INET6;
+	//-----------------------------------------------------------------------------
+	// Purpose: Moves the value on top of the stack into its parent
+	//-----------------------------------------------------------------------------
+	void EndValue()
+	{
+		if (m_vIsArray.back())
+			sq_arrayappend(m_sqvm, -2);
+		else
+			sq_newslot(m_sqvm, -3, false);
 	}
 
-	if (sockaddr_ipv4 == nullptr)
+	HSQUIRRELVM m_sqvm;
+
+	std::vector<bool> m_vIsArray;
+	std::string m_svKey;
+	std::string m_svError;
+
+	bool m_bHasRoot;
+	bool m_bRootArray;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Parses json and pushes it as a sq table, a root array ends up in
+//          the table under "RootArray"
+// Input  : *sqvm -
+//          *pszJson -
+//          &svError - Receives the parse error
+// Output : false if the json is invalid, nothing is pushed then
+//-----------------------------------------------------------------------------
+bool CScriptJson::DecodeJson(HSQUIRRELVM sqvm, const char* pszJson, std::string& svError)
+{
+	// The decoder pushes as it goes and we can't pop a partial result, so
+	// make sure the json is valid before touching the vm. Checking doesn't
+	// build anything, only the error path parses again for the message
+	if (!nlohmann::json::accept(pszJson))
 	{
-		if (bFoundIPv6)
+		try
 		{
-			Error(eLog::NS, NO_ERROR, "Only IPv4 destinations are supported for HTTP requests. To allow IPv6, launch the game using -allowlocalhttp.\n");
+			nlohmann::json jsInvalid = nlohmann::json::parse(pszJson);
+			NOTE_UNUSED(jsInvalid);
 		}
-		else
+		catch (const nlohmann::json::parse_error& ex)
 		{
-			Error(eLog::NS, NO_ERROR, "Failed to resolve http request destination %s into a valid IPv4 address.\n", urlHostname);
+			svError = ex.what();
 		}
 
-		curl_free(urlHostname);
-		curl_free(urlScheme);
-		curl_free(urlPort);
-		curl_url_cleanup(url);
-
 		return false;
 	}
 
-	// Fast checks for private ranges of IPv4.
-	// clang-format off
-	{
-		auto addrBytes = sockaddr_ipv4->sin_addr.S_un.S_un_b;
-
-		if (addrBytes.s_b1 == 10														// 10.0.0.0			- 10.255.255.255		(Class A Private)
-			|| addrBytes.s_b1 == 172 && addrBytes.s_b2 >= 16 && addrBytes.s_b2 <= 31	// 172.16.0.0		- 172.31.255.255		(Class B Private)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 == 168							// 192.168.0.0		- 192.168.255.255		(Class C Private)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 == 0 && addrBytes.s_b3 == 0		// 192.0.0.0		- 192.0.0.255			(IETF Assignment)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 == 0 && addrBytes.s_b3 == 2		// 192.0.2.0		- 192.0.2.255			(TEST-NET-1)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 == 88 && addrBytes.s_b3 == 99	// 192.88.99.0		- 192.88.99.255			(IPv4-IPv6 Relay)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 >= 18 &&	addrBytes.s_b2 <= 19	// 192.18.0.0		- 192.19.255.255		(Internet Benchmark)
-			|| addrBytes.s_b1 == 192 && addrBytes.s_b2 == 51 && addrBytes.s_b3 == 100	// 192.51.100.0		- 192.51.100.255		(TEST-NET-2)
-			|| addrBytes.s_b1 == 203 && addrBytes.s_b2 == 0 && addrBytes.s_b3 == 113	// 203.0.113.0		- 203.0.113.255			(TEST-NET-3)
-			|| addrBytes.s_b1 == 169 && addrBytes.s_b2 == 254							// 169.254.00		- 169.254.255.255		(Link-local/APIPA)
-			|| addrBytes.s_b1 == 127													// 127.0.0.0		- 127.255.255.255		(Loopback)
-			|| addrBytes.s_b1 == 0														// 0.0.0.0			- 0.255.255.255			(Current network)
-			|| addrBytes.s_b1 == 100 && addrBytes.s_b2 >= 64 && addrBytes.s_b2 <= 127	// 100.64.0.0		- 100.127.255.255		(Shared address space)
-			|| sockaddr_ipv4->sin_addr.S_un.S_addr == 0xFFFFFFFF						// 255.255.255.255							(Broadcast)
-			|| addrBytes.s_b1 >= 224 && addrBytes.s_b2 <= 239							// 224.0.0.0		- 239.255.255.255		(Multicast)
-			|| addrBytes.s_b1 == 233 && addrBytes.s_b2 == 252 && addrBytes.s_b3 == 0	// 233.252.0.0		- 233.252.0.255			(MCAST-TEST-NET)
-			|| addrBytes.s_b1 >= 240 && addrBytes.s_b4 <= 254)							// 240.0.0.0		- 255.255.255.254		(Future Use Class E)
-		{
-			curl_free(urlHostname);
-			curl_free(urlScheme);
-			curl_free(urlPort);
-			curl_url_cleanup(url);
-
-			return false;
-		}
+	CScriptJsonDecoder decoder(sqvm);
+	if (!nlohmann::json::sax_parse(pszJson, &decoder))
+	{
+		svError = decoder.GetError();
+		return false;
 	}
 
-	// clang-format on
-
-	char resolvedStr[INET_ADDRSTRLEN];
-	inet_ntop(AF_INET, &sockaddr_ipv4->sin_addr, resolvedStr, INET_ADDRSTRLEN);
-
-	// Use the resolved address as the new request host.
-	outHostname = urlHostname;
-	outAddress = resolvedStr;
-	outPort = urlPort;
-
-	freeaddrinfo(result);
-
-	curl_free(urlHostname);
-	curl_free(urlScheme);
-	curl_free(urlPort);
-	curl_url_cleanup(url);
+	if (!decoder.HasRoot())
+		sq_newtable(sqvm);
 
 	return true;
 }
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Encodes json represented as a sq table into json text
+// Input  : *pTable -
+//          &svOut - Text is appended to this
+//          nIndent - Spaces per level, -1 for compact output
 //-----------------------------------------------------------------------------
-int CScriptHttp::MakeHttpRequest(const HttpRequest_t& requestParameters, ScriptContext nContext)
+void CScriptJson::EncodeJson(SQTable* pTable, std::string& svOut, int nIndent)
 {
-	if (IsHttpDisabled())
+	EncodeTable(pTable, svOut, nIndent, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Encodes a sq table as a json object
+// Input  : *pTable -
+//          &svOut -
+//          nIndent -
+//          nDepth -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeTable(SQTable* pTable, std::string& svOut, int nIndent, int nDepth)
+{
+	// Keys are written sorted so output stays stable between runs
+	std::vector<const SQTable::_HashNode*> vNodes;
+	for (int i = 0; i < pTable->_numOfNodes; i++)
 	{
-		Warning(eLog::NS, "NS_InternalMakeHttpRequest called while the game is running with -disablehttprequests."
-						  " Please check if requests are allowed using NSIsHttpEnabled() first.\n");
-		return -1;
+		const SQTable::_HashNode* node = &pTable->_nodes[i];
+		if (node->key._Type == OT_STRING && CanEncode(&node->val, "CScriptJson::EncodeJsonTable"))
+			vNodes.push_back(node);
 	}
 
-	bool bAllowLocalHttp = IsLocalHttpAllowed();
-
-	// This handle will be returned to Squirrel so it can wait for the response and assign a callback for it.
-	int handle = ++m_iLastRequestHandle;
+	if (vNodes.empty())
+	{
+		svOut += "{}";
+		return;
+	}
 
-	std::thread(
-		[this, handle, requestParameters, bAllowLocalHttp, nContext]()
+	std::sort(
+		vNodes.begin(),
+		vNodes.end(),
+		[](const SQTable::_HashNode* a, const SQTable::_HashNode* b)
 		{
-			std::string hostname, resolvedAddress, resolvedPort;
+			return std::string_view(a->key._VAL.asString->_val, a->key._VAL.asString->length) <
+				   std::string_view(b->key._VAL.asString->_val, b->key._VAL.asString->length);
+		});
 
-			if (!bAllowLocalHttp)
-			{
-				if (!IsHttpDestinationHostAllowed(requestParameters.svBaseUrl, hostname, resolvedAddress, resolvedPort))
-				{
-					Warning(eLog::NS, "HttpRequestHandler::MakeHttpRequest attempted to make a request to a private network. This is only allowed when "
-									  "running the game with -allowlocalhttp.\n");
-					g_pTaskScheduler->AddTask(
-						[handle, nContext]()
-						{
-							CSquirrelVM* pVM = nullptr;
-							if (nContext == ScriptContext::SERVER)
-								pVM = g_pServerVM;
-							else if (nContext == ScriptContext::CLIENT)
-								pVM = g_pClientVM;
-							else if (nContext == ScriptContext::UI)
-								pVM = g_pUIVM;
-
-							if (pVM && pVM->GetVM())
-							{
-								HSQUIRRELVM hVM = pVM->GetVM();
-								const char* pszFunction = "NSHandleFailedHttpRequest";
-
-								SQObject oFunction {};
-								int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
-								if (nResult != 0)
-								{
-									Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
-									return;
-								}
-
-								// Push
-								sq_pushobject(hVM, &oFunction);
-								sq_pushroottable(hVM);
-
-								sq_pushinteger(hVM, handle);
-								sq_pushinteger(hVM, 0);
-								sq_pushstring(hVM, "Cannot make HTTP requests to private network hosts without -allowlocalhttp. Check your console for more information.", -1);
-
-								(void)sq_call(hVM, 4, false, false);
-							}
-						});
-					// g_pSquirrel<context>->AsyncCall("NSHandleFailedHttpRequest", handle, (int)0,
-					//								"Cannot make HTTP requests to private network hosts without -allowlocalhttp. Check your console for more "
-					//								"information.");
-					return;
-				}
-			}
+	svOut += '{';
 
-			CURL* curl = curl_easy_init();
-			if (!curl)
-			{
-				Error(eLog::NS, NO_ERROR, "HttpRequestHandler::MakeHttpRequest failed to init libcurl for request.\n");
-				std::string svError = curl_easy_strerror(CURLE_FAILED_INIT);
-				g_pTaskScheduler->AddTask(
-					[handle, svError, nContext]()
-					{
-						CSquirrelVM* pVM = nullptr;
-						if (nContext == ScriptContext::SERVER)
-							pVM = g_pServerVM;
-						else if (nContext == ScriptContext::CLIENT)
-							pVM = g_pClientVM;
-						else if (nContext == ScriptContext::UI)
-							pVM = g_pUIVM;
-
-						if (pVM && pVM->GetVM())
-						{
-							HSQUIRRELVM hVM = pVM->GetVM();
-							const char* pszFunction = "NSHandleFailedHttpRequest";
-
-							SQObject oFunction {};
-							int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
-							if (nResult != 0)
-							{
-								Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
-								return;
-							}
-
-							// Push
-							sq_pushobject(hVM, &oFunction);
-							sq_pushroottable(hVM);
-
-							sq_pushinteger(hVM, handle);
-							sq_pushinteger(hVM, static_cast<int>(CURLE_FAILED_INIT));
-							sq_pushstring(hVM, svError.c_str(), -1);
-
-							(void)sq_call(hVM, 4, false, false);
-						}
-					});
-				// g_pSquirrel<context>->AsyncCall("NSHandleFailedHttpRequest", handle, static_cast<int>(CURLE_FAILED_INIT), curl_easy_strerror(CURLE_FAILED_INIT));
-				return;
-			}
+	for (size_t i = 0; i < vNodes.size(); i++)
+	{
+		if (i)
+			svOut += ',';
 
-			// HEAD has no body.
-			if (requestParameters.eMethod == HTTP_HEAD)
-			{
-				curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-			}
+		EncodeNewLine(svOut, nIndent, nDepth + 1);
+		EncodeString(vNodes[i]->key._VAL.asString, svOut);
+		svOut += nIndent >= 0 ? ": " : ":";
+		EncodeValue(&vNodes[i]->val, svOut, nIndent, nDepth + 1);
+	}
 
-			curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, ToString(requestParameters.eMethod).c_str());
+	EncodeNewLine(svOut, nIndent, nDepth);
+	svOut += '}';
+}
 
-			// Only resolve to IPv4 if we don't allow private network requests.
-			curl_slist* host = nullptr;
-			if (!bAllowLocalHttp)
-			{
-				curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
-				host = curl_slist_append(host, FormatA("%s:%s:%s", hostname.c_str(), resolvedPort.c_str(), resolvedAddress.c_str()).c_str());
-				curl_easy_setopt(curl, CURLOPT_RESOLVE, host);
-			}
+//-----------------------------------------------------------------------------
+// Purpose: Encodes a sq array as a json array
+// Input  : *pArray -
+//          &svOut -
+//          nIndent -
+//          nDepth -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeArray(SQArray* pArray, std::string& svOut, int nIndent, int nDepth)
+{
+	bool bEmpty = true;
+	svOut += '[';
 
-			// Ensure we only allow HTTP or HTTPS.
-			curl_easy_setopt(curl, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+	for (int i = 0; i < pArray->_usedSlots; i++)
+	{
+		const SQObject* node = &pArray->_values[i];
+		if (!CanEncode(node, "CScriptJson::EncodeJsonArray"))
+			continue;
 
-			// Allow redirects
-			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-			curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
+		if (!bEmpty)
+			svOut += ',';
 
-			// Check if the url already contains a query.
-			// If so, we'll know to append with & instead of start with ?
-			std::string queryUrl = requestParameters.svBaseUrl;
-			bool bUrlContainsQuery = false;
+		bEmpty = false;
 
-			// If this fails, just ignore the parsing and trust what the user wants to query.
-			// Probably will fail but handling it here would be annoying.
-			CURLU* curlUrl = curl_url();
-			if (curlUrl)
-			{
-				if (curl_url_set(curlUrl, CURLUPART_URL, queryUrl.c_str(), CURLU_DEFAULT_SCHEME) == CURLUE_OK)
-				{
-					char* currentQuery;
-					if (curl_url_get(curlUrl, CURLUPART_QUERY, &currentQuery, 0) == CURLUE_OK)
-					{
-						if (currentQuery && std::strlen(currentQuery) != 0)
-						{
-							bUrlContainsQuery = true;
-						}
-					}
-
-					curl_free(currentQuery);
-				}
+		EncodeNewLine(svOut, nIndent, nDepth + 1);
+		EncodeValue(node, svOut, nIndent, nDepth + 1);
+	}
 
-				curl_url_cleanup(curlUrl);
-			}
+	if (!bEmpty)
+		EncodeNewLine(svOut, nIndent, nDepth);
 
-			// GET requests, or POST-like requests with an empty body, can have query parameters.
-			// Append them to the base url.
-			if (CanHaveQueryParameters(requestParameters.eMethod) && !UsesCurlPostOptions(requestParameters.eMethod) || requestParameters.svBody.empty())
-			{
-				bool isFirstValue = true;
-				for (const auto& kv : requestParameters.mpQueryParameters)
-				{
-					char* key = curl_easy_escape(curl, kv.first.c_str(), kv.first.length());
-
-					for (const std::string& queryValue : kv.second)
-					{
-						char* value = curl_easy_escape(curl, queryValue.c_str(), queryValue.length());
-
-						if (isFirstValue && !bUrlContainsQuery)
-						{
-							queryUrl.append(FormatA("?%s=%s", key, value));
-							isFirstValue = false;
-						}
-						else
-						{
-							queryUrl.append(FormatA("&%s=%s", key, value));
-						}
-
-						curl_free(value);
-					}
-
-					curl_free(key);
-				}
-			}
+	svOut += ']';
+}
 
-			// If this method uses POST-like curl options, set those and set the body.
-			// The body won't be sent if it's empty anyway, meaning the query parameters above, if any, would be.
-			if (UsesCurlPostOptions(requestParameters.eMethod))
-			{
-				// Grab the body and set it as a POST field
-				curl_easy_setopt(curl, CURLOPT_POST, 1L);
+//-----------------------------------------------------------------------------
+// Purpose: Encodes a value CanEncode accepted
+// Input  : *pObject -
+//          &svOut -
+//          nIndent -
+//          nDepth -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeValue(const SQObject* pObject, std::string& svOut, int nIndent, int nDepth)
+{
+	switch (pObject->_Type)
+	{
+	case OT_STRING:
+		EncodeString(pObject->_VAL.asString, svOut);
+		break;
+	case OT_INTEGER:
+	{
+		char szValue[16];
+		std::to_chars_result result = std::to_chars(szValue, szValue + sizeof(szValue), pObject->_VAL.asInteger);
+		svOut.append(szValue, result.ptr);
+		break;
+	}
+	case OT_FLOAT:
+		EncodeFloat(pObject->_VAL.asFloat, svOut);
+		break;
+	case OT_BOOL:
+		svOut += pObject->_VAL.asInteger ? "true" : "false";
+		break;
+	case OT_TABLE:
+		EncodeTable(pObject->_VAL.asTable, svOut, nIndent, nDepth);
+		break;
+	case OT_ARRAY:
+		EncodeArray(pObject->_VAL.asArray, svOut, nIndent, nDepth);
+		break;
+	default:
+		break;
+	}
+}
 
-				curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, requestParameters.svBody.length());
-				curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, requestParameters.svBody.c_str());
-			}
+//-----------------------------------------------------------------------------
+// Purpose: Encodes a string with quotes, escaping what json requires
+// Note   : Invalid UTF-8 is replaced with U+FFFD, the parser would reject the
+//          whole document otherwise
+// Input  : *pString -
+//          &svOut -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeString(const SQString* pString, std::string& svOut)
+{
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(pString->_val);
+	const uint8_t* pEnd = p + pString->length;
 
-			// Set the full URL for this http request.
-			curl_easy_setopt(curl, CURLOPT_URL, queryUrl.c_str());
+	svOut += '"';
 
-			std::string bodyBuffer;
-			std::string headerBuffer;
-
-			// Set up buffers to write the response headers and body.
-			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CURLWriteStringCallback);
-			curl_easy_setopt(curl, CURLOPT_WRITEDATA, &bodyBuffer);
-			curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, CURLWriteStringCallback);
-			curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headerBuffer);
+	while (p < pEnd)
+	{
+		// Copy runs of plain ascii in one go
+		const uint8_t* pRun = p;
+		while (p < pEnd && *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\')
+			p++;
 
-			// Add all the headers for the request.
-			curl_slist* headers = nullptr;
+		svOut.append(reinterpret_cast<const char*>(pRun), p - pRun);
+		if (p == pEnd)
+			break;
 
-			// Content-Type header for POST-like requests.
-			if (UsesCurlPostOptions(requestParameters.eMethod) && !requestParameters.svBody.empty())
+		uint8_t c = *p;
+		if (c < 0x80)
+		{
+			switch (c)
+			{
+			case '"':
+				svOut += "\\\"";
+				break;
+			case '\\':
+				svOut += "\\\\";
+				break;
+			case '\b':
+				svOut += "\\b";
+				break;
+			case '\f':
+				svOut += "\\f";
+				break;
+			case '\n':
+				svOut += "\\n";
+				break;
+			case '\r':
+				svOut += "\\r";
+				break;
+			case '\t':
+				svOut += "\\t";
+				break;
+			default:
 			{
-				headers = curl_slist_append(headers, FormatA("Content-Type: %s", requestParameters.svContentType.c_str()).c_str());
+				static const char szHex[] = "0123456789abcdef";
+				char szEscape[] = {'\\', 'u', '0', '0', szHex[c >> 4], szHex[c & 0xF]};
+				svOut.append(szEscape, sizeof(szEscape));
+				break;
 			}
+			}
+
+			p++;
+			continue;
+		}
+
+		// Work out the sequence length and the range of its second byte,
+		// which rules out overlong forms and surrogates
+		size_t nLength = 0;
+		uint8_t nLow = 0x80;
+		uint8_t nHigh = 0xBF;
+
+		if (c >= 0xC2 && c <= 0xDF)
+			nLength = 2;
+		else if (c >= 0xE0 && c <= 0xEF)
+		{
+			nLength = 3;
+			if (c == 0xE0)
+				nLow = 0xA0;
+			else if (c == 0xED)
+				nHigh = 0x9F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4)
+		{
+			nLength = 4;
+			if (c == 0xF0)
+				nLow = 0x90;
+			else if (c == 0xF4)
+				nHigh = 0x8F;
+		}
+
+		bool bValid = nLength && static_cast<size_t>(pEnd - p) >= nLength && p[1] >= nLow && p[1] <= nHigh;
+		for (size_t i = 2; bValid && i < nLength; i++)
+			bValid = p[i] >= 0x80 && p[i] <= 0xBF;
+
+		if (bValid)
+		{
+			svOut.append(reinterpret_cast<const char*>(p), nLength);
+			p += nLength;
+		}
+		else
+		{
+			svOut += "\xEF\xBF\xBD";
+			p++;
+		}
+	}
+
+	svOut += '"';
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Encodes a float with the fewest digits that read back the same
+// Input  : flValue -
+//          &svOut -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeFloat(float flValue, std::string& svOut)
+{
+	// Json has no inf or nan
+	if (!std::isfinite(flValue))
+	{
+		svOut += "null";
+		return;
+	}
+
+	char szValue[32];
+	std::to_chars_result result = std::to_chars(szValue, szValue + sizeof(szValue), flValue);
+	svOut.append(szValue, result.ptr);
+
+	// Keep it a float when it's decoded again
+	if (std::find_if(szValue, result.ptr, [](char c) { return c == '.' || c == 'e'; }) == result.ptr)
+		svOut += ".0";
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a new line in indented output
+// Input  : &svOut -
+//          nIndent -
+//          nDepth -
+//-----------------------------------------------------------------------------
+void CScriptJson::EncodeNewLine(std::string& svOut, int nIndent, int nDepth)
+{
+	if (nIndent < 0)
+		return;
+
+	svOut += '\n';
+	svOut.append(static_cast<size_t>(nIndent) * nDepth, ' ');
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if a value can be written as json, warns if it can't
+// Input  : *pObject -
+//          *pszCaller -
+//-----------------------------------------------------------------------------
+bool CScriptJson::CanEncode(const SQObject* pObject, const char* pszCaller)
+{
+	switch (pObject->_Type)
+	{
+	case OT_STRING:
+	case OT_INTEGER:
+	case OT_FLOAT:
+	case OT_BOOL:
+	case OT_TABLE:
+	case OT_ARRAY:
+		return true;
+	default:
+		Warning(eLog::NS, "%s: squirrel type %s not supported\n", pszCaller, SQ_GetTypeAsString(pObject->_Type));
+		return false;
+	}
+}
+
+// clang-format off
+// Destinations scripts can't reach without -allowlocalhttp
+static const char* s_pszBlockedHttpRanges[] =
+{
+	"0.0.0.0/8",			// Current network
+	"10.0.0.0/8",			// Class A Private
+	"100.64.0.0/10",		// Shared address space
+	"127.0.0.0/8",			// Loopback
+	"169.254.0.0/16",		// Link-local/APIPA
+	"172.16.0.0/12",		// Class B Private
+	"192.0.0.0/24",			// IETF Assignment
+	"192.0.2.0/24",			// TEST-NET-1
+	"192.88.99.0/24",		// IPv4-IPv6 Relay
+	"192.168.0.0/16",		// Class C Private
+	"198.18.0.0/15",		// Internet Benchmark
+	"198.51.100.0/24",		// TEST-NET-2
+	"203.0.113.0/24",		// TEST-NET-3
+	"224.0.0.0/4",			// Multicast, includes MCAST-TEST-NET
+	"240.0.0.0/4",			// Future Use Class E, includes broadcast
+
+	"::/128",				// Unspecified
+	"::1/128",				// Loopback
+	"64:ff9b::/96",			// NAT64, can wrap any IPv4 address
+	"64:ff9b:1::/48",		// Local-use IPv4/IPv6 translation
+	"100::/64",				// Discard-only
+	"2001::/23",			// IETF protocol assignments, includes Teredo
+	"2001:db8::/32",		// Documentation
+	"2002::/16",			// 6to4, can wrap any IPv4 address
+	"3fff::/20",			// Documentation
+	"fc00::/7",				// Unique local
+	"fe80::/10",			// Link-local
+	"fec0::/10",			// Site-local
+	"ff00::/8",				// Multicast
+};
+// clang-format on
+
+// How long resolved destinations are trusted for, getaddrinfo doesn't give us the record's TTL
+constexpr double HTTP_RESOLVE_TTL = 60.0;
+constexpr double HTTP_RESOLVE_FAILED_TTL = 5.0;
+constexpr size_t HTTP_RESOLVE_MAX_ENTRIES = 1024;
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CScriptHttp::CScriptHttp()
+{
+	m_bIsHttpDisabled = CommandLine()->FindParm("-disablehttprequests");
+	m_bIsLocalHttpAllowed = CommandLine()->FindParm("-allowlocalhttp");
+
+	for (const char* pszRange : s_pszBlockedHttpRanges)
+	{
+		if (!m_BlockedRanges.Insert(pszRange))
+			Error(eLog::NS, NO_ERROR, "Failed to parse blocked http range %s\n", pszRange);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks an address against the blocked ranges
+// Input  : *pAddress - sockaddr_in or sockaddr_in6
+//-----------------------------------------------------------------------------
+bool CScriptHttp::IsAddressAllowed(const sockaddr* pAddress) const
+{
+	uint8_t address[16];
+
+	if (pAddress->sa_family == AF_INET)
+	{
+		static const uint8_t V4_MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+		memcpy(address, V4_MAPPED_PREFIX, sizeof(V4_MAPPED_PREFIX));
+		memcpy(address + 12, &reinterpret_cast<const sockaddr_in*>(pAddress)->sin_addr, 4);
+	}
+	else if (pAddress->sa_family == AF_INET6)
+	{
+		memcpy(address, &reinterpret_cast<const sockaddr_in6*>(pAddress)->sin6_addr, 16);
+	}
+	else
+	{
+		return false;
+	}
+
+	return !m_BlockedRanges.Contains(address);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Curl opens every socket through this when local http isn't
+//          allowed, catches redirects to other hosts and anything that
+//          resolves differently than it did when we checked it
+//-----------------------------------------------------------------------------
+static curl_socket_t HttpOpenSocket(void* pUserData, curlsocktype purpose, curl_sockaddr* pAddress)
+{
+	NOTE_UNUSED(purpose);
+
+	CScriptHttp* pScriptHttp = static_cast<CScriptHttp*>(pUserData);
+	if (!pScriptHttp->IsAddressAllowed(&pAddress->addr))
+	{
+		Warning(eLog::NS, "Blocked http connection to a private network address.\n");
+		return CURL_SOCKET_BAD;
+	}
+
+	return socket(pAddress->family, pAddress->socktype, pAddress->protocol);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Resolves a request's destination and checks it isn't on a private
+//          network
+// Input  : &host - Url of the request
+//          &outHostname -
+//          &outAddress - Address to pin the connection to, IPv6 in brackets
+//          &outPort -
+// Note   : Results are cached for HTTP_RESOLVE_TTL so scripts polling the
+//          same host don't block a worker in getaddrinfo every time
+//-----------------------------------------------------------------------------
+bool CScriptHttp::IsHttpDestinationHostAllowed(const std::string& host, std::string& outHostname, std::string& outAddress, std::string& outPort)
+{
+	CURLU* url = curl_url();
+	if (!url)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to call curl_url() for http request.\n");
+		return false;
+	}
+
+	if (curl_url_set(url, CURLUPART_URL, host.c_str(), CURLU_DEFAULT_SCHEME) != CURLUE_OK)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to parse destination URL for http request.\n");
+
+		curl_url_cleanup(url);
+		return false;
+	}
+
+	char* urlHostname = nullptr;
+	if (curl_url_get(url, CURLUPART_HOST, &urlHostname, 0) != CURLUE_OK)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to parse hostname from destination URL for http request.\n");
+
+		curl_url_cleanup(url);
+		return false;
+	}
+
+	char* urlScheme = nullptr;
+	if (curl_url_get(url, CURLUPART_SCHEME, &urlScheme, CURLU_DEFAULT_SCHEME) != CURLUE_OK)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to parse scheme from destination URL for http request.\n");
+
+		curl_url_cleanup(url);
+		curl_free(urlHostname);
+		return false;
+	}
+
+	char* urlPort = nullptr;
+	if (curl_url_get(url, CURLUPART_PORT, &urlPort, CURLU_DEFAULT_PORT) != CURLUE_OK)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to parse port from destination URL for http request.\n");
+
+		curl_url_cleanup(url);
+		curl_free(urlHostname);
+		curl_free(urlScheme);
+		return false;
+	}
+
+	outHostname = urlHostname;
+	outPort = urlPort;
+
+	// curl gives IPv6 literals back in brackets, getaddrinfo wants them without
+	std::string svLookupHost = outHostname;
+	if (svLookupHost.size() > 2 && svLookupHost.front() == '[' && svLookupHost.back() == ']')
+		svLookupHost = svLookupHost.substr(1, svLookupHost.size() - 2);
+
+	std::string svCacheKey = svLookupHost + '\n' + urlScheme;
+	ResolvedHost_t resolved;
+
+	bool bCached = false;
+	{
+		std::lock_guard<std::mutex> lock(m_ResolverMutex);
+
+		auto it = m_mapResolved.find(svCacheKey);
+		if (it != m_mapResolved.end() && it->second.flExpires > Plat_FloatTime())
+		{
+			resolved = it->second;
+			bCached = true;
+		}
+	}
+
+	if (!bCached)
+	{
+		resolved = ResolveHost(svLookupHost.c_str(), urlScheme);
+
+		std::lock_guard<std::mutex> lock(m_ResolverMutex);
+
+		// Scripts can make up as many hostnames as they like, don't let that grow forever
+		if (m_mapResolved.size() >= HTTP_RESOLVE_MAX_ENTRIES)
+		{
+			double flTime = Plat_FloatTime();
+			for (auto it = m_mapResolved.begin(); it != m_mapResolved.end();)
+				it = it->second.flExpires <= flTime ? m_mapResolved.erase(it) : std::next(it);
+
+			if (m_mapResolved.size() >= HTTP_RESOLVE_MAX_ENTRIES)
+				m_mapResolved.clear();
+		}
+
+		m_mapResolved[svCacheKey] = resolved;
+	}
+
+	curl_free(urlHostname);
+	curl_free(urlScheme);
+	curl_free(urlPort);
+	curl_url_cleanup(url);
+
+	if (!resolved.bResolved)
+	{
+		Error(eLog::NS, NO_ERROR, "Failed to resolve http request destination %s using getaddrinfo().\n", outHostname.c_str());
+		return false;
+	}
+
+	if (!resolved.bAllowed)
+		return false;
+
+	// Use the resolved address as the new request host.
+	outAddress = resolved.svAddress;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks a hostname up and checks the address we'd connect to
+// Input  : *pszHostname -
+//          *pszScheme -
+//-----------------------------------------------------------------------------
+CScriptHttp::ResolvedHost_t CScriptHttp::ResolveHost(const char* pszHostname, const char* pszScheme) const
+{
+	ResolvedHost_t resolved {Plat_FloatTime() + HTTP_RESOLVE_FAILED_TTL, false, false, ""};
+
+	addrinfo* result;
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(addrinfo));
+	hints.ai_family = AF_UNSPEC;
+
+	if (getaddrinfo(pszHostname, pszScheme, &hints, &result) != 0)
+		return resolved;
 
-			for (const auto& kv : requestParameters.mpHeaders)
+	// Prefer IPv4 like curl would with CURL_IPRESOLVE_V4
+	const addrinfo* pAddress = nullptr;
+	for (const addrinfo* info = result; info; info = info->ai_next)
+	{
+		if (info->ai_family == AF_INET)
+		{
+			pAddress = info;
+			break;
+		}
+
+		if (!pAddress && info->ai_family == AF_INET6)
+			pAddress = info;
+	}
+
+	if (pAddress)
+	{
+		char resolvedStr[INET6_ADDRSTRLEN];
+		if (pAddress->ai_family == AF_INET)
+		{
+			inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(pAddress->ai_addr)->sin_addr, resolvedStr, sizeof(resolvedStr));
+			resolved.svAddress = resolvedStr;
+		}
+		else
+		{
+			inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(pAddress->ai_addr)->sin6_addr, resolvedStr, sizeof(resolvedStr));
+			resolved.svAddress = FormatA("[%s]", resolvedStr);
+		}
+
+		resolved.bResolved = true;
+		resolved.bAllowed = IsAddressAllowed(pAddress->ai_addr);
+		resolved.flExpires = Plat_FloatTime() + HTTP_RESOLVE_TTL;
+	}
+
+	freeaddrinfo(result);
+	return resolved;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands a http response to script
+// Input  : handle -
+//          nContext -
+//          httpCode -
+//          &svBody -
+//          &svHeaders -
+//-----------------------------------------------------------------------------
+static void QueueHttpRequestSuccess(int handle, ScriptContext nContext, long httpCode, const std::string& svBody, const std::string& svHeaders)
+{
+	g_pTaskScheduler->AddTask(
+		[handle, httpCode, svBody, svHeaders, nContext]()
+		{
+			CSquirrelVM* pVM = nullptr;
+			if (nContext == ScriptContext::SERVER)
+				pVM = g_pServerVM;
+			else if (nContext == ScriptContext::CLIENT)
+				pVM = g_pClientVM;
+			else if (nContext == ScriptContext::UI)
+				pVM = g_pUIVM;
+
+			if (pVM && pVM->GetVM())
 			{
-				for (const std::string& headerValue : kv.second)
+				HSQUIRRELVM hVM = pVM->GetVM();
+				const char* pszFunction = "NSHandleSuccessfulHttpRequest";
+
+				SQObject oFunction {};
+				int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
+				if (nResult != 0)
 				{
-					headers = curl_slist_append(headers, FormatA("%s: %s", kv.first.c_str(), headerValue.c_str()).c_str());
+					Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
+					return;
 				}
+
+				// Push
+				sq_pushobject(hVM, &oFunction);
+				sq_pushroottable(hVM);
+
+				sq_pushinteger(hVM, handle);
+				sq_pushinteger(hVM, static_cast<int>(httpCode));
+				sq_pushstring(hVM, svBody.c_str(), -1);
+				sq_pushstring(hVM, svHeaders.c_str(), -1);
+
+				(void)sq_call(hVM, 5, false, false);
 			}
+		});
+	// g_pSquirrel<context>->AsyncCall("NSHandleSuccessfulHttpRequest", handle, static_cast<int>(httpCode), bodyBuffer, headerBuffer);
+}
 
-			if (headers != nullptr)
+//-----------------------------------------------------------------------------
+// Purpose: Tells script a http request failed
+// Input  : handle -
+//          nContext -
+//          nErrorCode - CURLcode, 0 if the request never got that far
+//          &svError -
+//-----------------------------------------------------------------------------
+static void QueueHttpRequestFailure(int handle, ScriptContext nContext, int nErrorCode, const std::string& svError)
+{
+	g_pTaskScheduler->AddTask(
+		[handle, nErrorCode, svError, nContext]()
+		{
+			CSquirrelVM* pVM = nullptr;
+			if (nContext == ScriptContext::SERVER)
+				pVM = g_pServerVM;
+			else if (nContext == ScriptContext::CLIENT)
+				pVM = g_pClientVM;
+			else if (nContext == ScriptContext::UI)
+				pVM = g_pUIVM;
+
+			if (pVM && pVM->GetVM())
 			{
-				curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+				HSQUIRRELVM hVM = pVM->GetVM();
+				const char* pszFunction = "NSHandleFailedHttpRequest";
+
+				SQObject oFunction {};
+				int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
+				if (nResult != 0)
+				{
+					Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
+					return;
+				}
+
+				// Push
+				sq_pushobject(hVM, &oFunction);
+				sq_pushroottable(hVM);
+
+				sq_pushinteger(hVM, handle);
+				sq_pushinteger(hVM, nErrorCode);
+				sq_pushstring(hVM, svError.c_str(), -1);
+
+				(void)sq_call(hVM, 4, false, false);
 			}
+		});
+	// g_pSquirrel<context>->AsyncCall("NSHandleFailedHttpRequest", handle, nErrorCode, svError);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the key a request is cached and deduplicated under
+// Input  : &requestParameters -
+// Output : Empty if the request mustn't go through the cache
+//-----------------------------------------------------------------------------
+std::string CScriptHttp::GetCacheKey(const HttpRequest_t& requestParameters)
+{
+	if (requestParameters.eMethod != HTTP_GET)
+		return std::string();
+
+	// Sort so the same request always gives the same key, unordered_map order isn't stable
+	std::vector<std::pair<std::string, std::string>> vHeaders;
+	for (const auto& kv : requestParameters.mpHeaders)
+	{
+		std::string svName = kv.first;
+		std::transform(svName.begin(), svName.end(), svName.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		// Script is doing its own caching, stay out of its way
+		if (svName == "cache-control" || svName == "pragma" || svName == "if-none-match" || svName == "if-modified-since" || svName == "range")
+			return std::string();
+
+		for (const std::string& headerValue : kv.second)
+			vHeaders.emplace_back(svName, headerValue);
+	}
+
+	std::vector<std::pair<std::string, std::string>> vQuery;
+	for (const auto& kv : requestParameters.mpQueryParameters)
+	{
+		for (const std::string& queryValue : kv.second)
+			vQuery.emplace_back(kv.first, queryValue);
+	}
+
+	std::sort(vHeaders.begin(), vHeaders.end());
+	std::sort(vQuery.begin(), vQuery.end());
+
+	// Length prefix everything so values can't run into each other
+	std::string svKey;
+	auto Append = [&svKey](const std::string& svValue)
+	{
+		svKey += std::to_string(svValue.size());
+		svKey += ':';
+		svKey += svValue;
+	};
+
+	Append(requestParameters.svBaseUrl);
+	Append(requestParameters.svUserAgent);
+
+	for (const auto& [svName, svValue] : vQuery)
+	{
+		Append(svName);
+		Append(svValue);
+	}
+
+	svKey += '|';
+	for (const auto& [svName, svValue] : vHeaders)
+	{
+		Append(svName);
+		Append(svValue);
+	}
+
+	return svKey;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a script http request
+// Input  : &requestParameters -
+//          nContext -
+//          &svMod - Mod making the request, per mod limits are counted against it
+//          &saveDir - Save folder of that mod, the disk cache goes in there
+// Output : Handle script waits on, -1 if the request was dropped
+//-----------------------------------------------------------------------------
+int CScriptHttp::MakeHttpRequest(const HttpRequest_t& requestParameters, ScriptContext nContext, const std::string& svMod, const fs::path& saveDir)
+{
+	if (IsHttpDisabled())
+	{
+		Warning(eLog::NS, "NS_InternalMakeHttpRequest called while the game is running with -disablehttprequests."
+						  " Please check if requests are allowed using NSIsHttpEnabled() first.\n");
+		return -1;
+	}
+
+	// This handle will be returned to Squirrel so it can wait for the response and assign a callback for it.
+	int handle = ++m_iLastRequestHandle;
+
+	// GETs for the same thing can be answered from the cache or share a transfer that's already running
+	std::string svCacheKey = GetCacheKey(requestParameters);
+	if (!svCacheKey.empty())
+	{
+		if (CachedHttpResponsePtr pCached = m_Cache.GetFresh(svCacheKey, Plat_FloatTime()))
+		{
+			QueueHttpRequestSuccess(handle, nContext, 200, pCached->svBody, pCached->svHeaders);
+			return handle;
+		}
+
+		if (m_Cache.JoinInFlight(svCacheKey, handle, nContext))
+			return handle;
+	}
+
+	auto pRequest = std::make_shared<PendingHttpRequest_t>();
+	pRequest->nHandle = handle;
+	pRequest->nContext = nContext;
+	pRequest->request = requestParameters;
+	pRequest->bAllowLocalHttp = IsLocalHttpAllowed();
+	pRequest->svCacheKey = svCacheKey;
+	pRequest->svMod = svMod;
+	pRequest->saveDir = saveDir;
+	pRequest->flBandwidth = std::max(0.0f, Cvar_ns_http_mod_bandwidth->GetFloat()) * 1024.0;
+
+	// Responses to requests carrying credentials stay out of files the mod can read
+	bool bCredentials = std::any_of(requestParameters.mpHeaders.begin(), requestParameters.mpHeaders.end(),
+									[](const auto& kv) { return !_stricmp(kv.first.c_str(), "Authorization") || !_stricmp(kv.first.c_str(), "Cookie"); });
+
+	if (!svCacheKey.empty() && !saveDir.empty() && !bCredentials && Cvar_ns_http_cache_disk->GetBool())
+		pRequest->diskDir = saveDir / CScriptHttpCache::DISK_FOLDER;
+
+	auto fnFailWaiters = [this, &svCacheKey](const char* pszError)
+	{
+		if (!svCacheKey.empty())
+		{
+			for (const HttpWaiter_t& waiter : m_Cache.FinishInFlight(svCacheKey))
+				QueueHttpRequestFailure(waiter.nHandle, waiter.nContext, 0, pszError);
+		}
+	};
+
+	// A queued request only starts once one of the mod's transfers finishes
+	eHttpSlot eSlot = m_ModLimiter.Acquire(svMod, Cvar_ns_http_mod_max_requests->GetInt(),
+		[this, pRequest]()
+		{
+			if (SubmitHttpRequest(pRequest))
+				return;
 
-			// Disable SSL checks if requested by the user.
-			if (false) // TODO: make this a cvar
+			QueueHttpRequestFailure(pRequest->nHandle, pRequest->nContext, 0, "Too many http requests are pending.");
+			if (!pRequest->svCacheKey.empty())
 			{
-				curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-				curl_easy_setopt(curl, CURLOPT_SSL_VERIFYSTATUS, 0L);
+				for (const HttpWaiter_t& waiter : m_Cache.FinishInFlight(pRequest->svCacheKey))
+					QueueHttpRequestFailure(waiter.nHandle, waiter.nContext, 0, "Too many http requests are pending.");
 			}
 
-			// Enforce the Northstar user agent, unless an override was specified.
-			if (requestParameters.svUserAgent.empty())
+			FinishHttpRequest(pRequest->svMod);
+		});
+
+	if (eSlot == eHttpSlot::FULL)
+	{
+		fnFailWaiters("Too many http requests are pending for this mod.");
+
+		Warning(eLog::NS, "NS_InternalMakeHttpRequest called while mod '%s' has too many requests pending, request was dropped.\n", svMod.c_str());
+		return -1;
+	}
+
+	if (eSlot == eHttpSlot::START && !SubmitHttpRequest(pRequest))
+	{
+		fnFailWaiters("Too many http requests are pending.");
+		FinishHttpRequest(svMod);
+
+		Warning(eLog::NS, "NS_InternalMakeHttpRequest called while too many requests are pending, request was dropped.\n");
+		return -1;
+	}
+
+	return handle;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a request that holds one of its mod's slots on the job system
+// Input  : pRequest -
+// Output : false if the job queue is full, the slot is still held
+//-----------------------------------------------------------------------------
+bool CScriptHttp::SubmitHttpRequest(std::shared_ptr<PendingHttpRequest_t> pRequest)
+{
+	return g_pJobSystem->Submit(eJobQueue::SCRIPT_HTTP,
+		[this, pRequest]()
+		{
+			RunHttpRequest(*pRequest);
+			FinishHttpRequest(pRequest->svMod);
+		});
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gives up a mod's slot, starting its next queued request if it has one
+// Input  : &svMod -
+//-----------------------------------------------------------------------------
+void CScriptHttp::FinishHttpRequest(const std::string& svMod)
+{
+	if (std::function<void()> fnNext = m_ModLimiter.Release(svMod))
+		fnNext();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Waits until the mod's bandwidth allows for bytes it just moved
+// Input  : &pending -
+//          nBytes -
+//-----------------------------------------------------------------------------
+void CScriptHttp::ThrottleHttpRequest(const PendingHttpRequest_t& pending, size_t nBytes)
+{
+	double flWait = m_ModLimiter.Consume(pending.svMod, nBytes, Plat_FloatTime(), pending.flBandwidth);
+
+	// Nothing takes longer than the max timeout, curl gives up after that anyway
+	if (flWait > 0.0)
+		std::this_thread::sleep_for(std::chrono::duration<double>(std::min(flWait, 60.0)));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: curl write callback that counts what it receives against the mod's bandwidth
+//-----------------------------------------------------------------------------
+size_t CScriptHttp::HttpWriteThrottled(char* contents, size_t size, size_t nmemb, HttpTransferBuffer_t* pTransfer)
+{
+	size_t nBytes = size * nmemb;
+	pTransfer->pBuffer->append(contents, nBytes);
+	pTransfer->pScriptHttp->ThrottleHttpRequest(*pTransfer->pRequest, nBytes);
+
+	return nBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes the transfer for a request, runs on a job thread
+// Input  : &pending -
+//-----------------------------------------------------------------------------
+void CScriptHttp::RunHttpRequest(const PendingHttpRequest_t& pending)
+{
+	const HttpRequest_t& requestParameters = pending.request;
+	const std::string& svCacheKey = pending.svCacheKey;
+	int handle = pending.nHandle;
+	ScriptContext nContext = pending.nContext;
+	bool bAllowLocalHttp = pending.bAllowLocalHttp;
+
+	// Everything that joined this transfer gets the same result
+	auto fnSucceed = [this, handle, nContext, &svCacheKey](long httpCode, const std::string& svBody, const std::string& svHeaders)
+	{
+		QueueHttpRequestSuccess(handle, nContext, httpCode, svBody, svHeaders);
+		if (!svCacheKey.empty())
+		{
+			for (const HttpWaiter_t& waiter : m_Cache.FinishInFlight(svCacheKey))
+				QueueHttpRequestSuccess(waiter.nHandle, waiter.nContext, httpCode, svBody, svHeaders);
+		}
+	};
+
+	auto fnFail = [this, handle, nContext, &svCacheKey](int nErrorCode, const std::string& svError)
+	{
+		QueueHttpRequestFailure(handle, nContext, nErrorCode, svError);
+		if (!svCacheKey.empty())
+		{
+			for (const HttpWaiter_t& waiter : m_Cache.FinishInFlight(svCacheKey))
+				QueueHttpRequestFailure(waiter.nHandle, waiter.nContext, nErrorCode, svError);
+		}
+	};
+
+	// Not in memory, an earlier session may have left it on disk
+	if (!pending.diskDir.empty() && m_Cache.LoadFromDisk(svCacheKey, pending.diskDir, Plat_FloatTime()))
+	{
+		if (CachedHttpResponsePtr pCached = m_Cache.GetFresh(svCacheKey, Plat_FloatTime()))
+		{
+			fnSucceed(200, pCached->svBody, pCached->svHeaders);
+			return;
+		}
+	}
+
+	std::string hostname, resolvedAddress, resolvedPort;
+
+	if (!bAllowLocalHttp)
+	{
+		if (!IsHttpDestinationHostAllowed(requestParameters.svBaseUrl, hostname, resolvedAddress, resolvedPort))
+		{
+			Warning(eLog::NS, "HttpRequestHandler::MakeHttpRequest attempted to make a request to a private network. This is only allowed when "
+							  "running the game with -allowlocalhttp.\n");
+			fnFail(0, "Cannot make HTTP requests to private network hosts without -allowlocalhttp. Check your console for more information.");
+			return;
+		}
+	}
+
+	CURL* curl = curl_easy_init();
+	if (!curl)
+	{
+		Error(eLog::NS, NO_ERROR, "HttpRequestHandler::MakeHttpRequest failed to init libcurl for request.\n");
+		fnFail(static_cast<int>(CURLE_FAILED_INIT), curl_easy_strerror(CURLE_FAILED_INIT));
+		return;
+	}
+
+	// HEAD has no body.
+	if (requestParameters.eMethod == HTTP_HEAD)
+	{
+		curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+	}
+
+	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, ToString(requestParameters.eMethod).c_str());
+
+	// Pin the connection to the address we checked if we don't allow private network requests,
+	// every socket is checked again too so redirects can't reach private hosts either.
+	curl_slist* host = nullptr;
+	if (!bAllowLocalHttp)
+	{
+		curl_easy_setopt(curl, CURLOPT_IPRESOLVE, resolvedAddress.front() == '[' ? CURL_IPRESOLVE_V6 : CURL_IPRESOLVE_V4);
+		host = curl_slist_append(host, FormatA("%s:%s:%s", hostname.c_str(), resolvedPort.c_str(), resolvedAddress.c_str()).c_str());
+		curl_easy_setopt(curl, CURLOPT_RESOLVE, host);
+
+		curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, HttpOpenSocket);
+		curl_easy_setopt(curl, CURLOPT_OPENSOCKETDATA, this);
+	}
+
+	// Ensure we only allow HTTP or HTTPS.
+	curl_easy_setopt(curl, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS);
+
+	// Allow redirects
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
+
+	// Check if the url already contains a query.
+	// If so, we'll know to append with & instead of start with ?
+	std::string queryUrl = requestParameters.svBaseUrl;
+	bool bUrlContainsQuery = false;
+
+	// If this fails, just ignore the parsing and trust what the user wants to query.
+	// Probably will fail but handling it here would be annoying.
+	CURLU* curlUrl = curl_url();
+	if (curlUrl)
+	{
+		if (curl_url_set(curlUrl, CURLUPART_URL, queryUrl.c_str(), CURLU_DEFAULT_SCHEME) == CURLUE_OK)
+		{
+			char* currentQuery;
+			if (curl_url_get(curlUrl, CURLUPART_QUERY, &currentQuery, 0) == CURLUE_OK)
 			{
-				curl_easy_setopt(curl, CURLOPT_USERAGENT, NORTHSTAR_USERAGENT);
+				if (currentQuery && std::strlen(currentQuery) != 0)
+				{
+					bUrlContainsQuery = true;
+				}
 			}
-			else
+
+			curl_free(currentQuery);
+		}
+
+		curl_url_cleanup(curlUrl);
+	}
+
+	// GET requests, or POST-like requests with an empty body, can have query parameters.
+	// Append them to the base url.
+	if (CanHaveQueryParameters(requestParameters.eMethod) && !UsesCurlPostOptions(requestParameters.eMethod) || requestParameters.svBody.empty())
+	{
+		bool isFirstValue = true;
+		for (const auto& kv : requestParameters.mpQueryParameters)
+		{
+			char* key = curl_easy_escape(curl, kv.first.c_str(), kv.first.length());
+
+			for (const std::string& queryValue : kv.second)
 			{
-				curl_easy_setopt(curl, CURLOPT_USERAGENT, requestParameters.svUserAgent.c_str());
+				char* value = curl_easy_escape(curl, queryValue.c_str(), queryValue.length());
+
+				if (isFirstValue && !bUrlContainsQuery)
+				{
+					queryUrl.append(FormatA("?%s=%s", key, value));
+					isFirstValue = false;
+				}
+				else
+				{
+					queryUrl.append(FormatA("&%s=%s", key, value));
+				}
+
+				curl_free(value);
 			}
 
-			// Set the timeout for this request. Max 60 seconds so mods can't just spin up native threads all the time.
-			curl_easy_setopt(curl, CURLOPT_TIMEOUT, std::clamp<long>(requestParameters.nTimeout, 1, 60));
+			curl_free(key);
+		}
+	}
 
-			CURLcode result = curl_easy_perform(curl);
-			if (result == CURLE_OK)
+	// If this method uses POST-like curl options, set those and set the body.
+	// The body won't be sent if it's empty anyway, meaning the query parameters above, if any, would be.
+	if (UsesCurlPostOptions(requestParameters.eMethod))
+	{
+		// Grab the body and set it as a POST field
+		curl_easy_setopt(curl, CURLOPT_POST, 1L);
+
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, requestParameters.svBody.length());
+		curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, requestParameters.svBody.c_str());
+	}
+
+	// Set the full URL for this http request.
+	curl_easy_setopt(curl, CURLOPT_URL, queryUrl.c_str());
+
+	std::string bodyBuffer;
+	std::string headerBuffer;
+
+	// Set up buffers to write the response headers and body, both count against the mod's bandwidth.
+	HttpTransferBuffer_t bodyTransfer {this, &pending, &bodyBuffer};
+	HttpTransferBuffer_t headerTransfer {this, &pending, &headerBuffer};
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpWriteThrottled);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &bodyTransfer);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HttpWriteThrottled);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headerTransfer);
+
+	// Add all the headers for the request.
+	curl_slist* headers = nullptr;
+
+	// Content-Type header for POST-like requests.
+	if (UsesCurlPostOptions(requestParameters.eMethod) && !requestParameters.svBody.empty())
+	{
+		headers = curl_slist_append(headers, FormatA("Content-Type: %s", requestParameters.svContentType.c_str()).c_str());
+	}
+
+	for (const auto& kv : requestParameters.mpHeaders)
+	{
+		for (const std::string& headerValue : kv.second)
+		{
+			headers = curl_slist_append(headers, FormatA("%s: %s", kv.first.c_str(), headerValue.c_str()).c_str());
+		}
+	}
+
+	// We have a stale copy, ask the server if it's still good. Holding on to it
+	// means a 304 can be answered even if the entry gets evicted meanwhile
+	CachedHttpResponsePtr pStale;
+	if (!svCacheKey.empty())
+	{
+		std::string svETag, svLastModified;
+		pStale = m_Cache.GetStale(svCacheKey, svETag, svLastModified);
+		if (pStale)
+		{
+			if (!svETag.empty())
+				headers = curl_slist_append(headers, FormatA("If-None-Match: %s", svETag.c_str()).c_str());
+			if (!svLastModified.empty())
+				headers = curl_slist_append(headers, FormatA("If-Modified-Since: %s", svLastModified.c_str()).c_str());
+		}
+	}
+
+	if (headers != nullptr)
+	{
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	}
+
+	// Disable SSL checks if requested by the user.
+	if (false) // TODO: make this a cvar
+	{
+		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYSTATUS, 0L);
+	}
+
+	// Enforce the Northstar user agent, unless an override was specified.
+	if (requestParameters.svUserAgent.empty())
+	{
+		curl_easy_setopt(curl, CURLOPT_USERAGENT, NORTHSTAR_USERAGENT);
+	}
+	else
+	{
+		curl_easy_setopt(curl, CURLOPT_USERAGENT, requestParameters.svUserAgent.c_str());
+	}
+
+	// Set the timeout for this request. Max 60 seconds so mods can't just spin up native threads all the time.
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, std::clamp<long>(requestParameters.nTimeout, 1, 60));
+
+	// The upload goes out in one go, wait for the bandwidth it takes up front
+	if (UsesCurlPostOptions(requestParameters.eMethod))
+		ThrottleHttpRequest(pending, requestParameters.svBody.size());
+
+	CURLcode result = curl_easy_perform(curl);
+	if (result == CURLE_OK)
+	{
+		// While the curl request is OK, it could return a non success code.
+		// Squirrel side will handle firing the correct callback.
+		long httpCode = 0;
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+
+		if (!svCacheKey.empty())
+		{
+			if (httpCode == 304 && pStale)
 			{
-				// While the curl request is OK, it could return a non success code.
-				// Squirrel side will handle firing the correct callback.
-				long httpCode = 0;
-				curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-				g_pTaskScheduler->AddTask(
-					[handle, httpCode, bodyBuffer, headerBuffer, nContext]()
-					{
-						CSquirrelVM* pVM = nullptr;
-						if (nContext == ScriptContext::SERVER)
-							pVM = g_pServerVM;
-						else if (nContext == ScriptContext::CLIENT)
-							pVM = g_pClientVM;
-						else if (nContext == ScriptContext::UI)
-							pVM = g_pUIVM;
-
-						if (pVM && pVM->GetVM())
-						{
-							HSQUIRRELVM hVM = pVM->GetVM();
-							const char* pszFunction = "NSHandleSuccessfulHttpRequest";
-
-							SQObject oFunction {};
-							int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
-							if (nResult != 0)
-							{
-								Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
-								return;
-							}
-
-							// Push
-							sq_pushobject(hVM, &oFunction);
-							sq_pushroottable(hVM);
-
-							sq_pushinteger(hVM, handle);
-							sq_pushinteger(hVM, static_cast<int>(httpCode));
-							sq_pushstring(hVM, bodyBuffer.c_str(), -1);
-							sq_pushstring(hVM, headerBuffer.c_str(), -1);
-
-							(void)sq_call(hVM, 5, false, false);
-						}
-					});
-				// g_pSquirrel<context>->AsyncCall("NSHandleSuccessfulHttpRequest", handle, static_cast<int>(httpCode), bodyBuffer, headerBuffer);
+				m_Cache.Revalidate(svCacheKey, pStale, headerBuffer, Plat_FloatTime());
+
+				// Script asked for the resource, not whether it changed
+				httpCode = 200;
+				bodyBuffer = pStale->svBody;
+				headerBuffer = pStale->svHeaders;
 			}
-			else
+			else if (httpCode == 200)
 			{
-				// Pass CURL result code & error.
-				Error(eLog::NS, NO_ERROR, "curl_easy_perform() failed with code %i, error: %s\n", static_cast<int>(result), curl_easy_strerror(result));
-
-				// If it's an SSL issue, tell the user they may disable SSL checks using -disablehttpssl.
-				if (result == CURLE_PEER_FAILED_VERIFICATION || result == CURLE_SSL_CERTPROBLEM || result == CURLE_SSL_INVALIDCERTSTATUS)
-				{
-					Warning(eLog::NS, "You can try disabling SSL verifications for this issue using the -disablehttpssl launch argument. "
-									  "Keep in mind this is potentially dangerous!\n");
-				}
-				std::string svError = curl_easy_strerror(result);
-				g_pTaskScheduler->AddTask(
-					[handle, result, svError, nContext]()
-					{
-						CSquirrelVM* pVM = nullptr;
-						if (nContext == ScriptContext::SERVER)
-							pVM = g_pServerVM;
-						else if (nContext == ScriptContext::CLIENT)
-							pVM = g_pClientVM;
-						else if (nContext == ScriptContext::UI)
-							pVM = g_pUIVM;
-
-						if (pVM && pVM->GetVM())
-						{
-							HSQUIRRELVM hVM = pVM->GetVM();
-							const char* pszFunction = "NSHandleFailedHttpRequest";
-
-							SQObject oFunction {};
-							int nResult = sq_getfunction(hVM, pszFunction, &oFunction, 0);
-							if (nResult != 0)
-							{
-								Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFunction);
-								return;
-							}
-
-							// Push
-							sq_pushobject(hVM, &oFunction);
-							sq_pushroottable(hVM);
-
-							sq_pushinteger(hVM, handle);
-							sq_pushinteger(hVM, static_cast<int>(result));
-							sq_pushstring(hVM, svError.c_str(), -1);
-
-							(void)sq_call(hVM, 4, false, false);
-						}
-					});
-				// g_pSquirrel<context>->AsyncCall("NSHandleFailedHttpRequest", handle, static_cast<int>(result), curl_easy_strerror(result));
+				// Disk writes stop once the folder gets close to its quota so they
+				// never take the last of it from the mod's own saves
+				fs::path diskDir = pending.diskDir;
+				if (!diskDir.empty() && g_pSaveFolderQuota->GetFolderSize(pending.saveDir) + bodyBuffer.size() + headerBuffer.size() + CScriptHttpCache::MAX_DISK_SIZE > static_cast<uintmax_t>(MAX_FOLDER_SIZE))
+					diskDir.clear();
+
+				if (m_Cache.Store(svCacheKey, bodyBuffer, headerBuffer, Plat_FloatTime(), diskDir))
+					g_pSaveFolderQuota->InvalidateFolder(pending.saveDir);
 			}
+		}
 
-			curl_easy_cleanup(curl);
-			curl_slist_free_all(headers);
-			curl_slist_free_all(host);
-		})
-		.detach();
-	return handle;
+		fnSucceed(httpCode, bodyBuffer, headerBuffer);
+	}
+	else
+	{
+		// Pass CURL result code & error.
+		Error(eLog::NS, NO_ERROR, "curl_easy_perform() failed with code %i, error: %s\n", static_cast<int>(result), curl_easy_strerror(result));
+
+		// If it's an SSL issue, tell the user they may disable SSL checks using -disablehttpssl.
+		if (result == CURLE_PEER_FAILED_VERIFICATION || result == CURLE_SSL_CERTPROBLEM || result == CURLE_SSL_INVALIDCERTSTATUS)
+		{
+			Warning(eLog::NS, "You can try disabling SSL verifications for this issue using the -disablehttpssl launch argument. "
+							  "Keep in mind this is potentially dangerous!\n");
+		}
+
+		fnFail(static_cast<int>(result), curl_easy_strerror(result));
+	}
+
+	curl_easy_cleanup(curl);
+	curl_slist_free_all(headers);
+	curl_slist_free_all(host);
 }
 
 void VScript_RegisterSharedFunctions(CSquirrelVM* vm)
@@ -1,22 +1,29 @@
 #pragma once
 
 #include "vscript/vscript.h"
+#include "game/shared/vscript_httpcache.h"
+#include "tier1/addressprefixtrie.h"
 
 void VScript_RegisterSharedFunctions(CSquirrelVM* vm);
 
 //-----------------------------------------------------------------------------
-//
+// Purpose: Converts between json text and squirrel tables directly, without
+//          building an nlohmann::json tree in between
+//-----------------------------------------------------------------------------
 class CScriptJson
 {
   public:
-	static void DecodeJson(HSQUIRRELVM sqvm, nlohmann::json& jsObj);
-
-	static void EncodeJsonTable(SQTable* pTable, nlohmann::json& jsObj);
-	static void EncodeJsonArray(SQArray* pArray, nlohmann::json& jsObj);
+	static bool DecodeJson(HSQUIRRELVM sqvm, const char* pszJson, std::string& svError);
+	static void EncodeJson(SQTable* pTable, std::string& svOut, int nIndent = -1);
 
   private:
-	static void DecodeTable(HSQUIRRELVM sqvm, nlohmann::json& jsObj);
-	static void DecodeArray(HSQUIRRELVM sqvm, nlohmann::json& jsObj);
+	static void EncodeTable(SQTable* pTable, std::string& svOut, int nIndent, int nDepth);
+	static void EncodeArray(SQArray* pArray, std::string& svOut, int nIndent, int nDepth);
+	static void EncodeValue(const SQObject* pObject, std::string& svOut, int nIndent, int nDepth);
+	static void EncodeString(const SQString* pString, std::string& svOut);
+	static void EncodeFloat(float flValue, std::string& svOut);
+	static void EncodeNewLine(std::string& svOut, int nIndent, int nDepth);
+	static bool CanEncode(const SQObject* pObject, const char* pszCaller);
 };
 
 //-----------------------------------------------------------------------------
@@ -117,11 +124,61 @@ class CScriptHttp
 	}
 
 	bool IsHttpDestinationHostAllowed(const std::string& host, std::string& outHostname, std::string& outAddress, std::string& outPort);
+	bool IsAddressAllowed(const sockaddr* pAddress) const;
 
-	int MakeHttpRequest(const HttpRequest_t& requestParameters, ScriptContext nContext);
+	int MakeHttpRequest(const HttpRequest_t& requestParameters, ScriptContext nContext, const std::string& svMod, const fs::path& saveDir);
 
   private:
+	struct PendingHttpRequest_t
+	{
+		int nHandle;
+		ScriptContext nContext;
+		HttpRequest_t request;
+		bool bAllowLocalHttp;
+		std::string svCacheKey;
+
+		// Mod the request counts against, empty if it didn't come from one
+		std::string svMod;
+		fs::path saveDir;
+		// Disk tier to use, empty for none
+		fs::path diskDir;
+		// Bytes per second the mod may use, 0 for no limit
+		double flBandwidth;
+	};
+
+	struct HttpTransferBuffer_t
+	{
+		CScriptHttp* pScriptHttp;
+		const PendingHttpRequest_t* pRequest;
+		std::string* pBuffer;
+	};
+
+	struct ResolvedHost_t
+	{
+		double flExpires;
+		bool bResolved;
+		bool bAllowed;
+		std::string svAddress;
+	};
+
+	ResolvedHost_t ResolveHost(const char* pszHostname, const char* pszScheme) const;
+	static std::string GetCacheKey(const HttpRequest_t& requestParameters);
+
+	bool SubmitHttpRequest(std::shared_ptr<PendingHttpRequest_t> pRequest);
+	void RunHttpRequest(const PendingHttpRequest_t& pending);
+	void FinishHttpRequest(const std::string& svMod);
+	void ThrottleHttpRequest(const PendingHttpRequest_t& pending, size_t nBytes);
+	static size_t HttpWriteThrottled(char* contents, size_t size, size_t nmemb, HttpTransferBuffer_t* pTransfer);
+
 	int m_iLastRequestHandle = 0;
+	CScriptHttpCache m_Cache;
+	CScriptHttpModLimiter m_ModLimiter;
+
+	CAddressPrefixTrie m_BlockedRanges;
+
+	// Hostname and scheme : where it resolved to last
+	std::mutex m_ResolverMutex;
+	std::unordered_map<std::string, ResolvedHost_t> m_mapResolved;
 
 	bool m_bIsHttpDisabled = false;
 	bool m_bIsLocalHttpAllowed = false;
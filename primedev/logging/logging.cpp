@@ -55,9 +55,9 @@ void SpdLog_Init(void)
 	g_WinLogger = spdlog::stdout_logger_mt("win_console");
 	spdlog::set_level(spdlog::level::trace);
 
-	// NOTE [Fifty]: This may be bad as it writes to disk for every message?
-	//               Seems to fix logs not flushing properly, still needs testing
-	spdlog::flush_on(spdlog::level::trace);
+	// Warnings and errors hit the disk right away, everything else gets flushed periodically
+	spdlog::flush_on(spdlog::level::warn);
+	spdlog::flush_every(std::chrono::seconds(1));
 
 	if (g_bConsole_UseAnsiColor)
 		g_WinLogger->set_pattern("%v\u001b[0m");
@@ -75,6 +75,14 @@ void SpdLog_CreateLoggers(void)
 	spdlog::rotating_logger_mt<spdlog::synchronous_factory>("northstar(error)", fmt::format("{:s}\\{:s}", g_svLogDirectory, "error.txt"), SPDLOG_MAX_LOG_SIZE, SPDLOG_MAX_FILES)->set_pattern("[%Y-%m-%d %H:%M:%S.%e] %v");
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Flushes all loggers, they only flush on warnings by themselves
+//-----------------------------------------------------------------------------
+void SpdLog_Flush(void)
+{
+	spdlog::apply_all([](std::shared_ptr<spdlog::logger> pLogger) { pLogger->flush(); });
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Shutdowns spdlog
 //-----------------------------------------------------------------------------
@@ -115,6 +115,7 @@ constexpr int SPDLOG_MAX_FILES = 512;
 void SpdLog_PreInit(void);
 void SpdLog_Init(void);
 void SpdLog_CreateLoggers(void);
+void SpdLog_Flush(void);
 void SpdLog_Shutdown(void);
 #endif
 
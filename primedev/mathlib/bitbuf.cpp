@@ -7,7 +7,8 @@
 
 #include "mathlib/bitbuf.h"
 #include "mathlib/swap.h"
-#include "mathlib/bitvec.h"
+
+#include <cstring>
 
 //-----------------------------------------------------------------------------
 // Write masks
@@ -22,14 +23,14 @@ class CBitWriteMasks
 			for (unsigned int nBitsLeft = 0; nBitsLeft < 33; nBitsLeft++)
 			{
 				unsigned int endbit = startbit + nBitsLeft;
-				m_BitWriteMasks[startbit][nBitsLeft] = GetBitForBitnum(int(startbit)) - 1;
+				m_BitWriteMasks[startbit][nBitsLeft] = (1u << startbit) - 1;
 				if (endbit < 32)
-					m_BitWriteMasks[startbit][nBitsLeft] |= ~(GetBitForBitnum(int(endbit)) - 1);
+					m_BitWriteMasks[startbit][nBitsLeft] |= ~((1u << endbit) - 1);
 			}
 		}
 
 		for (unsigned int maskBit = 0; maskBit < 32; maskBit++)
-			m_ExtraMasks[maskBit] = GetBitForBitnum(int(maskBit)) - 1;
+			m_ExtraMasks[maskBit] = (1u << maskBit) - 1;
 		m_ExtraMasks[32] = ~0ul;
 
 		for (unsigned int littleBit = 0; littleBit < 32; littleBit++)
@@ -286,6 +287,49 @@ float CBitRead::ReadFloat()
 	return ret;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: gets the next unread byte if the read position is byte aligned
+// Input  : &nAvailable - Set to the number of bytes left in the buffer
+// Output : nullptr if not byte aligned or past the end of the buffer
+//-----------------------------------------------------------------------------
+const uint8* CBitRead::GetAlignedReadPtr(size_t& nAvailable) const
+{
+	// Running past the end leaves a single zero bit available, so this also catches that
+	if (!m_pData || (m_nBitsAvail & 7))
+		return nullptr;
+
+	// The unread bytes of m_nInBufWord are the ones right before m_pDataIn
+	const uint8* pNext = reinterpret_cast<const uint8*>(m_pDataIn) - (m_nBitsAvail >> 3);
+	const uint8* pEnd = reinterpret_cast<const uint8*>(m_pBufferEnd);
+
+	// Still in the partial dword at the head of the buffer, leave that to the slow path
+	if (pNext < reinterpret_cast<const uint8*>(m_pData) + (m_nDataBytes & 3) || pNext > pEnd)
+		return nullptr;
+
+	nAvailable = pEnd - pNext;
+	return pNext;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: moves the read position forward to a byte returned from
+//          GetAlignedReadPtr, or any byte after it up to the end of the buffer
+// Input  : *pNext -
+//-----------------------------------------------------------------------------
+void CBitRead::SkipToAlignedReadPtr(const uint8* pNext)
+{
+	// Partial dword is at the head of the buffer, after that it's whole dwords up to m_pBufferEnd
+	const uint8* pFirstDWord = reinterpret_cast<const uint8*>(m_pData) + (m_nDataBytes & 3);
+	size_t nOffset = pNext - pFirstDWord;
+
+	m_pDataIn = reinterpret_cast<const uint32*>(pFirstDWord + (nOffset & ~size_t(3)));
+
+	// Same state ReadUBitLong leaves behind when it uses up the last dword
+	FetchNext();
+
+	m_nInBufWord >>= (nOffset & 3) << 3;
+	m_nBitsAvail -= (nOffset & 3) << 3;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: reads bits from the buffer
 //-----------------------------------------------------------------------------
@@ -294,6 +338,19 @@ void CBitRead::ReadBits(void* pOutData, int nBits)
 	unsigned char* pOut = (unsigned char*)pOutData;
 	int nBitsLeft = nBits;
 
+	// byte aligned reads that fit in the buffer can copy straight out of it
+	size_t nAvailable;
+	const uint8* pNext = nBitsLeft >= 64 ? GetAlignedReadPtr(nAvailable) : nullptr;
+	if (pNext && size_t(nBitsLeft >> 3) <= nAvailable)
+	{
+		size_t nBytes = nBitsLeft >> 3;
+		memcpy(pOut, pNext, nBytes);
+		SkipToAlignedReadPtr(pNext + nBytes);
+
+		pOut += nBytes;
+		nBitsLeft &= 7;
+	}
+
 	// align output to dword boundary
 	while (((uintp)pOut & 3) != 0 && nBitsLeft >= 8)
 	{
@@ -343,7 +400,29 @@ bool CBitRead::ReadString(char* pStr, int maxLen, bool bLine, int* pOutNumChars)
 
 	bool bTooSmall = false;
 	int iChar = 0;
-	while (1)
+
+	// byte aligned and terminated before the end of the buffer, find the end with memchr instead of reading char by char
+	size_t nAvailable;
+	const uint8* pNext = GetAlignedReadPtr(nAvailable);
+	const uint8* pTerminator = pNext ? static_cast<const uint8*>(memchr(pNext, 0, nAvailable)) : nullptr;
+	if (pTerminator)
+	{
+		if (bLine)
+		{
+			const uint8* pNewLine = static_cast<const uint8*>(memchr(pNext, '\n', pTerminator - pNext));
+			if (pNewLine)
+				pTerminator = pNewLine;
+		}
+
+		size_t nLength = pTerminator - pNext;
+		bTooSmall = nLength > size_t(maxLen - 1);
+		iChar = int(bTooSmall ? maxLen - 1 : nLength);
+
+		memcpy(pStr, pNext, iChar);
+		SkipToAlignedReadPtr(pTerminator + 1);
+	}
+
+	while (!pTerminator)
 	{
 		char val = char(ReadChar());
 		if (val == 0)
@@ -371,6 +450,53 @@ bool CBitRead::ReadString(char* pStr, int maxLen, bool bLine, int* pOutNumChars)
 	return !IsOverflowed() && !bTooSmall;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: reads an integer written with WriteUBitVar
+// 2 bits select how many bits the value has: 4, 8, 12 or 32
+//-----------------------------------------------------------------------------
+uint32 CBitRead::ReadUBitVar()
+{
+	static const int s_nUBitVarBits[4] = {4, 8, 12, 32};
+	return ReadUBitLong(s_nUBitVarBits[ReadUBitLong(2)]);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads a 32 bit varint, 7 bits per byte with the top bit set on
+//          every byte but the last
+//-----------------------------------------------------------------------------
+uint32 CBitRead::ReadVarInt32()
+{
+	uint32 result = 0;
+	for (int count = 0; count < bitbuf::kMaxVarint32Bytes; count++)
+	{
+		uint32 b = ReadUBitLong(8);
+		result |= (b & 0x7F) << (7 * count);
+
+		if (!(b & 0x80))
+			break;
+	}
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: reads a 64 bit varint
+//-----------------------------------------------------------------------------
+uint64 CBitRead::ReadVarInt64()
+{
+	uint64 result = 0;
+	for (int count = 0; count < bitbuf::kMaxVarintBytes; count++)
+	{
+		uint64 b = ReadUBitLong(8);
+		result |= (b & 0x7F) << (7 * count);
+
+		if (!(b & 0x80))
+			break;
+	}
+
+	return result;
+}
+
 // ---------------------------------------------------------------------------------------- //
 // bf_write
 // ---------------------------------------------------------------------------------------- //
@@ -553,11 +679,11 @@ void CBitWrite::WriteSBitLong(int data, int numbits)
 
 			if (data < 0)
 			{
-				Assert(data >= -(GetBitForBitnum(numbits - 1)));
+				Assert(data >= -(1 << (numbits - 1)));
 			}
 			else
 			{
-				Assert(data < (GetBitForBitnum(numbits - 1)));
+				Assert(data < (1 << (numbits - 1)));
 			}
 		}
 #endif
@@ -676,6 +802,53 @@ bool CBitWrite::WriteBits(const void* pInData, int nBits)
 	return !IsOverflowed();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: writes an integer using 6 to 34 bits depending on its size
+//-----------------------------------------------------------------------------
+void CBitWrite::WriteUBitVar(unsigned int data)
+{
+	// low 2 bits pick the size, the value follows
+	if (data < 0x10u)
+		WriteUBitLong(data << 2, 6);
+	else if (data < 0x100u)
+		WriteUBitLong(data << 2 | 1, 10);
+	else if (data < 0x1000u)
+		WriteUBitLong(data << 2 | 2, 14);
+	else
+	{
+		WriteUBitLong(data << 2 | 3, 32);
+		WriteUBitLong(data >> 30, 2);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: writes a 32 bit varint
+//-----------------------------------------------------------------------------
+void CBitWrite::WriteVarInt32(uint32 data)
+{
+	while (data > 0x7F)
+	{
+		WriteUBitLong((data & 0x7F) | 0x80, 8);
+		data >>= 7;
+	}
+
+	WriteUBitLong(data, 8);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: writes a 64 bit varint
+//-----------------------------------------------------------------------------
+void CBitWrite::WriteVarInt64(uint64 data)
+{
+	while (data > 0x7F)
+	{
+		WriteUBitLong(uint32(data & 0x7F) | 0x80, 8);
+		data >>= 7;
+	}
+
+	WriteUBitLong(uint32(data), 8);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: checks if we have enough space for the requested number of bits
 //-----------------------------------------------------------------------------
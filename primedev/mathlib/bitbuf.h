@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 // You can define a handler function that will be called in case of
 // out-of-range values and overruns here.
@@ -77,7 +79,7 @@ namespace bitbuf
 	inline uint32 ZigZagEncode32(int32 n)
 	{
 		// Note:  the right-shift must be arithmetic
-		return (n << 1) ^ (n >> 31);
+		return (static_cast<uint32>(n) << 1) ^ (n >> 31);
 	}
 
 	inline int32 ZigZagDecode32(uint32 n)
@@ -88,7 +90,7 @@ namespace bitbuf
 	inline uint64 ZigZagEncode64(int64 n)
 	{
 		// Note:  the right-shift must be arithmetic
-		return (n << 1) ^ (n >> 63);
+		return (static_cast<uint64>(n) << 1) ^ (n >> 63);
 	}
 
 	inline int64 ZigZagDecode64(uint64 n)
@@ -191,6 +193,23 @@ class CBitRead : public CBitBuffer
 	bool ReadBytes(void* pOut, int nBytes);
 	bool ReadString(char* pStr, int bufLen, bool bLine = false, int* pOutNumChars = nullptr);
 
+	uint32 ReadUBitVar();
+	uint32 ReadVarInt32();
+	uint64 ReadVarInt64();
+
+	FORCEINLINE int32 ReadSignedVarInt32()
+	{
+		return bitbuf::ZigZagDecode32(ReadVarInt32());
+	}
+	FORCEINLINE int64 ReadSignedVarInt64()
+	{
+		return bitbuf::ZigZagDecode64(ReadVarInt64());
+	}
+
+	// Raw access for byte aligned reads, see ReadBits
+	const uint8* GetAlignedReadPtr(size_t& nAvailable) const;
+	void SkipToAlignedReadPtr(const uint8* pNext);
+
 	////////////////////////////////////
 	uint32 m_nInBufWord;
 	uint32 m_nBitsAvail;
@@ -242,14 +261,28 @@ class CBitWrite : public CBitBuffer
 		return WriteBits(pIn, nBytes << 3);
 	}
 
+	// Variable length integers, see the matching CBitRead functions
+	void WriteUBitVar(unsigned int data);
+	void WriteVarInt32(uint32 data);
+	void WriteVarInt64(uint64 data);
+
+	inline void WriteSignedVarInt32(int32 data)
+	{
+		WriteVarInt32(bitbuf::ZigZagEncode32(data));
+	}
+	inline void WriteSignedVarInt64(int64 data)
+	{
+		WriteVarInt64(bitbuf::ZigZagEncode64(data));
+	}
+
 	// How many bytes are filled in?
 	FORCEINLINE int GetNumBytesWritten() const
 	{
-		return BitByte(this->m_nDataBits);
+		return BitByte(this->m_iCurBit);
 	}
 	FORCEINLINE int GetNumBitsWritten() const
 	{
-		return this->m_nDataBits;
+		return this->m_iCurBit;
 	}
 	FORCEINLINE int GetMaxNumBits() const
 	{
@@ -257,7 +290,7 @@ class CBitWrite : public CBitBuffer
 	}
 	FORCEINLINE int GetNumBitsLeft() const
 	{
-		return this->m_nDataBits - m_nDataBits;
+		return this->m_nDataBits - m_iCurBit;
 	}
 	FORCEINLINE int GetNumBytesLeft() const
 	{
@@ -331,5 +364,5 @@ FORCEINLINE int64 CBitRead::Tell(void) const
 	nCurOfs *= 32;
 	nCurOfs += (32 - m_nBitsAvail);
 	int64 nAdjust = 8 * (m_nDataBytes & 3);
-	return std::min((const size_t)nCurOfs + nAdjust, m_nDataBits);
+	return std::min(size_t(nCurOfs + nAdjust), m_nDataBits);
 }
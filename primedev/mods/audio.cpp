@@ -1,13 +1,207 @@
 #include "audio.h"
 
 #include "codecs/miles/core.h"
+#include "tier0/jobsystem.h"
 
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <sstream>
 
 CustomAudioManager g_CustomAudioManager;
 
+//-----------------------------------------------------------------------------
+// Purpose: Destructor
+//-----------------------------------------------------------------------------
+CAudioSample::~CAudioSample()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks a sample file, it isn't kept mapped until it plays
+// Input  : &path -
+// Output : false if the file can't be mapped or isn't a wave file
+//-----------------------------------------------------------------------------
+bool CAudioSample::Load(const fs::path& path)
+{
+	void* pData = Map(path, m_nSize);
+	if (!pData)
+		return false;
+
+	UnmapViewOfFile(pData);
+	m_Path = path;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps a sample on the filesystem job queue ahead of it playing
+// Input  : &pSample -
+//-----------------------------------------------------------------------------
+void CAudioSample::Prefetch(const std::shared_ptr<CAudioSample>& pSample)
+{
+	if (pSample->m_bMapped.load(std::memory_order_acquire))
+		return;
+
+	auto fnMap = [pSample]()
+	{
+		std::lock_guard<std::mutex> lock(pSample->m_Mutex);
+		pSample->MapLocked();
+	};
+
+	// If the queue is full GetData maps it when it plays instead
+	g_pJobSystem->Submit(eJobQueue::FILESYSTEM, fnMap);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the sample data and its size
+// Note   : Only maps the file here if its prefetch hasn't run yet
+// Input  : &pData -
+//          &nSize -
+// Output : false if the file can't be mapped anymore
+//-----------------------------------------------------------------------------
+bool CAudioSample::GetData(void*& pData, unsigned int& nSize)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	MapLocked();
+
+	pData = m_pData;
+	nSize = m_nSize;
+
+	return m_pData != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps the file if that wasn't tried yet, caller holds m_Mutex
+//-----------------------------------------------------------------------------
+void CAudioSample::MapLocked()
+{
+	if (m_bMapped.load(std::memory_order_relaxed))
+		return;
+
+	// The file might have changed since we loaded it, Map checks it again
+	m_pData = Map(m_Path, m_nSize);
+	m_bMapped.store(true, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps a sample file
+// Input  : &path -
+//          &nSize - Size of the file
+// Output : The view, nullptr if the file can't be mapped or isn't a wave file
+//-----------------------------------------------------------------------------
+void* CAudioSample::Map(const fs::path& path, unsigned int& nSize)
+{
+	HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		Error(eLog::AUDIO, NO_ERROR, "Failed reading audio sample %s\n", path.string().c_str());
+		return nullptr;
+	}
+
+	LARGE_INTEGER nFileSize;
+	if (!GetFileSizeEx(hFile, &nFileSize) || nFileSize.QuadPart < 12 || nFileSize.QuadPart > UINT_MAX)
+	{
+		Error(eLog::AUDIO, NO_ERROR, "Failed reading audio sample %s: invalid file size\n", path.string().c_str());
+		CloseHandle(hFile);
+		return nullptr;
+	}
+
+	// The view keeps the file and mapping alive, the handles aren't needed after this
+	HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	CloseHandle(hFile);
+
+	if (!hMapping)
+	{
+		Error(eLog::AUDIO, NO_ERROR, "Failed mapping audio sample %s (%u)\n", path.string().c_str(), GetLastError());
+		return nullptr;
+	}
+
+	void* pData = MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(hMapping);
+
+	if (!pData)
+	{
+		Error(eLog::AUDIO, NO_ERROR, "Failed mapping audio sample %s (%u)\n", path.string().c_str(), GetLastError());
+		return nullptr;
+	}
+
+	if (!IsWave(static_cast<const uint8_t*>(pData), static_cast<size_t>(nFileSize.QuadPart)))
+	{
+		Error(eLog::AUDIO, NO_ERROR, "Failed reading audio sample %s: not a RIFF WAVE file\n", path.string().c_str());
+		UnmapViewOfFile(pData);
+		return nullptr;
+	}
+
+	nSize = static_cast<unsigned int>(nFileSize.QuadPart);
+	return pData;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks the RIFF header and that the fmt and data chunks are there,
+//          only touches the pages the chunk headers are on
+// Input  : *pData -
+//          nSize -
+//-----------------------------------------------------------------------------
+bool CAudioSample::IsWave(const uint8_t* pData, size_t nSize)
+{
+	if (memcmp(pData, "RIFF", 4) || memcmp(pData + 8, "WAVE", 4))
+		return false;
+
+	bool bHasFormat = false;
+	bool bHasData = false;
+
+	size_t nOffset = 12;
+	while (nOffset + 8 <= nSize && !(bHasFormat && bHasData))
+	{
+		uint32_t nChunkSize;
+		memcpy(&nChunkSize, pData + nOffset + 4, sizeof(nChunkSize));
+
+		if (!memcmp(pData + nOffset, "fmt ", 4))
+			bHasFormat = true;
+		else if (!memcmp(pData + nOffset, "data", 4))
+			bHasData = true;
+
+		// Chunks are padded to an even size
+		nOffset += 8 + static_cast<size_t>(nChunkSize) + (nChunkSize & 1);
+	}
+
+	return bHasFormat && bHasData;
+}
+
+// Picks random samples, only used from the audio thread and while loading mods
+static std::mt19937 s_SampleRandom(std::random_device {}());
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the sample to play and picks and prefetches the one after
+//          it, called from the audio thread
+// Output : nullptr if there are no samples
+//-----------------------------------------------------------------------------
+CAudioSample* EventOverrideData::TakeNextSample()
+{
+	if (Samples.empty())
+		return nullptr;
+
+	CAudioSample* pSample = Samples[CurrentIndex].get();
+
+	switch (Strategy)
+	{
+	case AudioSelectionStrategy::RANDOM:
+		CurrentIndex = std::uniform_int_distribution<size_t>(0, Samples.size() - 1)(s_SampleRandom);
+		break;
+	case AudioSelectionStrategy::SEQUENTIAL:
+	default:
+		if (++CurrentIndex >= Samples.size())
+			CurrentIndex = 0; // reset back to the first sample entry
+		break;
+	}
+
+	CAudioSample::Prefetch(Samples[CurrentIndex]);
+	return pSample;
+}
+
 EventOverrideData::EventOverrideData()
 {
 	Warning(eLog::AUDIO, "Initialised struct EventOverrideData without any data!\n");
@@ -165,57 +359,23 @@ EventOverrideData::EventOverrideData(const std::string& data, const fs::path& pa
 	{
 		if (file.is_regular_file() && file.path().extension().string() == ".wav")
 		{
-			std::string pathString = file.path().string();
-
-			// Open the file.
-			std::ifstream wavStream(pathString, std::ios::binary);
-
-			if (wavStream.fail())
-			{
-				Error(eLog::AUDIO, NO_ERROR, "Failed reading audio sample %s\n", file.path().string().c_str());
-				continue;
-			}
-
-			// Get file size.
-			wavStream.seekg(0, std::ios::end);
-			size_t fileSize = wavStream.tellg();
-			wavStream.close();
-
-			// Allocate enough memory for the file.
-			// blank out the memory for now, then read it later
-			uint8_t* data = new uint8_t[fileSize];
-			memcpy(data, EMPTY_WAVE, sizeof(EMPTY_WAVE));
-			Samples.push_back({fileSize, std::unique_ptr<uint8_t[]>(data)});
-
-			// thread off the file read
-			// should we spawn one thread per read? or should there be a cap to the number of reads at once?
-			std::thread readThread(
-				[pathString, fileSize, data]
-				{
-					std::shared_lock lock(g_CustomAudioManager.m_loadingMutex);
-					std::ifstream wavStream(pathString, std::ios::binary);
-
-					// would be weird if this got hit, since it would've worked previously
-					if (wavStream.fail())
-					{
-						Error(eLog::AUDIO, NO_ERROR, "Failed async read of audio sample %s\n", pathString.c_str());
-						return;
-					}
-
-					// read from after the header first to preserve the empty header, then read the header last
-					wavStream.seekg(0, std::ios::beg);
-					wavStream.read(reinterpret_cast<char*>(data), fileSize);
-					wavStream.close();
-
-					DevMsg(eLog::AUDIO, "Finished async read of audio sample %s\n", pathString.c_str());
-				});
-
-			readThread.detach();
+			std::shared_ptr<CAudioSample> pSample = std::make_shared<CAudioSample>();
+			if (pSample->Load(file.path()))
+				Samples.push_back(std::move(pSample));
 		}
 	}
 
 	if (Samples.size() == 0)
 		Warning(eLog::AUDIO, "Audio override %s has no valid samples! Sounds will not play for this event.\n", path.string().c_str());
+	else
+	{
+		// Pick the first sample now so it's mapped by the time it plays
+		CurrentIndex = 0;
+		if (Strategy == AudioSelectionStrategy::RANDOM)
+			CurrentIndex = std::uniform_int_distribution<size_t>(0, Samples.size() - 1)(s_SampleRandom);
+
+		CAudioSample::Prefetch(Samples[CurrentIndex]);
+	}
 
 	DevMsg(eLog::AUDIO, "Loaded audio override file %s\n", path.string().c_str());
 
@@ -256,9 +416,13 @@ bool CustomAudioManager::TryLoadAudioOverride(const fs::path& defPath)
 	for (const auto& eventIdRegexData : data->EventIdsRegex)
 	{
 		DevMsg(eLog::AUDIO, "Registering sound event regex %s\n", eventIdRegexData.first.c_str());
-		m_loadedAudioOverridesRegex.insert({eventIdRegexData.first, data});
+		m_vRegexOverrides.push_back({GetRequiredLiteral(eventIdRegexData.first), &eventIdRegexData.second, data});
 	}
 
+	// Events that missed before might match the new regexes
+	if (!data->EventIdsRegex.empty())
+		m_setRegexMisses.clear();
+
 	return true;
 }
 
@@ -267,7 +431,7 @@ void CustomAudioManager::ClearAudioOverrides()
 	if (IsDedicatedServer())
 		return;
 
-	if (m_loadedAudioOverrides.size() > 0 || m_loadedAudioOverridesRegex.size() > 0)
+	if (m_loadedAudioOverrides.size() > 0 || m_vRegexOverrides.size() > 0)
 	{
 		// stop all miles sounds beforehand
 		// miles_stop_all
@@ -278,10 +442,152 @@ void CustomAudioManager::ClearAudioOverrides()
 		Sleep(50);
 	}
 
-	// slightly (very) bad
-	// wait for all audio reads to complete so we don't kill preexisting audio buffers as we're writing to them
-	std::unique_lock lock(m_loadingMutex);
-
 	m_loadedAudioOverrides.clear();
-	m_loadedAudioOverridesRegex.clear();
+	m_vRegexOverrides.clear();
+	m_setRegexMisses.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the override whose regex matches an event
+// Note   : Misses are remembered so events no regex matches only pay for
+//          the regexes once
+// Input  : *pszEventName -
+// Output : nullptr if no regex matches
+//-----------------------------------------------------------------------------
+std::shared_ptr<EventOverrideData> CustomAudioManager::FindRegexOverride(const char* pszEventName)
+{
+	if (m_vRegexOverrides.empty())
+		return nullptr;
+
+	uint64_t nHash = std::hash<std::string_view>()(pszEventName);
+	if (m_setRegexMisses.find(nHash) != m_setRegexMisses.end())
+		return nullptr;
+
+	for (auto it = m_vRegexOverrides.rbegin(); it != m_vRegexOverrides.rend(); ++it)
+	{
+		if (!it->svLiteral.empty() && !strstr(pszEventName, it->svLiteral.c_str()))
+			continue;
+
+		if (std::regex_search(pszEventName, *it->pRegex))
+			return it->pData;
+	}
+
+	m_setRegexMisses.insert(nHash);
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the longest run of plain characters a regex can only match
+//          if the subject contains it
+// Note   : Errs on the side of returning less, anything inside groups or
+//          after an escape it doesn't know is ignored and patterns with
+//          top level alternation get no literal at all
+// Input  : &svRegex - ECMAScript pattern
+// Output : Empty if there's no such run
+//-----------------------------------------------------------------------------
+std::string CustomAudioManager::GetRequiredLiteral(const std::string& svRegex)
+{
+	auto IsAlnum = [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+	auto IsQuantifier = [](char c) { return c == '*' || c == '+' || c == '?' || c == '{'; };
+
+	std::string svBest;
+	std::string svRun;
+
+	auto EndRun = [&]()
+	{
+		if (svRun.size() > svBest.size())
+			svBest = svRun;
+
+		svRun.clear();
+	};
+
+	size_t i = 0;
+	while (i < svRegex.size())
+	{
+		char c = svRegex[i];
+
+		// Alternation outside a group, nothing is required
+		if (c == '|')
+			return "";
+
+		if (c == '(' || c == '[')
+		{
+			// Skip the whole group or class, escapes and classes inside
+			// can contain brackets that don't count
+			int nDepth = 0;
+			bool bInClass = false;
+			for (; i < svRegex.size(); i++)
+			{
+				char g = svRegex[i];
+				if (g == '\\')
+					i++;
+				else if (bInClass)
+					bInClass = g != ']';
+				else if (g == '[')
+					bInClass = true;
+				else if (g == '(')
+					nDepth++;
+				else if (g == ')')
+					nDepth--;
+
+				if (!nDepth && !bInClass)
+					break;
+			}
+
+			i++;
+			EndRun();
+			continue;
+		}
+
+		if (IsQuantifier(c))
+		{
+			// Quantifier on something that isn't a plain character, or a
+			// lazy modifier
+			if (c == '{')
+				while (i < svRegex.size() && svRegex[i] != '}')
+					i++;
+
+			i++;
+			EndRun();
+			continue;
+		}
+
+		if (c == '\\' && i + 1 < svRegex.size() && IsAlnum(svRegex[i + 1]))
+		{
+			// Character classes, backreferences and code escapes like \x41,
+			// skip what follows so their digits aren't taken as characters
+			i += 2;
+			while (i < svRegex.size() && IsAlnum(svRegex[i]))
+				i++;
+
+			EndRun();
+			continue;
+		}
+
+		if (c == '.' || c == '^' || c == '$' || c == ')' || c == ']' || c == '}' || (c == '\\' && i + 1 == svRegex.size()))
+		{
+			i++;
+			EndRun();
+			continue;
+		}
+
+		// Plain or escaped character
+		char cLiteral = c == '\\' ? svRegex[++i] : c;
+		i++;
+
+		if (i < svRegex.size() && IsQuantifier(svRegex[i]))
+		{
+			// Optional characters aren't required, one or more still needs one
+			if (svRegex[i] == '+')
+				svRun += cLiteral;
+
+			EndRun();
+			continue;
+		}
+
+		svRun += cLiteral;
+	}
+
+	EndRun();
+	return svBest;
 }
@@ -3,7 +3,10 @@
 #include <vector>
 #include <filesystem>
 #include <regex>
-#include <shared_mutex>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 // Empty stereo 48000 WAVE file
 inline unsigned char EMPTY_WAVE[45] = {0x52, 0x49, 0x46, 0x46, 0x25, 0x00, 0x00, 0x00, 0x57, 0x41, 0x56, 0x45, 0x66, 0x6D, 0x74, 0x20, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02,
@@ -16,6 +19,50 @@ enum class AudioSelectionStrategy
 	RANDOM
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Sample file mapped into memory
+// Note   : Loading only checks the header. The file gets mapped on the
+//          filesystem job queue once the sample is next in line to play, so
+//          the Miles thread doesn't wait on the disk. Pages are read in as
+//          Miles reads them and the OS can drop them again under memory
+//          pressure since they're backed by the file. The view is copy on
+//          write so nothing Miles does to the buffer ends up in the file
+//
+//          Windows won't delete or overwrite a mapped file, so once a sample
+//          was next in line its file stays locked until the overrides are
+//          cleared when mods are unloaded. Other samples can be updated while
+//          the game runs. Miles holds raw pointers into the view with no
+//          notification when it's done, so samples can't be unmapped earlier
+//-----------------------------------------------------------------------------
+class CAudioSample
+{
+  public:
+	CAudioSample() = default;
+	~CAudioSample();
+
+	CAudioSample(const CAudioSample&) = delete;
+	CAudioSample& operator=(const CAudioSample&) = delete;
+
+	bool Load(const fs::path& path);
+
+	static void Prefetch(const std::shared_ptr<CAudioSample>& pSample);
+	bool GetData(void*& pData, unsigned int& nSize);
+
+  private:
+	void MapLocked();
+
+	static void* Map(const fs::path& path, unsigned int& nSize);
+	static bool IsWave(const uint8_t* pData, size_t nSize);
+
+	fs::path m_Path;
+
+	std::mutex m_Mutex;
+	void* m_pData = nullptr;
+	unsigned int m_nSize = 0;
+	// Set once mapping was attempted, successful or not. Failures aren't retried
+	std::atomic_bool m_bMapped = false;
+};
+
 class EventOverrideData
 {
   public:
@@ -28,11 +75,15 @@ class EventOverrideData
 	std::vector<std::string> EventIds = {};
 	std::vector<std::pair<std::string, std::regex>> EventIdsRegex = {};
 
-	std::vector<std::pair<size_t, std::unique_ptr<uint8_t[]>>> Samples = {};
+	// Shared with prefetch jobs that may outlive the override
+	std::vector<std::shared_ptr<CAudioSample>> Samples = {};
 
 	AudioSelectionStrategy Strategy = AudioSelectionStrategy::SEQUENTIAL;
+	// Sample that plays next, picked ahead of time so it can be prefetched
 	size_t CurrentIndex = 0;
 
+	CAudioSample* TakeNextSample();
+
 	bool EnableOnLoopedSounds = false;
 };
 
@@ -42,9 +93,25 @@ class CustomAudioManager
 	bool TryLoadAudioOverride(const fs::path&);
 	void ClearAudioOverrides();
 
-	std::shared_mutex m_loadingMutex;
+	std::shared_ptr<EventOverrideData> FindRegexOverride(const char* pszEventName);
+
 	std::unordered_map<std::string, std::shared_ptr<EventOverrideData>> m_loadedAudioOverrides = {};
-	std::unordered_map<std::string, std::shared_ptr<EventOverrideData>> m_loadedAudioOverridesRegex = {};
+
+  private:
+	struct RegexOverride_t
+	{
+		// Substring every match contains, checked before running the regex
+		std::string svLiteral;
+		const std::regex* pRegex;
+		std::shared_ptr<EventOverrideData> pData;
+	};
+
+	static std::string GetRequiredLiteral(const std::string& svRegex);
+
+	// In load order, later overrides win
+	std::vector<RegexOverride_t> m_vRegexOverrides;
+	// Hashes of event names no regex matched
+	std::unordered_set<uint64_t> m_setRegexMisses;
 };
 
 extern CustomAudioManager g_CustomAudioManager;
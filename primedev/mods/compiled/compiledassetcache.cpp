@@ -0,0 +1,360 @@
+#include "mods/compiled/compiledassetcache.h"
+#include "mods/modfileindex.h"
+
+#include <algorithm>
+#include <fstream>
+#include <tuple>
+
+const char* COMPILED_MANIFEST_NAME = "manifest.json";
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+// Input  : nSeed -
+//-----------------------------------------------------------------------------
+CCompiledAssetHash::CCompiledAssetHash(uint64_t nSeed)
+	: m_nHash(0xCBF29CE484222325ull)
+{
+	Update(nSeed);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 64 bit FNV-1a over raw bytes
+// Input  : *pData -
+//          nSize -
+//-----------------------------------------------------------------------------
+void CCompiledAssetHash::Update(const void* pData, size_t nSize)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	for (size_t i = 0; i < nSize; i++)
+	{
+		m_nHash ^= pBytes[i];
+		m_nHash *= 0x100000001B3ull;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a string, length prefixed so "ab" "c" and "a" "bc" differ
+// Input  : svString -
+//-----------------------------------------------------------------------------
+void CCompiledAssetHash::Update(std::string_view svString)
+{
+	Update(static_cast<uint64_t>(svString.size()));
+	Update(svString.data(), svString.size());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a value
+// Input  : nValue -
+//-----------------------------------------------------------------------------
+void CCompiledAssetHash::Update(uint64_t nValue)
+{
+	Update(&nValue, sizeof(nValue));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes the path and contents of a file, a missing file hashes
+//          differently from an empty one
+// Input  : &path -
+//-----------------------------------------------------------------------------
+void CCompiledAssetHash::UpdateFile(const fs::path& path)
+{
+	Update(path.generic_string());
+
+	std::ifstream fStream(path, std::ios::binary);
+	if (!fStream.good())
+	{
+		Update(~0ull);
+		return;
+	}
+
+	std::string svContents((std::istreambuf_iterator<char>(fStream)), std::istreambuf_iterator<char>());
+	Update(svContents);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the manifest, anything in it that doesn't match the current
+//          game files is dropped
+// Input  : &compiledPath - Compiled assets dir
+//-----------------------------------------------------------------------------
+void CCompiledAssetCache::Load(const fs::path& compiledPath)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Reloading mods before the last build was flushed
+	if (m_bManifestDirty)
+		SaveManifest();
+
+	m_CompiledPath = compiledPath;
+	m_nBaseHash = HashGameFiles();
+	m_mapAssets.clear();
+
+	std::ifstream fStream(m_CompiledPath / COMPILED_MANIFEST_NAME, std::ios::binary);
+	if (!fStream.good())
+		return;
+
+	try
+	{
+		nlohmann::json jsManifest = nlohmann::json::parse(fStream);
+
+		if (jsManifest["version"].get<int>() != MANIFEST_VERSION || jsManifest["base"].get<uint64_t>() != m_nBaseHash)
+		{
+			DevMsg(eLog::MODSYS, "Game files changed, rebuilding all compiled assets\n");
+			return;
+		}
+
+		for (auto& [svKey, jsAsset] : jsManifest["assets"].items())
+		{
+			Asset_t& asset = m_mapAssets[svKey];
+			asset.nHash = jsAsset["hash"].get<uint64_t>();
+			asset.vOutputs = jsAsset["outputs"].get<std::vector<std::string>>();
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		Warning(eLog::MODSYS, "Failed to read compiled asset manifest: %s\n", ex.what());
+		m_mapAssets.clear();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets assets that aren't needed anymore and deletes every file
+//          in the compiled dir no remaining asset owns
+// Input  : &vAssets - Assets the loaded mods can build
+//-----------------------------------------------------------------------------
+void CCompiledAssetCache::Prune(const std::vector<std::string>& vAssets)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::unordered_set<std::string> setWanted;
+	for (const std::string& svAsset : vAssets)
+		setWanted.insert(NormaliseKey(svAsset));
+
+	std::unordered_set<std::string> setOwned;
+	for (auto it = m_mapAssets.begin(); it != m_mapAssets.end();)
+	{
+		if (setWanted.find(it->first) == setWanted.end())
+		{
+			it = m_mapAssets.erase(it);
+			continue;
+		}
+
+		setOwned.insert(it->second.vOutputs.begin(), it->second.vOutputs.end());
+		++it;
+	}
+
+	setOwned.insert(NormaliseKey(COMPILED_MANIFEST_NAME));
+
+	std::error_code ec;
+	std::vector<fs::path> vStale;
+	for (auto it = fs::recursive_directory_iterator(m_CompiledPath, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (it->is_regular_file(ec) && setOwned.find(NormaliseKey(it->path().lexically_relative(m_CompiledPath).string())) == setOwned.end())
+			vStale.push_back(it->path());
+	}
+
+	for (const fs::path& path : vStale)
+		fs::remove(path, ec);
+
+	if (vStale.size())
+		DevMsg(eLog::MODSYS, "Removed %zu stale compiled files\n", vStale.size());
+
+	SaveManifest();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a hash for an asset, seeded with the game files it builds on
+//-----------------------------------------------------------------------------
+CCompiledAssetHash CCompiledAssetCache::CreateHash() const
+{
+	CCompiledAssetHash hash(m_nBaseHash);
+	hash.Update(static_cast<uint64_t>(MANIFEST_VERSION));
+
+	return hash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if an asset was already built from the same inputs
+// Input  : *pszAsset - Path of the file the asset replaces
+//          nHash -
+//-----------------------------------------------------------------------------
+bool CCompiledAssetCache::IsUpToDate(const char* pszAsset, uint64_t nHash)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapAssets.find(NormaliseKey(pszAsset));
+	if (it == m_mapAssets.end() || it->second.nHash != nHash)
+		return false;
+
+	// Someone might have deleted files by hand
+	std::error_code ec;
+	for (const std::string& svOutput : it->second.vOutputs)
+	{
+		if (!fs::exists(m_CompiledPath / svOutput, ec))
+			return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records a built asset, call after all its outputs were written
+// Input  : *pszAsset - Path of the file the asset replaces
+//          nHash -
+//          &vOutputs - Every file the asset wrote, relative to the compiled dir
+//-----------------------------------------------------------------------------
+void CCompiledAssetCache::Store(const char* pszAsset, uint64_t nHash, const std::vector<fs::path>& vOutputs)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Asset_t& asset = m_mapAssets[NormaliseKey(pszAsset)];
+	asset.nHash = nHash;
+	asset.vOutputs.clear();
+
+	for (const fs::path& output : vOutputs)
+		asset.vOutputs.push_back(NormaliseKey(output.string()));
+
+	m_bManifestDirty = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the manifest if an asset was stored since it was last saved
+// Note   : Assets stored but not flushed before a crash aren't lost, Prune
+//          deletes their files and they get built again
+//-----------------------------------------------------------------------------
+void CCompiledAssetCache::Flush()
+{
+	if (!m_bManifestDirty)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	SaveManifest();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a file to a temporary path and renames it into place, so a
+//          crash can never leave a half written asset behind
+// Input  : &relativePath - Relative to the compiled dir
+//          svContents -
+//-----------------------------------------------------------------------------
+bool CCompiledAssetCache::WriteAsset(const fs::path& relativePath, std::string_view svContents)
+{
+	fs::path path = m_CompiledPath / relativePath;
+	fs::path tempPath = path;
+	tempPath += ".tmp";
+
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+
+	std::ofstream fStream(tempPath, std::ios::binary);
+	fStream.write(svContents.data(), svContents.size());
+	fStream.close();
+
+	if (fStream.fail())
+	{
+		Warning(eLog::MODSYS, "Failed to write compiled asset %s\n", relativePath.string().c_str());
+		fs::remove(tempPath, ec);
+		return false;
+	}
+
+	fs::rename(tempPath, path, ec);
+	if (ec)
+	{
+		Warning(eLog::MODSYS, "Failed to write compiled asset %s: %s\n", relativePath.string().c_str(), ec.message().c_str());
+		fs::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Same as WriteAsset but the contents come from a file
+// Input  : &sourcePath -
+//          &relativePath - Relative to the compiled dir
+//-----------------------------------------------------------------------------
+bool CCompiledAssetCache::CopyAsset(const fs::path& sourcePath, const fs::path& relativePath)
+{
+	fs::path path = m_CompiledPath / relativePath;
+	fs::path tempPath = path;
+	tempPath += ".tmp";
+
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+
+	fs::copy_file(sourcePath, tempPath, fs::copy_options::overwrite_existing, ec);
+	if (!ec)
+		fs::rename(tempPath, path, ec);
+
+	if (ec)
+	{
+		Warning(eLog::MODSYS, "Failed to copy %s to compiled assets: %s\n", sourcePath.string().c_str(), ec.message().c_str());
+		fs::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Normalises a path the same way m_ModFiles keys are
+// Input  : &svPath -
+//-----------------------------------------------------------------------------
+std::string CCompiledAssetCache::NormaliseKey(const std::string& svPath)
+{
+	char szNormalised[CModFileIndex::MAX_PATH_LENGTH];
+	return std::string(szNormalised, CModFileIndex::NormalisePath(svPath.c_str(), szNormalised, sizeof(szNormalised)));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes the size and write time of the game's vpk directories,
+//          vanilla files assets are built on top of come from these
+//-----------------------------------------------------------------------------
+uint64_t CCompiledAssetCache::HashGameFiles()
+{
+	// directory_iterator order isn't guaranteed, sort so the hash is stable
+	std::vector<std::tuple<std::string, uintmax_t, int64_t>> vFiles;
+
+	std::error_code ec;
+	for (auto it = fs::directory_iterator("./vpk", ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+	{
+		std::string svName = it->path().filename().string();
+		if (svName.size() < 8 || svName.compare(svName.size() - 8, 8, "_dir.vpk"))
+			continue;
+
+		vFiles.emplace_back(svName, it->file_size(ec), static_cast<int64_t>(it->last_write_time(ec).time_since_epoch().count()));
+	}
+
+	std::sort(vFiles.begin(), vFiles.end());
+
+	CCompiledAssetHash hash(0);
+	for (const auto& [svName, nSize, nWriteTime] : vFiles)
+	{
+		hash.Update(svName);
+		hash.Update(static_cast<uint64_t>(nSize));
+		hash.Update(static_cast<uint64_t>(nWriteTime));
+	}
+
+	return hash.Get();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the manifest, caller holds m_Mutex
+//-----------------------------------------------------------------------------
+void CCompiledAssetCache::SaveManifest()
+{
+	m_bManifestDirty = false;
+
+	nlohmann::json jsManifest;
+	jsManifest["version"] = MANIFEST_VERSION;
+	jsManifest["base"] = m_nBaseHash;
+
+	nlohmann::json& jsAssets = jsManifest["assets"] = nlohmann::json::object();
+	for (const auto& [svKey, asset] : m_mapAssets)
+	{
+		nlohmann::json& jsAsset = jsAssets[svKey];
+		jsAsset["hash"] = asset.nHash;
+		jsAsset["outputs"] = asset.vOutputs;
+	}
+
+	WriteAsset(COMPILED_MANIFEST_NAME, jsManifest.dump(4));
+}
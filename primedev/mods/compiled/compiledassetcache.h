@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+//-----------------------------------------------------------------------------
+// Purpose: Hash of everything a compiled asset is built from
+//-----------------------------------------------------------------------------
+class CCompiledAssetHash
+{
+  public:
+	CCompiledAssetHash(uint64_t nSeed);
+
+	void Update(const void* pData, size_t nSize);
+	void Update(std::string_view svString);
+	void Update(uint64_t nValue);
+	void UpdateFile(const fs::path& path);
+
+	uint64_t Get() const
+	{
+		return m_nHash;
+	}
+
+  private:
+	uint64_t m_nHash;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps compiled assets in runtime/compiled across restarts
+// Note   : A manifest records the hash of the inputs each asset was built
+//          from and which files it wrote, builders only run again when the
+//          hash changes. Files no manifest entry owns get deleted by Prune
+//          since the compiled dir sits at the head of the GAME search path.
+//          Store only marks the manifest dirty, it's written by Flush once a
+//          batch of assets is built
+//-----------------------------------------------------------------------------
+class CCompiledAssetCache
+{
+  public:
+	// Bump when any builder changes what it writes
+	static constexpr int MANIFEST_VERSION = 1;
+
+	void Load(const fs::path& compiledPath);
+	void Prune(const std::vector<std::string>& vAssets);
+
+	CCompiledAssetHash CreateHash() const;
+	bool IsUpToDate(const char* pszAsset, uint64_t nHash);
+	void Store(const char* pszAsset, uint64_t nHash, const std::vector<fs::path>& vOutputs);
+	void Flush();
+
+	bool WriteAsset(const fs::path& relativePath, std::string_view svContents);
+	bool CopyAsset(const fs::path& sourcePath, const fs::path& relativePath);
+
+  private:
+	struct Asset_t
+	{
+		uint64_t nHash;
+		// Paths relative to the compiled dir, normalised
+		std::vector<std::string> vOutputs;
+	};
+
+	static std::string NormaliseKey(const std::string& svPath);
+	static uint64_t HashGameFiles();
+
+	void SaveManifest();
+
+	std::mutex m_Mutex;
+	fs::path m_CompiledPath;
+
+	// Game files every asset is built on top of, changes when the game updates
+	uint64_t m_nBaseHash = 0;
+	std::unordered_map<std::string, Asset_t> m_mapAssets;
+
+	// Set by Store, checked without the lock every frame
+	std::atomic<bool> m_bManifestDirty = false;
+};
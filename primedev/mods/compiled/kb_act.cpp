@@ -2,18 +2,33 @@
 #include "filesystem/basefilesystem.h"
 
 #include <fstream>
+#include <sstream>
 
 const char* KB_ACT_PATH = "scripts\\kb_act.lst";
 
 // compiles the file kb_act.lst, that defines entries for keybindings in the options menu
 void ModManager::BuildKBActionsList()
 {
+	CCompiledAssetHash hash = m_CompiledAssetCache.CreateHash();
+	for (Mod& mod : m_LoadedMods)
+	{
+		if (mod.m_bEnabled)
+			hash.UpdateFile(mod.m_ModDirectory / "kb_act.lst");
+	}
+
+	if (m_CompiledAssetCache.IsUpToDate(KB_ACT_PATH, hash.Get()))
+	{
+		AddCompiledAssetOverride(KB_ACT_PATH);
+		return;
+	}
+
 	DevMsg(eLog::MODSYS, "Building kb_act.lst\n");
 
-	fs::create_directories(GetCompiledAssetsPath() / "scripts");
-	std::ofstream soCompiledKeys(GetCompiledAssetsPath() / KB_ACT_PATH, std::ios::binary);
+	// The compiled dir is searched first, get it out of the way so we read the vanilla file
+	fs::remove(GetCompiledAssetsPath() / KB_ACT_PATH);
 
 	// write vanilla file's content to compiled file
+	std::ostringstream soCompiledKeys;
 	soCompiledKeys << ReadVPKOriginalFile(KB_ACT_PATH);
 
 	for (Mod& mod : m_LoadedMods)
@@ -30,15 +45,9 @@ void ModManager::BuildKBActionsList()
 		siModKeys.close();
 	}
 
-	soCompiledKeys.close();
+	if (m_CompiledAssetCache.WriteAsset(KB_ACT_PATH, soCompiledKeys.str()))
+		m_CompiledAssetCache.Store(KB_ACT_PATH, hash.Get(), {KB_ACT_PATH});
 
 	// push to overrides
-	ModOverrideFile overrideFile;
-	overrideFile.m_pOwningMod = nullptr;
-	overrideFile.m_Path = KB_ACT_PATH;
-
-	if (m_ModFiles.find(KB_ACT_PATH) == m_ModFiles.end())
-		m_ModFiles.insert(std::make_pair(KB_ACT_PATH, overrideFile));
-	else
-		m_ModFiles[KB_ACT_PATH] = overrideFile;
+	AddCompiledAssetOverride(KB_ACT_PATH);
 }
@@ -1,22 +1,39 @@
 #include "mods/modmanager.h"
 #include "filesystem/basefilesystem.h"
 
-#include <fstream>
-
 void ModManager::TryBuildKeyValues(const char* filename)
 {
+	std::string normalisedPath = g_pModManager->NormaliseModFilePath(fs::path(filename));
+	size_t fileHash = STR_HASH(normalisedPath);
+
+	CCompiledAssetHash hash = m_CompiledAssetCache.CreateHash();
+	hash.Update(normalisedPath);
+
+	for (int64_t i = m_LoadedMods.size() - 1; i > -1; i--)
+	{
+		if (m_LoadedMods[i].m_bEnabled && m_LoadedMods[i].KeyValues.find(fileHash) != m_LoadedMods[i].KeyValues.end())
+			hash.UpdateFile(m_LoadedMods[i].m_ModDirectory / "keyvalues" / filename);
+	}
+
+	if (m_CompiledAssetCache.IsUpToDate(normalisedPath.c_str(), hash.Get()))
+	{
+		AddCompiledAssetOverride(normalisedPath.c_str());
+		return;
+	}
+
 	DevMsg(eLog::MODSYS, "Building KeyValues for file %s\n", filename);
 
-	std::string normalisedPath = g_pModManager->NormaliseModFilePath(fs::path(filename));
-	fs::path compiledPath = GetCompiledAssetsPath() / filename;
-	fs::path compiledDir = compiledPath.parent_path();
-	fs::create_directories(compiledDir);
+	fs::path compiledDir = fs::path(filename).parent_path();
+
+	// The compiled dir is searched first, get our last build out of the way so we read the vanilla file
+	fs::remove(GetCompiledAssetsPath() / filename);
 
 	fs::path kvPath(filename);
 	std::string ogFilePath = "mod_original_";
 	ogFilePath += kvPath.filename().string();
 
 	std::string newKvs = "// AUTOGENERATED: MOD PATCH KV\n";
+	std::vector<fs::path> vOutputs;
 
 	int patchNum = 0;
 
@@ -27,7 +44,6 @@ void ModManager::TryBuildKeyValues(const char* filename)
 		if (!m_LoadedMods[i].m_bEnabled)
 			continue;
 
-		size_t fileHash = STR_HASH(normalisedPath);
 		auto modKv = m_LoadedMods[i].KeyValues.find(fileHash);
 		if (modKv != m_LoadedMods[i].KeyValues.end())
 		{
@@ -42,9 +58,10 @@ void ModManager::TryBuildKeyValues(const char* filename)
 			newKvs += patchFilePath;
 			newKvs += "\"\n";
 
-			fs::remove(compiledDir / patchFilePath);
+			if (!m_CompiledAssetCache.CopyAsset(m_LoadedMods[i].m_ModDirectory / "keyvalues" / filename, compiledDir / patchFilePath))
+				return;
 
-			fs::copy_file(m_LoadedMods[i].m_ModDirectory / "keyvalues" / filename, compiledDir / patchFilePath);
+			vOutputs.push_back(compiledDir / patchFilePath);
 		}
 	}
 
@@ -84,20 +101,12 @@ void ModManager::TryBuildKeyValues(const char* filename)
 	newKvs += rootName;
 	newKvs += "\n{\n}\n";
 
-	std::ofstream originalFileWriteStream(compiledDir / ogFilePath, std::ios::binary);
-	originalFileWriteStream << originalFile;
-	originalFileWriteStream.close();
-
-	std::ofstream writeStream(compiledPath, std::ios::binary);
-	writeStream << newKvs;
-	writeStream.close();
+	if (!m_CompiledAssetCache.WriteAsset(compiledDir / ogFilePath, originalFile) || !m_CompiledAssetCache.WriteAsset(filename, newKvs))
+		return;
 
-	ModOverrideFile overrideFile;
-	overrideFile.m_pOwningMod = nullptr;
-	overrideFile.m_Path = normalisedPath;
+	vOutputs.push_back(compiledDir / ogFilePath);
+	vOutputs.push_back(filename);
+	m_CompiledAssetCache.Store(normalisedPath.c_str(), hash.Get(), vOutputs);
 
-	if (m_ModFiles.find(normalisedPath) == m_ModFiles.end())
-		m_ModFiles.insert(std::make_pair(normalisedPath, overrideFile));
-	else
-		m_ModFiles[normalisedPath] = overrideFile;
+	AddCompiledAssetOverride(normalisedPath.c_str());
 }
@@ -3,18 +3,32 @@
 
 #include <map>
 #include <sstream>
-#include <fstream>
 
 const fs::path MOD_PDEF_SUFFIX = "cfg/server/persistent_player_data_version_231.pdef";
 const char* VPK_PDEF_PATH = "cfg/server/persistent_player_data_version_231.pdef";
 
 void ModManager::BuildPdef()
 {
-	DevMsg(eLog::MODSYS, "Building persistent_player_data_version_231.pdef...\n");
+	CCompiledAssetHash hash = m_CompiledAssetCache.CreateHash();
+	for (Mod& mod : m_LoadedMods)
+	{
+		if (!mod.m_bEnabled || !mod.Pdiff.size())
+			continue;
 
-	fs::path MOD_PDEF_PATH = fs::path(GetCompiledAssetsPath() / MOD_PDEF_SUFFIX);
+		hash.Update(mod.Name);
+		hash.Update(mod.Pdiff);
+	}
 
-	fs::remove(MOD_PDEF_PATH);
+	if (m_CompiledAssetCache.IsUpToDate(VPK_PDEF_PATH, hash.Get()))
+	{
+		AddCompiledAssetOverride(VPK_PDEF_PATH);
+		return;
+	}
+
+	DevMsg(eLog::MODSYS, "Building persistent_player_data_version_231.pdef...\n");
+
+	// The compiled dir is searched first, get it out of the way so we read the vanilla file
+	fs::remove(GetCompiledAssetsPath() / MOD_PDEF_SUFFIX);
 	std::string pdef = ReadVPKOriginalFile(VPK_PDEF_PATH);
 
 	for (Mod& mod : m_LoadedMods)
@@ -101,18 +115,8 @@ void ModManager::BuildPdef()
 		}
 	}
 
-	fs::create_directories(MOD_PDEF_PATH.parent_path());
-
-	std::ofstream writeStream(MOD_PDEF_PATH, std::ios::binary);
-	writeStream << pdef;
-	writeStream.close();
-
-	ModOverrideFile overrideFile;
-	overrideFile.m_pOwningMod = nullptr;
-	overrideFile.m_Path = VPK_PDEF_PATH;
+	if (m_CompiledAssetCache.WriteAsset(MOD_PDEF_SUFFIX, pdef))
+		m_CompiledAssetCache.Store(VPK_PDEF_PATH, hash.Get(), {MOD_PDEF_SUFFIX});
 
-	if (m_ModFiles.find(VPK_PDEF_PATH) == m_ModFiles.end())
-		m_ModFiles.insert(std::make_pair(VPK_PDEF_PATH, overrideFile));
-	else
-		m_ModFiles[VPK_PDEF_PATH] = overrideFile;
+	AddCompiledAssetOverride(VPK_PDEF_PATH);
 }
@@ -1,16 +1,37 @@
 #include "mods/modmanager.h"
 #include "filesystem/basefilesystem.h"
 
-#include <fstream>
-
 const std::string MOD_SCRIPTS_RSON_SUFFIX = "scripts/vscripts/scripts.rson";
 const char* VPK_SCRIPTS_RSON_PATH = "scripts\\vscripts\\scripts.rson";
 
 void ModManager::BuildScriptsRson()
 {
+	CCompiledAssetHash hash = m_CompiledAssetCache.CreateHash();
+	for (Mod& mod : m_LoadedMods)
+	{
+		if (!mod.m_bEnabled)
+			continue;
+
+		hash.Update(mod.Name);
+		hash.Update(static_cast<uint64_t>(mod.Scripts.size()));
+
+		for (ModScript& script : mod.Scripts)
+		{
+			hash.Update(script.RunOn);
+			hash.Update(script.Path);
+		}
+	}
+
+	if (m_CompiledAssetCache.IsUpToDate(VPK_SCRIPTS_RSON_PATH, hash.Get()))
+	{
+		AddCompiledAssetOverride(VPK_SCRIPTS_RSON_PATH);
+		return;
+	}
+
 	DevMsg(eLog::MODSYS, "Building custom scripts.rson\n");
-	fs::path MOD_SCRIPTS_RSON_PATH = fs::path(GetCompiledAssetsPath() / MOD_SCRIPTS_RSON_SUFFIX);
-	fs::remove(MOD_SCRIPTS_RSON_PATH);
+
+	// The compiled dir is searched first, get it out of the way so we read the vanilla file
+	fs::remove(GetCompiledAssetsPath() / MOD_SCRIPTS_RSON_SUFFIX);
 
 	std::string scriptsRson = ReadVPKOriginalFile(VPK_SCRIPTS_RSON_PATH);
 	scriptsRson += "\n\n// START MODDED SCRIPT CONTENT\n\n"; // newline before we start custom stuff
@@ -44,20 +65,10 @@ void ModManager::BuildScriptsRson()
 		}
 	}
 
-	fs::create_directories(MOD_SCRIPTS_RSON_PATH.parent_path());
-
-	std::ofstream writeStream(MOD_SCRIPTS_RSON_PATH, std::ios::binary);
-	writeStream << scriptsRson;
-	writeStream.close();
-
-	ModOverrideFile overrideFile;
-	overrideFile.m_pOwningMod = nullptr;
-	overrideFile.m_Path = VPK_SCRIPTS_RSON_PATH;
+	if (m_CompiledAssetCache.WriteAsset(MOD_SCRIPTS_RSON_SUFFIX, scriptsRson))
+		m_CompiledAssetCache.Store(VPK_SCRIPTS_RSON_PATH, hash.Get(), {MOD_SCRIPTS_RSON_SUFFIX});
 
-	if (m_ModFiles.find(VPK_SCRIPTS_RSON_PATH) == m_ModFiles.end())
-		m_ModFiles.insert(std::make_pair(VPK_SCRIPTS_RSON_PATH, overrideFile));
-	else
-		m_ModFiles[VPK_SCRIPTS_RSON_PATH] = overrideFile;
+	AddCompiledAssetOverride(VPK_SCRIPTS_RSON_PATH);
 
 	// todo: for preventing dupe scripts in scripts.rson, we could actually parse when conditions with the squirrel vm, just need a way to
 	// get a result out of squirrelmanager.ExecuteCode this would probably be the best way to do this, imo
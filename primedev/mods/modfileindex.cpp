@@ -0,0 +1,201 @@
+#include "mods/modfileindex.h"
+#include "mods/modmanager.h"
+
+static std::atomic<uint32_t> s_nIndexGeneration = 0;
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the index
+// Input  : &mapModFiles -
+//-----------------------------------------------------------------------------
+CModFileIndex::CModFileIndex(const std::unordered_map<std::string, ModOverrideFile>& mapModFiles)
+	: m_nNumFiles(0), m_nGeneration(++s_nIndexGeneration)
+{
+	// Keep the load factor at or below a half so misses stop early
+	size_t nCapacity = 16;
+	while (nCapacity < mapModFiles.size() * 2)
+		nCapacity <<= 1;
+
+	m_vEntries.assign(nCapacity, Entry_t {0, 0, 0, 0});
+	m_nMask = nCapacity - 1;
+
+	// Files of the same mod share one result
+	std::unordered_map<const Mod*, uint32_t> mapFileForMod;
+
+	char szNormalised[MAX_PATH_LENGTH];
+	for (const auto& modFilePair : mapModFiles)
+	{
+		// Run keys through the same normaliser lookups use so both always agree
+		size_t nLength = NormalisePath(modFilePair.first.c_str(), szNormalised, sizeof(szNormalised));
+		if (!nLength)
+			continue;
+
+		std::string_view svPath(szNormalised, nLength);
+		if (Find(svPath))
+			continue;
+
+		const Mod* pMod = modFilePair.second.m_pOwningMod;
+		auto itFile = mapFileForMod.find(pMod);
+		if (itFile == mapFileForMod.end())
+		{
+			File_t& file = m_vFiles.emplace_back();
+			if (pMod)
+				file.svSearchPath = (fs::absolute(pMod->m_ModDirectory) / MOD_OVERRIDE_DIR).string();
+
+			itFile = mapFileForMod.emplace(pMod, static_cast<uint32_t>(m_vFiles.size() - 1)).first;
+		}
+
+		uint64_t nHash = HashPath(svPath);
+		size_t nSlot = nHash & m_nMask;
+		while (m_vEntries[nSlot].nLength)
+			nSlot = (nSlot + 1) & m_nMask;
+
+		Entry_t& entry = m_vEntries[nSlot];
+		entry.nHash = nHash;
+		entry.nOffset = static_cast<uint32_t>(m_svStrings.size());
+		entry.nLength = static_cast<uint32_t>(nLength);
+		entry.nFile = itFile->second;
+
+		m_svStrings.append(svPath);
+		m_nNumFiles++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the mod file overriding a path
+// Input  : svNormalisedPath - Output of NormalisePath
+// Output : nullptr if no mod overrides this path
+//-----------------------------------------------------------------------------
+const CModFileIndex::File_t* CModFileIndex::Find(std::string_view svNormalisedPath) const
+{
+	uint64_t nHash = HashPath(svNormalisedPath);
+
+	for (size_t nSlot = nHash & m_nMask;; nSlot = (nSlot + 1) & m_nMask)
+	{
+		const Entry_t& entry = m_vEntries[nSlot];
+		if (!entry.nLength)
+			return nullptr;
+
+		if (entry.nHash == nHash && entry.nLength == svNormalisedPath.size() && !memcmp(m_svStrings.data() + entry.nOffset, svNormalisedPath.data(), entry.nLength))
+			return &m_vFiles[entry.nFile];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 64 bit FNV-1a
+// Input  : svPath -
+//-----------------------------------------------------------------------------
+uint64_t CModFileIndex::HashPath(std::string_view svPath)
+{
+	uint64_t nHash = 0xCBF29CE484222325ull;
+	for (char c : svPath)
+	{
+		nHash ^= static_cast<uint8_t>(c);
+		nHash *= 0x100000001B3ull;
+	}
+
+	return nHash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Allocation free version of ModManager::NormaliseModFilePath, does
+//          what fs::path::lexically_normal does with backslashes as separator
+//          and lowercases the result
+// Input  : *pszPath -
+//          *pszOut - Buffer to write to
+//          nOutSize - Size of pszOut
+// Output : Length of the normalised path, 0 if it didn't fit
+//-----------------------------------------------------------------------------
+size_t CModFileIndex::NormalisePath(const char* pszPath, char* pszOut, size_t nOutSize)
+{
+	auto IsSeparator = [](char c) { return c == '/' || c == '\\'; };
+
+	if (!*pszPath || nOutSize < 2)
+		return 0;
+
+	// Where each segment we wrote starts so '..' can drop the last one
+	size_t nSegmentStarts[MAX_PATH_LENGTH / 2];
+	size_t nNumSegments = 0;
+	size_t nLength = 0;
+	bool bHasRoot = false;
+
+	const char* p = pszPath;
+	if (IsSeparator(*p))
+	{
+		pszOut[nLength++] = '\\';
+		bHasRoot = true;
+
+		while (IsSeparator(*p))
+			p++;
+	}
+
+	bool bLastWasDotDot = false;
+	while (*p)
+	{
+		const char* pszSegment = p;
+		while (*p && !IsSeparator(*p))
+			p++;
+
+		size_t nSegment = p - pszSegment;
+		bool bHasSeparator = *p != '\0';
+
+		// Collapse repeated separators
+		while (IsSeparator(*p))
+			p++;
+
+		// Drop '.' along with its separator
+		if (nSegment == 1 && pszSegment[0] == '.')
+			continue;
+
+		if (nSegment == 2 && pszSegment[0] == '.' && pszSegment[1] == '.')
+		{
+			// 'dir\..' cancels out
+			if (nNumSegments && !bLastWasDotDot)
+			{
+				nLength = nSegmentStarts[--nNumSegments];
+
+				bLastWasDotDot = false;
+				if (nNumSegments)
+				{
+					const char* pszPrev = pszOut + nSegmentStarts[nNumSegments - 1];
+					bLastWasDotDot = pszPrev[0] == '.' && pszPrev[1] == '.' && pszPrev + 2 == pszOut + nLength - 1;
+				}
+
+				continue;
+			}
+
+			// Can't go above the root
+			if (bHasRoot)
+				continue;
+
+			bLastWasDotDot = true;
+		}
+		else
+		{
+			bLastWasDotDot = false;
+		}
+
+		if (nNumSegments == ARRAY_SIZE(nSegmentStarts) || nLength + nSegment + 2 > nOutSize)
+			return 0;
+
+		nSegmentStarts[nNumSegments++] = nLength;
+
+		for (size_t i = 0; i < nSegment; i++)
+		{
+			char c = pszSegment[i];
+			pszOut[nLength++] = c >= 'A' && c <= 'Z' ? c - ('Z' - 'z') : c;
+		}
+
+		if (bHasSeparator)
+			pszOut[nLength++] = '\\';
+	}
+
+	// A trailing '..' loses its separator
+	if (bLastWasDotDot && pszOut[nLength - 1] == '\\')
+		nLength--;
+
+	if (!nLength)
+		pszOut[nLength++] = '.';
+
+	pszOut[nLength] = '\0';
+	return nLength;
+}
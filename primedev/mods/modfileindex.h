@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string_view>
+
+struct ModOverrideFile;
+
+//-----------------------------------------------------------------------------
+// Purpose: Flat, immutable lookup table from normalised path to the mod file
+//          overriding it. Built from ModManager::m_ModFiles whenever that
+//          changes, so the filesystem hooks can look paths up without
+//          allocating
+// Note   : Results are copied into the index instead of pointing at
+//          m_ModFiles or the owning mod, a reader holding the index can use
+//          them while mods get unloaded
+//-----------------------------------------------------------------------------
+class CModFileIndex
+{
+  public:
+	// Longest path NormalisePath can handle, including the terminator
+	static constexpr size_t MAX_PATH_LENGTH = 1024;
+
+	// What an overridden path resolves to
+	struct File_t
+	{
+		// Absolute path of the owning mod's override folder, empty for compiled assets
+		std::string svSearchPath;
+	};
+
+	CModFileIndex(const std::unordered_map<std::string, ModOverrideFile>& mapModFiles);
+
+	const File_t* Find(std::string_view svNormalisedPath) const;
+
+	// Changes every time an index is built
+	uint32_t GetGeneration() const
+	{
+		return m_nGeneration;
+	}
+
+	size_t GetNumFiles() const
+	{
+		return m_nNumFiles;
+	}
+
+	static size_t NormalisePath(const char* pszPath, char* pszOut, size_t nOutSize);
+	static uint64_t HashPath(std::string_view svPath);
+
+  private:
+	struct Entry_t
+	{
+		uint64_t nHash;
+		uint32_t nOffset;
+		// 0 for empty slots, normalised paths are never empty
+		uint32_t nLength;
+		uint32_t nFile;
+	};
+
+	// Interned keys, entries point into this
+	std::string m_svStrings;
+	std::vector<Entry_t> m_vEntries;
+	// One per owning mod, entries index into this
+	std::vector<File_t> m_vFiles;
+	size_t m_nMask;
+	size_t m_nNumFiles;
+
+	uint32_t m_nGeneration;
+};
@@ -10,6 +10,7 @@
 
 #include "tier0/filestream.h"
 #include "tier0/taskscheduler.h"
+#include "tier0/jobsystem.h"
 
 ModManager* g_pModManager;
 
@@ -237,6 +238,8 @@ ModManager::ModManager()
 	m_hPdefHash = STR_HASH("cfg\\server\\persistent_player_data_version_231.pdef" // this can have multiple versions, but we use 231 so that's what we hash
 	);
 	m_hKBActHash = STR_HASH("scripts\\kb_act.lst");
+
+	RebuildModFileIndex();
 }
 
 template <ScriptContext context>
@@ -379,181 +382,73 @@ void ModConCommandCallback(const CCommand& command)
 	};
 }
 
-void ModManager::LoadMods()
+//-----------------------------------------------------------------------------
+// Everything LoadMods reads from a mod's directory. Filled in on a worker so
+// only registering the results has to happen in load order
+struct ModScanResult_t
 {
-	// Unload mods first
-	if (m_bHasLoadedMods)
-		UnloadMods();
-
-	// Ensure dirs exist
-	fs::remove_all(GetCompiledAssetsPath());
-	fs::create_directories(GetModFolderPath());
-	fs::create_directories(GetThunderstoreModFolderPath());
-	fs::create_directories(GetRemoteModFolderPath());
-
-	// Read enabled mods cfg
-	nlohmann::json jsEnabledModsCfg;
-	bool bHasEnabledModsCfg = false;
-
-	try
+	// Null if mod.json couldn't be read
+	std::unique_ptr<Mod> pMod;
+
+	// Vpks to mount right away when reloading mods
+	std::vector<std::string> vAutoMountVpks;
+	// Audio override definitions, these register globally so they're loaded on the calling thread
+	std::vector<fs::path> vAudioDefs;
+	// Normalised paths of all files in the mod's override dir
+	std::vector<std::string> vOverrideFiles;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads mod.json and, if the mod is enabled, everything else in its
+//          directory. Safe to run on any thread, touches no global state
+// Input  : &modDir -
+//          *pjsEnabledModsCfg - Parsed enabledmods.json, nullptr if there is none
+//          &result -
+//-----------------------------------------------------------------------------
+static void ScanModDirectory(const fs::path& modDir, const nlohmann::json* pjsEnabledModsCfg, ModScanResult_t& result)
+{
+	// First read mod.json
+	std::string svModJson;
+	CFileStream fStream;
+	if (fStream.Open(FormatA("%s/mod.json", modDir.string().c_str()).c_str(), CFileStream::READ))
 	{
-		std::string svEnabledModsCfg;
-		CFileStream fStream;
-
-		if (fStream.Open(FormatA("%s/enabledmods.json", g_svProfileDir.c_str()).c_str(), CFileStream::READ))
-		{
-			fStream.ReadString(svEnabledModsCfg);
-			fStream.Close();
-
-			jsEnabledModsCfg = nlohmann::json::parse(svEnabledModsCfg);
-
-			bHasEnabledModsCfg = true;
-		}
+		fStream.ReadString(svModJson);
+		fStream.Close();
 	}
-	catch (const std::exception& ex)
+	else
 	{
-		NOTE_UNUSED(ex);
-		Error(eLog::MODSYS, NO_ERROR, "Failed to parse enabledmods.json\n");
+		Warning(eLog::MODSYS, "Mod file at '%s' does not exist or could not be read, is it installed correctly?\n", (modDir / "mod.json").string().c_str());
+		return;
 	}
 
-	std::vector<fs::path> vModDirs;
-
-	// Get mod directories
-	fs::directory_iterator fsClassicModsDir = fs::directory_iterator(GetModFolderPath());
-	fs::directory_iterator fsRemoteModsDir = fs::directory_iterator(GetRemoteModFolderPath());
+	// Parse mod.json
+	result.pMod = std::make_unique<Mod>(modDir, svModJson);
+	Mod& mod = *result.pMod;
 
-	// Collect all mods in classic and remote mod dirs
-	for (fs::directory_iterator modIterator : {fsClassicModsDir, fsRemoteModsDir})
-		for (fs::directory_entry dir : modIterator)
-			if (FileExists(dir.path() / "mod.json"))
-				vModDirs.push_back(dir.path());
-
-	// Collect all thunderstore mods and make sure the package dir matches AUTHOR-MOD-VERSION
-	fs::directory_iterator thunderstoreModsDir = fs::directory_iterator(GetThunderstoreModFolderPath());
-	std::regex pattern(R"(.*\\([a-zA-Z0-9_]+)-([a-zA-Z0-9_]+)-(\d+\.\d+\.\d+))");
-	for (fs::directory_entry dir : thunderstoreModsDir)
+	// Check if it should be enabled
+	if (pjsEnabledModsCfg)
 	{
-		fs::path modsDir = dir.path() / "mods"; // Check for mods folder in the Thunderstore mod
-		// Use regex to match `AUTHOR-MOD-VERSION` pattern
-		if (!std::regex_match(dir.path().string(), pattern))
+		try
 		{
-			Warning(eLog::MODSYS, "The following directory did not match 'AUTHOR-MOD-VERSION': %s\n", dir.path().string().c_str());
-			continue; // skip loading mod that doesn't match
+			mod.m_bEnabled = pjsEnabledModsCfg->value(mod.Name, true);
 		}
-		if (FileExists(modsDir) && fs::is_directory(modsDir))
+		catch (const std::exception& ex)
 		{
-			for (fs::directory_entry subDir : fs::directory_iterator(modsDir))
-			{
-				if (FileExists(subDir.path() / "mod.json"))
-				{
-					vModDirs.push_back(subDir.path());
-				}
-			}
+			NOTE_UNUSED(ex);
+			mod.m_bEnabled = true;
+			Error(eLog::MODSYS, NO_ERROR, "enabledmods.json: '%s' has incorrect type ( expected bool )\n", mod.Name.c_str());
 		}
 	}
-
-	// Try to load all collected mods
-	for (fs::path modDir : vModDirs)
+	else
 	{
-		// First read mod.json
-		std::string svModJson;
-		CFileStream fStream;
-		if (fStream.Open(FormatA("%s/mod.json", modDir.string().c_str()).c_str(), CFileStream::READ))
-		{
-			fStream.ReadString(svModJson);
-			fStream.Close();
-		}
-		else
-		{
-			Warning(eLog::MODSYS, "Mod file at '%s' does not exist or could not be read, is it installed correctly?\n", (modDir / "mod.json").string().c_str());
-			continue;
-		}
-
-		// Parse mod.json
-		Mod mod(modDir, svModJson);
-
-		// Setup mod dependencies
-		for (auto& pair : mod.DependencyConstants)
-		{
-			if (m_DependencyConstants.find(pair.first) != m_DependencyConstants.end() && m_DependencyConstants[pair.first] != pair.second)
-			{
-				Error(eLog::MODSYS, NO_ERROR,
-					  "'%s' attempted to register a dependency constant '%s' for '%s' that already exists for '%s'. "
-					  "Change the constant name.\n",
-					  mod.Name.c_str(), pair.first.c_str(), pair.second.c_str(), m_DependencyConstants[pair.first].c_str());
-				mod.m_bWasReadSuccessfully = false;
-				break;
-			}
-			if (m_DependencyConstants.find(pair.first) == m_DependencyConstants.end())
-				m_DependencyConstants.emplace(pair);
-		}
-
-		// Check if it should be enabled
-		if (bHasEnabledModsCfg)
-		{
-			try
-			{
-				mod.m_bEnabled = jsEnabledModsCfg.value(mod.Name, true);
-			}
-			catch (const std::exception& ex)
-			{
-				NOTE_UNUSED(ex);
-				mod.m_bEnabled = true;
-				Error(eLog::MODSYS, NO_ERROR, "enabledmods.json: '%s' has incorrect type ( expected bool )\n", mod.Name.c_str());
-			}
-		}
-		else
-		{
-			mod.m_bEnabled = true;
-		}
-
-		// If succesful add it to m_LoadedMods, otherwise don't
-		if (mod.m_bWasReadSuccessfully)
-		{
-			if (mod.m_bEnabled)
-				DevMsg(eLog::MODSYS, "'%s' loaded successfully\n", mod.Name.c_str());
-			else
-				DevMsg(eLog::MODSYS, "'%s' loaded successfully (DISABLED)\n", mod.Name.c_str());
-
-			m_LoadedMods.push_back(mod);
-		}
-		else
-		{
-			Warning(eLog::MODSYS, "Mod file at '%s' failed to load\n", (modDir / "mod.json").string().c_str());
-		}
+		mod.m_bEnabled = true;
 	}
 
-	// sort by load prio, lowest-highest
-	std::sort(m_LoadedMods.begin(), m_LoadedMods.end(), [](Mod& a, Mod& b) { return a.LoadPriority < b.LoadPriority; });
+	if (!mod.m_bWasReadSuccessfully || !mod.m_bEnabled)
+		return;
 
-	for (Mod& mod : m_LoadedMods)
+	try
 	{
-		if (!mod.m_bEnabled)
-			continue;
-
-		// register convars
-		// for reloads, this is sorta barebones, when we have a good findconvar method, we could probably reset flags and stuff on
-		// preexisting convars note: we don't delete convars if they already exist because they're used for script stuff, unfortunately this
-		// causes us to leak memory on reload, but not much, potentially find a way to not do this at some point
-		for (ModConVar* convar : mod.ConVars)
-		{
-			// make sure convar isn't registered yet, unsure if necessary but idk what
-			// behaviour is for defining same convar multiple times
-			if (!g_pCVar->FindVar(convar->Name.c_str()))
-			{
-				ConVar::StaticCreate(convar->Name.c_str(), convar->DefaultValue.c_str(), convar->Flags, convar->HelpString.c_str());
-			}
-		}
-
-		for (ModConCommand* command : mod.ConCommands)
-		{
-			// make sure command isnt't registered multiple times.
-			if (!g_pCVar->FindCommand(command->Name.c_str()))
-			{
-				ConCommand::StaticCreate(command->Name.c_str(), command->HelpString.c_str(), command->Flags, ModConCommandCallback, nullptr);
-			}
-		}
-
 		// read vpk paths
 		if (FileExists(mod.m_ModDirectory / "vpk"))
 		{
@@ -561,7 +456,6 @@ void ModManager::LoadMods()
 			nlohmann::json jsVpk;
 			bool bHasVpkCfg = false;
 
-			CFileStream fStream;
 			if (fStream.Open(mod.m_ModDirectory / "vpk/vpk.json", CFileStream::READ))
 			{
 				std::string svVpk;
@@ -596,8 +490,8 @@ void ModManager::LoadMods()
 
 					mod.Vpks.emplace_back(modVpk);
 
-					if (m_bHasLoadedMods && modVpk.m_bAutoLoad)
-						g_pFilesystem->m_vtable->MountVPK(g_pFilesystem, vpkName.c_str());
+					if (modVpk.m_bAutoLoad)
+						result.vAutoMountVpks.push_back(vpkName);
 				}
 			}
 		}
@@ -609,7 +503,6 @@ void ModManager::LoadMods()
 			nlohmann::json jsRPak;
 			bool bHasRPakCfg = false;
 
-			CFileStream fStream;
 			if (fStream.Open(mod.m_ModDirectory / "paks/rpak.json", CFileStream::READ))
 			{
 				std::string svRPak;
@@ -691,8 +584,7 @@ void ModManager::LoadMods()
 							// only add the string we are making if it isnt empty
 							if (!str.empty())
 							{
-								mod.StarpakPaths.push_back(STR_HASH(str));
-								DevMsg(eLog::MODSYS, "Mod %s registered starpak '%s'\n", mod.Name.c_str(), str.c_str());
+								mod.StarpakPaths.push_back(str);
 								str = "";
 							}
 						}
@@ -743,68 +635,285 @@ void ModManager::LoadMods()
 					mod.BinkVideos.push_back(file.path().filename().string());
 		}
 
-		// try to load audio
+		// find audio defs
 		if (FileExists(mod.m_ModDirectory / "audio"))
 		{
 			for (fs::directory_entry file : fs::directory_iterator(mod.m_ModDirectory / "audio"))
 			{
 				if (fs::is_regular_file(file) && file.path().extension().string() == ".json")
+					result.vAudioDefs.push_back(file.path());
+			}
+		}
+
+		// find override files
+		if (FileExists(mod.m_ModDirectory / MOD_OVERRIDE_DIR))
+		{
+			for (fs::directory_entry file : fs::recursive_directory_iterator(mod.m_ModDirectory / MOD_OVERRIDE_DIR))
+			{
+				if (file.is_regular_file())
+					result.vOverrideFiles.push_back(g_pModManager->NormaliseModFilePath(file.path().lexically_relative(mod.m_ModDirectory / MOD_OVERRIDE_DIR)));
+			}
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		Error(eLog::MODSYS, NO_ERROR, "Failed to read files of mod '%s': %s\n", mod.Name.c_str(), ex.what());
+		mod.m_bWasReadSuccessfully = false;
+	}
+}
+
+void ModManager::LoadMods()
+{
+	// Unload mods first
+	if (m_bHasLoadedMods)
+		UnloadMods();
+
+	// Compiled assets from the last run are kept, anything that no longer matches gets rebuilt or pruned
+	m_CompiledAssetCache.Load(GetCompiledAssetsPath());
+
+	// Ensure dirs exist
+	fs::create_directories(GetModFolderPath());
+	fs::create_directories(GetThunderstoreModFolderPath());
+	fs::create_directories(GetRemoteModFolderPath());
+
+	// Read enabled mods cfg
+	nlohmann::json jsEnabledModsCfg;
+	bool bHasEnabledModsCfg = false;
+
+	try
+	{
+		std::string svEnabledModsCfg;
+		CFileStream fStream;
+
+		if (fStream.Open(FormatA("%s/enabledmods.json", g_svProfileDir.c_str()).c_str(), CFileStream::READ))
+		{
+			fStream.ReadString(svEnabledModsCfg);
+			fStream.Close();
+
+			jsEnabledModsCfg = nlohmann::json::parse(svEnabledModsCfg);
+
+			bHasEnabledModsCfg = true;
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		NOTE_UNUSED(ex);
+		Error(eLog::MODSYS, NO_ERROR, "Failed to parse enabledmods.json\n");
+	}
+
+	std::vector<fs::path> vModDirs;
+
+	// Get mod directories
+	fs::directory_iterator fsClassicModsDir = fs::directory_iterator(GetModFolderPath());
+	fs::directory_iterator fsRemoteModsDir = fs::directory_iterator(GetRemoteModFolderPath());
+
+	// Collect all mods in classic and remote mod dirs
+	for (fs::directory_iterator modIterator : {fsClassicModsDir, fsRemoteModsDir})
+		for (fs::directory_entry dir : modIterator)
+			if (FileExists(dir.path() / "mod.json"))
+				vModDirs.push_back(dir.path());
+
+	// Collect all thunderstore mods and make sure the package dir matches AUTHOR-MOD-VERSION
+	fs::directory_iterator thunderstoreModsDir = fs::directory_iterator(GetThunderstoreModFolderPath());
+	std::regex pattern(R"(.*\\([a-zA-Z0-9_]+)-([a-zA-Z0-9_]+)-(\d+\.\d+\.\d+))");
+	for (fs::directory_entry dir : thunderstoreModsDir)
+	{
+		fs::path modsDir = dir.path() / "mods"; // Check for mods folder in the Thunderstore mod
+		// Use regex to match `AUTHOR-MOD-VERSION` pattern
+		if (!std::regex_match(dir.path().string(), pattern))
+		{
+			Warning(eLog::MODSYS, "The following directory did not match 'AUTHOR-MOD-VERSION': %s\n", dir.path().string().c_str());
+			continue; // skip loading mod that doesn't match
+		}
+		if (FileExists(modsDir) && fs::is_directory(modsDir))
+		{
+			for (fs::directory_entry subDir : fs::directory_iterator(modsDir))
+			{
+				if (FileExists(subDir.path() / "mod.json"))
 				{
-					if (!g_CustomAudioManager.TryLoadAudioOverride(file.path()))
-					{
-						Warning(eLog::MODSYS, "Mod %s has an invalid audio def %s\n", mod.Name.c_str(), file.path().filename().string().c_str());
-						continue;
-					}
+					vModDirs.push_back(subDir.path());
 				}
 			}
 		}
 	}
 
+	// Read every mod's directory in parallel, everything below registers the results in order
+	std::vector<ModScanResult_t> vScanResults(vModDirs.size());
+	const nlohmann::json* pjsEnabledModsCfg = bHasEnabledModsCfg ? &jsEnabledModsCfg : nullptr;
+
+	for (size_t i = 0; i < vModDirs.size(); i++)
+	{
+		const fs::path* pModDir = &vModDirs[i];
+		ModScanResult_t* pResult = &vScanResults[i];
+
+		auto fnScan = [pModDir, pjsEnabledModsCfg, pResult]() { ScanModDirectory(*pModDir, pjsEnabledModsCfg, *pResult); };
+		if (!g_pJobSystem->Submit(eJobQueue::MODS, fnScan))
+			fnScan();
+	}
+
+	g_pJobSystem->WaitForQueue(eJobQueue::MODS);
+
+	// Results of mods that loaded, same order as m_LoadedMods
+	std::vector<ModScanResult_t*> vLoadedResults;
+
+	for (size_t i = 0; i < vScanResults.size(); i++)
+	{
+		if (!vScanResults[i].pMod)
+			continue;
+
+		Mod& mod = *vScanResults[i].pMod;
+
+		// Setup mod dependencies
+		for (auto& pair : mod.DependencyConstants)
+		{
+			if (m_DependencyConstants.find(pair.first) != m_DependencyConstants.end() && m_DependencyConstants[pair.first] != pair.second)
+			{
+				Error(eLog::MODSYS, NO_ERROR,
+					  "'%s' attempted to register a dependency constant '%s' for '%s' that already exists for '%s'. "
+					  "Change the constant name.\n",
+					  mod.Name.c_str(), pair.first.c_str(), pair.second.c_str(), m_DependencyConstants[pair.first].c_str());
+				mod.m_bWasReadSuccessfully = false;
+				break;
+			}
+			if (m_DependencyConstants.find(pair.first) == m_DependencyConstants.end())
+				m_DependencyConstants.emplace(pair);
+		}
+
+		// If succesful add it to m_LoadedMods, otherwise don't
+		if (mod.m_bWasReadSuccessfully)
+		{
+			if (mod.m_bEnabled)
+				DevMsg(eLog::MODSYS, "'%s' loaded successfully\n", mod.Name.c_str());
+			else
+				DevMsg(eLog::MODSYS, "'%s' loaded successfully (DISABLED)\n", mod.Name.c_str());
+
+			vLoadedResults.push_back(&vScanResults[i]);
+		}
+		else
+		{
+			Warning(eLog::MODSYS, "Mod file at '%s' failed to load\n", (vModDirs[i] / "mod.json").string().c_str());
+		}
+	}
+
+	// sort by load prio, lowest-highest. stable so mods with the same prio keep the order we found them in
+	std::stable_sort(vLoadedResults.begin(), vLoadedResults.end(), [](ModScanResult_t* a, ModScanResult_t* b) { return a->pMod->LoadPriority < b->pMod->LoadPriority; });
+
+	m_LoadedMods.reserve(vLoadedResults.size());
+	for (ModScanResult_t* pResult : vLoadedResults)
+		m_LoadedMods.push_back(std::move(*pResult->pMod));
+
+	for (size_t i = 0; i < m_LoadedMods.size(); i++)
+	{
+		Mod& mod = m_LoadedMods[i];
+		ModScanResult_t& result = *vLoadedResults[i];
+
+		if (!mod.m_bEnabled)
+			continue;
+
+		// register convars
+		// for reloads, this is sorta barebones, when we have a good findconvar method, we could probably reset flags and stuff on
+		// preexisting convars note: we don't delete convars if they already exist because they're used for script stuff, unfortunately this
+		// causes us to leak memory on reload, but not much, potentially find a way to not do this at some point
+		for (ModConVar* convar : mod.ConVars)
+		{
+			// make sure convar isn't registered yet, unsure if necessary but idk what
+			// behaviour is for defining same convar multiple times
+			if (!g_pCVar->FindVar(convar->Name.c_str()))
+			{
+				ConVar::StaticCreate(convar->Name.c_str(), convar->DefaultValue.c_str(), convar->Flags, convar->HelpString.c_str());
+			}
+		}
+
+		for (ModConCommand* command : mod.ConCommands)
+		{
+			// make sure command isnt't registered multiple times.
+			if (!g_pCVar->FindCommand(command->Name.c_str()))
+			{
+				ConCommand::StaticCreate(command->Name.c_str(), command->HelpString.c_str(), command->Flags, ModConCommandCallback, nullptr);
+			}
+		}
+
+		if (m_bHasLoadedMods)
+		{
+			for (const std::string& vpkName : result.vAutoMountVpks)
+				g_pFilesystem->m_vtable->MountVPK(g_pFilesystem, vpkName.c_str());
+		}
+
+		for (const std::string& starpak : mod.StarpakPaths)
+			DevMsg(eLog::MODSYS, "Mod %s registered starpak '%s'\n", mod.Name.c_str(), starpak.c_str());
+
+		// try to load audio
+		for (const fs::path& audioDef : result.vAudioDefs)
+		{
+			if (!g_CustomAudioManager.TryLoadAudioOverride(audioDef))
+			{
+				Warning(eLog::MODSYS, "Mod %s has an invalid audio def %s\n", mod.Name.c_str(), audioDef.filename().string().c_str());
+				continue;
+			}
+		}
+	}
+
 	// in a seperate loop because we register mod files in reverse order, since mods loaded later should have their files prioritised
 	for (int64_t i = m_LoadedMods.size() - 1; i > -1; i--)
 	{
 		if (!m_LoadedMods[i].m_bEnabled)
 			continue;
 
-		if (FileExists(m_LoadedMods[i].m_ModDirectory / MOD_OVERRIDE_DIR))
+		for (const std::string& path : vLoadedResults[i]->vOverrideFiles)
 		{
-			for (fs::directory_entry file : fs::recursive_directory_iterator(m_LoadedMods[i].m_ModDirectory / MOD_OVERRIDE_DIR))
+			if (m_ModFiles.find(path) == m_ModFiles.end())
 			{
-				std::string path = g_pModManager->NormaliseModFilePath(file.path().lexically_relative(m_LoadedMods[i].m_ModDirectory / MOD_OVERRIDE_DIR));
-				if (file.is_regular_file() && m_ModFiles.find(path) == m_ModFiles.end())
-				{
-					ModOverrideFile modFile;
-					modFile.m_pOwningMod = &m_LoadedMods[i];
-					modFile.m_Path = path;
-					m_ModFiles.insert(std::make_pair(path, modFile));
-				}
+				ModOverrideFile modFile;
+				modFile.m_pOwningMod = &m_LoadedMods[i];
+				modFile.m_Path = path;
+				m_ModFiles.insert(std::make_pair(path, modFile));
 			}
 		}
 	}
 
+	// Everything the loaded mods can compile, any other files in the compiled dir are stale
+	std::vector<std::string> vCompiledAssets = {"scripts\\vscripts\\scripts.rson", "cfg\\server\\persistent_player_data_version_231.pdef", "scripts\\kb_act.lst"};
+	for (Mod& mod : m_LoadedMods)
+	{
+		if (!mod.m_bEnabled)
+			continue;
+
+		for (const std::pair<const size_t, std::string>& kvPaths : mod.KeyValues)
+			vCompiledAssets.push_back(kvPaths.second);
+	}
+
+	m_CompiledAssetCache.Prune(vCompiledAssets);
+
 	m_bHasLoadedMods = true;
+	m_nLoadGeneration++;
+
+	RebuildModFileIndex();
+
+	if (g_pPakLoadManager)
+		g_pPakLoadManager->RebuildStreamFileIndex();
 
 	ReloadMapsList();
 }
 
 void ModManager::UnloadMods()
 {
+	// Swap in an empty index before the mods go away, readers still holding
+	// the old one keep it alive and it doesn't point into anything we free
+	std::atomic_store(&m_pModFileIndex, std::shared_ptr<const CModFileIndex>(std::make_shared<CModFileIndex>(std::unordered_map<std::string, ModOverrideFile>())));
+
 	// clean up stuff from mods before we unload
 	m_vMapList.clear();
 	m_ModFiles.clear();
+	m_setCompiledAssets.clear();
 	m_DependencyConstants.clear();
-	fs::remove_all(GetCompiledAssetsPath());
 
+	// Compiled assets stay on disk, LoadMods prunes the ones the new mods don't need
 	g_CustomAudioManager.ClearAudioOverrides();
 
 	nlohmann::json jsEnabledModsCfg;
 
 	for (Mod& mod : m_LoadedMods)
 	{
-		// remove all built kvs
-		for (std::pair<size_t, std::string> kvPaths : mod.KeyValues)
-			fs::remove(GetCompiledAssetsPath() / fs::path(kvPaths.second).lexically_relative(mod.m_ModDirectory));
-
 		mod.KeyValues.clear();
 
 		// write to m_enabledModsCfg
@@ -835,9 +944,21 @@ std::string ModManager::NormaliseModFilePath(const fs::path path)
 	return str;
 }
 
-void ModManager::CompileAssetsForFile(const char* filename)
+//-----------------------------------------------------------------------------
+// Purpose: Builds any compiled assets that replace a file
+// Input  : *filename - Path as the game passed it
+//          svNormalisedPath - Output of CModFileIndex::NormalisePath for filename
+// Output : False if no compiled asset exists for this path
+//-----------------------------------------------------------------------------
+bool ModManager::CompileAssetsForFile(const char* filename, std::string_view svNormalisedPath)
 {
-	size_t fileHash = STR_HASH(NormaliseModFilePath(fs::path(filename)));
+	// Same hash as STR_HASH, without having to build a std::string
+	size_t fileHash = std::hash<std::string_view>()(svNormalisedPath);
+
+	// Inputs can't change until mods are reloaded, so each asset only needs
+	// hashing and checking against the cache once
+	if (m_setCompiledAssets.find(fileHash) != m_setCompiledAssets.end())
+		return true;
 
 	if (fileHash == m_hScriptsRsonHash)
 		BuildScriptsRson();
@@ -856,10 +977,49 @@ void ModManager::CompileAssetsForFile(const char* filename)
 			if (mod.KeyValues.find(fileHash) != mod.KeyValues.end())
 			{
 				TryBuildKeyValues(filename);
-				return;
+				m_setCompiledAssets.insert(fileHash);
+				return true;
 			}
 		}
+
+		return false;
 	}
+
+	m_setCompiledAssets.insert(fileHash);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes a compiled asset override the file it replaces
+// Input  : *pszPath -
+//-----------------------------------------------------------------------------
+void ModManager::AddCompiledAssetOverride(const char* pszPath)
+{
+	// Already overridden by the compiled file, rebuilding the index would only
+	// throw away the lookup caches keyed on its generation
+	auto it = m_ModFiles.find(pszPath);
+	if (it != m_ModFiles.end() && !it->second.m_pOwningMod && it->second.m_Path == pszPath)
+		return;
+
+	ModOverrideFile overrideFile;
+	overrideFile.m_pOwningMod = nullptr;
+	overrideFile.m_Path = pszPath;
+
+	if (it == m_ModFiles.end())
+		m_ModFiles.insert(std::make_pair(pszPath, overrideFile));
+	else
+		it->second = overrideFile;
+
+	RebuildModFileIndex();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds the lookup index after m_ModFiles changed
+// Note   : The old index is freed once the last reader holding it lets go
+//-----------------------------------------------------------------------------
+void ModManager::RebuildModFileIndex()
+{
+	std::atomic_store(&m_pModFileIndex, std::shared_ptr<const CModFileIndex>(std::make_shared<CModFileIndex>(m_ModFiles)));
 }
 
 void ModManager::ReloadMapsList()
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "vscript/vscript.h"
+#include "mods/modfileindex.h"
+#include "mods/compiled/compiledassetcache.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -116,9 +120,8 @@ class Mod
 
 	std::vector<ModRpakEntry> Rpaks;
 	std::unordered_map<std::string, std::string> RpakAliases; // paks we alias to other rpaks, e.g. to load sp_crashsite paks on the map mp_crashsite
-	std::vector<size_t> StarpakPaths; // starpaks that this mod contains
+	std::vector<std::string> StarpakPaths; // starpaks that this mod contains, as its rpaks reference them
 	// there seems to be no nice way to get the rpak that is causing the load of a starpak?
-	// hashed with STR_HASH
 
 	std::unordered_map<std::string, std::string> DependencyConstants;
 
@@ -152,12 +155,23 @@ class ModManager
 
   private:
 	bool m_bHasLoadedMods = false;
+	// Bumped every time LoadMods changes m_LoadedMods
+	uint32_t m_nLoadGeneration = 0;
 
 	// precalculated hashes
 	size_t m_hScriptsRsonHash;
 	size_t m_hPdefHash;
 	size_t m_hKBActHash;
 
+	// Current lookup index for m_ModFiles, read from filesystem threads. Only
+	// touched through std::atomic_load/store, readers keep it alive themselves
+	std::shared_ptr<const CModFileIndex> m_pModFileIndex;
+
+	// Tracks what's in runtime/compiled so we only rebuild assets whose inputs changed
+	CCompiledAssetCache m_CompiledAssetCache;
+	// Assets built or found up to date since mods were loaded, keyed on the path hash
+	std::unordered_set<size_t> m_setCompiledAssets;
+
   public:
 	std::vector<Mod> m_LoadedMods;
 	std::unordered_map<std::string, ModOverrideFile> m_ModFiles;
@@ -169,7 +183,32 @@ class ModManager
 	void LoadMods();
 	void UnloadMods();
 	std::string NormaliseModFilePath(const fs::path path);
-	void CompileAssetsForFile(const char* filename);
+	bool CompileAssetsForFile(const char* filename, std::string_view svNormalisedPath);
+
+	void RebuildModFileIndex();
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Gets the current lookup index, safe from any thread. Hold on to
+	//          it for as long as anything found in it is used
+	//-----------------------------------------------------------------------------
+	std::shared_ptr<const CModFileIndex> GetModFileIndex() const
+	{
+		return std::atomic_load(&m_pModFileIndex);
+	}
+
+	uint32_t GetLoadGeneration() const
+	{
+		return m_nLoadGeneration;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Saves the compiled asset manifest if anything was built since
+	//          the last call, cheap enough to call every frame
+	//-----------------------------------------------------------------------------
+	void FlushCompiledAssets()
+	{
+		m_CompiledAssetCache.Flush();
+	}
 
 	// compile asset type stuff, these are done in files under runtime/compiled/
 	void BuildScriptsRson();
@@ -178,6 +217,7 @@ class ModManager
 	void BuildKBActionsList();
 
   private:
+	void AddCompiledAssetOverride(const char* pszPath);
 	void ReloadMapsList();
 };
 
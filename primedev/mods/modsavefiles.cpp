@@ -1,55 +1,228 @@
 #include "modsavefiles.h"
 
-/// <summary></summary>
-/// <param name="dir">The directory we want the size of.</param>
-/// <param name="file">The file we're excluding from the calculation.</param>
-/// <returns>The size of the contents of the current directory, excluding a specific file.</returns>
-uintmax_t GetSizeOfFolderContentsMinusFile(fs::path dir, std::string file)
+//-----------------------------------------------------------------------------
+// Purpose: Returns the size of everything in a folder
+// Input  : &dir -
+//-----------------------------------------------------------------------------
+uintmax_t CSaveFolderQuota::GetFolderSize(const fs::path& dir)
 {
-	uintmax_t result = 0;
-	for (const auto& entry : fs::directory_iterator(dir))
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	return GetFolder(dir, lock).nTotal;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the size of everything in a folder except for one file,
+//          what the folder would take up if that file was overwritten
+// Input  : &dir -
+//          &file - Relative to dir
+//-----------------------------------------------------------------------------
+uintmax_t CSaveFolderQuota::GetFolderSizeMinusFile(const fs::path& dir, const std::string& file)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	Folder_t* pFolder = &GetFolder(dir, lock);
+	auto it = pFolder->mapFiles.find(GetFileKey(file));
+
+	// Something else wrote to the file, so the rest of the folder can't be trusted either
+	std::error_code ec;
+	uintmax_t nSize = fs::file_size(dir / file, ec);
+	if (ec ? it != pFolder->mapFiles.end() : (it == pFolder->mapFiles.end() || it->second != nSize))
 	{
-		if (entry.path().filename() == file)
-			continue;
-		// fs::file_size may not work on directories - but does in some cases.
-		// per cppreference.com, it's "implementation-defined".
-		try
-		{
-			result += fs::file_size(entry.path());
-		}
-		catch (fs::filesystem_error& ex)
-		{
-			NOTE_UNUSED(ex);
-			if (entry.is_directory())
-			{
-				result += GetSizeOfFolderContentsMinusFile(entry.path(), "");
-			}
-		}
+		pFolder = &RescanFolder(dir, lock);
+		it = pFolder->mapFiles.find(GetFileKey(file));
 	}
-	return result;
+
+	return it == pFolder->mapFiles.end() ? pFolder->nTotal : pFolder->nTotal - it->second;
 }
 
-uintmax_t GetSizeOfFolder(fs::path dir)
+//-----------------------------------------------------------------------------
+// Purpose: Picks up the new size of a file after it was written or deleted
+// Input  : &dir -
+//          &file - Relative to dir
+//-----------------------------------------------------------------------------
+void CSaveFolderQuota::UpdateFile(const fs::path& dir, const std::string& file)
 {
-	uintmax_t result = 0;
-	for (const auto& entry : fs::directory_iterator(dir))
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	// Don't go through GetFolder, the write time already changed if the file
+	// is new and that would rescan the whole folder for our own write
+	auto itFolder = m_mapFolders.find(dir.lexically_normal().string());
+	if (itFolder == m_mapFolders.end())
 	{
-		// fs::file_size may not work on directories - but does in some cases.
-		// per cppreference.com, it's "implementation-defined".
-		try
-		{
-			result += fs::file_size(entry.path());
-		}
-		catch (fs::filesystem_error& ex)
+		RescanFolder(dir, lock);
+		return;
+	}
+
+	Folder_t& folder = itFolder->second;
+	folder.nChanges++;
+	std::string svKey = GetFileKey(file);
+
+	auto it = folder.mapFiles.find(svKey);
+	if (it != folder.mapFiles.end())
+	{
+		folder.nTotal -= it->second;
+		folder.mapFiles.erase(it);
+	}
+
+	// Stat instead of trusting the length we wrote, text mode writes expand newlines
+	std::error_code ec;
+	uintmax_t nSize = fs::file_size(dir / file, ec);
+	if (!ec)
+	{
+		folder.mapFiles.emplace(std::move(svKey), nSize);
+		folder.nTotal += nSize;
+	}
+
+	// Creating or deleting a file bumps its folder's write time, take the new
+	// one so our own changes don't cause a rescan. A folder we haven't seen
+	// was created for this file, its parent changed too so just rescan
+	fs::path parent = (dir / file).parent_path();
+	auto itDir = folder.mapDirs.find(GetFileKey(parent.lexically_relative(dir).string()));
+	if (itDir == folder.mapDirs.end())
+		folder.bStale = true;
+	else
+		itDir->second = GetWriteTime(parent);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes the next check scan a folder again, for when a write or
+//          delete failed and we don't know what's on the disk
+// Input  : &dir -
+//-----------------------------------------------------------------------------
+void CSaveFolderQuota::InvalidateFolder(const fs::path& dir)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapFolders.find(dir.lexically_normal().string());
+	if (it != m_mapFolders.end())
+	{
+		it->second.bStale = true;
+		it->second.nChanges++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the entry for a folder, scanning it if it's new or changed
+//          since we last looked
+// Input  : &dir -
+//          &lock - Holds m_Mutex, released while scanning
+//-----------------------------------------------------------------------------
+CSaveFolderQuota::Folder_t& CSaveFolderQuota::GetFolder(const fs::path& dir, std::unique_lock<std::mutex>& lock)
+{
+	auto it = m_mapFolders.find(dir.lexically_normal().string());
+	if (it != m_mapFolders.end() && !it->second.bStale && !DirsChanged(it->second, dir))
+		return it->second;
+
+	return RescanFolder(dir, lock);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Scans a folder and replaces its entry, the walk runs without
+//          m_Mutex so other mods' checks don't wait on it
+// Input  : &dir -
+//          &lock - Holds m_Mutex, released while scanning
+//-----------------------------------------------------------------------------
+CSaveFolderQuota::Folder_t& CSaveFolderQuota::RescanFolder(const fs::path& dir, std::unique_lock<std::mutex>& lock)
+{
+	std::string svFolderKey = dir.lexically_normal().string();
+	uint64_t nChanges = m_mapFolders[svFolderKey].nChanges;
+
+	lock.unlock();
+
+	Folder_t scanned;
+	ScanFolder(scanned, dir);
+
+	lock.lock();
+
+	// Entries are never erased, so this is the one we read nChanges from
+	Folder_t& folder = m_mapFolders[svFolderKey];
+
+	// A write that finished mid scan may or may not be in it, use it for now and scan again next time
+	scanned.bStale = folder.nChanges != nChanges;
+	scanned.nChanges = folder.nChanges;
+	folder = std::move(scanned);
+
+	return folder;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds a folder's entry from what's on the disk
+// Input  : &folder -
+//          &dir -
+//-----------------------------------------------------------------------------
+void CSaveFolderQuota::ScanFolder(Folder_t& folder, const fs::path& dir)
+{
+	folder.mapDirs.clear();
+	folder.nTotal = 0;
+	folder.mapFiles.clear();
+
+	// Write times go first, anything changing during the scan makes the next check scan again
+	folder.mapDirs.emplace(GetFileKey("."), GetWriteTime(dir));
+
+	std::error_code ec;
+	for (auto itEntry = fs::recursive_directory_iterator(dir, ec); !ec && itEntry != fs::recursive_directory_iterator(); itEntry.increment(ec))
+	{
+		std::error_code ecFile;
+		std::string svKey = GetFileKey(itEntry->path().lexically_relative(dir).string());
+
+		if (itEntry->is_directory(ecFile))
 		{
-			NOTE_UNUSED(ex);
-			if (entry.is_directory())
-			{
-				result += GetSizeOfFolderContentsMinusFile(entry.path(), "");
-			}
+			folder.mapDirs.emplace(std::move(svKey), GetWriteTime(itEntry->path()));
+			continue;
 		}
+
+		if (!itEntry->is_regular_file(ecFile))
+			continue;
+
+		uintmax_t nSize = itEntry->file_size(ecFile);
+		if (ecFile)
+			continue;
+
+		folder.mapFiles.emplace(std::move(svKey), nSize);
+		folder.nTotal += nSize;
 	}
-	return result;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if a file was added to or removed from a folder or any of
+//          its subfolders since it was scanned
+// Input  : &folder -
+//          &dir -
+//-----------------------------------------------------------------------------
+bool CSaveFolderQuota::DirsChanged(const Folder_t& folder, const fs::path& dir)
+{
+	for (const auto& [svDir, writeTime] : folder.mapDirs)
+	{
+		if (GetWriteTime(dir / svDir) != writeTime)
+			return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the write time of a path, min if it can't be read
+// Input  : &path -
+//-----------------------------------------------------------------------------
+fs::file_time_type CSaveFolderQuota::GetWriteTime(const fs::path& path)
+{
+	std::error_code ec;
+	fs::file_time_type writeTime = fs::last_write_time(path, ec);
+
+	return ec ? fs::file_time_type::min() : writeTime;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Normalises a path relative to a save folder, paths are case
+//          insensitive on windows
+// Input  : &file -
+//-----------------------------------------------------------------------------
+std::string CSaveFolderQuota::GetFileKey(const std::string& file)
+{
+	std::string svKey = fs::path(file).lexically_normal().generic_string();
+	std::transform(svKey.begin(), svKey.end(), svKey.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return svKey;
 }
 
 // Checks if a file contains null characters.
@@ -87,7 +260,14 @@ bool IsPathSafe(const std::string param, fs::path dir)
 ON_DLL_LOAD("engine.dll", ModSaveFFiles_Init, (CModule module))
 {
 	g_svSavePath = fs::path(g_svProfileDir) / "save_data";
+	g_svSaveTempPath = fs::path(g_svProfileDir) / "save_data_tmp";
+
+	// Anything left over is from a save that never finished
+	std::error_code ec;
+	fs::remove_all(g_svSaveTempPath, ec);
+	fs::create_directories(g_svSaveTempPath, ec);
 	g_pSaveFileManager = new SaveFileManager;
+	g_pSaveFolderQuota = new CSaveFolderQuota;
 	int parm = CommandLine()->FindParm("-maxfoldersize");
 
 	if (parm)
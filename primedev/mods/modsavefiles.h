@@ -4,133 +4,152 @@
 #include <fstream>
 #include "mods/modmanager.h"
 #include "tier0/taskscheduler.h"
+#include "tier0/jobsystem.h"
 
 inline int MAX_FOLDER_SIZE = 52428800; // 50MB (50 * 1024 * 1024)
 inline fs::path g_svSavePath;
+// Saves get written here first, outside of any mod's folder so the quota never counts them
+inline fs::path g_svSaveTempPath;
 
 int GetMaxSaveFolderSize();
 bool ContainsInvalidChars(std::string str);
 bool IsPathSafe(const std::string param, fs::path dir);
 
-uintmax_t GetSizeOfFolder(fs::path dir);
-uintmax_t GetSizeOfFolderContentsMinusFile(fs::path dir, std::string file);
+//-----------------------------------------------------------------------------
+// Purpose: Tracks how much space each mod's save folder takes up
+// Note   : A folder is scanned once, after that every write or delete going
+//          through SaveFileManager adjusts the total by the file's size
+//          delta. Folders get scanned again when the write time of the
+//          folder or any of its subfolders stops matching the one recorded,
+//          when the file about to be written doesn't have the size we
+//          recorded, or after a write or delete failed, so files changed
+//          behind our back don't keep the total wrong
+//-----------------------------------------------------------------------------
+class CSaveFolderQuota
+{
+  public:
+	uintmax_t GetFolderSize(const fs::path& dir);
+	uintmax_t GetFolderSizeMinusFile(const fs::path& dir, const std::string& file);
+
+	void UpdateFile(const fs::path& dir, const std::string& file);
+	void InvalidateFolder(const fs::path& dir);
+
+  private:
+	struct Folder_t
+	{
+		// Normalised path relative to the folder, "." for the folder itself : write time
+		std::unordered_map<std::string, fs::file_time_type> mapDirs;
+		uintmax_t nTotal = 0;
+		// Normalised path relative to the folder : size
+		std::unordered_map<std::string, uintmax_t> mapFiles;
+		bool bStale = false;
+		// Bumped by UpdateFile and InvalidateFolder, tells a scan if it raced with them
+		uint64_t nChanges = 0;
+	};
+
+	Folder_t& GetFolder(const fs::path& dir, std::unique_lock<std::mutex>& lock);
+	Folder_t& RescanFolder(const fs::path& dir, std::unique_lock<std::mutex>& lock);
+	static void ScanFolder(Folder_t& folder, const fs::path& dir);
+	static bool DirsChanged(const Folder_t& folder, const fs::path& dir);
+	static fs::file_time_type GetWriteTime(const fs::path& path);
+	static std::string GetFileKey(const std::string& file);
+
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, Folder_t> m_mapFolders;
+};
+
+inline CSaveFolderQuota* g_pSaveFolderQuota;
 
 class SaveFileManager
 {
   public:
 	// Saves a file asynchronously.
-	void SaveFileAsync(fs::path file, std::string contents)
+	void SaveFileAsync(fs::path dir, std::string fileName, std::string contents)
 	{
-		auto mutex = std::ref(fileMutex);
-		std::thread writeThread(
-			[mutex, file, contents]()
+		SaveFolder_t* pFolder = GetFolder(dir);
+		uint64_t nRequest = QueueRequest(pFolder, fileName);
+		auto fnWrite = [this, pFolder, nRequest, dir, fileName, contents]()
+		{
+			std::lock_guard<std::mutex> lock(pFolder->mutex);
+
+			// A newer save or delete of this file already ran
+			if (!ClaimRequest(pFolder, fileName, nRequest))
+				return;
+
+			fs::path file = dir / fileName;
+			// Named after the destination, writes to the same file never run at the same time
+			fs::path tempFile = g_svSaveTempPath / FormatA("%016llx.tmp", static_cast<unsigned long long>(std::hash<std::string>()(file.string())));
+			try
 			{
-				try
+				// this actually allows mods to go over the limit, but not by much
+				// the limit is to prevent mods from taking gigabytes of space,
+				// we don't need to be particularly strict.
+				if (g_pSaveFolderQuota->GetFolderSizeMinusFile(dir, fileName) + contents.length() > MAX_FOLDER_SIZE)
 				{
-					mutex.get().lock();
-
-					fs::path dir = file.parent_path();
-					// this actually allows mods to go over the limit, but not by much
-					// the limit is to prevent mods from taking gigabytes of space,
-					// we don't need to be particularly strict.
-					if (GetSizeOfFolderContentsMinusFile(dir, file.filename().string()) + contents.length() > MAX_FOLDER_SIZE)
-					{
-						// tbh, you're either trying to fill the hard drive or use so much data, you SHOULD be congratulated.
-						Error(eLog::MODSYS, NO_ERROR, "Mod spamming save requests? Folder limit bypassed despite previous checks. Not saving.\n");
-						mutex.get().unlock();
-						return;
-					}
-
-					std::ofstream fileStr(file);
-					if (fileStr.fail())
-					{
-						mutex.get().unlock();
-						return;
-					}
-
-					fileStr.write(contents.c_str(), contents.length());
-					fileStr.close();
-
-					mutex.get().unlock();
-					// side-note: this causes a leak?
-					// when a file is added to the map, it's never removed.
-					// no idea how to fix this - because we have no way to check if there are other threads waiting to use this file(?)
-					// tried to use m.try_lock(), but it's unreliable, it seems.
+					// tbh, you're either trying to fill the hard drive or use so much data, you SHOULD be congratulated.
+					Error(eLog::MODSYS, NO_ERROR, "Mod spamming save requests? Folder limit bypassed despite previous checks. Not saving.\n");
+					return;
 				}
-				catch (std::exception ex)
+
+				// Write to a temp file on the same drive and rename over the file so a
+				// crash mid write leaves either the old or the new contents, never half of them
+				std::ofstream fileStr(tempFile);
+				if (fileStr.fail())
+					return;
+
+				fileStr.write(contents.c_str(), contents.length());
+				fileStr.close();
+
+				if (fileStr.fail())
 				{
 					Error(eLog::MODSYS, NO_ERROR, "SAVE FAILED!\n");
-					mutex.get().unlock();
-					Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
+					fs::remove(tempFile);
+					g_pSaveFolderQuota->InvalidateFolder(dir);
+					return;
 				}
-			});
 
-		writeThread.detach();
+				fs::rename(tempFile, file);
+				g_pSaveFolderQuota->UpdateFile(dir, fileName);
+			}
+			catch (std::exception ex)
+			{
+				Error(eLog::MODSYS, NO_ERROR, "SAVE FAILED!\n");
+				Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
+
+				std::error_code ec;
+				fs::remove(tempFile, ec);
+
+				// Don't know what made it to the disk
+				g_pSaveFolderQuota->InvalidateFolder(dir);
+			}
+		};
+
+		// Pending writes to the same file get coalesced so only the newest contents hit the disk,
+		// if the queue is full we write on the calling thread instead of dropping the save
+		if (!g_pJobSystem->Submit(eJobQueue::FILESYSTEM, fnWrite, std::hash<std::string>()((dir / fileName).string())))
+		{
+			fnWrite();
+		}
 	}
 
 	// Loads a file asynchronously.
-	int LoadFileAsync(fs::path file, ScriptContext nContext)
+	int LoadFileAsync(fs::path dir, std::string fileName, ScriptContext nContext)
 	{
 		int handle = ++m_iLastRequestHandle;
-		auto mutex = std::ref(fileMutex);
-		std::thread readThread(
-			[mutex, file, handle, nContext]()
+		SaveFolder_t* pFolder = GetFolder(dir);
+		auto fnRead = [pFolder, dir, fileName, handle, nContext]()
+		{
+			fs::path file = dir / fileName;
+			std::lock_guard<std::mutex> lock(pFolder->mutex);
+			try
 			{
-				try
+				std::ifstream fileStr(file);
+				if (fileStr.fail())
 				{
-					mutex.get().lock();
-
-					std::ifstream fileStr(file);
-					if (fileStr.fail())
-					{
-						Error(eLog::MODSYS, NO_ERROR, "A file was supposed to be loaded but we can't access it?!\n");
-
-						g_pTaskScheduler->AddTask(
-							[handle, nContext]()
-							{
-								CSquirrelVM* pVM = nullptr;
-								if (nContext == ScriptContext::SERVER)
-									pVM = g_pServerVM;
-								else if (nContext == ScriptContext::CLIENT)
-									pVM = g_pClientVM;
-								else if (nContext == ScriptContext::UI)
-									pVM = g_pUIVM;
-
-								if (pVM && pVM->GetVM())
-								{
-									HSQUIRRELVM hVM = pVM->GetVM();
-									const char* pszFuncName = "NSHandleLoadResult";
-
-									SQObject oFunction {};
-									int nResult = sq_getfunction(hVM, pszFuncName, &oFunction, 0);
-									if (nResult != 0)
-									{
-										Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFuncName);
-										return;
-									}
-
-									// Push
-									sq_pushobject(hVM, &oFunction);
-									sq_pushroottable(hVM);
-
-									sq_pushinteger(hVM, handle);
-									sq_pushbool(hVM, false);
-									sq_pushstring(hVM, "", -1);
-
-									(void)sq_call(hVM, 4, false, false);
-								}
-							});
-						//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, false, "");
-						mutex.get().unlock();
-						return;
-					}
+					Error(eLog::MODSYS, NO_ERROR, "A file was supposed to be loaded but we can't access it?!\n");
 
-					std::stringstream stringStream;
-					stringStream << fileStr.rdbuf();
-
-					std::string svContents = stringStream.str();
 					g_pTaskScheduler->AddTask(
-						[handle, svContents, nContext]()
+						[handle, nContext]()
 						{
 							CSquirrelVM* pVM = nullptr;
 							if (nContext == ScriptContext::SERVER)
@@ -158,104 +177,196 @@ class SaveFileManager
 								sq_pushroottable(hVM);
 
 								sq_pushinteger(hVM, handle);
-								sq_pushbool(hVM, true);
-								sq_pushstring(hVM, svContents.c_str(), -1);
+								sq_pushbool(hVM, false);
+								sq_pushstring(hVM, "", -1);
 
 								(void)sq_call(hVM, 4, false, false);
 							}
 						});
-					//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, true, stringStream.str());
-
-					fileStr.close();
-					mutex.get().unlock();
-					// side-note: this causes a leak?
-					// when a file is added to the map, it's never removed.
-					// no idea how to fix this - because we have no way to check if there are other threads waiting to use this file(?)
-					// tried to use m.try_lock(), but it's unreliable, it seems.
+					//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, false, "");
+					return;
 				}
-				catch (std::exception ex)
-				{
-					Error(eLog::MODSYS, NO_ERROR, "LOAD FAILED!\n");
-					g_pTaskScheduler->AddTask(
-						[handle, nContext]()
+
+				std::stringstream stringStream;
+				stringStream << fileStr.rdbuf();
+
+				std::string svContents = stringStream.str();
+				g_pTaskScheduler->AddTask(
+					[handle, svContents, nContext]()
+					{
+						CSquirrelVM* pVM = nullptr;
+						if (nContext == ScriptContext::SERVER)
+							pVM = g_pServerVM;
+						else if (nContext == ScriptContext::CLIENT)
+							pVM = g_pClientVM;
+						else if (nContext == ScriptContext::UI)
+							pVM = g_pUIVM;
+
+						if (pVM && pVM->GetVM())
 						{
-							CSquirrelVM* pVM = nullptr;
-							if (nContext == ScriptContext::SERVER)
-								pVM = g_pServerVM;
-							else if (nContext == ScriptContext::CLIENT)
-								pVM = g_pClientVM;
-							else if (nContext == ScriptContext::UI)
-								pVM = g_pUIVM;
+							HSQUIRRELVM hVM = pVM->GetVM();
+							const char* pszFuncName = "NSHandleLoadResult";
 
-							if (pVM && pVM->GetVM())
+							SQObject oFunction {};
+							int nResult = sq_getfunction(hVM, pszFuncName, &oFunction, 0);
+							if (nResult != 0)
 							{
-								ScriptContext nContext = (ScriptContext)pVM->vmContext;
-								HSQUIRRELVM hVM = pVM->GetVM();
-								const char* pszFuncName = "NSHandleLoadResult";
+								Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFuncName);
+								return;
+							}
 
-								SQObject oFunction {};
-								int nResult = sq_getfunction(hVM, pszFuncName, &oFunction, 0);
-								if (nResult != 0)
-								{
-									Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFuncName);
-									return;
-								}
+							// Push
+							sq_pushobject(hVM, &oFunction);
+							sq_pushroottable(hVM);
 
-								// Push
-								sq_pushobject(hVM, &oFunction);
-								sq_pushroottable(hVM);
+							sq_pushinteger(hVM, handle);
+							sq_pushbool(hVM, true);
+							sq_pushstring(hVM, svContents.c_str(), -1);
 
-								sq_pushinteger(hVM, handle);
-								sq_pushbool(hVM, false);
-								sq_pushstring(hVM, "", -1);
+							(void)sq_call(hVM, 4, false, false);
+						}
+					});
+				//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, true, stringStream.str());
 
-								(void)sq_call(hVM, 4, false, false);
+				fileStr.close();
+			}
+			catch (std::exception ex)
+			{
+				Error(eLog::MODSYS, NO_ERROR, "LOAD FAILED!\n");
+				g_pTaskScheduler->AddTask(
+					[handle, nContext]()
+					{
+						CSquirrelVM* pVM = nullptr;
+						if (nContext == ScriptContext::SERVER)
+							pVM = g_pServerVM;
+						else if (nContext == ScriptContext::CLIENT)
+							pVM = g_pClientVM;
+						else if (nContext == ScriptContext::UI)
+							pVM = g_pUIVM;
+
+						if (pVM && pVM->GetVM())
+						{
+							ScriptContext nContext = (ScriptContext)pVM->vmContext;
+							HSQUIRRELVM hVM = pVM->GetVM();
+							const char* pszFuncName = "NSHandleLoadResult";
+
+							SQObject oFunction {};
+							int nResult = sq_getfunction(hVM, pszFuncName, &oFunction, 0);
+							if (nResult != 0)
+							{
+								Error(VScript_GetNativeLogContext(nContext), NO_ERROR, "Call was unable to find function with name '%s'. Is it global?\n", pszFuncName);
+								return;
 							}
-						});
-					//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, false, "");
-					mutex.get().unlock();
-					Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
-				}
-			});
 
-		readThread.detach();
+							// Push
+							sq_pushobject(hVM, &oFunction);
+							sq_pushroottable(hVM);
+
+							sq_pushinteger(hVM, handle);
+							sq_pushbool(hVM, false);
+							sq_pushstring(hVM, "", -1);
+
+							(void)sq_call(hVM, 4, false, false);
+						}
+					});
+				//g_pSquirrel<context>->AsyncCall("NSHandleLoadResult", handle, false, "");
+				Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
+			}
+		};
+
+		if (!g_pJobSystem->Submit(eJobQueue::FILESYSTEM, fnRead))
+		{
+			fnRead();
+		}
+
 		return handle;
 	}
 
 	// Deletes a file asynchronously.
-	void DeleteFileAsync(fs::path file)
+	void DeleteFileAsync(fs::path dir, std::string fileName)
 	{
 		// P.S. I don't like how we have to async delete calls but we do.
-		auto m = std::ref(fileMutex);
-		std::thread deleteThread(
-			[m, file]()
-			{
-				try
-				{
-					m.get().lock();
+		SaveFolder_t* pFolder = GetFolder(dir);
+		uint64_t nRequest = QueueRequest(pFolder, fileName);
+		auto fnDelete = [this, pFolder, nRequest, dir, fileName]()
+		{
+			std::lock_guard<std::mutex> lock(pFolder->mutex);
 
-					fs::remove(file);
+			// A newer save or delete of this file already ran
+			if (!ClaimRequest(pFolder, fileName, nRequest))
+				return;
 
-					m.get().unlock();
-					// side-note: this causes a leak?
-					// when a file is added to the map, it's never removed.
-					// no idea how to fix this - because we have no way to check if there are other threads waiting to use this file(?)
-					// tried to use m.try_lock(), but it's unreliable, it seems.
-				}
-				catch (std::exception ex)
-				{
-					Error(eLog::MODSYS, NO_ERROR, "DELETE FAILED!\n");
-					m.get().unlock();
-					Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
-				}
-			});
+			try
+			{
+				fs::remove(dir / fileName);
+				g_pSaveFolderQuota->UpdateFile(dir, fileName);
+			}
+			catch (std::exception ex)
+			{
+				Error(eLog::MODSYS, NO_ERROR, "DELETE FAILED!\n");
+				Error(eLog::MODSYS, NO_ERROR, "%s\n", ex.what());
+
+				g_pSaveFolderQuota->InvalidateFolder(dir);
+			}
+		};
 
-		deleteThread.detach();
+		if (!g_pJobSystem->Submit(eJobQueue::FILESYSTEM, fnDelete))
+		{
+			fnDelete();
+		}
 	}
-	// Future proofed in that if we ever get multi-threaded SSDs this code will take advantage of them.
-	std::mutex fileMutex;
 
   private:
+	//-----------------------------------------------------------------------------
+	// Each mod's save folder gets its own lock so mods don't wait on each other
+	struct SaveFolder_t
+	{
+		std::mutex mutex;
+
+		// Newest save or delete queued for each file, with more than one worker
+		// an older request can start after a newer one and would undo it
+		std::unordered_map<std::string, uint64_t> mapPending;
+	};
+
+	SaveFolder_t* GetFolder(const fs::path& dir)
+	{
+		std::lock_guard<std::mutex> lock(m_FoldersMutex);
+
+		std::unique_ptr<SaveFolder_t>& pFolder = m_mapFolders[dir.lexically_normal().string()];
+		if (!pFolder)
+			pFolder = std::make_unique<SaveFolder_t>();
+
+		return pFolder.get();
+	}
+
+	uint64_t QueueRequest(SaveFolder_t* pFolder, const std::string& fileName)
+	{
+		std::lock_guard<std::mutex> lock(m_FoldersMutex);
+
+		uint64_t nRequest = ++m_nLastRequest;
+		pFolder->mapPending[fileName] = nRequest;
+
+		return nRequest;
+	}
+
+	// Returns false if the request was superseded, otherwise forgets about it so
+	// the map doesn't grow with every file a mod ever saved
+	bool ClaimRequest(SaveFolder_t* pFolder, const std::string& fileName, uint64_t nRequest)
+	{
+		std::lock_guard<std::mutex> lock(m_FoldersMutex);
+
+		auto it = pFolder->mapPending.find(fileName);
+		if (it == pFolder->mapPending.end() || it->second != nRequest)
+			return false;
+
+		pFolder->mapPending.erase(it);
+		return true;
+	}
+
+	std::mutex m_FoldersMutex;
+	std::unordered_map<std::string, std::unique_ptr<SaveFolder_t>> m_mapFolders;
+	uint64_t m_nLastRequest = 0;
+
 	int m_iLastRequestHandle = 0;
 };
 
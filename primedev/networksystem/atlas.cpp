@@ -1,13 +1,23 @@
 #include "networksystem/atlas.h"
 
-#include "tier2/curlutils.h"
+#include "tier0/jobsystem.h"
+#include "tier2/httpclient.h"
 #include "engine/edict.h"
 #include "shared/playlist.h"
 #include "engine/server/server.h"
 #include "networksystem/bcrypt.h"
 #include "networksystem/bansystem.h"
+#include "networksystem/persistencedelta.h"
 #include "mods/modmanager.h"
 
+// FIXME [Fifty]: Atlas cries when i send pdata of PERSISTENCE_MAX_SIZE size
+//                '56306' is the size of pdata we get from atlas on auth so lets hope it doesnt break
+constexpr int PERSISTENCE_PUSH_SIZE = 56306;
+
+// Limits of one write_persistence_batch request
+constexpr size_t PERSISTENCE_BATCH_MAX_PLAYERS = 16;
+constexpr size_t PERSISTENCE_BATCH_MAX_SIZE = 1024 * 1024;
+
 // NOTE [Fifty]: Not using __FUNCTION__ as in threads it gets appended with more information
 //               decreasing readabality
 
@@ -41,26 +51,21 @@ void CAtlasClient::AuthenticateOrigin(const char* pszUID, const char* pszToken)
 	std::string svUID = pszUID;
 	std::string svToken = pszToken;
 
-	std::thread(
-		[this, svUID, svToken]()
-		{
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
-
-			std::string svUrl = FormatA("%s/client/origin_auth?id=%s&token=%s", Cvar_atlas_hostname->GetString(), svUID.c_str(), svToken.c_str());
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "GET", svResponse, cParms);
+	std::string svUrl = FormatA("%s/client/origin_auth?id=%s&token=%s", Cvar_atlas_hostname->GetString(), svUID.c_str(), svToken.c_str());
 
-			CURLcode result = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "GET", cParms, nullptr,
+		[this](HttpResult_t& result)
+		{
+			std::string& svResponse = result.svResponse;
 
-			if (result != CURLcode::CURLE_OK)
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(result));
+				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
 				SetOriginAuthInProgress(false);
 				return;
 			}
@@ -99,8 +104,7 @@ void CAtlasClient::AuthenticateOrigin(const char* pszUID, const char* pszToken)
 			}
 
 			SetOriginAuthInProgress(false);
-		})
-		.detach();
+		});
 #undef __FUNCTION
 }
 
@@ -127,26 +131,21 @@ void CAtlasClient::FetchRemoteGameServerList()
 
 	SetFetchingRemoteGameServers(true);
 
-	std::thread(
-		[this]()
-		{
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
-
-			std::string svUrl = FormatA("%s/client/servers", Cvar_atlas_hostname->GetString());
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "GET", svResponse, cParms);
+	std::string svUrl = FormatA("%s/client/servers", Cvar_atlas_hostname->GetString());
 
-			CURLcode result = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "GET", cParms, nullptr,
+		[this](HttpResult_t& result)
+		{
+			std::string& svResponse = result.svResponse;
 
-			if (result != CURLcode::CURLE_OK)
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(result));
+				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
 				SetFetchingRemoteGameServers(false);
 				return;
 			}
@@ -199,8 +198,7 @@ void CAtlasClient::FetchRemoteGameServerList()
 			}
 
 			SetFetchingRemoteGameServers(false);
-		})
-		.detach();
+		});
 #undef __FUNCTION
 }
 
@@ -256,7 +254,6 @@ void CAtlasClient::AuthenticateRemoteGameServer(const char* pszUID, const char*
 
 			CURLParms cParms;
 			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
 			cParms.bVerifyHost = true; // TODO: make this a cvar
 			cParms.bVerifyPeer = true; // TODO: make this a cvar
 
@@ -264,15 +261,12 @@ void CAtlasClient::AuthenticateRemoteGameServer(const char* pszUID, const char*
 			std::string svUrl = FormatA("%s/client/auth_with_server?id=%s&playerToken=%s&server=%s&password=%s", Cvar_atlas_hostname->GetString(), svUID.c_str(), m_svToken.c_str(), server.m_svID.c_str(), pszEscapedPassword);
 			curl_free(pszEscapedPassword);
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms);
-
-			CURLcode result = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+			HttpResult_t result = g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms).get();
+			std::string& svResponse = result.svResponse;
 
-			if (result != CURLcode::CURLE_OK)
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error %s\n", __FUNCTION, curl_easy_strerror(result));
+				Error(eLog::MS, NO_ERROR, "%s: Curl error %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
 				m_bAuthenticatingWithGameServer = false;
 				return;
 			}
@@ -320,6 +314,58 @@ void CAtlasClient::AuthenticateRemoteGameServer(const char* pszUID, const char*
 #undef __FUNCTION
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns the mod list atlas wants with add_server and update_values
+// Note   : Serialising it every heartbeat adds up with large mod lists, the
+//          mod list only changes in LoadMods so its load generation tells us
+//          when the cached list went stale
+//-----------------------------------------------------------------------------
+const std::string& CAtlasServer::GetModInfo()
+{
+	uint32_t nGeneration = g_pModManager->GetLoadGeneration();
+	if (nGeneration == m_nModInfoGeneration && !m_svModInfo.empty())
+		return m_svModInfo;
+
+	nlohmann::json jsModList;
+	for (const Mod& mod : g_pModManager->m_LoadedMods)
+	{
+		nlohmann::json jsMod;
+
+		jsMod["Name"] = mod.Name;
+		jsMod["Version"] = mod.Version;
+		jsMod["RequiredOnClient"] = mod.RequiredOnClient;
+
+		jsModList["Mods"].emplace_back(jsMod);
+	}
+
+	m_svModInfo = jsModList.dump();
+	m_nModInfoGeneration = nGeneration;
+
+	return m_svModInfo;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands the current heartbeat values to m_HeartBeat, which marks the
+//          ones that changed
+//-----------------------------------------------------------------------------
+void CAtlasServer::UpdateHeartBeatValues()
+{
+	auto Get = [](const char* pszValue) { return std::string(pszValue ? pszValue : ""); };
+
+	HeartBeatValues_t values;
+	values.svName = Get(Cvar_hostname->GetString());
+	values.svDescription = Get(Cvar_hostdescription->GetString());
+	values.svMap = Get(g_pServerGlobalVariables->m_pMapName);
+	values.svPlaylist = Get(Cvar_mp_gamemode->GetString());
+	values.svMaxPlayers = Get(GetCurrentPlaylistVar("max_players", true));
+	values.svPassword = Get(Cvar_hostpassword->GetString());
+	values.nPort = Cvar_hostport->GetInt();
+	values.nPlayerCount = g_pServer->GetNumClients();
+	values.nModGeneration = g_pModManager->GetLoadGeneration();
+
+	m_HeartBeat.Update(values);
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Tries to send a heartbeat to atlas every 5 seconds only when
 //          atlas_broadcast_local_server is true. If it is true and we're
@@ -350,64 +396,41 @@ void CAtlasServer::HeartBeat(double flCurrentTime)
 		return;
 	}
 
-	std::thread(
-		[this]()
-		{
-			// Format URL
-			char* pszEscapedHostName = curl_easy_escape(nullptr, Cvar_hostname->GetString(), strlen(Cvar_hostname->GetString()));
-			char* pszEscapedHostDescription = curl_easy_escape(nullptr, Cvar_hostdescription->GetString(), strlen(Cvar_hostdescription->GetString()));
-			char* pszEscapedHostMap = curl_easy_escape(nullptr, g_pServerGlobalVariables->m_pMapName, strlen(g_pServerGlobalVariables->m_pMapName));
-			char* pszEscapedHostPlaylist = curl_easy_escape(nullptr, Cvar_mp_gamemode->GetString(), strlen(Cvar_mp_gamemode->GetString()));
-			char* pszEscapedHostPassword = curl_easy_escape(nullptr, Cvar_hostpassword->GetString(), strlen(Cvar_hostpassword->GetString()));
-			std::string svUrl = FormatA("%s/server/update_values?id=%s&port=%i&authPort=udp&name=%s&description=%s&map=%s&playlist=%s&playerCount=%i&maxPlayers=%s&password=%s", Cvar_atlas_hostname->GetString(), m_svID.c_str(), Cvar_hostport->GetInt(),
-										pszEscapedHostName, pszEscapedHostDescription, pszEscapedHostMap, pszEscapedHostPlaylist, g_pServer->GetNumClients(), GetCurrentPlaylistVar("max_players", true), pszEscapedHostPassword);
-			curl_free(pszEscapedHostName);
-			curl_free(pszEscapedHostDescription);
-			curl_free(pszEscapedHostMap);
-			curl_free(pszEscapedHostPlaylist);
-			curl_free(pszEscapedHostPassword);
+	// Only what changed since the last heartbeat goes out when atlas takes that
+	UpdateHeartBeatValues();
 
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
-
-			CURLMime cMime;
-			cMime.svFileName = "modinfo.json";
-			cMime.svName = "modinfo";
-			cMime.svType = "application/json";
-
-			// Build mods list
-			nlohmann::json jsModList;
-			for (const Mod& mod : g_pModManager->m_LoadedMods)
-			{
-				nlohmann::json jsMod;
+	HeartBeatRequest_t request;
+	m_HeartBeat.Build(Cvar_atlas_hostname->GetString(), m_svID, m_bHeartBeatDelta, request);
 
-				jsMod["Name"] = mod.Name;
-				jsMod["Version"] = mod.Version;
-				jsMod["RequiredOnClient"] = mod.RequiredOnClient;
-
-				jsModList["Mods"].emplace_back(jsMod);
-			}
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-			cMime.svData = jsModList.dump();
+	CURLMime cMime;
+	cMime.svFileName = "modinfo.json";
+	cMime.svName = "modinfo";
+	cMime.svType = "application/json";
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms, &cMime);
+	if (request.bModInfo)
+		cMime.svData = GetModInfo();
 
-			CURLcode nResult = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+	g_pHttpClient->SubmitRequest(request.svUrl.c_str(), "POST", cParms, request.bModInfo ? &cMime : nullptr,
+		[this, nFields = request.nFields](HttpResult_t& result)
+		{
+			std::string& svResponse = result.svResponse;
 
-			if (nResult != CURLcode::CURLE_OK)
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error %s\n", __FUNCTION, curl_easy_strerror(nResult));
+				Error(eLog::MS, NO_ERROR, "%s: Curl error %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
+				m_HeartBeat.Failed(nFields);
 				return;
 			}
 
 			if (svResponse.empty())
 			{
 				Error(eLog::MS, NO_ERROR, "%s: Response body is empty\n", __FUNCTION);
+				m_HeartBeat.Failed(nFields);
 				return;
 			}
 
@@ -423,6 +446,7 @@ void CAtlasServer::HeartBeat(double flCurrentTime)
 					if (jsResponse["error"]["msg"].is_string())
 						Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
 
+					m_HeartBeat.Failed(nFields);
 					return;
 				}
 
@@ -434,8 +458,7 @@ void CAtlasServer::HeartBeat(double flCurrentTime)
 			{
 				Error(eLog::MS, NO_ERROR, "%s: Failed parsing response json: '%s'\n", __FUNCTION, ex.what());
 			}
-		})
-		.detach();
+		});
 #undef __FUNCTION
 }
 
@@ -453,58 +476,40 @@ void CAtlasServer::RegisterSelf()
 	DevMsg(eLog::MS, "%s: Attempting to register local server to atlas\n", __FUNCTION);
 	m_bAttemptingToRegisterSelf = true;
 
-	std::thread(
-		[this]()
-		{
-			// Format URL
-			char* pszEscapedHostName = curl_easy_escape(nullptr, Cvar_hostname->GetString(), strlen(Cvar_hostname->GetString()));
-			char* pszEscapedHostDescription = curl_easy_escape(nullptr, Cvar_hostdescription->GetString(), strlen(Cvar_hostdescription->GetString()));
-			char* pszEscapedHostMap = curl_easy_escape(nullptr, g_pServerGlobalVariables->m_pMapName, strlen(g_pServerGlobalVariables->m_pMapName));
-			char* pszEscapedHostPlaylist = curl_easy_escape(nullptr, Cvar_mp_gamemode->GetString(), strlen(Cvar_mp_gamemode->GetString()));
-			char* pszEscapedHostPassword = curl_easy_escape(nullptr, Cvar_hostpassword->GetString(), strlen(Cvar_hostpassword->GetString()));
-			std::string svUrl = FormatA("%s/server/add_server?port=%i&authPort=udp&name=%s&description=%s&map=%s&playlist=%s&maxPlayers=%s&password=%s", Cvar_atlas_hostname->GetString(), Cvar_hostport->GetInt(), pszEscapedHostName,
-										pszEscapedHostDescription, pszEscapedHostMap, pszEscapedHostPlaylist, GetCurrentPlaylistVar("max_players", true), pszEscapedHostPassword);
-			curl_free(pszEscapedHostName);
-			curl_free(pszEscapedHostDescription);
-			curl_free(pszEscapedHostMap);
-			curl_free(pszEscapedHostPlaylist);
-			curl_free(pszEscapedHostPassword);
-
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
-
-			CURLMime cMime;
-			cMime.svFileName = "modinfo.json";
-			cMime.svName = "modinfo";
-			cMime.svType = "application/json";
-
-			// Build mods list
-			nlohmann::json jsModList;
-			for (const Mod& mod : g_pModManager->m_LoadedMods)
-			{
-				nlohmann::json jsMod;
-
-				jsMod["Name"] = mod.Name;
-				jsMod["Version"] = mod.Version;
-				jsMod["RequiredOnClient"] = mod.RequiredOnClient;
+	// Format URL
+	char* pszEscapedHostName = curl_easy_escape(nullptr, Cvar_hostname->GetString(), strlen(Cvar_hostname->GetString()));
+	char* pszEscapedHostDescription = curl_easy_escape(nullptr, Cvar_hostdescription->GetString(), strlen(Cvar_hostdescription->GetString()));
+	char* pszEscapedHostMap = curl_easy_escape(nullptr, g_pServerGlobalVariables->m_pMapName, strlen(g_pServerGlobalVariables->m_pMapName));
+	char* pszEscapedHostPlaylist = curl_easy_escape(nullptr, Cvar_mp_gamemode->GetString(), strlen(Cvar_mp_gamemode->GetString()));
+	char* pszEscapedHostPassword = curl_easy_escape(nullptr, Cvar_hostpassword->GetString(), strlen(Cvar_hostpassword->GetString()));
+	std::string svUrl = FormatA("%s/server/add_server?port=%i&authPort=udp&name=%s&description=%s&map=%s&playlist=%s&maxPlayers=%s&password=%s", Cvar_atlas_hostname->GetString(), Cvar_hostport->GetInt(), pszEscapedHostName,
+								pszEscapedHostDescription, pszEscapedHostMap, pszEscapedHostPlaylist, GetCurrentPlaylistVar("max_players", true), pszEscapedHostPassword);
+	curl_free(pszEscapedHostName);
+	curl_free(pszEscapedHostDescription);
+	curl_free(pszEscapedHostMap);
+	curl_free(pszEscapedHostPlaylist);
+	curl_free(pszEscapedHostPassword);
 
-				jsModList["Mods"].emplace_back(jsMod);
-			}
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-			cMime.svData = jsModList.dump();
+	CURLMime cMime;
+	cMime.svFileName = "modinfo.json";
+	cMime.svName = "modinfo";
+	cMime.svType = "application/json";
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms, &cMime);
+	cMime.svData = GetModInfo();
 
-			CURLcode nResult = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms, &cMime,
+		[this](HttpResult_t& result)
+		{
+			std::string& svResponse = result.svResponse;
 
-			if (nResult != CURLcode::CURLE_OK)
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(nResult));
+				Error(eLog::MS, NO_ERROR, "%s: Curl error: %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
 				m_bAttemptingToRegisterSelf = false;
 				return;
 			}
@@ -535,6 +540,22 @@ void CAtlasServer::RegisterSelf()
 				m_svID = jsResponse["id"].get<std::string>();
 				m_svAuthToken = jsResponse["serverAuthToken"].get<std::string>();
 
+				// Atlas lists what it takes beyond the original api
+				bool bPersistenceBatch = false;
+				bool bHeartBeatDelta = false;
+				auto itCapabilities = jsResponse.find("capabilities");
+				if (itCapabilities != jsResponse.end() && itCapabilities->is_array())
+				{
+					for (const nlohmann::json& jsCapability : *itCapabilities)
+					{
+						bPersistenceBatch |= jsCapability == PERSISTENCE_BATCH_CAPABILITY;
+						bHeartBeatDelta |= jsCapability == HEARTBEAT_DELTA_CAPABILITY;
+					}
+				}
+
+				m_bPersistenceBatch = bPersistenceBatch;
+				m_bHeartBeatDelta = bHeartBeatDelta;
+
 				DevMsg(eLog::MS, "%s: Successfully registered server:\n", __FUNCTION);
 				DevMsg(eLog::MS, "Name: %s\n", Cvar_hostname->GetString());
 				DevMsg(eLog::MS, "ID  : %s\n", m_svID.c_str());
@@ -546,8 +567,7 @@ void CAtlasServer::RegisterSelf()
 			}
 
 			m_bAttemptingToRegisterSelf = false;
-		})
-		.detach();
+		});
 #undef __FUNCTION
 }
 
@@ -561,29 +581,23 @@ void CAtlasServer::UnregisterSelf()
 		return;
 	}
 
-	std::thread(
-		[this]
-		{
-			std::string svUrl = FormatA("%s/server/remove_server?id=%s", Cvar_atlas_hostname->GetString(), m_svID.c_str());
+	// Pdata of players that just left has to reach atlas while it still knows us
+	FlushPersistence(true);
+	m_bPersistenceBatch = false;
+	m_bHeartBeatDelta = false;
 
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
-
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "DELETE", svResponse, cParms);
+	std::string svUrl = FormatA("%s/server/remove_server?id=%s", Cvar_atlas_hostname->GetString(), m_svID.c_str());
 
-			CURLcode nResult = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+	// Clear right away, this gets called every frame while the server isn't active
+	m_svAuthToken = "";
+	m_svID = "";
 
-			NOTE_UNUSED(nResult);
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-			m_svAuthToken = "";
-			m_svID = "";
-		})
-		.detach();
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "DELETE", cParms, nullptr, [](HttpResult_t& result) { NOTE_UNUSED(result); });
 }
 
 //-----------------------------------------------------------------------------
@@ -635,14 +649,21 @@ void CAtlasServer::HandleConnectionlessPacket(netpacket_t* packet)
 		return;
 	}
 
-	if (!VerifyHMACSHA256(g_pAtlasServer->m_svAuthToken, pSig, pData))
+	// Only rekey when atlas hands us a new token
+	if (m_svAuthHMACKey != m_svAuthToken)
+	{
+		m_svAuthHMACKey = m_svAuthToken;
+		m_AuthHMAC.SetKey(m_svAuthHMACKey);
+	}
+
+	if (!m_AuthHMAC.Verify(pSig, pData))
 	{
 		Warning(eLog::MS, "%s: Ignoring Atlas connectionless packet (size=%i type=%s): invalid: invalid signature (key=%s)\n", __FUNCTION, packet->size, pType.c_str(), m_svAuthToken.c_str());
 		return;
 	}
 
 	// Don't block
-	std::thread(
+	bool bQueued = g_pJobSystem->Submit(eJobQueue::NETWORK,
 		[this, pData]()
 		{
 			std::string svToken;
@@ -698,57 +719,55 @@ void CAtlasServer::HandleConnectionlessPacket(netpacket_t* packet)
 
 				CURLParms cParms;
 				cParms.nTimeout = 30; // TODO: make this a cvar
-				cParms.pWriteFunc = CURLWriteStringCallback;
 				cParms.bVerifyHost = true; // TODO: make this a cvar
 				cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-				std::string svResponse;
-				CURL* curl = CURLInitRequest(svUrl.c_str(), "GET", svResponse, cParms);
-
-				CURLcode nResult = CURLSubmitRequest(curl);
-				long nResponse = CURLGetResponse(curl);
-				CURLCleanup(curl);
-
-				if (nResult != CURLcode::CURLE_OK)
-				{
-					Error(eLog::MS, NO_ERROR, "%s (connect): Curl error: %s \n", __FUNCTION, curl_easy_strerror(nResult));
-					return;
-				}
-
-				if (nResponse != 200)
-				{
-					Error(eLog::MS, NO_ERROR, "%s: Failed making connect request: %ld\n", __FUNCTION, nResponse);
-					try
-					{
-						nlohmann::json jsResponse = nlohmann::json::parse(svResponse);
-
-						if (jsResponse["error"]["enum"].is_string())
-							Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
-						if (jsResponse["error"]["msg"].is_string())
-							Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
-					}
-					catch (const std::exception& ex)
+				g_pHttpClient->SubmitRequest(svUrl.c_str(), "GET", cParms, nullptr,
+					[this, svToken, svUserName, nUID](HttpResult_t& result)
 					{
-						NOTE_UNUSED(ex);
-					}
-					return;
-				}
-				if (svResponse.size() > PERSISTENCE_MAX_SIZE)
-				{
-					Error(eLog::MS, NO_ERROR, "%s: Persistence buffer too large!\n", __FUNCTION);
-					return;
-				}
-
-				AuthInfo_t info;
-				info.m_svName = svUserName;
-				info.m_svUID = std::to_string(nUID);
-				info.m_bValid = true;
-
-				info.m_svPData = svResponse;
-
-				DevMsg(eLog::MS, "%s: Authenticated user '%s' ( %s ), pdata size: %li\n", __FUNCTION, info.m_svName.c_str(), info.m_svUID.c_str(), info.m_svPData.size());
-
-				AddAuthInfo(svToken, info);
+						std::string& svResponse = result.svResponse;
+
+						if (result.nResult != CURLcode::CURLE_OK)
+						{
+							Error(eLog::MS, NO_ERROR, "%s (connect): Curl error: %s \n", __FUNCTION, curl_easy_strerror(result.nResult));
+							return;
+						}
+
+						if (result.nResponse != 200)
+						{
+							Error(eLog::MS, NO_ERROR, "%s: Failed making connect request: %ld\n", __FUNCTION, result.nResponse);
+							try
+							{
+								nlohmann::json jsResponse = nlohmann::json::parse(svResponse);
+
+								if (jsResponse["error"]["enum"].is_string())
+									Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
+								if (jsResponse["error"]["msg"].is_string())
+									Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
+							}
+							catch (const std::exception& ex)
+							{
+								NOTE_UNUSED(ex);
+							}
+							return;
+						}
+						if (svResponse.size() > PERSISTENCE_MAX_SIZE)
+						{
+							Error(eLog::MS, NO_ERROR, "%s: Persistence buffer too large!\n", __FUNCTION);
+							return;
+						}
+
+						AuthInfo_t info;
+						info.m_svName = svUserName;
+						info.m_svUID = std::to_string(nUID);
+						info.m_bValid = true;
+
+						info.m_svPData = svResponse;
+
+						DevMsg(eLog::MS, "%s: Authenticated user '%s' ( %s ), pdata size: %li\n", __FUNCTION, info.m_svName.c_str(), info.m_svUID.c_str(), info.m_svPData.size());
+
+						AddAuthInfo(svToken, info);
+					});
 			}
 			else // Reject is not empty so lets reject the connect attempt
 			{
@@ -758,46 +777,47 @@ void CAtlasServer::HandleConnectionlessPacket(netpacket_t* packet)
 
 				CURLParms cParms;
 				cParms.nTimeout = 30; // TODO: make this a cvar
-				cParms.pWriteFunc = CURLWriteStringCallback;
 				cParms.bVerifyHost = true; // TODO: make this a cvar
 				cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-				std::string svResponse;
-				CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms);
-
-				CURLcode nResult = CURLSubmitRequest(curl);
-				long nResponse = CURLGetResponse(curl);
-				CURLCleanup(curl);
-
-				if (nResult != CURLcode::CURLE_OK)
-				{
-					Error(eLog::MS, NO_ERROR, "%s (reject): Curl error: %s\n", __FUNCTION, curl_easy_strerror(nResult));
-					return;
-				}
-
-				if (nResponse != 200)
-				{
-					Error(eLog::MS, NO_ERROR, "%s: Failed rejecting connect request: %ld\n", __FUNCTION, nResponse);
-					try
-					{
-						nlohmann::json jsResponse = nlohmann::json::parse(svResponse);
-
-						if (jsResponse["error"]["enum"].is_string())
-							Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
-						if (jsResponse["error"]["msg"].is_string())
-							Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
-					}
-					catch (const std::exception& ex)
+				g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms, nullptr,
+					[svUserName, svReject](HttpResult_t& result)
 					{
-						NOTE_UNUSED(ex);
-					}
-					return;
-				}
-
-				DevMsg(eLog::MS, "%s: Rejected atlas connectionless packet for client '%s' with reason: '%s'\n", __FUNCTION, svUserName.c_str(), svReject.c_str());
+						if (result.nResult != CURLcode::CURLE_OK)
+						{
+							Error(eLog::MS, NO_ERROR, "%s (reject): Curl error: %s\n", __FUNCTION, curl_easy_strerror(result.nResult));
+							return;
+						}
+
+						if (result.nResponse != 200)
+						{
+							Error(eLog::MS, NO_ERROR, "%s: Failed rejecting connect request: %ld\n", __FUNCTION, result.nResponse);
+							try
+							{
+								nlohmann::json jsResponse = nlohmann::json::parse(result.svResponse);
+
+								if (jsResponse["error"]["enum"].is_string())
+									Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
+								if (jsResponse["error"]["msg"].is_string())
+									Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
+							}
+							catch (const std::exception& ex)
+							{
+								NOTE_UNUSED(ex);
+							}
+							return;
+						}
+
+						DevMsg(eLog::MS, "%s: Rejected atlas connectionless packet for client '%s' with reason: '%s'\n", __FUNCTION, svUserName.c_str(), svReject.c_str());
+					});
 			}
-		})
-		.detach();
+		});
+
+	// Too many connects pending, atlas will time the attempt out and the client can retry
+	if (!bQueued)
+	{
+		Warning(eLog::MS, "%s: Dropping atlas connectionless packet, job queue is full\n", __FUNCTION);
+	}
 #undef __FUNCTION
 }
 
@@ -815,25 +835,20 @@ void CAtlasServer::AuthenticateLocalClient(std::string svUID)
 
 	CURLParms cParms;
 	cParms.nTimeout = 30; // TODO: make this a cvar
-	cParms.pWriteFunc = CURLWriteStringCallback;
 	cParms.bVerifyHost = true; // TODO: make this a cvar
 	cParms.bVerifyPeer = true; // TODO: make this a cvar
 
-	std::string svResponse;
-	CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms);
-
-	CURLcode nResult = CURLSubmitRequest(curl);
-	CURLCleanup(curl);
+	HttpResult_t result = g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms).get();
 
-	if (nResult != CURLcode::CURLE_OK)
+	if (result.nResult != CURLcode::CURLE_OK)
 	{
-		Error(eLog::MS, NO_ERROR, "%s: Curl error: '%s'\n", __FUNCTION, curl_easy_strerror(nResult));
+		Error(eLog::MS, NO_ERROR, "%s: Curl error: '%s'\n", __FUNCTION, curl_easy_strerror(result.nResult));
 		return;
 	}
 
 	try
 	{
-		nlohmann::json jsResponse = nlohmann::json::parse(svResponse);
+		nlohmann::json jsResponse = nlohmann::json::parse(result.svResponse);
 
 		if (jsResponse["success"] == false)
 		{
@@ -897,11 +912,25 @@ bool CAtlasServer::SetupClient(CClient* pClient, std::string svToken)
 
 	pClient->m_nPersistenceState = ePersistenceReady::READY_REMOTE;
 
+	// Atlas just gave us this pdata, pushing it back unchanged is pointless
+	// and later pushes can be sent as deltas against it
+	{
+		std::lock_guard<std::mutex> guard(m_PersistenceMutex);
+
+		PersistenceSync_t& sync = m_mpPersistenceSync[pClient->m_UID];
+		sync.svAcked.assign(pClient->m_PersistenceBuffer, PERSISTENCE_PUSH_SIZE);
+		sync.bDisconnected = false;
+	}
+
 	return true;
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Pushes persistence of a client to atlas
+// Purpose: Queues persistence of a client to be pushed to atlas
+// Note   : Pushes are held for atlas_persistence_coalesce_window so players
+//          leaving together, like at match end, go out in one flush. Only
+//          the newest pdata of a player is kept and pdata atlas already has
+//          isn't sent again, see FlushPersistence
 //        : *pClient -
 //-----------------------------------------------------------------------------
 void CAtlasServer::PushPersistence(CClient* pClient)
@@ -918,72 +947,382 @@ void CAtlasServer::PushPersistence(CClient* pClient)
 		return;
 	}
 
-	DevMsg(eLog::MS, "%s: Pushing persistence to atlas for: '%s' ( %s )\n", __FUNCTION, pClient->m_szServerName, pClient->m_UID);
-	m_iPersistencePushes++;
-
-	// FIXME [Fifty]: Atlas cries when i send pdata of PERSISTENCE_MAX_SIZE size
-	//                '56306' is the size of pdata we get from atlas on auth so lets hope it doesnt break
-	std::string pData;
-	pData.resize(56306);
-	memcpy_s(pData.data(), 56306, pClient->m_PersistenceBuffer, 56306);
-
+	std::string pData(pClient->m_PersistenceBuffer, PERSISTENCE_PUSH_SIZE);
 	std::string svUID = pClient->m_UID;
 	std::string svName = pClient->m_szServerName;
 
-	std::thread(
-		[this, svUID, svName, pData]()
-		{
-			CURLParms cParms;
-			cParms.nTimeout = 30; // TODO: make this a cvar
-			cParms.pWriteFunc = CURLWriteStringCallback;
-			cParms.bVerifyHost = true; // TODO: make this a cvar
-			cParms.bVerifyPeer = true; // TODO: make this a cvar
+	std::lock_guard<std::mutex> guard(m_PersistenceMutex);
+	PersistenceSync_t& sync = m_mpPersistenceSync[svUID];
 
-			CURLMime cMime;
-			cMime.svData = pData;
-			cMime.svFileName = "file.pdata";
-			cMime.svName = "pdata";
-			cMime.svType = "application/octet-stream";
+	if (sync.svPending.empty() && !sync.bInFlight && sync.svAcked == pData)
+	{
+		DevMsg(eLog::MS, "%s: Persistence unchanged for: '%s' ( %s )\n", __FUNCTION, svName.c_str(), svUID.c_str());
+		return;
+	}
+
+	if (sync.svPending.empty())
+		m_iPersistencePushes++;
+	else
+		DevMsg(eLog::MS, "%s: Replaced queued persistence push for: '%s' ( %s )\n", __FUNCTION, svName.c_str(), svUID.c_str());
 
-			std::string svUrl = FormatA("%s/accounts/write_persistence?id=%s&serverId=%s", Cvar_atlas_hostname->GetString(), svUID.c_str(), m_svID.c_str());
+	sync.svPending = std::move(pData);
+	sync.svPendingName = std::move(svName);
+	sync.svPendingServerID = m_svID;
+	sync.svPendingHostname = Cvar_atlas_hostname->GetString();
 
-			std::string svResponse;
-			CURL* curl = CURLInitRequest(svUrl.c_str(), "POST", svResponse, cParms, &cMime);
+	if (m_flPersistenceFlushTime == 0.0)
+		m_flPersistenceFlushTime = Plat_FloatTime() + std::max(Cvar_atlas_persistence_coalesce_window->GetFloat(), 0.0f);
+#undef __FUNCTION
+}
 
-			CURLcode nResult = CURLSubmitRequest(curl);
-			CURLCleanup(curl);
+//-----------------------------------------------------------------------------
+// Purpose: Sends queued persistence pushes, called every frame
+// Note   : When atlas takes batches players are sent together, each as a
+//          delta against the pdata atlas acknowledged last if that is
+//          smaller. Otherwise every player gets their own full push. Players
+//          with a push in flight stay queued, its callback flushes again
+// Input  : bForce - Don't wait for the coalesce window to pass
+//-----------------------------------------------------------------------------
+void CAtlasServer::FlushPersistence(bool bForce)
+{
+#define __FUNCTION "CAtlasServer::FlushPersistence"
+	std::vector<PersistencePush_t> vPushes;
+	bool bBatch = m_bPersistenceBatch;
+
+	{
+		std::lock_guard<std::mutex> guard(m_PersistenceMutex);
+
+		if (m_flPersistenceFlushTime == 0.0 || (!bForce && Plat_FloatTime() < m_flPersistenceFlushTime))
+			return;
+
+		m_flPersistenceFlushTime = 0.0;
+
+		for (auto it = m_mpPersistenceSync.begin(); it != m_mpPersistenceSync.end();)
+		{
+			PersistenceSync_t& sync = it->second;
 
-			if (nResult != CURLcode::CURLE_OK)
+			if (sync.svPending.empty() || sync.bInFlight)
 			{
-				Error(eLog::MS, NO_ERROR, "%s: Curl error: '%s'\n", __FUNCTION, curl_easy_strerror(nResult));
+				++it;
+				continue;
+			}
+
+			if (sync.svPending == sync.svAcked)
+			{
+				DevMsg(eLog::MS, "%s: Persistence unchanged for: '%s' ( %s )\n", __FUNCTION, sync.svPendingName.c_str(), it->first.c_str());
 				m_iPersistencePushes--;
-				return;
+				sync.svPending.clear();
+
+				if (sync.bDisconnected)
+				{
+					it = m_mpPersistenceSync.erase(it);
+					continue;
+				}
+
+				++it;
+				continue;
 			}
 
-			try
+			PersistencePush_t& push = vPushes.emplace_back();
+			push.svUID = it->first;
+			push.svName = std::move(sync.svPendingName);
+			push.svServerID = std::move(sync.svPendingServerID);
+			push.svHostname = std::move(sync.svPendingHostname);
+			push.svData = std::move(sync.svPending);
+			sync.svPending.clear();
+
+			if (bBatch)
+				push.svBase = sync.svAcked;
+
+			sync.bInFlight = true;
+			++it;
+		}
+	}
+
+	if (!bBatch)
+	{
+		for (PersistencePush_t& push : vPushes)
+			SendPersistence(std::move(push));
+
+		return;
+	}
+
+	// A batch goes to one server id, it only changes if we re-registered
+	// while pushes were queued
+	std::sort(vPushes.begin(), vPushes.end(),
+		[](const PersistencePush_t& a, const PersistencePush_t& b) { return std::tie(a.svHostname, a.svServerID) < std::tie(b.svHostname, b.svServerID); });
+
+	// Sizes are counted as full pdata, deltas only make a batch smaller
+	std::vector<PersistencePush_t> vBatch;
+	size_t nBatchSize = 0;
+
+	for (PersistencePush_t& push : vPushes)
+	{
+		if (!vBatch.empty() &&
+			(vBatch.size() >= PERSISTENCE_BATCH_MAX_PLAYERS || nBatchSize + push.svData.size() > PERSISTENCE_BATCH_MAX_SIZE || push.svHostname != vBatch.front().svHostname ||
+			 push.svServerID != vBatch.front().svServerID))
+		{
+			SendPersistenceBatch(std::move(vBatch));
+			vBatch.clear();
+			nBatchSize = 0;
+		}
+
+		nBatchSize += push.svData.size();
+		vBatch.push_back(std::move(push));
+	}
+
+	if (!vBatch.empty())
+		SendPersistenceBatch(std::move(vBatch));
+#undef __FUNCTION
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops the persistence sync state of a disconnected player
+// Note   : If a push is still queued or in flight the entry goes once it's done
+// Input  : svUID -
+//-----------------------------------------------------------------------------
+void CAtlasServer::RemovePersistenceSync(std::string svUID)
+{
+	std::lock_guard<std::mutex> guard(m_PersistenceMutex);
+
+	auto it = m_mpPersistenceSync.find(svUID);
+	if (it == m_mpPersistenceSync.end())
+		return;
+
+	if (it->second.bInFlight || !it->second.svPending.empty())
+		it->second.bDisconnected = true;
+	else
+		m_mpPersistenceSync.erase(it);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Uploads the full pdata of one player
+// Input  : push - The player's sync state has to be marked in flight
+//-----------------------------------------------------------------------------
+void CAtlasServer::SendPersistence(PersistencePush_t push)
+{
+#define __FUNCTION "CAtlasServer::SendPersistence"
+	DevMsg(eLog::MS, "%s: Pushing persistence to atlas for: '%s' ( %s )\n", __FUNCTION, push.svName.c_str(), push.svUID.c_str());
+
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
+
+	CURLMime cMime;
+	cMime.svData = push.svData;
+	cMime.svFileName = "file.pdata";
+	cMime.svName = "pdata";
+	cMime.svType = "application/octet-stream";
+
+	std::string svUrl = FormatA("%s/accounts/write_persistence?id=%s&serverId=%s", push.svHostname.c_str(), push.svUID.c_str(), push.svServerID.c_str());
+
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms, &cMime,
+		[this, push = std::move(push)](HttpResult_t& result) mutable
+		{
+			ePersistencePushResult eResult = ePersistencePushResult::FAILED;
+
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				nlohmann::json jsResponse = nlohmann::json::parse(svResponse);
+				Error(eLog::MS, NO_ERROR, "%s: Curl error: '%s'\n", __FUNCTION, curl_easy_strerror(result.nResult));
+			}
+			else
+			{
+				try
+				{
+					nlohmann::json jsResponse = nlohmann::json::parse(result.svResponse);
 
-				if (jsResponse["success"] == false)
+					if (jsResponse["success"] == false)
+					{
+						Error(eLog::MS, NO_ERROR, "%s: Failed to push persistence to atlas for '%s'!\n", __FUNCTION, push.svName.c_str());
+						if (jsResponse["error"]["enum"].is_string())
+							Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
+						if (jsResponse["error"]["msg"].is_string())
+							Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
+					}
+					else
+					{
+						eResult = ePersistencePushResult::SUCCESS;
+					}
+				}
+				catch (const std::exception& ex)
 				{
-					Error(eLog::MS, NO_ERROR, "%s: Failed to push persistence to atlas for '%s'!\n", __FUNCTION, svName.c_str());
-					if (jsResponse["error"]["enum"].is_string())
-						Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
-					if (jsResponse["error"]["msg"].is_string())
-						Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
+					NOTE_UNUSED(ex);
 				}
 			}
-			catch (const std::exception& ex)
+
+			FinishPersistencePush(push, eResult);
+		});
+#undef __FUNCTION
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Uploads the pdata of several players in one request
+// Note   : Atlas answers with a result per player, a player missing from it
+//          counts as failed
+// Input  : vPushes - All going to the same server id, marked in flight
+//-----------------------------------------------------------------------------
+void CAtlasServer::SendPersistenceBatch(std::vector<PersistencePush_t> vPushes)
+{
+#define __FUNCTION "CAtlasServer::SendPersistenceBatch"
+	CURLMime cMime;
+	cMime.svFileName = "batch.pdata";
+	cMime.svName = "pdata";
+	cMime.svType = PERSISTENCE_BATCH_TYPE;
+
+	PersistenceBatch_Begin(cMime.svData);
+
+	std::string svDelta;
+	size_t nFullSize = 0;
+	int nDeltas = 0;
+
+	for (PersistencePush_t& push : vPushes)
+	{
+		nFullSize += push.svData.size();
+
+		bool bDelta = false;
+		if (!push.svBase.empty())
+		{
+			PersistenceDelta_Encode(push.svBase, push.svData, svDelta);
+			bDelta = svDelta.size() < push.svData.size();
+
+			// Only needed to encode, don't keep it around until atlas answers
+			std::string().swap(push.svBase);
+		}
+
+		if (bDelta)
+		{
+			PersistenceBatch_Add(cMime.svData, push.svUID, ePersistenceEncoding::DELTA, svDelta);
+			nDeltas++;
+		}
+		else
+		{
+			PersistenceBatch_Add(cMime.svData, push.svUID, ePersistenceEncoding::FULL, push.svData);
+		}
+	}
+
+	DevMsg(eLog::MS, "%s: Pushing persistence to atlas for %zu players, %i as deltas ( %zu bytes instead of %zu )\n", __FUNCTION, vPushes.size(), nDeltas, cMime.svData.size(), nFullSize);
+
+	CURLParms cParms;
+	cParms.nTimeout = 30; // TODO: make this a cvar
+	cParms.bVerifyHost = true; // TODO: make this a cvar
+	cParms.bVerifyPeer = true; // TODO: make this a cvar
+
+	std::string svUrl = FormatA("%s/accounts/write_persistence_batch?serverId=%s", vPushes.front().svHostname.c_str(), vPushes.front().svServerID.c_str());
+
+	g_pHttpClient->SubmitRequest(svUrl.c_str(), "POST", cParms, &cMime,
+		[this, vPushes = std::move(vPushes)](HttpResult_t& result) mutable
+		{
+			std::vector<ePersistencePushResult> vResults(vPushes.size(), ePersistencePushResult::FAILED);
+
+			if (result.nResult != CURLcode::CURLE_OK)
 			{
-				NOTE_UNUSED(ex);
+				Error(eLog::MS, NO_ERROR, "%s: Curl error: '%s'\n", __FUNCTION, curl_easy_strerror(result.nResult));
 			}
+			else
+			{
+				try
+				{
+					nlohmann::json jsResponse = nlohmann::json::parse(result.svResponse);
 
-			m_iPersistencePushes--;
-		})
-		.detach();
+					if (jsResponse["success"] == false)
+					{
+						Error(eLog::MS, NO_ERROR, "%s: Failed to push persistence to atlas for %zu players!\n", __FUNCTION, vPushes.size());
+						if (jsResponse["error"]["enum"].is_string())
+							Error(eLog::MS, NO_ERROR, "Code: '%s'\n", jsResponse["error"]["enum"].get<std::string>().c_str());
+						if (jsResponse["error"]["msg"].is_string())
+							Error(eLog::MS, NO_ERROR, "Msg : '%s'\n", jsResponse["error"]["msg"].get<std::string>().c_str());
+					}
+					else
+					{
+						nlohmann::json& jsResults = jsResponse["results"];
+
+						for (size_t i = 0; i < vPushes.size(); i++)
+						{
+							nlohmann::json& jsResult = jsResults[vPushes[i].svUID];
+
+							if (jsResult["success"] == true)
+							{
+								vResults[i] = ePersistencePushResult::SUCCESS;
+								continue;
+							}
+
+							std::string svError = jsResult["error"]["enum"].is_string() ? jsResult["error"]["enum"].get<std::string>() : "";
+							if (svError == "PERSISTENCE_STALE_BASE")
+								vResults[i] = ePersistencePushResult::STALE_BASE;
+							else
+								Error(eLog::MS, NO_ERROR, "%s: Failed to push persistence to atlas for '%s' ( %s )!\n", __FUNCTION, vPushes[i].svName.c_str(), svError.c_str());
+						}
+					}
+				}
+				catch (const std::exception& ex)
+				{
+					NOTE_UNUSED(ex);
+				}
+			}
+
+			for (size_t i = 0; i < vPushes.size(); i++)
+				FinishPersistencePush(vPushes[i], vResults[i]);
+		});
 #undef __FUNCTION
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Updates a player's sync state once atlas answered their push
+// Note   : Called from the http client thread
+// Input  : &push -
+//          eResult -
+//-----------------------------------------------------------------------------
+void CAtlasServer::FinishPersistencePush(PersistencePush_t& push, ePersistencePushResult eResult)
+{
+	std::lock_guard<std::mutex> guard(m_PersistenceMutex);
+
+	// Entries are never removed while a push is in flight
+	auto it = m_mpPersistenceSync.find(push.svUID);
+	if (it != m_mpPersistenceSync.end())
+	{
+		PersistenceSync_t& sync = it->second;
+		sync.bInFlight = false;
+
+		switch (eResult)
+		{
+		case ePersistencePushResult::SUCCESS:
+			sync.svAcked = std::move(push.svData);
+			break;
+		case ePersistencePushResult::FAILED:
+			// Unknown after a failure, the next push sends everything
+			sync.svAcked.clear();
+			break;
+		case ePersistencePushResult::STALE_BASE:
+			sync.svAcked.clear();
+
+			// Send it again in full, unless something newer is queued anyway
+			if (sync.svPending.empty())
+			{
+				sync.svPending = std::move(push.svData);
+				sync.svPendingName = std::move(push.svName);
+				sync.svPendingServerID = std::move(push.svServerID);
+				sync.svPendingHostname = std::move(push.svHostname);
+				m_iPersistencePushes++;
+			}
+			break;
+		}
+
+		// Anything queued while this was in flight goes out with the next flush
+		if (!sync.svPending.empty())
+		{
+			if (m_flPersistenceFlushTime == 0.0)
+				m_flPersistenceFlushTime = Plat_FloatTime();
+		}
+		else if (sync.bDisconnected)
+		{
+			m_mpPersistenceSync.erase(it);
+		}
+	}
+
+	m_iPersistencePushes--;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Checks if we have auth info for a token
 // Input  : svToken -
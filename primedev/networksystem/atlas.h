@@ -2,6 +2,8 @@
 
 #include "networksystem/netchannel.h"
 #include "engine/client/client.h"
+#include "networksystem/bcrypt.h"
+#include "networksystem/heartbeat.h"
 
 //-----------------------------------------------------------------------------
 //
@@ -130,6 +132,8 @@ class CAtlasServer
 
 	bool SetupClient(CClient* pClient, std::string svToken);
 	void PushPersistence(CClient* pClient);
+	void FlushPersistence(bool bForce);
+	void RemovePersistenceSync(std::string svUID);
 
 	bool HasAuthInfo(std::string svToken);
 	AuthInfo_t GetAuthInfo(std::string svToken);
@@ -143,19 +147,90 @@ class CAtlasServer
 	}
 
   private:
+	const std::string& GetModInfo();
+	void UpdateHeartBeatValues();
+
 	double m_flLastHearBeat = 0.0;
 
+	// Fields atlas hasn't seen yet, see heartbeat.h
+	CHeartBeatState m_HeartBeat;
+
+	// Atlas takes partial heartbeats and keepalives
+	std::atomic_bool m_bHeartBeatDelta = false;
+
+	// Serialised mod list, rebuilt when the mod manager's load generation changes
+	std::string m_svModInfo;
+	uint32_t m_nModInfoGeneration = 0;
+
 	bool m_bAttemptingToRegisterSelf = false;
 	bool m_bSuccesfullyRegisteredSelf = false;
 
 	std::string m_svID;
 	std::string m_svAuthToken;
 
+	// Keyed with m_svAuthToken, verifies sigreq1 packets
+	CHMACSHA256 m_AuthHMAC;
+	std::string m_svAuthHMACKey;
+
 	// Map of auth info ( token : info )
 	std::map<std::string, AuthInfo_t> m_mpAuthInfo;
 	std::mutex m_AuthDataMutex;
 
+	// Players with pdata queued or in flight, connecting to another server waits on this
 	std::atomic_int m_iPersistencePushes = 0;
+
+	// Atlas takes several players per request as deltas, see persistencedelta.h
+	std::atomic_bool m_bPersistenceBatch = false;
+
+	//-----------------------------------------------------------------------------
+	// Persistence push bookkeeping for a player
+	struct PersistenceSync_t
+	{
+		// Pdata atlas has for this player as far as we know, deltas are made
+		// against it. Empty when unknown
+		std::string svAcked;
+
+		// Newest pdata, waits for the flush or for the push in flight
+		std::string svPending;
+		std::string svPendingName;
+		std::string svPendingServerID;
+		std::string svPendingHostname;
+
+		bool bInFlight = false;
+
+		// Player disconnected, the entry goes once nothing is queued or in flight
+		bool bDisconnected = false;
+	};
+
+	//-----------------------------------------------------------------------------
+	// A player's pdata taken out of the queue by FlushPersistence
+	struct PersistencePush_t
+	{
+		std::string svUID;
+		std::string svName;
+		std::string svServerID;
+		std::string svHostname;
+		std::string svData;
+		// What atlas acknowledged last, only filled when deltas can be sent
+		std::string svBase;
+	};
+
+	enum class ePersistencePushResult : int
+	{
+		SUCCESS = 0,
+		FAILED = 1,
+		STALE_BASE = 2 // Atlas doesn't have the base the delta was made against
+	};
+
+	void SendPersistence(PersistencePush_t push);
+	void SendPersistenceBatch(std::vector<PersistencePush_t> vPushes);
+	void FinishPersistencePush(PersistencePush_t& push, ePersistencePushResult eResult);
+
+	// Map of persistence sync state ( uid : state )
+	std::unordered_map<std::string, PersistenceSync_t> m_mpPersistenceSync;
+	// When queued pushes go out, 0 when nothing is queued
+	double m_flPersistenceFlushTime = 0.0;
+	std::mutex m_PersistenceMutex;
 };
 
 inline CAtlasServer* g_pAtlasServer = nullptr;
@@ -5,136 +5,161 @@
 #include <filesystem>
 
 const char* BANLIST_PATH_SUFFIX = "/banlist.txt";
+const char* BANLIST_JOURNAL_PATH_SUFFIX = "/banlist_journal.txt";
 const char BANLIST_COMMENT_CHAR = '#';
 
 ServerBanSystem* g_pBanSystem;
 
-void ServerBanSystem::OpenBanlist()
+//-----------------------------------------------------------------------------
+// Purpose: Gets the uid from a banlist line
+// Input  : &line -
+//          &uid -
+// Output : False if the line is empty or a comment
+//-----------------------------------------------------------------------------
+static bool GetBanlistLineUID(const std::string& line, uint64_t& uid)
 {
-	std::ifstream banlistStream(g_svProfileDir + "/banlist.txt");
+	std::string modLine = line;
 
-	if (!banlistStream.fail())
-	{
-		std::string line;
-		while (std::getline(banlistStream, line))
-		{
-			// ignore line if first char is # or line is empty
-			if (line == "" || line.front() == BANLIST_COMMENT_CHAR)
-				continue;
+	// remove tabs which shouldnt be there but maybe someone did the funny
+	modLine.erase(std::remove(modLine.begin(), modLine.end(), '\t'), modLine.end());
+	// remove spaces to allow for spaces before uids
+	modLine.erase(std::remove(modLine.begin(), modLine.end(), ' '), modLine.end());
 
-			// remove tabs which shouldnt be there but maybe someone did the funny
-			line.erase(std::remove(line.begin(), line.end(), '\t'), line.end());
-			// remove spaces to allow for spaces before uids
-			line.erase(std::remove(line.begin(), line.end(), ' '), line.end());
+	// ignore line if first char is # or line is empty
+	if (modLine.empty() || modLine.front() == BANLIST_COMMENT_CHAR)
+		return false;
 
-			// check if line is empty to allow for newlines in the file
-			if (line == "")
-				continue;
+	// for inline comments like: 123123123 #banned for unfunny
+	uid = strtoull(modLine.substr(0, modLine.find(BANLIST_COMMENT_CHAR)).c_str(), nullptr, 10);
+	return true;
+}
 
-			// for inline comments like: 123123123 #banned for unfunny
-			std::string uid = line.substr(0, line.find(BANLIST_COMMENT_CHAR));
+//-----------------------------------------------------------------------------
+// Purpose: Gets the size and write time of banlist.txt with a single stat
+//-----------------------------------------------------------------------------
+ServerBanSystem::FileState_t ServerBanSystem::GetBanlistFileState()
+{
+	FileState_t state;
 
-			m_vBannedUids.push_back(strtoull(uid.c_str(), nullptr, 10));
-		}
+	std::error_code ec;
+	std::filesystem::directory_entry entry(g_svProfileDir + BANLIST_PATH_SUFFIX, ec);
 
-		banlistStream.close();
+	if (!ec && entry.is_regular_file(ec))
+	{
+		state.bExists = true;
+		state.nSize = entry.file_size(ec);
+		state.tWriteTime = entry.last_write_time(ec);
 	}
 
-	// open write stream for banlist // dont do this to allow for all time access
-	// m_sBanlistStream.open(g_svProfileDir + "/banlist.txt", std::ofstream::out | std::ofstream::binary | std::ofstream::app);
+	return state;
 }
 
-void ServerBanSystem::ReloadBanlist()
+//-----------------------------------------------------------------------------
+// Purpose: Checks if banlist.txt was changed since we last read it
+//-----------------------------------------------------------------------------
+bool ServerBanSystem::HasBanlistChanged()
 {
-	std::ifstream fsBanlist(g_svProfileDir + "/banlist.txt");
+	FileState_t state = GetBanlistFileState();
+	return state.bExists != m_BanlistState.bExists || state.nSize != m_BanlistState.nSize || state.tWriteTime != m_BanlistState.tWriteTime;
+}
 
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds the banned uid set from banlist.txt and the journal,
+//          m_Mutex must be held
+//-----------------------------------------------------------------------------
+void ServerBanSystem::ParseBanlist()
+{
+	// Grab the state before reading so an edit made while we read triggers another reload
+	m_BanlistState = GetBanlistFileState();
+
+	m_BannedUids.clear();
+
+	std::ifstream fsBanlist(g_svProfileDir + BANLIST_PATH_SUFFIX);
 	if (!fsBanlist.fail())
 	{
 		std::string line;
-		// since we wanna use this as the reload func we need to clear the list
-		m_vBannedUids.clear();
 		while (std::getline(fsBanlist, line))
-			m_vBannedUids.push_back(strtoull(line.c_str(), nullptr, 10));
+		{
+			uint64_t uid;
+			if (GetBanlistLineUID(line, uid))
+				m_BannedUids.insert(uid);
+		}
 
 		fsBanlist.close();
 	}
-}
 
-void ServerBanSystem::ClearBanlist()
-{
-	m_vBannedUids.clear();
-
-	// reopen the file, don't provide std::ofstream::app so it clears on open
-	m_sBanlistStream.close();
-	m_sBanlistStream.open(g_svProfileDir + "/banlist.txt", std::ofstream::out | std::ofstream::binary);
-	m_sBanlistStream.close();
+	// Apply changes that haven't made it into the file yet
+	for (const JournalEntry_t& entry : m_vJournal)
+	{
+		if (entry.bBanned)
+			m_BannedUids.insert(entry.uid);
+		else
+			m_BannedUids.erase(entry.uid);
+	}
 }
 
-void ServerBanSystem::BanUID(uint64_t uid)
+//-----------------------------------------------------------------------------
+// Purpose: Records a ban or unban and folds it into banlist.txt straight away,
+//          m_Mutex must be held
+// Note   : The journal only outlives this call if rewriting banlist.txt
+//          failed, OpenBanlist applies whatever is left of it on startup
+// Input  : &entry -
+//-----------------------------------------------------------------------------
+void ServerBanSystem::AppendToJournal(const JournalEntry_t& entry)
 {
-	// checking if last char is \n to make sure uids arent getting fucked
-	std::ifstream fsBanlist(g_svProfileDir + "/banlist.txt");
-	std::string content((std::istreambuf_iterator<char>(fsBanlist)), (std::istreambuf_iterator<char>()));
-	fsBanlist.close();
+	m_vJournal.push_back(entry);
 
-	m_sBanlistStream.open(g_svProfileDir + "/banlist.txt", std::ofstream::out | std::ofstream::binary | std::ofstream::app);
-	if (content.back() != '\n')
-		m_sBanlistStream << std::endl;
+	// Format is one change per line: [+-]uid time
+	std::ofstream fsJournal(g_svProfileDir + BANLIST_JOURNAL_PATH_SUFFIX, std::ofstream::out | std::ofstream::binary | std::ofstream::app);
+	fsJournal << (entry.bBanned ? '+' : '-') << entry.uid << ' ' << static_cast<int64_t>(entry.tTime) << '\n';
+	fsJournal.close();
 
-	m_vBannedUids.push_back(uid);
-	m_sBanlistStream << std::to_string(uid) << std::endl;
-	m_sBanlistStream.close();
-	DevMsg(eLog::NS, "%li was banned\n", uid);
+	// Bans are rare, keeping banlist.txt current means edits to it by hand never race a pending journal
+	CompactJournal();
 }
 
-void ServerBanSystem::UnbanUID(uint64_t uid)
+//-----------------------------------------------------------------------------
+// Purpose: Folds the journal into banlist.txt and clears it, m_Mutex must be
+//          held. Unbanned uids get commented out, new bans get appended
+//-----------------------------------------------------------------------------
+void ServerBanSystem::CompactJournal()
 {
-	auto findResult = std::find(m_vBannedUids.begin(), m_vBannedUids.end(), uid);
-	if (findResult == m_vBannedUids.end())
+	if (m_vJournal.empty())
 		return;
 
-	m_vBannedUids.erase(findResult);
+	// Only the last change for each uid matters
+	std::unordered_map<uint64_t, const JournalEntry_t*> mapLastChange;
+	for (const JournalEntry_t& entry : m_vJournal)
+		mapLastChange[entry.uid] = &entry;
 
 	std::vector<std::string> banlistText;
-	std::ifstream fs_readBanlist(g_svProfileDir + "/banlist.txt");
+	std::unordered_set<uint64_t> fileUids;
 
+	std::ifstream fs_readBanlist(g_svProfileDir + BANLIST_PATH_SUFFIX);
 	if (!fs_readBanlist.fail())
 	{
 		std::string line;
 		while (std::getline(fs_readBanlist, line))
 		{
 			// support for comments and newlines added in https://github.com/R2Northstar/NorthstarLauncher/pull/227
-
-			std::string modLine = line; // copy the line into a free var that we can fuck with, line will be the original
-
-			// remove tabs which shouldnt be there but maybe someone did the funny
-			modLine.erase(std::remove(modLine.begin(), modLine.end(), '\t'), modLine.end());
-			// remove spaces to allow for spaces before uids
-			modLine.erase(std::remove(modLine.begin(), modLine.end(), ' '), modLine.end());
-
-			// ignore line if first char is # or empty line, just add it
-			if (line.front() == BANLIST_COMMENT_CHAR || modLine == "")
+			uint64_t lineUid;
+			if (!GetBanlistLineUID(line, lineUid))
 			{
 				banlistText.push_back(line);
 				continue;
 			}
 
-			// for inline comments like: 123123123 #banned for unfunny
-			std::string lineUid = line.substr(0, line.find(BANLIST_COMMENT_CHAR));
-			// have to erase spaces or else inline comments will fuck up the uid finding
-			lineUid.erase(std::remove(lineUid.begin(), lineUid.end(), '\t'), lineUid.end());
-			lineUid.erase(std::remove(lineUid.begin(), lineUid.end(), ' '), lineUid.end());
+			auto it = mapLastChange.find(lineUid);
 
-			// if the uid in the line is the uid we wanna unban
-			if (std::to_string(uid) == lineUid)
+			// if the uid in the line is a uid we wanna unban
+			if (it != mapLastChange.end() && !it->second->bBanned)
 			{
 				// comment the uid out
 				line.insert(0, "# ");
 
 				// add a comment with unban date
 				// not necessary but i feel like this makes it better
-				std::time_t t = std::time(0);
-				std::tm* now = std::localtime(&t);
+				std::tm* now = std::localtime(&it->second->tTime);
 
 				std::ostringstream unbanComment;
 
@@ -148,6 +173,10 @@ void ServerBanSystem::UnbanUID(uint64_t uid)
 
 				line.append(unbanComment.str());
 			}
+			else
+			{
+				fileUids.insert(lineUid);
+			}
 
 			banlistText.push_back(line);
 		}
@@ -155,22 +184,146 @@ void ServerBanSystem::UnbanUID(uint64_t uid)
 		fs_readBanlist.close();
 	}
 
-	// open write stream for banlist // without append so we clear the file
-	if (m_sBanlistStream.is_open())
-		m_sBanlistStream.close();
-	m_sBanlistStream.open(g_svProfileDir + "/banlist.txt", std::ofstream::out | std::ofstream::binary);
+	// Bans that aren't in the file yet, in the order they happened
+	for (const JournalEntry_t& entry : m_vJournal)
+	{
+		if (mapLastChange[entry.uid] == &entry && entry.bBanned && fileUids.find(entry.uid) == fileUids.end())
+			banlistText.push_back(std::to_string(entry.uid));
+	}
+
+	// Write to a temporary file first so a crash can't leave us with half a banlist
+	std::string svBanlistPath = g_svProfileDir + BANLIST_PATH_SUFFIX;
+	std::string svTempPath = svBanlistPath + ".tmp";
 
-	for (std::string updatedLine : banlistText)
+	m_sBanlistStream.open(svTempPath, std::ofstream::out | std::ofstream::binary);
+	for (const std::string& updatedLine : banlistText)
 		m_sBanlistStream << updatedLine << std::endl;
+	m_sBanlistStream.close();
+
+	std::error_code ec;
+	std::filesystem::rename(svTempPath, svBanlistPath, ec);
+	if (ec)
+	{
+		// Keep the journal, we'll try again next time
+		Warning(eLog::NS, "Failed to compact banlist: %s\n", ec.message().c_str());
+		return;
+	}
+
+	std::filesystem::remove(g_svProfileDir + BANLIST_JOURNAL_PATH_SUFFIX, ec);
+	m_vJournal.clear();
+
+	// Pick up any edits the file had before we rewrote it
+	ParseBanlist();
+}
 
+//-----------------------------------------------------------------------------
+// Purpose: Loads the banlist and folds in any journal left over from last time
+//-----------------------------------------------------------------------------
+void ServerBanSystem::OpenBanlist()
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	m_vJournal.clear();
+
+	std::ifstream fsJournal(g_svProfileDir + BANLIST_JOURNAL_PATH_SUFFIX);
+	if (!fsJournal.fail())
+	{
+		std::string line;
+		while (std::getline(fsJournal, line))
+		{
+			if (line.size() < 2 || (line.front() != '+' && line.front() != '-'))
+				continue;
+
+			char* pszEnd = nullptr;
+
+			JournalEntry_t entry;
+			entry.bBanned = line.front() == '+';
+			entry.uid = strtoull(line.c_str() + 1, &pszEnd, 10);
+			entry.tTime = static_cast<std::time_t>(strtoll(pszEnd, nullptr, 10));
+
+			m_vJournal.push_back(entry);
+		}
+
+		fsJournal.close();
+	}
+
+	ParseBanlist();
+	CompactJournal();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forces a reload of banlist.txt
+//-----------------------------------------------------------------------------
+void ServerBanSystem::ReloadBanlist()
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+	ParseBanlist();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Unbans everyone
+//-----------------------------------------------------------------------------
+void ServerBanSystem::ClearBanlist()
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	m_BannedUids.clear();
+	m_vJournal.clear();
+
+	std::error_code ec;
+	std::filesystem::remove(g_svProfileDir + BANLIST_JOURNAL_PATH_SUFFIX, ec);
+
+	// reopen the file, don't provide std::ofstream::app so it clears on open
+	m_sBanlistStream.close();
+	m_sBanlistStream.open(g_svProfileDir + BANLIST_PATH_SUFFIX, std::ofstream::out | std::ofstream::binary);
 	m_sBanlistStream.close();
+
+	ParseBanlist();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bans a uid and writes it to banlist.txt
+// Input  : uid -
+//-----------------------------------------------------------------------------
+void ServerBanSystem::BanUID(uint64_t uid)
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	if (!m_BannedUids.insert(uid).second)
+		return;
+
+	AppendToJournal({true, uid, std::time(0)});
+	DevMsg(eLog::NS, "%li was banned\n", uid);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Unbans a uid and comments it out in banlist.txt
+// Input  : uid -
+//-----------------------------------------------------------------------------
+void ServerBanSystem::UnbanUID(uint64_t uid)
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	if (m_BannedUids.erase(uid) == 0)
+		return;
+
+	AppendToJournal({false, uid, std::time(0)});
 	DevMsg(eLog::NS, "%li was unbanned\n", uid);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Checks if a uid is allowed to join, only rereads banlist.txt if it
+//          was changed since the last time we read it
+// Input  : uid -
+//-----------------------------------------------------------------------------
 bool ServerBanSystem::IsUIDAllowed(uint64_t uid)
 {
-	ReloadBanlist(); // Reload to have up to date list on join
-	return std::find(m_vBannedUids.begin(), m_vBannedUids.end(), uid) == m_vBannedUids.end();
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	if (HasBanlistChanged())
+		ParseBanlist();
+
+	return m_BannedUids.find(uid) == m_BannedUids.end();
 }
 
 ON_DLL_LOAD("engine.dll", BanSystem, (CModule module))
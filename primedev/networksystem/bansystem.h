@@ -1,11 +1,40 @@
 #pragma once
 #include <fstream>
+#include <filesystem>
 
 class ServerBanSystem
 {
   private:
+	struct JournalEntry_t
+	{
+		bool bBanned;
+		uint64_t uid;
+		std::time_t tTime;
+	};
+
+	// Size and write time of a file the last time we read it
+	struct FileState_t
+	{
+		bool bExists = false;
+		uintmax_t nSize = 0;
+		std::filesystem::file_time_type tWriteTime;
+	};
+
+	std::mutex m_Mutex;
+
 	std::ofstream m_sBanlistStream;
-	std::vector<uint64_t> m_vBannedUids;
+	std::unordered_set<uint64_t> m_BannedUids;
+
+	// Bans and unbans that couldn't be folded into banlist.txt yet
+	std::vector<JournalEntry_t> m_vJournal;
+
+	FileState_t m_BanlistState;
+
+	static FileState_t GetBanlistFileState();
+	bool HasBanlistChanged();
+	void ParseBanlist();
+	void AppendToJournal(const JournalEntry_t& entry);
+	void CompactJournal();
 
   public:
 	void OpenBanlist();
@@ -1,79 +1,264 @@
 #include "bcrypt.h"
 
-#include <bcrypt.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
 
-BCRYPT_ALG_HANDLE HMACSHA256;
+static constexpr uint32_t SHA256_K[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA, 0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+static inline uint32_t RotR(uint32_t nValue, int nBits)
+{
+	return (nValue >> nBits) | (nValue << (32 - nBits));
+}
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Constructor
 //-----------------------------------------------------------------------------
-bool InitHMACSHA256()
+CSHA256::CSHA256()
+	: m_nState {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19}, m_Buffer {}, m_nLength(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes more data
+// Input  : *pData -
+//          nSize -
+//-----------------------------------------------------------------------------
+void CSHA256::Update(const void* pData, size_t nSize)
 {
-	NTSTATUS status;
-	DWORD hashLength = 0;
-	ULONG hashLengthSz = 0;
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	size_t nBuffered = m_nLength % BLOCK_SIZE;
+	m_nLength += nSize;
 
-	if ((status = BCryptOpenAlgorithmProvider(&HMACSHA256, BCRYPT_SHA256_ALGORITHM, NULL, BCRYPT_ALG_HANDLE_HMAC_FLAG)))
+	// Top up a partial block first
+	if (nBuffered)
 	{
-		Error(eLog::NS, NO_ERROR, "failed to initialize HMAC-SHA256: BCryptOpenAlgorithmProvider: error 0x%x\n", (ULONG)status);
-		return false;
+		size_t nCopy = std::min(BLOCK_SIZE - nBuffered, nSize);
+		memcpy(m_Buffer + nBuffered, pBytes, nCopy);
+		pBytes += nCopy;
+		nSize -= nCopy;
+
+		if (nBuffered + nCopy < BLOCK_SIZE)
+			return;
+
+		Transform(m_Buffer);
+	}
+
+	// Whole blocks straight from the input
+	for (; nSize >= BLOCK_SIZE; pBytes += BLOCK_SIZE, nSize -= BLOCK_SIZE)
+		Transform(pBytes);
+
+	memcpy(m_Buffer, pBytes, nSize);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pads the message and writes the digest, the context is spent after
+// Input  : &hash -
+//-----------------------------------------------------------------------------
+void CSHA256::Final(uint8_t (&hash)[HMACSHA256_LEN])
+{
+	uint64_t nBits = m_nLength * 8;
+
+	// 0x80, zeroes until 8 bytes short of a block, then the length in bits
+	static constexpr uint8_t PADDING[BLOCK_SIZE] = {0x80};
+	size_t nBuffered = m_nLength % BLOCK_SIZE;
+	Update(PADDING, nBuffered < BLOCK_SIZE - 8 ? BLOCK_SIZE - 8 - nBuffered : 2 * BLOCK_SIZE - 8 - nBuffered);
+
+	uint8_t nLength[8];
+	for (int i = 0; i < 8; i++)
+		nLength[i] = static_cast<uint8_t>(nBits >> (56 - i * 8));
+
+	Update(nLength, sizeof(nLength));
+
+	for (int i = 0; i < 8; i++)
+	{
+		hash[i * 4 + 0] = static_cast<uint8_t>(m_nState[i] >> 24);
+		hash[i * 4 + 1] = static_cast<uint8_t>(m_nState[i] >> 16);
+		hash[i * 4 + 2] = static_cast<uint8_t>(m_nState[i] >> 8);
+		hash[i * 4 + 3] = static_cast<uint8_t>(m_nState[i]);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compresses one block into the state
+// Input  : *pBlock - BLOCK_SIZE bytes
+//-----------------------------------------------------------------------------
+void CSHA256::Transform(const uint8_t* pBlock)
+{
+	uint32_t w[64];
+	for (int i = 0; i < 16; i++)
+		w[i] = (uint32_t(pBlock[i * 4]) << 24) | (uint32_t(pBlock[i * 4 + 1]) << 16) | (uint32_t(pBlock[i * 4 + 2]) << 8) | uint32_t(pBlock[i * 4 + 3]);
 
-	if ((status = BCryptGetProperty(HMACSHA256, BCRYPT_HASH_LENGTH, (PUCHAR)&hashLength, sizeof(hashLength), &hashLengthSz, 0)))
+	for (int i = 16; i < 64; i++)
 	{
-		Error(eLog::NS, NO_ERROR, "failed to initialize HMAC-SHA256: BCryptGetProperty(BCRYPT_HASH_LENGTH): error 0x%x\n", (ULONG)status);
-		return false;
+		uint32_t s0 = RotR(w[i - 15], 7) ^ RotR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = RotR(w[i - 2], 17) ^ RotR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
 	}
 
-	if (hashLength != HMACSHA256_LEN)
+	uint32_t a = m_nState[0], b = m_nState[1], c = m_nState[2], d = m_nState[3];
+	uint32_t e = m_nState[4], f = m_nState[5], g = m_nState[6], h = m_nState[7];
+
+	for (int i = 0; i < 64; i++)
 	{
-		Error(eLog::NS, NO_ERROR, "failed to initialize HMAC-SHA256: BCryptGetProperty(BCRYPT_HASH_LENGTH): unexpected value %i\n", hashLength);
-		return false;
+		uint32_t t1 = h + (RotR(e, 6) ^ RotR(e, 11) ^ RotR(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+		uint32_t t2 = (RotR(a, 2) ^ RotR(a, 13) ^ RotR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
 	}
 
-	return true;
+	m_nState[0] += a;
+	m_nState[1] += b;
+	m_nState[2] += c;
+	m_nState[3] += d;
+	m_nState[4] += e;
+	m_nState[5] += f;
+	m_nState[6] += g;
+	m_nState[7] += h;
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: compare the HMAC-SHA256(data, key) against sig
-//          (note: all strings are treated as raw binary data)
+// Purpose: Hashes the padded key into the inner and outer states
+// Input  : svKey - Raw binary
 //-----------------------------------------------------------------------------
-bool VerifyHMACSHA256(std::string key, std::string sig, std::string data)
+void CHMACSHA256::SetKey(std::string_view svKey)
 {
-	uint8_t invalid = 1;
-	char hash[HMACSHA256_LEN];
-
-	NTSTATUS status;
-	BCRYPT_HASH_HANDLE h = NULL;
+	uint8_t key[CSHA256::BLOCK_SIZE] = {};
 
-	if ((status = BCryptCreateHash(HMACSHA256, &h, NULL, 0, (PUCHAR)key.c_str(), (ULONG)key.length(), 0)))
+	// Keys longer than a block get hashed down first
+	if (svKey.size() > CSHA256::BLOCK_SIZE)
 	{
-		Error(eLog::NS, NO_ERROR, "failed to verify HMAC-SHA256: BCryptCreateHash: error 0x%x\n", (ULONG)status);
-		goto cleanup;
+		uint8_t hash[HMACSHA256_LEN];
+		CSHA256 sha;
+		sha.Update(svKey.data(), svKey.size());
+		sha.Final(hash);
+		memcpy(key, hash, sizeof(hash));
 	}
-
-	if ((status = BCryptHashData(h, (PUCHAR)data.c_str(), (ULONG)data.length(), 0)))
+	else
 	{
-		Error(eLog::NS, NO_ERROR, "failed to verify HMAC-SHA256: BCryptHashData: error 0x%x\n", (ULONG)status);
-		goto cleanup;
+		memcpy(key, svKey.data(), svKey.size());
 	}
 
-	if ((status = BCryptFinishHash(h, (PUCHAR)&hash, (ULONG)sizeof(hash), 0)))
+	uint8_t pad[CSHA256::BLOCK_SIZE];
+
+	for (size_t i = 0; i < sizeof(pad); i++)
+		pad[i] = key[i] ^ 0x36;
+	m_Inner = CSHA256();
+	m_Inner.Update(pad, sizeof(pad));
+
+	for (size_t i = 0; i < sizeof(pad); i++)
+		pad[i] = key[i] ^ 0x5C;
+	m_Outer = CSHA256();
+	m_Outer.Update(pad, sizeof(pad));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Computes HMAC-SHA256(key, data)
+// Input  : svData - Raw binary
+//          &hash -
+//-----------------------------------------------------------------------------
+void CHMACSHA256::Compute(std::string_view svData, uint8_t (&hash)[HMACSHA256_LEN]) const
+{
+	uint8_t inner[HMACSHA256_LEN];
+
+	CSHA256 sha = m_Inner;
+	sha.Update(svData.data(), svData.size());
+	sha.Final(inner);
+
+	sha = m_Outer;
+	sha.Update(inner, sizeof(inner));
+	sha.Final(hash);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compares HMAC-SHA256(key, data) against sig
+// Input  : svSig - Raw binary
+//          svData - Raw binary
+//-----------------------------------------------------------------------------
+bool CHMACSHA256::Verify(std::string_view svSig, std::string_view svData) const
+{
+	if (svSig.size() != HMACSHA256_LEN)
+		return false;
+
+	uint8_t hash[HMACSHA256_LEN];
+	Compute(svData, hash);
+
+	return ConstantTimeCompare(svSig.data(), hash, sizeof(hash));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compares two buffers without returning early, so the time it takes
+//          doesn't tell an attacker how many leading bytes they got right
+// Input  : *pA -
+//          *pB -
+//          nSize -
+//-----------------------------------------------------------------------------
+bool ConstantTimeCompare(const void* pA, const void* pB, size_t nSize)
+{
+	const volatile uint8_t* pBytesA = static_cast<const volatile uint8_t*>(pA);
+	const volatile uint8_t* pBytesB = static_cast<const volatile uint8_t*>(pB);
+
+	uint8_t nDiff = 0;
+	for (size_t i = 0; i < nSize; i++)
+		nDiff |= pBytesA[i] ^ pBytesB[i];
+
+	return nDiff == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks the implementation against the RFC 4231 test vectors
+// Note   : Doesn't log so the standalone tests can build this file, the
+//          caller reports failure
+//-----------------------------------------------------------------------------
+bool InitHMACSHA256()
+{
+	struct TestVector_t
 	{
-		Error(eLog::NS, NO_ERROR, "failed to verify HMAC-SHA256: BCryptFinishHash: error 0x%x\n", (ULONG)status);
-		goto cleanup;
-	}
+		std::string svKey;
+		std::string svData;
+		const char* pszHash;
+	};
 
-	// constant-time compare
-	if (sig.length() == sizeof(hash))
+	const TestVector_t vTests[] = {
+		{std::string(20, '\x0b'), "Hi There", "\xb0\x34\x4c\x61\xd8\xdb\x38\x53\x5c\xa8\xaf\xce\xaf\x0b\xf1\x2b\x88\x1d\xc2\x00\xc9\x83\x3d\xa7\x26\xe9\x37\x6c\x2e\x32\xcf\xf7"},
+		{"Jefe", "what do ya want for nothing?", "\x5b\xdc\xc1\x46\xbf\x60\x75\x4e\x6a\x04\x24\x26\x08\x95\x75\xc7\x5a\x00\x3f\x08\x9d\x27\x39\x83\x9d\xec\x58\xb9\x64\xec\x38\x43"},
+		{std::string(20, '\xaa'), std::string(50, '\xdd'), "\x77\x3e\xa9\x1e\x36\x80\x0e\x46\x85\x4d\xb8\xeb\xd0\x91\x81\xa7\x29\x59\x09\x8b\x3e\xf8\xc1\x22\xd9\x63\x55\x14\xce\xd5\x65\xfe"},
+		{std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First",
+		 "\x60\xe4\x31\x59\x1e\xe0\xb6\x7f\x0d\x8a\x26\xaa\xcb\xf5\xb7\x7f\x8e\x0b\xc6\x21\x37\x28\xc5\x14\x05\x46\x04\x0f\x0e\xe3\x7f\x54"},
+		{std::string(131, '\xaa'), "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm.",
+		 "\x9b\x09\xff\xa7\x1b\x94\x2f\xcb\x27\x63\x5f\xbc\xd5\xb0\xe9\x44\xbf\xdc\x63\x64\x4f\x07\x13\x93\x8a\x7f\x51\x53\x5c\x3a\x35\xe2"},
+	};
+
+	for (const TestVector_t& test : vTests)
 	{
-		invalid = 0;
-		for (size_t i = 0; i < sizeof(hash); i++)
-			invalid |= (uint8_t)(sig[i]) ^ (uint8_t)(hash[i]);
+		if (!VerifyHMACSHA256(test.svKey, std::string_view(test.pszHash, HMACSHA256_LEN), test.svData))
+			return false;
 	}
 
-cleanup:
-	if (h)
-		BCryptDestroyHash(h);
-	return !invalid;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: compare the HMAC-SHA256(data, key) against sig
+//          (note: all strings are treated as raw binary data)
+// Note   : Hashes the key every call, keep a CHMACSHA256 around when the
+//          same key verifies many messages
+//-----------------------------------------------------------------------------
+bool VerifyHMACSHA256(std::string_view svKey, std::string_view svSig, std::string_view svData)
+{
+	CHMACSHA256 hmac;
+	hmac.SetKey(svKey);
+
+	return hmac.Verify(svSig, svData);
 }
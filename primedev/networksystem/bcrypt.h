@@ -1,6 +1,52 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
 constexpr size_t HMACSHA256_LEN = 256 / 8;
 
+//-----------------------------------------------------------------------------
+// Purpose: Incremental SHA-256
+//-----------------------------------------------------------------------------
+class CSHA256
+{
+  public:
+	static constexpr size_t BLOCK_SIZE = 64;
+
+	CSHA256();
+
+	void Update(const void* pData, size_t nSize);
+	void Final(uint8_t (&hash)[HMACSHA256_LEN]);
+
+  private:
+	void Transform(const uint8_t* pBlock);
+
+	uint32_t m_nState[8];
+	uint8_t m_Buffer[BLOCK_SIZE];
+	uint64_t m_nLength;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Keyed HMAC-SHA256 context
+// Note   : The padded key is hashed once in SetKey, every Compute after that
+//          starts from the saved inner and outer states so verifying a
+//          message costs two SHA-256 passes over it and nothing else
+//-----------------------------------------------------------------------------
+class CHMACSHA256
+{
+  public:
+	void SetKey(std::string_view svKey);
+
+	void Compute(std::string_view svData, uint8_t (&hash)[HMACSHA256_LEN]) const;
+	bool Verify(std::string_view svSig, std::string_view svData) const;
+
+  private:
+	CSHA256 m_Inner;
+	CSHA256 m_Outer;
+};
+
+bool ConstantTimeCompare(const void* pA, const void* pB, size_t nSize);
+
 bool InitHMACSHA256();
-bool VerifyHMACSHA256(std::string key, std::string sig, std::string data);
+bool VerifyHMACSHA256(std::string_view svKey, std::string_view svSig, std::string_view svData);
@@ -0,0 +1,172 @@
+#include "networksystem/heartbeat.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Marks the fields that differ from the last values as dirty
+// Input  : &values -
+//-----------------------------------------------------------------------------
+void CHeartBeatState::Update(const HeartBeatValues_t& values)
+{
+	uint32_t nChanged = 0;
+
+	auto Compare = [&nChanged](const auto& current, const auto& value, uint32_t nField)
+	{
+		if (current != value)
+			nChanged |= nField;
+	};
+
+	Compare(m_Values.svName, values.svName, HEARTBEAT_NAME);
+	Compare(m_Values.svDescription, values.svDescription, HEARTBEAT_DESCRIPTION);
+	Compare(m_Values.svMap, values.svMap, HEARTBEAT_MAP);
+	Compare(m_Values.svPlaylist, values.svPlaylist, HEARTBEAT_PLAYLIST);
+	Compare(m_Values.nPlayerCount, values.nPlayerCount, HEARTBEAT_PLAYER_COUNT);
+	Compare(m_Values.svMaxPlayers, values.svMaxPlayers, HEARTBEAT_MAX_PLAYERS);
+	Compare(m_Values.svPassword, values.svPassword, HEARTBEAT_PASSWORD);
+	Compare(m_Values.nPort, values.nPort, HEARTBEAT_PORT);
+	Compare(m_Values.nModGeneration, values.nModGeneration, HEARTBEAT_MODS);
+
+	if (!nChanged)
+		return;
+
+	m_Values = values;
+	m_nDirty |= nChanged;
+
+	if (nChanged & ~HEARTBEAT_MODS)
+		m_bFullUrlStale = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the next heartbeat and clears the fields it carries
+// Input  : svAtlas - atlas_hostname
+//          svID - Our server id
+//          bDelta - Atlas has HEARTBEAT_DELTA_CAPABILITY
+//          &request -
+//-----------------------------------------------------------------------------
+void CHeartBeatState::Build(std::string_view svAtlas, std::string_view svID, bool bDelta, HeartBeatRequest_t& request)
+{
+	m_nDirty |= m_nFailed.exchange(0);
+
+	// A different atlas or a new registration knows nothing about us
+	if (svAtlas != m_svAtlas || svID != m_svID)
+	{
+		m_svAtlas = svAtlas;
+		m_svID = svID;
+		m_nDirty = HEARTBEAT_ALL;
+		m_bFullUrlStale = true;
+	}
+
+	if (!bDelta)
+	{
+		if (m_bFullUrlStale)
+		{
+			m_svFullUrl = m_svAtlas;
+			m_svFullUrl += "/server/update_values?id=";
+			AppendEscaped(m_svFullUrl, m_svID);
+
+			for (uint32_t nField = 1; nField < HEARTBEAT_MODS; nField <<= 1)
+				AppendField(m_svFullUrl, nField);
+
+			m_bFullUrlStale = false;
+		}
+
+		request.svUrl = m_svFullUrl;
+		request.nFields = HEARTBEAT_ALL;
+		request.bModInfo = true;
+
+		m_nDirty = 0;
+		return;
+	}
+
+	request.nFields = m_nDirty;
+	request.bModInfo = m_nDirty & HEARTBEAT_MODS;
+	m_nDirty = 0;
+
+	request.svUrl = m_svAtlas;
+	request.svUrl += request.nFields ? "/server/update_values?id=" : "/server/keepalive?id=";
+	AppendEscaped(request.svUrl, m_svID);
+
+	for (uint32_t nField = 1; nField < HEARTBEAT_MODS; nField <<= 1)
+	{
+		if (request.nFields & nField)
+			AppendField(request.svUrl, nField);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Marks the fields of a heartbeat that didn't reach atlas dirty again
+// Note   : Called from the http client thread
+// Input  : nFields -
+//-----------------------------------------------------------------------------
+void CHeartBeatState::Failed(uint32_t nFields)
+{
+	m_nFailed.fetch_or(nFields);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Percent encodes everything but unreserved characters, the same
+//          as curl_easy_escape without allocating
+// Input  : &svOut -
+//          svValue -
+//-----------------------------------------------------------------------------
+void CHeartBeatState::AppendEscaped(std::string& svOut, std::string_view svValue)
+{
+	static const char s_szHex[] = "0123456789ABCDEF";
+
+	for (char c : svValue)
+	{
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~')
+		{
+			svOut.push_back(c);
+			continue;
+		}
+
+		uint8_t nByte = static_cast<uint8_t>(c);
+		svOut.push_back('%');
+		svOut.push_back(s_szHex[nByte >> 4]);
+		svOut.push_back(s_szHex[nByte & 0xF]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends one field as a query parameter
+// Input  : &svUrl -
+//          nField - A single eHeartBeatField
+//-----------------------------------------------------------------------------
+void CHeartBeatState::AppendField(std::string& svUrl, uint32_t nField) const
+{
+	switch (nField)
+	{
+	case HEARTBEAT_NAME:
+		svUrl += "&name=";
+		AppendEscaped(svUrl, m_Values.svName);
+		break;
+	case HEARTBEAT_DESCRIPTION:
+		svUrl += "&description=";
+		AppendEscaped(svUrl, m_Values.svDescription);
+		break;
+	case HEARTBEAT_MAP:
+		svUrl += "&map=";
+		AppendEscaped(svUrl, m_Values.svMap);
+		break;
+	case HEARTBEAT_PLAYLIST:
+		svUrl += "&playlist=";
+		AppendEscaped(svUrl, m_Values.svPlaylist);
+		break;
+	case HEARTBEAT_PLAYER_COUNT:
+		svUrl += "&playerCount=";
+		svUrl += std::to_string(m_Values.nPlayerCount);
+		break;
+	case HEARTBEAT_MAX_PLAYERS:
+		svUrl += "&maxPlayers=";
+		AppendEscaped(svUrl, m_Values.svMaxPlayers);
+		break;
+	case HEARTBEAT_PASSWORD:
+		svUrl += "&password=";
+		AppendEscaped(svUrl, m_Values.svPassword);
+		break;
+	case HEARTBEAT_PORT:
+		svUrl += "&port=";
+		svUrl += std::to_string(m_Values.nPort);
+		svUrl += "&authPort=udp";
+		break;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Capability atlas lists in its add_server response when update_values takes
+// only the fields that changed and /server/keepalive exists
+constexpr const char* HEARTBEAT_DELTA_CAPABILITY = "heartbeat_delta";
+
+//-----------------------------------------------------------------------------
+// Fields of an update_values request
+enum eHeartBeatField : uint32_t
+{
+	HEARTBEAT_NAME = 1 << 0,
+	HEARTBEAT_DESCRIPTION = 1 << 1,
+	HEARTBEAT_MAP = 1 << 2,
+	HEARTBEAT_PLAYLIST = 1 << 3,
+	HEARTBEAT_PLAYER_COUNT = 1 << 4,
+	HEARTBEAT_MAX_PLAYERS = 1 << 5,
+	HEARTBEAT_PASSWORD = 1 << 6,
+	HEARTBEAT_PORT = 1 << 7,
+	HEARTBEAT_MODS = 1 << 8, // The modinfo form, not part of the url
+
+	HEARTBEAT_ALL = (1 << 9) - 1
+};
+
+//-----------------------------------------------------------------------------
+// Everything a heartbeat reports
+struct HeartBeatValues_t
+{
+	std::string svName;
+	std::string svDescription;
+	std::string svMap;
+	std::string svPlaylist;
+	std::string svMaxPlayers;
+	std::string svPassword;
+	int nPort = 0;
+	int nPlayerCount = -1;
+	// Changes whenever the mod list does
+	uint32_t nModGeneration = 0;
+};
+
+//-----------------------------------------------------------------------------
+// What CHeartBeatState::Build wants sent
+struct HeartBeatRequest_t
+{
+	std::string svUrl;
+	// Fields this request carries, hand them to Failed if it didn't go through
+	uint32_t nFields = 0;
+	// Attach the modinfo form
+	bool bModInfo = false;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Tracks which heartbeat fields atlas hasn't seen yet
+// Note   : Atlas with HEARTBEAT_DELTA_CAPABILITY only gets the fields that
+//          changed since the last heartbeat, or a keepalive with just our id
+//          if none did. Older atlas gets every field each time, that url is
+//          only rebuilt when a field changes
+//-----------------------------------------------------------------------------
+class CHeartBeatState
+{
+  public:
+	void Update(const HeartBeatValues_t& values);
+	void Build(std::string_view svAtlas, std::string_view svID, bool bDelta, HeartBeatRequest_t& request);
+	void Failed(uint32_t nFields);
+
+	static void AppendEscaped(std::string& svOut, std::string_view svValue);
+
+  private:
+	void AppendField(std::string& svUrl, uint32_t nField) const;
+
+	HeartBeatValues_t m_Values;
+
+	// Atlas and server id the fields were reported to
+	std::string m_svAtlas;
+	std::string m_svID;
+
+	uint32_t m_nDirty = HEARTBEAT_ALL;
+	// Set by Failed from the http client thread, merged into m_nDirty by Build
+	std::atomic<uint32_t> m_nFailed = 0;
+
+	std::string m_svFullUrl;
+	bool m_bFullUrlStale = true;
+};
@@ -0,0 +1,267 @@
+#include "networksystem/persistencedelta.h"
+
+#include <algorithm>
+#include <cstring>
+
+// 'PDD1' and 'PDB1', little endian
+constexpr uint32_t PERSISTENCE_DELTA_MAGIC = 0x31444450;
+constexpr uint32_t PERSISTENCE_BATCH_MAGIC = 0x31424450;
+
+// magic, target size, base hash, target hash
+constexpr size_t PERSISTENCE_DELTA_HEADER_SIZE = 4 + 4 + 8 + 8;
+
+// Unchanged runs shorter than this are cheaper to send as part of the
+// surrounding literal than to end it, a new run costs at least 2 bytes
+constexpr size_t PERSISTENCE_DELTA_MIN_RUN = 4;
+
+//-----------------------------------------------------------------------------
+// Purpose: Little endian helpers, the format is the same on every platform
+//-----------------------------------------------------------------------------
+static void WriteU32(std::string& svOut, uint32_t nValue)
+{
+	for (int i = 0; i < 4; i++)
+		svOut.push_back(static_cast<char>((nValue >> (i * 8)) & 0xFF));
+}
+
+static void WriteU64(std::string& svOut, uint64_t nValue)
+{
+	for (int i = 0; i < 8; i++)
+		svOut.push_back(static_cast<char>((nValue >> (i * 8)) & 0xFF));
+}
+
+static uint64_t ReadLE(const char* pData, int nBytes)
+{
+	uint64_t nValue = 0;
+	for (int i = 0; i < nBytes; i++)
+		nValue |= static_cast<uint64_t>(static_cast<uint8_t>(pData[i])) << (i * 8);
+
+	return nValue;
+}
+
+static void WriteVarInt(std::string& svOut, size_t nValue)
+{
+	while (nValue >= 0x80)
+	{
+		svOut.push_back(static_cast<char>((nValue & 0x7F) | 0x80));
+		nValue >>= 7;
+	}
+
+	svOut.push_back(static_cast<char>(nValue));
+}
+
+static bool ReadVarInt(std::string_view svIn, size_t& nPos, size_t& nValue)
+{
+	nValue = 0;
+	for (int nShift = 0; nShift < 35; nShift += 7)
+	{
+		if (nPos >= svIn.size())
+			return false;
+
+		uint8_t nByte = static_cast<uint8_t>(svIn[nPos++]);
+		nValue |= static_cast<size_t>(nByte & 0x7F) << nShift;
+
+		if (!(nByte & 0x80))
+			return true;
+	}
+
+	// Nothing in pdata needs more than 32 bits
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: FNV-1a, atlas checks the base of a delta with it so it has to be
+//          the same everywhere unlike std::hash
+// Input  : svData -
+//-----------------------------------------------------------------------------
+uint64_t PersistenceDelta_Hash(std::string_view svData)
+{
+	uint64_t nHash = 0xCBF29CE484222325ull;
+	for (char c : svData)
+	{
+		nHash ^= static_cast<uint8_t>(c);
+		nHash *= 0x100000001B3ull;
+	}
+
+	return nHash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Encodes svTarget as a delta against svBase
+// Note   : The delta is the XOR of both buffers, run length encoded as pairs
+//          of ( unchanged bytes, changed bytes ) followed by the changed
+//          bytes XORed with the base. Bytes past the end of the base XOR
+//          with 0 and whatever follows the last pair is unchanged. The
+//          header carries both hashes so a stale base or a bad decode is
+//          caught instead of corrupting pdata
+// Input  : svBase - pdata atlas acknowledged last
+//          svTarget - pdata to send
+//          &svDelta -
+//-----------------------------------------------------------------------------
+void PersistenceDelta_Encode(std::string_view svBase, std::string_view svTarget, std::string& svDelta)
+{
+	svDelta.clear();
+	WriteU32(svDelta, PERSISTENCE_DELTA_MAGIC);
+	WriteU32(svDelta, static_cast<uint32_t>(svTarget.size()));
+	WriteU64(svDelta, PersistenceDelta_Hash(svBase));
+	WriteU64(svDelta, PersistenceDelta_Hash(svTarget));
+
+	const size_t nSize = svTarget.size();
+	const size_t nShared = std::min(nSize, svBase.size());
+
+	auto XorAt = [&](size_t i) -> uint8_t { return static_cast<uint8_t>(svTarget[i] ^ (i < svBase.size() ? svBase[i] : 0)); };
+
+	size_t i = 0;
+	while (i < nSize)
+	{
+		// Unchanged run, most of pdata after a match so compare 8 bytes at a time
+		size_t nRunStart = i;
+		while (i + 8 <= nShared && !memcmp(svTarget.data() + i, svBase.data() + i, 8))
+			i += 8;
+		while (i < nSize && !XorAt(i))
+			i++;
+
+		if (i == nSize)
+			break;
+
+		// Changed run, swallowing unchanged gaps too short to be worth a pair
+		size_t nLiteralStart = i;
+		while (i < nSize)
+		{
+			if (XorAt(i))
+			{
+				i++;
+				continue;
+			}
+
+			size_t nGapEnd = i;
+			while (nGapEnd < nSize && !XorAt(nGapEnd) && nGapEnd - i < PERSISTENCE_DELTA_MIN_RUN)
+				nGapEnd++;
+
+			if (nGapEnd == nSize || nGapEnd - i >= PERSISTENCE_DELTA_MIN_RUN)
+				break;
+
+			i = nGapEnd;
+		}
+
+		WriteVarInt(svDelta, nLiteralStart - nRunStart);
+		WriteVarInt(svDelta, i - nLiteralStart);
+		for (size_t j = nLiteralStart; j < i; j++)
+			svDelta.push_back(static_cast<char>(XorAt(j)));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds pdata from a delta made by PersistenceDelta_Encode
+// Input  : svBase - has to be the buffer the delta was made against
+//          svDelta -
+//          &svTarget -
+// Output : false if the delta is malformed or svBase is the wrong base
+//-----------------------------------------------------------------------------
+bool PersistenceDelta_Decode(std::string_view svBase, std::string_view svDelta, std::string& svTarget)
+{
+	if (svDelta.size() < PERSISTENCE_DELTA_HEADER_SIZE || ReadLE(svDelta.data(), 4) != PERSISTENCE_DELTA_MAGIC)
+		return false;
+
+	const size_t nSize = static_cast<size_t>(ReadLE(svDelta.data() + 4, 4));
+	const uint64_t nBaseHash = ReadLE(svDelta.data() + 8, 8);
+	const uint64_t nTargetHash = ReadLE(svDelta.data() + 16, 8);
+
+	if (PersistenceDelta_Hash(svBase) != nBaseHash)
+		return false;
+
+	svTarget.assign(nSize, '\0');
+	memcpy(svTarget.data(), svBase.data(), std::min(nSize, svBase.size()));
+
+	size_t nPos = PERSISTENCE_DELTA_HEADER_SIZE;
+	size_t nOut = 0;
+	while (nPos < svDelta.size())
+	{
+		size_t nUnchanged;
+		size_t nChanged;
+		if (!ReadVarInt(svDelta, nPos, nUnchanged) || !ReadVarInt(svDelta, nPos, nChanged))
+			return false;
+
+		if (nUnchanged > nSize - nOut || nChanged > nSize - nOut - nUnchanged || nChanged > svDelta.size() - nPos)
+			return false;
+
+		nOut += nUnchanged;
+		for (size_t i = 0; i < nChanged; i++, nOut++)
+			svTarget[nOut] = static_cast<char>(svTarget[nOut] ^ svDelta[nPos++]);
+	}
+
+	return PersistenceDelta_Hash(svTarget) == nTargetHash;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a write_persistence_batch body
+// Input  : &svBatch -
+//-----------------------------------------------------------------------------
+void PersistenceBatch_Begin(std::string& svBatch)
+{
+	svBatch.clear();
+	WriteU32(svBatch, PERSISTENCE_BATCH_MAGIC);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Appends a player to a write_persistence_batch body
+// Input  : &svBatch -
+//          svUID -
+//          eEncoding -
+//          svPayload - pdata or a delta depending on eEncoding
+//-----------------------------------------------------------------------------
+bool PersistenceBatch_Add(std::string& svBatch, std::string_view svUID, ePersistenceEncoding eEncoding, std::string_view svPayload)
+{
+	if (svUID.empty() || svUID.size() > UINT8_MAX || svPayload.size() > UINT32_MAX)
+		return false;
+
+	svBatch.push_back(static_cast<char>(svUID.size()));
+	svBatch.append(svUID);
+	svBatch.push_back(static_cast<char>(eEncoding));
+	WriteU32(svBatch, static_cast<uint32_t>(svPayload.size()));
+	svBatch.append(svPayload);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Splits a write_persistence_batch body into its players
+// Input  : svBatch - has to outlive vEntries
+//          &vEntries -
+//-----------------------------------------------------------------------------
+bool PersistenceBatch_Parse(std::string_view svBatch, std::vector<PersistenceBatchEntry_t>& vEntries)
+{
+	vEntries.clear();
+
+	if (svBatch.size() < 4 || ReadLE(svBatch.data(), 4) != PERSISTENCE_BATCH_MAGIC)
+		return false;
+
+	size_t nPos = 4;
+	while (nPos < svBatch.size())
+	{
+		size_t nUIDSize = static_cast<uint8_t>(svBatch[nPos++]);
+		if (!nUIDSize || svBatch.size() - nPos < nUIDSize + 1 + 4)
+			return false;
+
+		PersistenceBatchEntry_t entry;
+		entry.svUID = svBatch.substr(nPos, nUIDSize);
+		nPos += nUIDSize;
+
+		uint8_t nEncoding = static_cast<uint8_t>(svBatch[nPos++]);
+		if (nEncoding > static_cast<uint8_t>(ePersistenceEncoding::DELTA))
+			return false;
+
+		entry.eEncoding = static_cast<ePersistenceEncoding>(nEncoding);
+
+		size_t nPayloadSize = static_cast<size_t>(ReadLE(svBatch.data() + nPos, 4));
+		nPos += 4;
+		if (svBatch.size() - nPos < nPayloadSize)
+			return false;
+
+		entry.svPayload = svBatch.substr(nPos, nPayloadSize);
+		nPos += nPayloadSize;
+
+		vEntries.push_back(entry);
+	}
+
+	return true;
+}
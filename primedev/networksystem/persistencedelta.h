@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Capability atlas lists in its add_server response when it takes
+// /accounts/write_persistence_batch
+constexpr const char* PERSISTENCE_BATCH_CAPABILITY = "persistence_batch";
+
+// Content type of a write_persistence_batch body
+constexpr const char* PERSISTENCE_BATCH_TYPE = "application/x-ns-pdata-batch";
+
+//-----------------------------------------------------------------------------
+// How a player's pdata is stored in a batch
+enum class ePersistenceEncoding : uint8_t
+{
+	FULL = 0, // Raw pdata
+	DELTA = 1 // PersistenceDelta_Encode against the pdata atlas last acknowledged
+};
+
+//-----------------------------------------------------------------------------
+// One player in a write_persistence_batch body, views into the body
+struct PersistenceBatchEntry_t
+{
+	std::string_view svUID;
+	ePersistenceEncoding eEncoding;
+	std::string_view svPayload;
+};
+
+uint64_t PersistenceDelta_Hash(std::string_view svData);
+
+void PersistenceDelta_Encode(std::string_view svBase, std::string_view svTarget, std::string& svDelta);
+bool PersistenceDelta_Decode(std::string_view svBase, std::string_view svDelta, std::string& svTarget);
+
+void PersistenceBatch_Begin(std::string& svBatch);
+bool PersistenceBatch_Add(std::string& svBatch, std::string_view svUID, ePersistenceEncoding eEncoding, std::string_view svPayload);
+bool PersistenceBatch_Parse(std::string_view svBatch, std::vector<PersistenceBatchEntry_t>& vEntries);
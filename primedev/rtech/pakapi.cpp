@@ -51,12 +51,39 @@ LoadedPak* PakLoadManager::TrackLoadedPak(ePakLoadSource nLoadSource, int nPakHa
 	pak.m_nPakNameHash = nPakNameHash;
 
 	m_vLoadedPaks.insert(std::make_pair(nPakHandle, pak));
+
+	// Lowest handle wins if a name is loaded more than once, same as scanning m_vLoadedPaks would
+	auto it = m_HashToPakHandle.find(nPakNameHash);
+	if (it == m_HashToPakHandle.end() || nPakHandle < it->second)
+		m_HashToPakHandle[nPakNameHash] = nPakHandle;
+
 	return &m_vLoadedPaks.at(nPakHandle);
 }
 
 void PakLoadManager::RemoveLoadedPak(int nPakHandle)
 {
-	m_vLoadedPaks.erase(nPakHandle);
+	auto pakIt = m_vLoadedPaks.find(nPakHandle);
+	if (pakIt == m_vLoadedPaks.end())
+		return;
+
+	size_t nPakNameHash = pakIt->second.m_nPakNameHash;
+	m_vLoadedPaks.erase(pakIt);
+
+	auto it = m_HashToPakHandle.find(nPakNameHash);
+	if (it == m_HashToPakHandle.end() || it->second != nPakHandle)
+		return;
+
+	m_HashToPakHandle.erase(it);
+
+	// Fall back to another handle with the same name, if there is one
+	for (auto& pair : m_vLoadedPaks)
+	{
+		if (pair.second.m_nPakNameHash == nPakNameHash)
+		{
+			m_HashToPakHandle[nPakNameHash] = pair.first;
+			break;
+		}
+	}
 }
 
 LoadedPak* PakLoadManager::GetPakInfo(const int nPakHandle)
@@ -66,11 +93,11 @@ LoadedPak* PakLoadManager::GetPakInfo(const int nPakHandle)
 
 int PakLoadManager::GetPakHandle(const size_t nPakNameHash)
 {
-	for (auto& pair : m_vLoadedPaks)
-		if (pair.second.m_nPakNameHash == nPakNameHash)
-			return pair.first;
+	auto it = m_HashToPakHandle.find(nPakNameHash);
+	if (it == m_HashToPakHandle.end())
+		return -1;
 
-	return -1;
+	return it->second;
 }
 
 int PakLoadManager::GetPakHandle(const char* pPath)
@@ -83,6 +110,47 @@ void* PakLoadManager::LoadFile(const char* path)
 	return g_pakLoadApi->LoadFile(path);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Rebuilds the lookup h_ReadFileAsync resolves modded starpaks and
+//          stbsps with, call whenever the loaded mods change
+//-----------------------------------------------------------------------------
+void PakLoadManager::RebuildStreamFileIndex()
+{
+	static uint32_t s_nGeneration = 0;
+
+	std::unique_ptr<StreamFileIndex_t> pIndex = std::make_unique<StreamFileIndex_t>();
+	pIndex->nGeneration = ++s_nGeneration;
+
+	// Starpaks are keyed by their path without r2\, the first mod in load order that has one wins
+	for (Mod& mod : g_pModManager->m_LoadedMods)
+	{
+		if (!mod.m_bEnabled)
+			continue;
+
+		for (const std::string& svStarpak : mod.StarpakPaths)
+			pIndex->mapFiles.emplace(STR_HASH(svStarpak), StreamFile_t {(mod.m_ModDirectory / "paks" / svStarpak).string(), mod.Name});
+	}
+
+	// Stbsps are keyed by the normalised path of their override file
+	for (auto& modFilePair : g_pModManager->m_ModFiles)
+	{
+		const ModOverrideFile& file = modFilePair.second;
+		if (!file.m_pOwningMod || file.m_Path.extension() != ".stbsp")
+			continue;
+
+		pIndex->mapFiles.emplace(STR_HASH(modFilePair.first), StreamFile_t {(file.m_pOwningMod->m_ModDirectory / "mod" / file.m_Path).string(), file.m_pOwningMod->Name});
+	}
+
+	DevMsg(eLog::RTECH, "Built stream file index %u with %zu files\n", pIndex->nGeneration, pIndex->mapFiles.size());
+
+	m_pStreamFileIndex.store(pIndex.get(), std::memory_order_release);
+	m_vStreamFileIndices.push_back(std::move(pIndex));
+
+	// Reads only hold an index for the duration of the hook, a couple of old ones is plenty
+	if (m_vStreamFileIndices.size() > 4)
+		m_vStreamFileIndices.erase(m_vStreamFileIndices.begin());
+}
+
 void HandlePakAliases(char** map)
 {
 	// convert the pak being loaded to it's aliased one, e.g. aliasing mp_hub_timeshift => sp_hub_timeshift
@@ -247,81 +315,84 @@ void* h_UnloadPak(int nPakHandle, void* pCallback)
 	return o_UnloadPak(nPakHandle, pCallback);
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Finds a modded stream file
+// Input  : *pIndex -
+//          svPath - Path the game asked for, same form the index is keyed by
+//-----------------------------------------------------------------------------
+static const StreamFile_t* FindStreamFile(const StreamFileIndex_t* pIndex, std::string_view svPath)
+{
+	// Same hash as STR_HASH, without having to build a std::string
+	auto it = pIndex->mapFiles.find(std::hash<std::string_view>()(svPath));
+	if (it == pIndex->mapFiles.end())
+		return nullptr;
+
+	return &it->second;
+}
+
 // we hook this exclusively for resolving stbsp paths, but seemingly it's also used for other stuff like vpk, rpak, mprj and starpak loads
 // tbh this actually might be for memory mapped files or something, would make sense i think
 void* (*o_ReadFileAsync)(const char* pPath, void* pCallback);
 
 void* h_ReadFileAsync(const char* pPath, void* pCallback)
 {
-	fs::path path(pPath);
-	std::string newPath = "";
-	fs::path filename = path.filename();
+	const char* pszExtension = strrchr(pPath, '.');
+	if (!pszExtension || (strcmp(pszExtension, ".stbsp") && strcmp(pszExtension, ".starpak")))
+		return o_ReadFileAsync(pPath, pCallback);
+
+	if (IsDedicatedServer())
+		return nullptr;
 
-	if (path.extension() == ".stbsp")
+	const char* pszFilename = pPath;
+	for (const char* p = pPath; *p; p++)
 	{
-		if (IsDedicatedServer())
-			return nullptr;
+		if (*p == '/' || *p == '\\')
+			pszFilename = p + 1;
+	}
 
-		DevMsg(eLog::RTECH, "LoadStreamBsp: %s\n", filename.string().c_str());
+	// Snapshot the index so a mod reload can't swap it out from under us
+	const StreamFileIndex_t* pIndex = g_pPakLoadManager->GetStreamFileIndex();
+	const StreamFile_t* pFile = nullptr;
 
-		// resolve modded stbsp path so we can load mod stbsps
-		auto modFile = g_pModManager->m_ModFiles.find(g_pModManager->NormaliseModFilePath(fs::path("maps" / filename)));
-		if (modFile != g_pModManager->m_ModFiles.end())
+	if (!strcmp(pszExtension, ".stbsp"))
+	{
+		DevMsg(eLog::RTECH, "LoadStreamBsp: %s\n", pszFilename);
+
+		// resolve modded stbsp path so we can load mod stbsps, they're keyed like m_ModFiles
+		char szModPath[CModFileIndex::MAX_PATH_LENGTH];
+		int nLength = snprintf(szModPath, sizeof(szModPath), "maps\\%s", pszFilename);
+		if (nLength > 0 && static_cast<size_t>(nLength) < sizeof(szModPath))
 		{
-			newPath = (modFile->second.m_pOwningMod->m_ModDirectory / "mod" / modFile->second.m_Path).string();
-			pPath = newPath.c_str();
+			for (int i = 0; i < nLength; i++)
+				szModPath[i] = static_cast<char>(tolower(static_cast<unsigned char>(szModPath[i])));
+
+			pFile = pIndex ? FindStreamFile(pIndex, std::string_view(szModPath, nLength)) : nullptr;
 		}
 	}
-	else if (path.extension() == ".starpak")
+	else
 	{
-		if (IsDedicatedServer())
-			return nullptr;
-
-		// code for this is mostly stolen from above
-
 		// unfortunately I can't find a way to get the rpak that is causing this function call, so I have to
 		// store them on mod init and then compare the current path with the stored paths
 
 		// game adds r2\ to every path, so assume that a starpak path that begins with r2\paks\ is a vanilla one
 		// modded starpaks will be in the mod's paks folder (but can be in folders within the paks folder)
+		const char* pszRelative = pPath;
+		while (*pszRelative && *pszRelative != '/' && *pszRelative != '\\')
+			pszRelative++;
 
-		// this might look a bit confusing, but its just an iterator over the various directories in a path.
-		// path.begin() being the first directory, r2 in this case, which is guaranteed anyway,
-		// so increment the iterator with ++ to get the first actual directory, * just gets the actual value
-		// then we compare to "paks" to determine if it's a vanilla rpak or not
-		if (*++path.begin() != "paks")
-		{
-			// remove the r2\ from the start used for path lookups
-			std::string starpakPath = path.string().substr(3);
-			// hash the starpakPath to compare with stored entries
-			size_t hashed = STR_HASH(starpakPath);
+		if (*pszRelative)
+			pszRelative++;
 
-			// loop through all loaded mods
-			for (Mod& mod : g_pModManager->m_LoadedMods)
-			{
-				// ignore non-loaded mods
-				if (!mod.m_bEnabled)
-					continue;
+		bool bIsVanilla = !strncmp(pszRelative, "paks", 4) && (pszRelative[4] == '/' || pszRelative[4] == '\\');
+		if (!bIsVanilla && pIndex)
+			pFile = FindStreamFile(pIndex, pszRelative);
 
-				// loop through the stored starpak paths
-				for (size_t hash : mod.StarpakPaths)
-				{
-					if (hash == hashed)
-					{
-						// construct new path
-						newPath = (mod.m_ModDirectory / "paks" / starpakPath).string();
-						// set path to the new path
-						pPath = newPath.c_str();
-						goto LOG_STARPAK;
-					}
-				}
-			}
-		}
-
-	LOG_STARPAK:
-		DevMsg(eLog::RTECH, "LoadStreamPak: %s\n", filename.string().c_str());
+		DevMsg(eLog::RTECH, "LoadStreamPak: %s\n", pszFilename);
 	}
 
+	if (pFile)
+		pPath = pFile->svPath.c_str();
+
 	return o_ReadFileAsync(pPath, pCallback);
 }
 
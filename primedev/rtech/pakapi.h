@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+
 enum class ePakLoadSource
 {
 	UNTRACKED = -1, // not a pak we loaded, we shouldn't touch this one
@@ -15,12 +18,32 @@ struct LoadedPak
 	size_t m_nPakNameHash;
 };
 
+// A starpak or stbsp a mod replaces
+struct StreamFile_t
+{
+	// Path the game should read instead
+	std::string svPath;
+	std::string svOwningMod;
+};
+
+// Lookup for stream file reads, keyed by STR_HASH of the path the game asks for
+struct StreamFileIndex_t
+{
+	uint32_t nGeneration;
+	std::unordered_map<size_t, StreamFile_t> mapFiles;
+};
+
 class PakLoadManager
 {
   private:
 	std::map<int, LoadedPak> m_vLoadedPaks {};
 	std::unordered_map<size_t, int> m_HashToPakHandle {};
 
+	// Current stream file index, read from async file read threads
+	std::atomic<const StreamFileIndex_t*> m_pStreamFileIndex = nullptr;
+	// Recent indices, reads that started before a rebuild may still be using them
+	std::vector<std::unique_ptr<StreamFileIndex_t>> m_vStreamFileIndices;
+
   public:
 	int LoadPakAsync(const char* pPath, const ePakLoadSource nLoadSource);
 	void UnloadPak(const int nPakHandle);
@@ -34,6 +57,17 @@ class PakLoadManager
 
 	int GetPakHandle(const size_t nPakNameHash);
 	int GetPakHandle(const char* pPath);
+
+	void RebuildStreamFileIndex();
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Gets the index stream file reads resolve against, hold on to it
+	//          for the whole read so a rebuild can't change results midway
+	//-----------------------------------------------------------------------------
+	const StreamFileIndex_t* GetStreamFileIndex() const
+	{
+		return m_pStreamFileIndex.load(std::memory_order_acquire);
+	}
 };
 
 extern PakLoadManager* g_pPakLoadManager;
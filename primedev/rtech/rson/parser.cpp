@@ -1,156 +1,171 @@
+#include <intrin.h>
+
 INT64(__fastcall* sub_F1320)(DWORD a1, char* a2);
 
-// Reimplementation of an exploitable UTF decoding function in titanfall
+//-----------------------------------------------------------------------------
+// Purpose: Checks a whole range is committed and readable, walking every
+//          region it spans
+// Input  : *pData -
+//          nSize -
+//-----------------------------------------------------------------------------
+static bool IsRangeReadable(const char* pData, size_t nSize)
+{
+	const char* pEnd = pData + nSize;
+	while (pData < pEnd)
+	{
+		MEMORY_BASIC_INFORMATION memInfo;
+		if (!VirtualQuery(pData, &memInfo, sizeof(memInfo)))
+			return false;
+
+		if (!(memInfo.State & MEM_COMMIT) || memInfo.Protect & (PAGE_NOACCESS | PAGE_GUARD))
+			return false;
+
+		pData = static_cast<const char*>(memInfo.BaseAddress) + memInfo.RegionSize;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the next escape sequence, 16 bytes at a time
+// Note   : SSE2 is part of x64 so this needs no cpu feature check, the loop is
+//          bound by memory bandwidth long before wider vectors would help
+// Input  : *pData -
+//          *pEnd -
+// Output : First backslash in [pData, pEnd), pEnd if there is none
+//-----------------------------------------------------------------------------
+static const char* FindEscape(const char* pData, const char* pEnd)
+{
+	const __m128i backslash = _mm_set1_epi8('\\');
+
+	while (pEnd - pData >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
+		unsigned long nMask = static_cast<unsigned long>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)));
+
+		unsigned long nIndex;
+		if (_BitScanForward(&nIndex, nMask))
+			return pData + nIndex;
+
+		pData += 16;
+	}
+
+	while (pData < pEnd && *pData != '\\')
+		pData++;
+
+	return pData;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Decodes the 4 hex digits of a \u escape the same way the game does,
+//          which doesn't reject invalid digits
+// Input  : *pData -
+//-----------------------------------------------------------------------------
+static DWORD DecodeHex4(const char* pData)
+{
+	DWORD nValue = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		DWORD nChar = pData[i] | 0x20;
+		nValue = (nValue << 4) | (nChar - (nChar <= 0x39 ? 48 : 87));
+	}
+
+	return nValue;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reimplementation of an exploitable UTF decoding function in titanfall
+// Note   : The game reads escape sequences without checking where the string
+//          ends, so anything that would make it read past the closing quote is
+//          rejected here. Readability of the string is checked once up front
+// Output : False if the game's parser shouldn't see this string
+//-----------------------------------------------------------------------------
 bool __fastcall CheckUTF8Valid(INT64* a1, DWORD* a2, char* strData)
 {
-	DWORD v3; // eax
-	char* v4; // rbx
-	char v5; // si
-	char* _strData; // rdi
-	char* v7; // rbp
-	char v11; // al
-	DWORD v12; // er9
-	DWORD v13; // ecx
-	DWORD v14; // edx
-	DWORD v15; // er8
-	int v16; // eax
-	DWORD v17; // er9
-	int v18; // eax
-	DWORD v19; // er9
-	DWORD v20; // ecx
-	int v21; // eax
-	int v22; // er9
-	DWORD v23; // edx
-	int v24; // eax
-	int v25; // er9
-	DWORD v26; // er9
-	DWORD v27; // er10
-	DWORD v28; // ecx
-	DWORD v29; // edx
-	DWORD v30; // er8
-	int v31; // eax
-	DWORD v32; // er10
-	int v33; // eax
-	DWORD v34; // er10
-	DWORD v35; // ecx
-	int v36; // eax
-	int v37; // er10
-	DWORD v38; // edx
-	int v39; // eax
-	int v40; // er10
-	DWORD v41; // er10
-
-	v3 = a2[2];
-	v4 = (char*)(a1[1] + *a2);
-	v5 = 0;
-	_strData = strData;
-	v7 = &v4[*((UINT16*)a2 + 2)];
-	if (v3 >= 2)
+	if (a2[2] < 3)
+		return true;
+
+	// Skip the quotes, pEnd points at the closing one
+	const char* pData = reinterpret_cast<const char*>(a1[1] + *a2) + 1;
+	const char* pEnd = pData + *reinterpret_cast<UINT16*>(a2 + 1) - 2;
+
+	if (pData >= pEnd)
+		return true;
+
+	// Include the closing quote, surrogate pairs peek at it
+	if (!IsRangeReadable(pData, pEnd - pData + 1))
+		return false;
+
+	while (pData < pEnd)
 	{
-		++v4;
-		--v7;
-		if (v3 != 2)
+		// Copy everything up to the next escape as is
+		const char* pEscape = FindEscape(pData, pEnd);
+		memcpy(strData, pData, pEscape - pData);
+		strData += pEscape - pData;
+		pData = pEscape;
+
+		if (pData == pEnd)
+			break;
+
+		if (pEnd - pData < 2)
+			return false;
+
+		char c = pData[1];
+		pData += 2;
+
+		switch (c)
+		{
+		case 'n':
+			c = '\n';
+			break;
+		case 't':
+			c = '\t';
+			break;
+		case 'r':
+			c = '\r';
+			break;
+		case 'b':
+			c = '\b';
+			break;
+		case 'f':
+			c = '\f';
+			break;
+		case 'u':
 		{
-			while (1)
+			if (pEnd - pData < 4)
+				return false;
+
+			DWORD nCodepoint = DecodeHex4(pData);
+			pData += 4;
+
+			if (nCodepoint - 0xD800 <= 0x7FF)
 			{
-				if (!CMemory(v4).IsMemoryReadable(1))
-					return false; // INVALID
-
-				v11 = *v4++; // crash potential
-				if (v11 != 92)
-					goto LABEL_6;
-				v11 = *v4++;
-				if (v11 == 110)
-					break;
-				switch (v11)
-				{
-				case 't':
-					v11 = 9;
-					goto LABEL_6;
-				case 'r':
-					v11 = 13;
-					goto LABEL_6;
-				case 'b':
-					v11 = 8;
-					goto LABEL_6;
-				case 'f':
-					v11 = 12;
-					goto LABEL_6;
-				}
-				if (v11 != 117)
-					goto LABEL_6;
-				v12 = *v4 | 0x20;
-				v13 = v4[1] | 0x20;
-				v14 = v4[2] | 0x20;
-				v15 = v4[3] | 0x20;
-				v16 = 87;
-				if (v12 <= 0x39)
-					v16 = 48;
-				v17 = v12 - v16;
-				v18 = 87;
-				v19 = v17 << 12;
-				if (v13 <= 0x39)
-					v18 = 48;
-				v20 = v13 - v18;
-				v21 = 87;
-				v22 = (v20 << 8) | v19;
-				if (v14 <= 0x39)
-					v21 = 48;
-				v23 = v14 - v21;
-				v24 = 87;
-				v25 = (16 * v23) | v22;
-				if (v15 <= 0x39)
-					v24 = 48;
-				v4 += 4;
-				v26 = (v15 - v24) | v25;
-				if (v26 - 55296 <= 0x7FF)
-				{
-					if (v26 >= 0xDC00)
-						return true;
-					if (*v4 != 92 || v4[1] != 117)
-						return true;
-
-					v27 = v4[2] | 0x20;
-					v28 = v4[3] | 0x20;
-					v29 = v4[4] | 0x20;
-					v30 = v4[5] | 0x20;
-					v31 = 87;
-					if (v27 <= 0x39)
-						v31 = 48;
-					v32 = v27 - v31;
-					v33 = 87;
-					v34 = v32 << 12;
-					if (v28 <= 0x39)
-						v33 = 48;
-					v35 = v28 - v33;
-					v36 = 87;
-					v37 = (v35 << 8) | v34;
-					if (v29 <= 0x39)
-						v36 = 48;
-					v38 = v29 - v36;
-					v39 = 87;
-					v40 = (16 * v38) | v37;
-					if (v30 <= 0x39)
-						v39 = 48;
-					v4 += 6;
-					v41 = ((v30 - v39) | v40) - 56320;
-					if (v41 > 0x3FF)
-						return true;
-					v26 = v41 | ((v26 - 55296) << 10);
-				}
-				_strData += (DWORD)sub_F1320(v26, _strData);
-			LABEL_7:
-				if (v4 == v7)
-					goto LABEL_48;
+				if (nCodepoint >= 0xDC00)
+					return true;
+
+				if (pEnd - pData < 2 || pData[0] != '\\' || pData[1] != 'u')
+					return true;
+
+				if (pEnd - pData < 6)
+					return false;
+
+				DWORD nLow = DecodeHex4(pData + 2) - 0xDC00;
+				pData += 6;
+
+				if (nLow > 0x3FF)
+					return true;
+
+				nCodepoint = nLow | ((nCodepoint - 0xD800) << 10);
 			}
-			v11 = 10;
-		LABEL_6:
-			v5 |= v11;
-			*_strData++ = v11;
-			goto LABEL_7;
+
+			strData += (DWORD)sub_F1320(nCodepoint, strData);
+			continue;
+		}
 		}
+
+		*strData++ = c;
 	}
-LABEL_48:
+
 	return true;
 }
 
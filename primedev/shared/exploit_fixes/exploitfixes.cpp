@@ -6,6 +6,7 @@
 #include "engine/edict.h"
 #include "engine/client/client.h"
 #include "mathlib/bitbuf.h"
+#include "tier1/lzss.h"
 
 #define BLOCKED_INFO(s)                                                  \
 	(                                                                    \
@@ -370,6 +371,14 @@ bool h_CL_CopyExistingEntity(void* a1)
 	return o_CL_CopyExistingEntity(a1);
 }
 
+unsigned int (*o_CLZSS__SafeDecompress)(void* self, const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize);
+
+unsigned int h_CLZSS__SafeDecompress(void* self, const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize)
+{
+	NOTE_UNUSED(self);
+	return LZSS_SafeDecompress(pInput, pOutput, unBufSize);
+}
+
 ON_DLL_LOAD("engine.dll", EngineExploitFixes, (CModule module))
 {
 	o_CLC_Screenshot_WriteToBuffer = module.Offset(0x22AF20).RCast<bool (*)(void*, void*)>();
@@ -396,6 +405,9 @@ ON_DLL_LOAD("engine.dll", EngineExploitFixes, (CModule module))
 	o_CL_CopyExistingEntity = module.Offset(0x6F940).RCast<bool (*)(void*)>();
 	HookAttach(&(PVOID&)o_CL_CopyExistingEntity, (PVOID)h_CL_CopyExistingEntity);
 
+	o_CLZSS__SafeDecompress = module.Offset(0x432A10).RCast<unsigned int (*)(void*, const unsigned char*, unsigned char*, unsigned int)>();
+	HookAttach(&(PVOID&)o_CLZSS__SafeDecompress, (PVOID)h_CLZSS__SafeDecompress);
+
 	// allow client/ui to run clientcommands despite restricting servercommands
 	module.Offset(0x4FB65).Patch("EB 11");
 	module.Offset(0x4FBAC).Patch("EB 16");
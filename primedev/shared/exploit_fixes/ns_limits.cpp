@@ -142,42 +142,22 @@ bool ServerLimitsManager::CheckConnectionlessPacketLimits(netpacket_t* packet)
 	// don't ratelimit datablock packets as long as datablock is enabled
 	if (packet->adr.type == NA_IP && (!(packet->data[4] == 'N' && Cvar_net_data_block_enabled->GetBool()) || !Cvar_net_data_block_enabled->GetBool()))
 	{
-		// bad lookup: optimise later tm
-		UnconnectedPlayerLimitData* sendData = nullptr;
-		for (UnconnectedPlayerLimitData& foundSendData : g_pServerLimits->m_UnconnectedPlayerLimitData)
-		{
-			if (!memcmp(packet->adr.ip, foundSendData.ip, 16))
-			{
-				sendData = &foundSendData;
-				break;
-			}
-		}
-
-		if (!sendData)
-		{
-			sendData = &g_pServerLimits->m_UnconnectedPlayerLimitData.emplace_back();
-			memcpy(sendData->ip, packet->adr.ip, 16);
-		}
+		RateLimitParams_t params;
+		params.flRate = Cvar_sv_querylimit_per_sec->GetFloat();
+		params.flBurst = Cvar_sv_querylimit_burst->GetFloat();
+		params.flSubnetRate = Cvar_sv_querylimit_subnet_per_sec->GetFloat();
+		params.flSubnetBurst = Cvar_sv_querylimit_subnet_burst->GetFloat();
+		params.flPenalty = Cvar_sv_querylimit_timeout->GetFloat();
 
-		if (Plat_FloatTime() < sendData->timeoutEnd)
-			return false;
+		eRateLimit eResult = g_pServerLimits->m_UnconnectedLimiter.Check(packet->adr.ip, Plat_FloatTime(), params);
 
-		if (Plat_FloatTime() - sendData->lastQuotaStart >= 1.0)
-		{
-			sendData->lastQuotaStart = Plat_FloatTime();
-			sendData->packetCount = 0;
-		}
-
-		sendData->packetCount++;
-
-		if (sendData->packetCount >= Cvar_sv_querylimit_per_sec->GetInt())
+		if (eResult == eRateLimit::LIMITED)
 		{
 			Warning(eLog::NS, "Client went over connectionless ratelimit of %i per sec with packet of type %c\n", Cvar_sv_querylimit_per_sec->GetInt(), packet->data[4]);
+		}
 
-			// timeout for a minute
-			sendData->timeoutEnd = Plat_FloatTime() + 60.0;
+		if (eResult != eRateLimit::ALLOWED)
 			return false;
-		}
 	}
 
 	return true;
@@ -3,6 +3,7 @@
 #include "tier1/convar.h"
 #include "engine/client/client.h"
 #include "networksystem/netchannel.h"
+#include "tier1/ratelimiter.h"
 
 #include <unordered_map>
 
@@ -20,19 +21,11 @@ struct PlayerLimitData
 	float flFrameUserCmdBudget = 0.0;
 };
 
-struct UnconnectedPlayerLimitData
-{
-	char ip[16];
-	double lastQuotaStart = 0.0;
-	int packetCount = 0;
-	double timeoutEnd = -1.0;
-};
-
 class ServerLimitsManager
 {
   public:
 	std::unordered_map<CClient*, PlayerLimitData> m_PlayerLimitData;
-	std::vector<UnconnectedPlayerLimitData> m_UnconnectedPlayerLimitData;
+	CAddressRateLimiter m_UnconnectedLimiter;
 
   public:
 	void RunFrame(double flCurrentTime, float flFrameTime);
@@ -9,6 +9,7 @@
 
 #define CRASHHANDLER_MAX_FRAMES 32
 #define CRASHHANDLER_GETMODULEHANDLE_FAIL "GetModuleHandleExA_failed!"
+#define CRASHHANDLER_FLUSH_TIMEOUT_MS 2000
 
 //-----------------------------------------------------------------------------
 // Purpose: Vectored exception callback
@@ -42,6 +43,9 @@ LONG WINAPI ExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo)
 
 	g_pCrashHandler->SetState(true);
 
+	// Get queued log lines to disk before anything else can go wrong
+	g_pCrashHandler->FlushLogs(CRASHHANDLER_FLUSH_TIMEOUT_MS);
+
 	// Needs to be called first as we use the members this sets later on
 	g_pCrashHandler->SetCrashedModule();
 
@@ -70,7 +74,7 @@ LONG WINAPI ExceptionFilter(EXCEPTION_POINTERS* pExceptionInfo)
 //-----------------------------------------------------------------------------
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
-CCrashHandler::CCrashHandler() : m_hExceptionFilter(nullptr), m_pExceptionInfos(nullptr), m_bHasShownCrashMsg(false), m_bState(false)
+CCrashHandler::CCrashHandler() : m_hExceptionFilter(nullptr), m_pExceptionInfos(nullptr), m_bHasShownCrashMsg(false), m_bState(false), m_pfnFlushLogs(nullptr)
 {
 	Init();
 }
@@ -103,6 +107,18 @@ void CCrashHandler::Shutdown()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Emits Northstar's queued log lines and flushes the log files
+// Input  : nTimeoutMs - How long to wait for Northstar's sink, -1 waits forever
+//-----------------------------------------------------------------------------
+void CCrashHandler::FlushLogs(int nTimeoutMs)
+{
+	if (m_pfnFlushLogs)
+		m_pfnFlushLogs(nTimeoutMs);
+
+	SpdLog_Flush();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Sets the exception info
 //-----------------------------------------------------------------------------
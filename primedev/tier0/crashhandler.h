@@ -34,6 +34,16 @@ class CCrashHandler
 		return m_bState;
 	}
 
+	//-----------------------------------------------------------------------------
+	// Logging
+	//-----------------------------------------------------------------------------
+	void SetFlushLogsFn(bool (*pfnFlushLogs)(int))
+	{
+		m_pfnFlushLogs = pfnFlushLogs;
+	}
+
+	void FlushLogs(int nTimeoutMs);
+
 	//-----------------------------------------------------------------------------
 	// Exception helpers
 	//-----------------------------------------------------------------------------
@@ -75,6 +85,9 @@ class CCrashHandler
 	bool m_bHasShownCrashMsg;
 	bool m_bState;
 
+	// Flushes Northstar's async log queue, null until it's injected
+	bool (*m_pfnFlushLogs)(int);
+
 	std::string m_svCrashedModule;
 	std::string m_svCrashedOffset;
 
@@ -1,8 +1,9 @@
 #include "dbg.h"
 
-#include <regex>
-
 #ifdef NORTHSTAR
+#include <condition_variable>
+#include <thread>
+
 #include "dedicated/dedicatedlogtoclient.h"
 #include "dedicated/dedicated.h"
 #include <vgui/vgui_baseui_interface.h>
@@ -16,8 +17,6 @@
 #include "windows/wconsole.h"
 #endif
 
-const std::regex AnsiRegex("\\\033\\[.*?m");
-
 //-----------------------------------------------------------------------------
 // Purpose: Get the log context string
 // Input  : eContext -
@@ -111,53 +110,440 @@ std::shared_ptr<spdlog::logger> Log_GetLogger(eLogLevel eLevel)
 #endif
 
 //-----------------------------------------------------------------------------
-// Purpose: Prints to all outputs based on parameters, va_list version
-// Input  : eContext -
+// Purpose: Removes ANSI escape sequences in place, single pass replacement
+//          for the "\033\[.*?m" regex we used to run on every message
+// Input  : *pszBuffer - Zero terminated string
+// Output : New length of the string
+//-----------------------------------------------------------------------------
+size_t Log_StripAnsi(char* pszBuffer)
+{
+	const char* pszRead = pszBuffer;
+	char* pszWrite = pszBuffer;
+
+	while (*pszRead)
+	{
+		if (pszRead[0] != '\033' || pszRead[1] != '[')
+		{
+			*pszWrite++ = *pszRead++;
+			continue;
+		}
+
+		// Find the terminator, like the regex we don't match across line breaks
+		const char* pszEnd = pszRead + 2;
+		while (*pszEnd && *pszEnd != 'm' && *pszEnd != '\n' && *pszEnd != '\r')
+		{
+			pszEnd++;
+		}
+
+		if (*pszEnd == 'm')
+		{
+			pszRead = pszEnd + 1;
+			continue;
+		}
+
+		// Unterminated, keep it as is. Nothing up to pszEnd can start a valid
+		// sequence either so skip straight there
+		while (pszRead != pszEnd)
+		{
+			*pszWrite++ = *pszRead++;
+		}
+	}
+
+	*pszWrite = '\0';
+	return static_cast<size_t>(pszWrite - pszBuffer);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Removes ANSI escape sequences in place
+// Input  : &svMessage -
+//-----------------------------------------------------------------------------
+void Log_StripAnsi(std::string& svMessage)
+{
+	svMessage.resize(Log_StripAnsi(svMessage.data()));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Formats header + message into svOut, reuses svOut's storage
+// Input  : &svOut -
+//          eContext -
 //          eLevel -
-//          iCode -
 //          *pszName -
 //          *fmt -
 //          vArgs -
 //-----------------------------------------------------------------------------
-void CoreMsgV(eLog eContext, eLogLevel eLevel, const int iCode, const char* pszName, const char* fmt, va_list vArgs)
+static void Log_FormatMessage(std::string& svOut, eLog eContext, eLogLevel eLevel, const char* pszName, const char* fmt, va_list vArgs)
 {
-	std::string svMessage;
+	svOut.clear();
 
 	//-----------------------------------
 	// Format header
-	std::string svAnsiString = Log_GetColor(eContext, eLevel).ToANSIColor();
 	if (eContext != eLog::NONE)
 	{
-		svMessage += FormatA("%s[%s] ", svAnsiString.c_str(), pszName);
+		int r, g, b, a;
+		Log_GetColor(eContext, eLevel).GetColor(r, g, b, a);
+
+		char szHeader[128];
+		int nHeader = snprintf(szHeader, sizeof(szHeader), "\033[38;2;%i;%i;%im[%s] ", r, g, b, pszName);
+		if (nHeader > 0)
+		{
+			svOut.append(szHeader, std::min(static_cast<size_t>(nHeader), sizeof(szHeader) - 1));
+		}
 	}
 
+	//-----------------------------------
 	// Add the message itself
-	svMessage += FormatAV(fmt, vArgs);
+	size_t nOffset = svOut.size();
 
-	//-----------------------------------
-	// Emit to all loggers
-	//-----------------------------------
-	std::lock_guard<std::mutex> lock(g_LogMutex);
+	// Try to fit it into the capacity we already have, only retry if it doesn't
+	svOut.resize(std::max(svOut.capacity(), nOffset + 256));
 
-#if defined(LAUNCHER) || defined(WSOCKPROXY)
-	LogMsg(eLevel, svMessage.c_str(), iCode);
-#endif
+	va_list vArgsCopy;
+	va_copy(vArgsCopy, vArgs);
+	int nLen = std::vsnprintf(svOut.data() + nOffset, svOut.size() - nOffset + 1, fmt, vArgsCopy);
+	va_end(vArgsCopy);
+
+	if (nLen < 0)
+	{
+		svOut.resize(nOffset);
+		return;
+	}
+
+	if (nOffset + nLen > svOut.size())
+	{
+		svOut.resize(nOffset + nLen);
+		std::vsnprintf(svOut.data() + nOffset, nLen + 1, fmt, vArgs);
+	}
+
+	svOut.resize(nOffset + nLen);
+}
 
 #ifdef NORTHSTAR
+//-----------------------------------------------------------------------------
+// Purpose: Emits a formatted message to the launcher, clients and the game
+//          console
+// Input  : eContext -
+//          eLevel -
+//          iCode -
+//          &svMessage - Gets stripped of ANSI sequences
+//-----------------------------------------------------------------------------
+static void Log_Emit(eLog eContext, eLogLevel eLevel, int iCode, std::string& svMessage)
+{
+	std::lock_guard<std::mutex> lock(g_LogMutex);
+
 	// Log through launcher
 	g_pLogMsg(eLevel, svMessage.c_str(), iCode);
 
 	// Remove ansi escape sequences
-	svMessage = std::regex_replace(svMessage, AnsiRegex, "");
+	Log_StripAnsi(svMessage);
 
 	// Log to clients if enabled
-	DediClientMsg(svMessage.c_str());
+	DediClientMsg(eLevel, svMessage.c_str());
 
 	// Log to game console
 	if (g_bEngineVguiInitilased && g_pCVar)
 	{
 		g_pCVar->ConsoleColorPrintf(Log_GetColor(eContext, eLevel).ToSourceColor(), "%s", svMessage.c_str());
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bounded lock-free queue of formatted messages, a single sink
+//          thread drains it and does the slow part of logging so callers only
+//          pay for formatting and a copy
+//-----------------------------------------------------------------------------
+class CLogSink
+{
+  public:
+	// Must be a power of two
+	static constexpr size_t RING_SIZE = 4096;
+
+	CLogSink();
+
+	void Push(eLog eContext, eLogLevel eLevel, const std::string& svMessage);
+	bool Flush(int nTimeoutMs);
+	void Drain();
+
+	bool IsSinkThread() const
+	{
+		return std::this_thread::get_id() == m_Thread.get_id();
+	}
+
+  private:
+	struct Record_t
+	{
+		std::atomic<size_t> nSequence;
+		eLog eContext;
+		eLogLevel eLevel;
+		std::string svMessage;
+	};
+
+	void Thread_Run();
+	void WakeSink();
+
+	Record_t m_Records[RING_SIZE];
+
+	// Claimed by producers
+	alignas(64) std::atomic<size_t> m_nEnqueuePos;
+	// Only touched by the sink thread
+	alignas(64) size_t m_nDequeuePos;
+	// Number of records the sink has emitted, used for flushing
+	std::atomic<size_t> m_nEmitted;
+
+	std::mutex m_WakeMutex;
+	std::condition_variable m_cvWake;
+	std::condition_variable m_cvEmitted;
+	std::atomic_bool m_bSinkWaiting;
+	std::atomic_int m_nFlushWaiters;
+
+	std::thread m_Thread;
+};
+
+static_assert((CLogSink::RING_SIZE & (CLogSink::RING_SIZE - 1)) == 0);
+
+// Never freed, the sink thread lives for as long as the process
+static CLogSink* s_pLogSink = nullptr;
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor, starts the sink thread
+//-----------------------------------------------------------------------------
+CLogSink::CLogSink() : m_nEnqueuePos(0), m_nDequeuePos(0), m_nEmitted(0), m_bSinkWaiting(false), m_nFlushWaiters(0)
+{
+	for (size_t i = 0; i < RING_SIZE; i++)
+	{
+		m_Records[i].nSequence.store(i, std::memory_order_relaxed);
+	}
+
+	m_Thread = std::thread(&CLogSink::Thread_Run, this);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a formatted message, safe to call from any thread. Waits
+//          for the sink if the ring is full instead of dropping messages
+// Input  : eContext -
+//          eLevel -
+//          &svMessage -
+//-----------------------------------------------------------------------------
+void CLogSink::Push(eLog eContext, eLogLevel eLevel, const std::string& svMessage)
+{
+	Record_t* pRecord;
+	size_t nPos = m_nEnqueuePos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		pRecord = &m_Records[nPos & (RING_SIZE - 1)];
+		size_t nSequence = pRecord->nSequence.load(std::memory_order_acquire);
+		intptr_t nDiff = static_cast<intptr_t>(nSequence) - static_cast<intptr_t>(nPos);
+
+		if (nDiff == 0)
+		{
+			if (m_nEnqueuePos.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (nDiff < 0)
+		{
+			// Full, let the sink catch up
+			WakeSink();
+			std::this_thread::yield();
+			nPos = m_nEnqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			nPos = m_nEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pRecord->eContext = eContext;
+	pRecord->eLevel = eLevel;
+	// The slot keeps its capacity between uses so this rarely allocates
+	pRecord->svMessage.assign(svMessage);
+
+	pRecord->nSequence.store(nPos + 1, std::memory_order_seq_cst);
+
+	if (m_bSinkWaiting.load(std::memory_order_seq_cst))
+		WakeSink();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Blocks until everything pushed before this call has been emitted
+// Input  : nTimeoutMs - How long to wait at most, -1 waits forever
+// Output : true if everything was emitted
+//-----------------------------------------------------------------------------
+bool CLogSink::Flush(int nTimeoutMs)
+{
+	size_t nTarget = m_nEnqueuePos.load(std::memory_order_acquire);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(nTimeoutMs, 0));
+
+	std::unique_lock<std::mutex> lock(m_WakeMutex);
+
+	// Both sides are seq_cst, the sink either sees us waiting or we see its
+	// progress. The timeout is only a backstop so a lost wakeup can't hang us
+	m_nFlushWaiters.fetch_add(1, std::memory_order_seq_cst);
+	m_cvWake.notify_one();
+	bool bEmitted;
+	while (!(bEmitted = m_nEmitted.load(std::memory_order_seq_cst) >= nTarget))
+	{
+		if (nTimeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline)
+			break;
+
+		m_cvEmitted.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	m_nFlushWaiters.fetch_sub(1, std::memory_order_seq_cst);
+
+	return bEmitted;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Emits whatever is left in the ring on the calling thread
+// Note   : Only safe once the sink thread is gone, the process exiting kills
+//          it without letting it finish what's queued
+//-----------------------------------------------------------------------------
+void CLogSink::Drain()
+{
+	while (true)
+	{
+		Record_t* pRecord = &m_Records[m_nDequeuePos & (RING_SIZE - 1)];
+
+		if (pRecord->nSequence.load(std::memory_order_acquire) != m_nDequeuePos + 1)
+			break;
+
+		Log_Emit(pRecord->eContext, pRecord->eLevel, 0, pRecord->svMessage);
+
+		pRecord->nSequence.store(m_nDequeuePos + RING_SIZE, std::memory_order_release);
+		m_nDequeuePos++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Wakes up the sink thread if it's waiting for messages
+//-----------------------------------------------------------------------------
+void CLogSink::WakeSink()
+{
+	std::lock_guard<std::mutex> guard(m_WakeMutex);
+	m_cvWake.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sink thread
+//-----------------------------------------------------------------------------
+void CLogSink::Thread_Run()
+{
+	while (true)
+	{
+		Record_t* pRecord = &m_Records[m_nDequeuePos & (RING_SIZE - 1)];
+
+		if (pRecord->nSequence.load(std::memory_order_acquire) != m_nDequeuePos + 1)
+		{
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+
+			m_bSinkWaiting.store(true, std::memory_order_seq_cst);
+
+			// Check again now that producers will see we're waiting
+			if (pRecord->nSequence.load(std::memory_order_seq_cst) != m_nDequeuePos + 1)
+			{
+				m_cvWake.wait_for(lock, std::chrono::milliseconds(10));
+			}
+
+			m_bSinkWaiting.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		Log_Emit(pRecord->eContext, pRecord->eLevel, 0, pRecord->svMessage);
+
+		// Hand the slot back to producers
+		pRecord->nSequence.store(m_nDequeuePos + RING_SIZE, std::memory_order_release);
+		m_nDequeuePos++;
+
+		// Store then load, must be seq_cst to pair with Flush
+		m_nEmitted.store(m_nDequeuePos, std::memory_order_seq_cst);
+
+		if (m_nFlushWaiters.load(std::memory_order_seq_cst))
+		{
+			std::lock_guard<std::mutex> guard(m_WakeMutex);
+			m_cvEmitted.notify_all();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the asynchronous log sink, anything logged before this is
+//          emitted on the calling thread
+//-----------------------------------------------------------------------------
+void Log_InitAsync()
+{
+	if (s_pLogSink)
+		return;
+
+	s_pLogSink = new CLogSink();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Blocks until all queued messages have been emitted
+// Input  : nTimeoutMs - How long to wait at most, -1 waits forever. A crashed
+//          thread can hold locks the sink needs, so crash paths should pass one
+// Output : true if everything was emitted
+//-----------------------------------------------------------------------------
+bool Log_FlushAsync(int nTimeoutMs)
+{
+	if (!s_pLogSink || s_pLogSink->IsSinkThread())
+		return true;
+
+	return s_pLogSink->Flush(nTimeoutMs);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Emits what the sink thread didn't get to, call when the process is
+//          exiting and every other thread has already been terminated
+//-----------------------------------------------------------------------------
+void Log_ShutdownAsync()
+{
+	if (!s_pLogSink)
+		return;
+
+	// A terminated thread may have been holding it, hanging the exit is worse than losing the lines
+	if (!g_LogMutex.try_lock())
+		return;
+
+	g_LogMutex.unlock();
+
+	s_pLogSink->Drain();
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Purpose: Prints to all outputs based on parameters, va_list version
+// Input  : eContext -
+//          eLevel -
+//          iCode -
+//          *pszName -
+//          *fmt -
+//          vArgs -
+//-----------------------------------------------------------------------------
+void CoreMsgV(eLog eContext, eLogLevel eLevel, const int iCode, const char* pszName, const char* fmt, va_list vArgs)
+{
+	// Per thread so formatting doesn't allocate once the buffer has grown
+	thread_local std::string svMessage;
+	Log_FormatMessage(svMessage, eContext, eLevel, pszName, fmt, vArgs);
+
+	//-----------------------------------
+	// Emit to all loggers
+	//-----------------------------------
+#if defined(LAUNCHER) || defined(WSOCKPROXY)
+	std::lock_guard<std::mutex> lock(g_LogMutex);
+	LogMsg(eLevel, svMessage.c_str(), iCode);
+#endif
+
+#ifdef NORTHSTAR
+	// Errors skip the queue so they make it to disk even if we crash right after, messages
+	// logged by the sink itself can't wait on it
+	if (s_pLogSink && eLevel != eLogLevel::LOG_ERROR && !s_pLogSink->IsSinkThread())
+	{
+		s_pLogSink->Push(eContext, eLevel, svMessage);
+		return;
+	}
+
+	// Keep ordering with whatever is still queued
+	Log_FlushAsync();
+	Log_Emit(eContext, eLevel, iCode, svMessage);
 #endif
 }
 
@@ -184,24 +570,27 @@ void CoreMsg(eLog eContext, eLogLevel eLevel, const int iCode, const char* pszNa
 //-----------------------------------------------------------------------------
 void LogMsg(eLogLevel eLevel, const char* pszMessage, int nCode)
 {
+	// Remove ANSI sequences
 	std::string svMessage = pszMessage;
-
-	if (!g_bConsole_UseAnsiColor)
-	{
-		svMessage = std::regex_replace(svMessage, AnsiRegex, "");
-	}
+	Log_StripAnsi(svMessage);
 
 	// Log to win console
 	if (g_WinLogger.get()) // Allows using before spdlog is initilazed (Only Error benefits from this)
-		g_WinLogger->debug("{}", svMessage);
-
-	// Remove ANSI sequences
-	svMessage = std::regex_replace(svMessage, AnsiRegex, "");
+		g_WinLogger->debug("{}", g_bConsole_UseAnsiColor ? pszMessage : svMessage.c_str());
 
 	// Log to file
 	std::shared_ptr<spdlog::logger> pLogger = Log_GetLogger(eLevel);
 	if (pLogger.get())
-		pLogger->info("{:s}", svMessage);
+	{
+		// The level doesn't show up in the file, it decides when the logger flushes
+		spdlog::level::level_enum eSpdLevel = spdlog::level::info;
+		if (eLevel == eLogLevel::LOG_WARN)
+			eSpdLevel = spdlog::level::warn;
+		else if (eLevel == eLogLevel::LOG_ERROR)
+			eSpdLevel = spdlog::level::err;
+
+		pLogger->log(eSpdLevel, "{:s}", svMessage);
+	}
 
 	//-----------------------------------
 	// Terminate process if needed
@@ -209,6 +598,9 @@ void LogMsg(eLogLevel eLevel, const char* pszMessage, int nCode)
 	// NOTE [Fifty]: Needs tier0 to be loaded otherwise CommandLine will be null
 	if (nCode)
 	{
+		// Make sure everything up to here is on disk
+		spdlog::apply_all([](std::shared_ptr<spdlog::logger> pFileLogger) { pFileLogger->flush(); });
+
 		if (CommandLine()->CheckParm("-dedicated") == nullptr)
 		{
 			MessageBoxA(NULL, svMessage.c_str(), "Northstar Prime Error", MB_ICONERROR | MB_OK);
@@ -16,6 +16,15 @@ void CoreMsg(eLog eContext, eLogLevel eLevel, const int iCode, const char* pszNa
 
 const char* Log_GetContextString(eLog eContext);
 
+size_t Log_StripAnsi(char* pszBuffer);
+void Log_StripAnsi(std::string& svMessage);
+
+#ifdef NORTHSTAR
+void Log_InitAsync();
+bool Log_FlushAsync(int nTimeoutMs = -1);
+void Log_ShutdownAsync();
+#endif
+
 #ifdef NORTHSTAR
 void PluginMsg(eLogLevel eLevel, const char* pszName, const char* fmt, ...);
 #endif
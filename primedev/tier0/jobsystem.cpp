@@ -0,0 +1,273 @@
+#include "tier0/jobsystem.h"
+
+// clang-format off
+constexpr JobQueueDesc_t s_JobQueueDescs[] =
+{
+	{ "network",     eJobPriority::HIGH,   256,   eJobOverflow::REJECT,   0 },
+	{ "script_http", eJobPriority::NORMAL, 1024,  eJobOverflow::REJECT,   8 }, // Blocking transfers with up to a minute timeout
+	{ "filesystem",  eJobPriority::NORMAL, 1024,  eJobOverflow::COALESCE, 0 },
+	{ "mods",        eJobPriority::HIGH,   4096,  eJobOverflow::REJECT,   0 }
+};
+// clang-format on
+// Make sure eJobQueue and s_JobQueueDescs are of the same length
+static_assert(ARRAY_SIZE(s_JobQueueDescs) == static_cast<int>(eJobQueue::SIZE));
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+// Input  : nWorkers - Number of worker threads, 0 picks one based on core count
+//-----------------------------------------------------------------------------
+CJobSystem::CJobSystem(int nWorkers) : m_bShuttingDown(false)
+{
+	Init(nWorkers);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Destructor
+//-----------------------------------------------------------------------------
+CJobSystem::~CJobSystem()
+{
+	Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the worker threads
+// Input  : nWorkers - Number of shared worker threads, 0 picks one based on
+//                     core count. Queues with dedicated workers come on top
+//-----------------------------------------------------------------------------
+void CJobSystem::Init(int nWorkers)
+{
+	if (!m_vWorkers.empty())
+	{
+		return;
+	}
+
+	if (nWorkers <= 0)
+	{
+		// Leave a core for the game, most of our jobs are io bound anyway
+		nWorkers = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) - 1, 2, 8);
+	}
+
+	m_bShuttingDown = false;
+
+	for (int i = 0; i < nWorkers; i++)
+	{
+		m_vWorkers.emplace_back(&CJobSystem::Thread_Run, this, -1);
+	}
+
+	for (int i = 0; i < static_cast<int>(eJobQueue::SIZE); i++)
+	{
+		for (int j = 0; j < s_JobQueueDescs[i].nDedicatedWorkers; j++)
+		{
+			m_vWorkers.emplace_back(&CJobSystem::Thread_Run, this, i);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops accepting jobs, lets the workers finish everything that was
+//          already queued and joins them
+//-----------------------------------------------------------------------------
+void CJobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_Mutex);
+		m_bShuttingDown = true;
+	}
+
+	m_cvWork.notify_all();
+	for (JobQueue_t& queue : m_Queues)
+	{
+		queue.cvWork.notify_all();
+	}
+
+	for (std::thread& worker : m_vWorkers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	m_vWorkers.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a job
+// Input  : eQueue -
+//          fnJob -
+//          nCoalesceKey - Non zero key, a pending job with the same key in a
+//                         coalescing queue gets replaced by this one
+// Output : False if the job was rejected
+//-----------------------------------------------------------------------------
+bool CJobSystem::Submit(eJobQueue eQueue, std::function<void()> fnJob, uint64_t nCoalesceKey)
+{
+	const JobQueueDesc_t& desc = s_JobQueueDescs[static_cast<int>(eQueue)];
+
+	{
+		std::lock_guard<std::mutex> guard(m_Mutex);
+
+		JobQueue_t& queue = m_Queues[static_cast<int>(eQueue)];
+
+		if (m_bShuttingDown)
+		{
+			queue.stats.nRejected++;
+			return false;
+		}
+
+		bool bCoalesced = false;
+		if (nCoalesceKey && desc.eOverflow == eJobOverflow::COALESCE)
+		{
+			// The older job is superseded, drop it and queue the new one at the back so it runs after
+			// anything that was submitted in between
+			auto it = std::find_if(queue.dqJobs.begin(), queue.dqJobs.end(), [nCoalesceKey](const Job_t& job) { return job.nCoalesceKey == nCoalesceKey; });
+			if (it != queue.dqJobs.end())
+			{
+				queue.dqJobs.erase(it);
+				queue.nOutstanding--;
+				queue.stats.nCoalesced++;
+				bCoalesced = true;
+			}
+		}
+
+		if (!bCoalesced && queue.dqJobs.size() >= desc.nCapacity)
+		{
+			queue.stats.nRejected++;
+			return false;
+		}
+
+		queue.dqJobs.push_back({fnJob, nCoalesceKey, std::chrono::steady_clock::now()});
+		queue.nOutstanding++;
+		queue.stats.nSubmitted++;
+	}
+
+	if (desc.nDedicatedWorkers)
+	{
+		m_Queues[static_cast<int>(eQueue)].cvWork.notify_one();
+	}
+	else
+	{
+		m_cvWork.notify_one();
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Blocks until every job submitted to a queue has finished running
+// Input  : eQueue -
+//-----------------------------------------------------------------------------
+void CJobSystem::WaitForQueue(eJobQueue eQueue)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	JobQueue_t& queue = m_Queues[static_cast<int>(eQueue)];
+	m_cvIdle.wait(lock, [&queue]() { return queue.nOutstanding == 0; });
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns a copy of a queue's stats
+// Input  : eQueue -
+//-----------------------------------------------------------------------------
+JobQueueStats_t CJobSystem::GetStats(eJobQueue eQueue)
+{
+	std::lock_guard<std::mutex> guard(m_Mutex);
+
+	return m_Queues[static_cast<int>(eQueue)].stats;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Pops the oldest job of the highest priority non-empty queue,
+//          m_Mutex must be held
+// Input  : &job -
+//          &eQueue -
+//          nOwnQueue - Queue a dedicated worker serves, -1 for shared workers
+// Output : False if all queues are empty
+//-----------------------------------------------------------------------------
+bool CJobSystem::PopJob(Job_t& job, eJobQueue& eQueue, int nOwnQueue)
+{
+	if (nOwnQueue >= 0)
+	{
+		JobQueue_t& queue = m_Queues[nOwnQueue];
+		if (queue.dqJobs.empty())
+		{
+			return false;
+		}
+
+		job = std::move(queue.dqJobs.front());
+		queue.dqJobs.pop_front();
+		eQueue = static_cast<eJobQueue>(nOwnQueue);
+		return true;
+	}
+
+	for (int nPriority = static_cast<int>(eJobPriority::HIGH); nPriority <= static_cast<int>(eJobPriority::LOW); nPriority++)
+	{
+		for (int i = 0; i < static_cast<int>(eJobQueue::SIZE); i++)
+		{
+			if (static_cast<int>(s_JobQueueDescs[i].ePriority) != nPriority || s_JobQueueDescs[i].nDedicatedWorkers || m_Queues[i].dqJobs.empty())
+			{
+				continue;
+			}
+
+			job = std::move(m_Queues[i].dqJobs.front());
+			m_Queues[i].dqJobs.pop_front();
+			eQueue = static_cast<eJobQueue>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Worker thread
+// Input  : nOwnQueue - Queue this worker is dedicated to, -1 for shared
+//-----------------------------------------------------------------------------
+void CJobSystem::Thread_Run(int nOwnQueue)
+{
+	std::condition_variable& cvWork = nOwnQueue >= 0 ? m_Queues[nOwnQueue].cvWork : m_cvWork;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	while (true)
+	{
+		Job_t job;
+		eJobQueue eQueue;
+
+		if (!PopJob(job, eQueue, nOwnQueue))
+		{
+			// Only exit once everything queued before shutdown has run
+			if (m_bShuttingDown)
+			{
+				return;
+			}
+
+			cvWork.wait(lock);
+			continue;
+		}
+
+		JobQueue_t& queue = m_Queues[static_cast<int>(eQueue)];
+
+		double flWait = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.tSubmitTime).count();
+		queue.stats.flTotalWait += flWait;
+		queue.stats.flMaxWait = std::max(queue.stats.flMaxWait, flWait);
+
+		lock.unlock();
+
+		try
+		{
+			job.fnJob();
+		}
+		catch (const std::exception& ex)
+		{
+			Error(eLog::NS, NO_ERROR, "Job in queue '%s' threw: '%s'\n", s_JobQueueDescs[static_cast<int>(eQueue)].pszName, ex.what());
+		}
+
+		lock.lock();
+
+		queue.stats.nCompleted++;
+		if (--queue.nOutstanding == 0)
+		{
+			m_cvIdle.notify_all();
+		}
+	}
+}
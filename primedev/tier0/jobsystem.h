@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+//-----------------------------------------------------------------------------
+// Queues jobs can be submitted to, each has its own priority and capacity
+enum class eJobQueue : int
+{
+	NETWORK = 0, // Atlas connectionless packets
+	SCRIPT_HTTP = 1, // Script http requests
+	FILESYSTEM = 2, // Mod save files, audio sample prefetches
+	MODS = 3, // Reading mod directories in LoadMods
+
+	// Used for static_assert
+	SIZE = 4
+};
+
+//-----------------------------------------------------------------------------
+// Workers always pick from the highest priority non-empty queue
+enum class eJobPriority : int
+{
+	HIGH = 0,
+	NORMAL = 1,
+	LOW = 2
+};
+
+//-----------------------------------------------------------------------------
+// What to do when a job is submitted to a full queue
+enum class eJobOverflow : int
+{
+	REJECT = 0, // Submit fails
+	COALESCE = 1 // A pending job with the same key is always replaced, full or not, jobs without one are rejected
+};
+
+//-----------------------------------------------------------------------------
+//
+struct JobQueueDesc_t
+{
+	const char* pszName;
+	eJobPriority ePriority;
+	size_t nCapacity;
+	eJobOverflow eOverflow;
+
+	// Jobs that can block for a long time get their own workers so they can't
+	// starve the other queues, 0 runs on the shared workers
+	int nDedicatedWorkers;
+};
+
+//-----------------------------------------------------------------------------
+//
+struct JobQueueStats_t
+{
+	JobQueueStats_t() : nSubmitted(0), nCompleted(0), nRejected(0), nCoalesced(0), flMaxWait(0.0), flTotalWait(0.0) {}
+
+	uint64_t nSubmitted;
+	uint64_t nCompleted;
+	uint64_t nRejected;
+	uint64_t nCoalesced;
+
+	// Time jobs spent waiting in the queue, in seconds
+	double flMaxWait;
+	double flTotalWait;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Fixed size worker pool, replaces spawning a detached thread for
+//          every request
+//-----------------------------------------------------------------------------
+class CJobSystem
+{
+  public:
+	CJobSystem(int nWorkers = 0);
+	~CJobSystem();
+
+	void Init(int nWorkers);
+	void Shutdown();
+
+	bool Submit(eJobQueue eQueue, std::function<void()> fnJob, uint64_t nCoalesceKey = 0);
+	void WaitForQueue(eJobQueue eQueue);
+
+	JobQueueStats_t GetStats(eJobQueue eQueue);
+
+	int GetNumWorkers() const
+	{
+		return static_cast<int>(m_vWorkers.size());
+	}
+
+  private:
+	struct Job_t
+	{
+		std::function<void()> fnJob;
+		uint64_t nCoalesceKey;
+		std::chrono::steady_clock::time_point tSubmitTime;
+	};
+
+	struct JobQueue_t
+	{
+		std::deque<Job_t> dqJobs;
+		JobQueueStats_t stats;
+
+		// Jobs that were submitted but haven't finished running yet
+		size_t nOutstanding = 0;
+
+		// Wakes the dedicated workers, shared ones wait on m_cvWork
+		std::condition_variable cvWork;
+	};
+
+	void Thread_Run(int nOwnQueue);
+	bool PopJob(Job_t& job, eJobQueue& eQueue, int nOwnQueue);
+
+	std::vector<std::thread> m_vWorkers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_cvWork;
+	std::condition_variable m_cvIdle;
+
+	JobQueue_t m_Queues[static_cast<int>(eJobQueue::SIZE)];
+
+	bool m_bShuttingDown;
+};
+
+inline CJobSystem* g_pJobSystem = nullptr;
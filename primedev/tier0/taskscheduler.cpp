@@ -1,26 +1,162 @@
 #include "tier0/taskscheduler.h"
 
 //-----------------------------------------------------------------------------
-// Purpose: Adds a task to the pool
+// Purpose: Constructor
 //-----------------------------------------------------------------------------
-void CTaskScheduler::AddTask(std::function<void()> fnTask)
+CTaskScheduler::CTaskScheduler()
+	: m_pPool(std::make_unique<TaskNode_t[]>(POOL_SIZE)), m_nFreeHead(0), m_pIncoming(nullptr), m_pPendingHead(nullptr), m_pPendingTail(nullptr), m_flFrameBudget(0.0), m_nPending(0)
 {
-	std::lock_guard<std::mutex> Guard(m_Mutex);
+	for (uint32_t i = 0; i < POOL_SIZE; i++)
+	{
+		m_pPool[i].nNextFree.store(i + 1 < POOL_SIZE ? i + 1 : INVALID_INDEX, std::memory_order_relaxed);
+	}
+}
 
-	m_vTaskPool.push_back(fnTask);
+//-----------------------------------------------------------------------------
+// Purpose: Destructor, frees tasks that never ran
+//-----------------------------------------------------------------------------
+CTaskScheduler::~CTaskScheduler()
+{
+	TaskNode_t* pNode = m_pIncoming.exchange(nullptr, std::memory_order_acquire);
+	while (pNode)
+	{
+		TaskNode_t* pNext = pNode->pNext;
+		FreeNode(pNode);
+		pNode = pNext;
+	}
+
+	pNode = m_pPendingHead;
+	while (pNode)
+	{
+		TaskNode_t* pNext = pNode->pNext;
+		FreeNode(pNode);
+		pNode = pNext;
+	}
 }
 
 //-----------------------------------------------------------------------------
-// Purpose: Runs all tasks for this frame
+// Purpose: Takes a node from the pool, or the heap if the pool is empty.
+//          Safe to call from any thread
+//-----------------------------------------------------------------------------
+CTaskScheduler::TaskNode_t* CTaskScheduler::AllocNode()
+{
+	uint64_t nHead = m_nFreeHead.load(std::memory_order_acquire);
+	while (true)
+	{
+		uint32_t nIndex = static_cast<uint32_t>(nHead);
+		if (nIndex == INVALID_INDEX)
+			return new TaskNode_t();
+
+		// May be stale if another producer popped this node first, the tag makes the exchange fail then
+		uint32_t nNext = m_pPool[nIndex].nNextFree.load(std::memory_order_relaxed);
+		uint64_t nNewHead = (((nHead >> 32) + 1) << 32) | nNext;
+
+		if (m_nFreeHead.compare_exchange_weak(nHead, nNewHead, std::memory_order_acquire, std::memory_order_acquire))
+			return &m_pPool[nIndex];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Destroys a node's task and returns the node to the pool
+// Input  : *pNode -
+//-----------------------------------------------------------------------------
+void CTaskScheduler::FreeNode(TaskNode_t* pNode)
+{
+	if (pNode < m_pPool.get() || pNode >= m_pPool.get() + POOL_SIZE)
+	{
+		delete pNode;
+		return;
+	}
+
+	pNode->fnTask.Reset();
+	pNode->pNext = nullptr;
+
+	uint32_t nIndex = static_cast<uint32_t>(pNode - m_pPool.get());
+	uint64_t nHead = m_nFreeHead.load(std::memory_order_relaxed);
+	uint64_t nNewHead;
+	do
+	{
+		pNode->nNextFree.store(static_cast<uint32_t>(nHead), std::memory_order_relaxed);
+		nNewHead = (nHead & 0xFFFFFFFF00000000ull) | nIndex;
+	} while (!m_nFreeHead.compare_exchange_weak(nHead, nNewHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a task to the pool, safe to call from any thread
+// Input  : *pNode -
+//-----------------------------------------------------------------------------
+void CTaskScheduler::PushTask(TaskNode_t* pNode)
+{
+	TaskNode_t* pHead = m_pIncoming.load(std::memory_order_relaxed);
+	do
+	{
+		pNode->pNext = pHead;
+	} while (!m_pIncoming.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs tasks for this frame, tasks that don't fit into the frame
+//          budget run next frame
 //-----------------------------------------------------------------------------
 void CTaskScheduler::RunFrame()
 {
-	std::lock_guard<std::mutex> Guard(m_Mutex);
+	// Take everything that was queued since the last frame in one go
+	TaskNode_t* pIncoming = m_pIncoming.exchange(nullptr, std::memory_order_acquire);
+
+	// The stack is newest first, reverse it so tasks run in the order they were added
+	TaskNode_t* pReversed = nullptr;
+	TaskNode_t* pReversedTail = pIncoming;
+	while (pIncoming)
+	{
+		TaskNode_t* pNext = pIncoming->pNext;
+		pIncoming->pNext = pReversed;
+		pReversed = pIncoming;
+		pIncoming = pNext;
+
+		m_nPending++;
+	}
 
-	for (std::function<void()> fnTask : m_vTaskPool)
+	// Append after anything carried over from last frame
+	if (pReversed)
 	{
-		fnTask();
+		if (m_pPendingTail)
+			m_pPendingTail->pNext = pReversed;
+		else
+			m_pPendingHead = pReversed;
+
+		m_pPendingTail = pReversedTail;
 	}
 
-	m_vTaskPool.clear();
+	std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+	// Always run at least one task so we make progress even with a tiny budget
+	bool bRanTask = false;
+	while (m_pPendingHead)
+	{
+		if (bRanTask && m_flFrameBudget > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count() >= m_flFrameBudget)
+		{
+			break;
+		}
+
+		TaskNode_t* pNode = m_pPendingHead;
+		m_pPendingHead = pNode->pNext;
+		if (!m_pPendingHead)
+			m_pPendingTail = nullptr;
+
+		m_nPending--;
+
+		// The node is already off the list, hand it back even if the task throws
+		try
+		{
+			pNode->fnTask();
+		}
+		catch (const std::exception& ex)
+		{
+			Error(eLog::NS, NO_ERROR, "Queued task threw: %s\n", ex.what());
+		}
+
+		FreeNode(pNode);
+
+		bRanTask = true;
+	}
 }
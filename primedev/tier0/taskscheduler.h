@@ -1,13 +1,194 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+//-----------------------------------------------------------------------------
+// Purpose: Move-only callable, captures that fit into the inline buffer don't
+//          get heap allocated
+//-----------------------------------------------------------------------------
+class CTaskFn
+{
+  public:
+	static constexpr size_t INLINE_SIZE = 96;
+
+	CTaskFn() : m_pOps(nullptr) {}
+
+	template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, CTaskFn>>> CTaskFn(Fn&& fn)
+	{
+		using Functor = std::decay_t<Fn>;
+
+		if constexpr (sizeof(Functor) <= INLINE_SIZE && alignof(Functor) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Functor>)
+		{
+			new (m_Storage) Functor(std::forward<Fn>(fn));
+			m_pOps = &s_InlineOps<Functor>;
+		}
+		else
+		{
+			*reinterpret_cast<Functor**>(m_Storage) = new Functor(std::forward<Fn>(fn));
+			m_pOps = &s_HeapOps<Functor>;
+		}
+	}
+
+	CTaskFn(CTaskFn&& other) noexcept : m_pOps(other.m_pOps)
+	{
+		if (m_pOps)
+		{
+			m_pOps->pfnMove(m_Storage, other.m_Storage);
+			other.m_pOps = nullptr;
+		}
+	}
+
+	CTaskFn& operator=(CTaskFn&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+
+			m_pOps = other.m_pOps;
+			if (m_pOps)
+			{
+				m_pOps->pfnMove(m_Storage, other.m_Storage);
+				other.m_pOps = nullptr;
+			}
+		}
+
+		return *this;
+	}
+
+	CTaskFn(const CTaskFn&) = delete;
+	CTaskFn& operator=(const CTaskFn&) = delete;
+
+	~CTaskFn()
+	{
+		Reset();
+	}
+
+	void operator()()
+	{
+		m_pOps->pfnInvoke(m_Storage);
+	}
+
+	explicit operator bool() const
+	{
+		return m_pOps != nullptr;
+	}
+
+	void Reset()
+	{
+		if (m_pOps)
+		{
+			m_pOps->pfnDestroy(m_Storage);
+			m_pOps = nullptr;
+		}
+	}
+
+  private:
+	struct Ops_t
+	{
+		void (*pfnInvoke)(void* pStorage);
+		void (*pfnMove)(void* pDst, void* pSrc);
+		void (*pfnDestroy)(void* pStorage);
+	};
+
+	template <typename Functor> static constexpr Ops_t s_InlineOps = {
+		[](void* pStorage) { (*static_cast<Functor*>(pStorage))(); },
+		[](void* pDst, void* pSrc)
+		{
+			new (pDst) Functor(std::move(*static_cast<Functor*>(pSrc)));
+			static_cast<Functor*>(pSrc)->~Functor();
+		},
+		[](void* pStorage) { static_cast<Functor*>(pStorage)->~Functor(); }};
+
+	template <typename Functor> static constexpr Ops_t s_HeapOps = {
+		[](void* pStorage) { (**static_cast<Functor**>(pStorage))(); },
+		[](void* pDst, void* pSrc) { *static_cast<Functor**>(pDst) = *static_cast<Functor**>(pSrc); },
+		[](void* pStorage) { delete *static_cast<Functor**>(pStorage); }};
+
+	alignas(std::max_align_t) unsigned char m_Storage[INLINE_SIZE];
+	const Ops_t* m_pOps;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs tasks queued from any thread on the game thread
+// Note   : Producers push onto an intrusive lock-free stack, RunFrame takes
+//          the whole stack with a single exchange so AddTask never waits on
+//          tasks that are currently running. Nodes come from a fixed pool,
+//          only once that runs dry does AddTask allocate
+//-----------------------------------------------------------------------------
 class CTaskScheduler
 {
   public:
-	void AddTask(std::function<void()> fnTask);
+	CTaskScheduler();
+	~CTaskScheduler();
+
+	template <typename Fn> void AddTask(Fn&& fnTask)
+	{
+		TaskNode_t* pNode = AllocNode();
+		pNode->fnTask = CTaskFn(std::forward<Fn>(fnTask));
+
+		PushTask(pNode);
+	}
+
 	void RunFrame();
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Max time in seconds RunFrame may spend running tasks, tasks that
+	//          didn't fit carry over to the next frame. 0 means no limit
+	//-----------------------------------------------------------------------------
+	void SetFrameBudget(double flBudget)
+	{
+		m_flFrameBudget = flBudget;
+	}
+
+	double GetFrameBudget() const
+	{
+		return m_flFrameBudget;
+	}
+
+	// Number of tasks RunFrame had to carry over to the next frame
+	size_t GetNumCarriedOver() const
+	{
+		return m_nPending;
+	}
+
   private:
-	std::mutex m_Mutex;
-	std::vector<std::function<void()>> m_vTaskPool;
+	static constexpr uint32_t POOL_SIZE = 1024;
+	static constexpr uint32_t INVALID_INDEX = ~0u;
+
+	struct TaskNode_t
+	{
+		TaskNode_t() : pNext(nullptr), nNextFree(INVALID_INDEX) {}
+
+		CTaskFn fnTask;
+		TaskNode_t* pNext;
+		// Next node in the pool's free list, read by producers racing for the head
+		std::atomic<uint32_t> nNextFree;
+	};
+
+	TaskNode_t* AllocNode();
+	void FreeNode(TaskNode_t* pNode);
+	void PushTask(TaskNode_t* pNode);
+
+	std::unique_ptr<TaskNode_t[]> m_pPool;
+	// Pool index of the first free node in the low 32 bits, bumped on every
+	// pop in the high 32 bits so a stale head can't be swapped back in
+	std::atomic<uint64_t> m_nFreeHead;
+
+	// Newest first, written by producers
+	std::atomic<TaskNode_t*> m_pIncoming;
+
+	// Oldest first, only touched by RunFrame
+	TaskNode_t* m_pPendingHead;
+	TaskNode_t* m_pPendingTail;
+
+	double m_flFrameBudget;
+	size_t m_nPending;
 };
 
 inline CTaskScheduler* g_pTaskScheduler = nullptr;
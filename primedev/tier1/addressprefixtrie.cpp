@@ -0,0 +1,130 @@
+#include "tier1/addressprefixtrie.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+// First 12 bytes of an IPv4-mapped IPv6 address ( ::ffff:a.b.c.d )
+static const uint8_t s_V4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CAddressPrefixTrie::CAddressPrefixTrie()
+{
+	// Root, child index 0 means no child since nothing can point back at the root
+	m_vNodes.push_back({{0, 0}, false});
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a prefix
+// Input  : *pszCidr - "10.0.0.0/8", "fc00::/7" or a single address
+// Output : false if it couldn't be parsed
+//-----------------------------------------------------------------------------
+bool CAddressPrefixTrie::Insert(const char* pszCidr)
+{
+	char szAddress[64];
+	const char* pszSlash = strchr(pszCidr, '/');
+	size_t nLength = pszSlash ? static_cast<size_t>(pszSlash - pszCidr) : strlen(pszCidr);
+	if (nLength >= sizeof(szAddress))
+		return false;
+
+	memcpy(szAddress, pszCidr, nLength);
+	szAddress[nLength] = '\0';
+
+	uint8_t address[16];
+	if (!ParseAddress(szAddress, address))
+		return false;
+
+	bool bIPv4 = strchr(szAddress, ':') == nullptr;
+	int nMaxLength = bIPv4 ? 32 : 128;
+	int nPrefixLength = nMaxLength;
+
+	if (pszSlash)
+	{
+		char* pszEnd = nullptr;
+		long nParsed = strtol(pszSlash + 1, &pszEnd, 10);
+		if (pszEnd == pszSlash + 1 || *pszEnd || nParsed < 0 || nParsed > nMaxLength)
+			return false;
+
+		nPrefixLength = static_cast<int>(nParsed);
+	}
+
+	// v4 prefixes sit below the mapped prefix
+	Insert(address, bIPv4 ? nPrefixLength + 96 : nPrefixLength);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds a prefix
+// Input  : &address - IPv6 or IPv4-mapped
+//          nPrefixLength - In bits, 0 to 128
+//-----------------------------------------------------------------------------
+void CAddressPrefixTrie::Insert(const uint8_t (&address)[16], int nPrefixLength)
+{
+	uint32_t nNode = 0;
+	for (int i = 0; i < nPrefixLength; i++)
+	{
+		// Already covered by a shorter prefix
+		if (m_vNodes[nNode].bTerminal)
+			return;
+
+		int nBit = (address[i / 8] >> (7 - i % 8)) & 1;
+		if (!m_vNodes[nNode].nChildren[nBit])
+		{
+			m_vNodes[nNode].nChildren[nBit] = static_cast<uint32_t>(m_vNodes.size());
+			m_vNodes.push_back({{0, 0}, false});
+		}
+
+		nNode = m_vNodes[nNode].nChildren[nBit];
+	}
+
+	// Longer prefixes below this one are redundant now, they stay in the
+	// vector but nothing walks past a terminal node
+	m_vNodes[nNode].bTerminal = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if any prefix covers an address
+// Input  : &address - IPv6 or IPv4-mapped
+//-----------------------------------------------------------------------------
+bool CAddressPrefixTrie::Contains(const uint8_t (&address)[16]) const
+{
+	uint32_t nNode = 0;
+	for (int i = 0; i < 128; i++)
+	{
+		if (m_vNodes[nNode].bTerminal)
+			return true;
+
+		nNode = m_vNodes[nNode].nChildren[(address[i / 8] >> (7 - i % 8)) & 1];
+		if (!nNode)
+			return false;
+	}
+
+	return m_vNodes[nNode].bTerminal;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Parses an IPv4 or IPv6 address, IPv4 comes out IPv4-mapped
+// Input  : *pszAddress -
+//          &address -
+//-----------------------------------------------------------------------------
+bool CAddressPrefixTrie::ParseAddress(const char* pszAddress, uint8_t (&address)[16])
+{
+	if (inet_pton(AF_INET6, pszAddress, address) == 1)
+		return true;
+
+	if (inet_pton(AF_INET, pszAddress, address + 12) == 1)
+	{
+		memcpy(address, s_V4MappedPrefix, sizeof(s_V4MappedPrefix));
+		return true;
+	}
+
+	return false;
+}
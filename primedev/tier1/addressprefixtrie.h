@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Set of IPv4 and IPv6 CIDR prefixes
+// Note   : Binary trie over the 128 bits of an IPv6 address, IPv4 is stored
+//          IPv4-mapped ( ::ffff:a.b.c.d ) so both share one trie and a v4
+//          rule also covers the mapped form of the address
+//-----------------------------------------------------------------------------
+class CAddressPrefixTrie
+{
+  public:
+	CAddressPrefixTrie();
+
+	bool Insert(const char* pszCidr);
+	void Insert(const uint8_t (&address)[16], int nPrefixLength);
+
+	bool Contains(const uint8_t (&address)[16]) const;
+
+	static bool ParseAddress(const char* pszAddress, uint8_t (&address)[16]);
+
+  private:
+	struct Node_t
+	{
+		uint32_t nChildren[2];
+		// A prefix ends here, everything below is covered
+		bool bTerminal;
+	};
+
+	std::vector<Node_t> m_vNodes;
+};
@@ -1,3 +1,6 @@
+#include "tier1/lzss.h"
+
+#include <cstring>
 
 static constexpr int LZSS_LOOKSHIFT = 4;
 
@@ -7,38 +10,60 @@ struct lzss_header_t
 	unsigned int actualSize;
 };
 
-// Rewrite of CLZSS::SafeUncompress to fix a vulnerability where malicious compressed payloads could cause the decompressor to try to read
-// out of the bounds of the output buffer.
-
-unsigned int (*o_CLZSS__SafeDecompress)(void* self, const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize);
-
-unsigned int h_CLZSS__SafeDecompress(void* self, const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize)
+//-----------------------------------------------------------------------------
+// Purpose: Rewrite of CLZSS::SafeUncompress to fix a vulnerability where
+//          malicious compressed payloads could cause the decompressor to try
+//          to read out of the bounds of the output buffer
+// Input  : *pInput - Header followed by the compressed stream
+//          *pOutput -
+//          unBufSize - Size of pOutput
+// Output : Decompressed size, 0 if the stream is malformed
+//-----------------------------------------------------------------------------
+unsigned int LZSS_SafeDecompress(const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize)
 {
-	NOTE_UNUSED(self);
 	unsigned int totalBytes = 0;
 	int getCmdByte = 0;
 	int cmdByte = 0;
 
-	lzss_header_t header = *(lzss_header_t*)pInput;
+	if (!pInput)
+		return 0;
+
+	lzss_header_t header;
+	memcpy(&header, pInput, sizeof(header));
 
-	if (!pInput || !header.actualSize || header.id != 0x53535A4C || header.actualSize > unBufSize)
+	if (!header.actualSize || header.id != LZSS_ID || header.actualSize > unBufSize)
 		return 0;
 
+	// Anything past actualSize fails the size check at the end anyway, so it's what we bound writes by
+	const unsigned int unOutputSize = header.actualSize;
+
 	pInput += sizeof(lzss_header_t);
 
 	for (;;)
 	{
 		if (!getCmdByte)
+		{
 			cmdByte = *pInput++;
 
+			// 8 literals in a row, very common for data that doesn't compress well
+			if (!cmdByte && totalBytes + 8 <= unOutputSize)
+			{
+				memcpy(pOutput, pInput, 8);
+				pOutput += 8;
+				pInput += 8;
+				totalBytes += 8;
+				continue;
+			}
+		}
+
 		getCmdByte = (getCmdByte + 1) & 0x07;
 
 		if (cmdByte & 0x01)
 		{
-			int position = *pInput++ << LZSS_LOOKSHIFT;
+			unsigned int position = *pInput++ << LZSS_LOOKSHIFT;
 			position |= (*pInput >> LZSS_LOOKSHIFT);
 			position += 1;
-			int count = (*pInput++ & 0x0F) + 1;
+			unsigned int count = (*pInput++ & 0x0F) + 1;
 			if (count == 1)
 				break;
 
@@ -46,18 +71,31 @@ unsigned int h_CLZSS__SafeDecompress(void* self, const unsigned char* pInput, un
 			if (position > totalBytes)
 				return 0;
 
-			totalBytes += count;
-			if (totalBytes > unBufSize)
+			if (totalBytes + count > unOutputSize)
 				return 0;
 
 			unsigned char* pSource = pOutput - position;
-			for (int i = 0; i < count; i++)
-				*pOutput++ = *pSource++;
+
+			// Matches are at most 16 bytes, if the source is at least 8 bytes back each 8 byte chunk only reads bytes
+			// that were written before it. Only done with room for all 16 bytes so the tail of the buffer is never overrun
+			if (position >= 8 && totalBytes + 16 <= unOutputSize)
+			{
+				memcpy(pOutput, pSource, 8);
+				memcpy(pOutput + 8, pSource + 8, 8);
+				pOutput += count;
+			}
+			else
+			{
+				for (unsigned int i = 0; i < count; i++)
+					*pOutput++ = *pSource++;
+			}
+
+			totalBytes += count;
 		}
 		else
 		{
 			totalBytes++;
-			if (totalBytes > unBufSize)
+			if (totalBytes > unOutputSize)
 				return 0;
 
 			*pOutput++ = *pInput++;
@@ -70,9 +108,3 @@ unsigned int h_CLZSS__SafeDecompress(void* self, const unsigned char* pInput, un
 
 	return totalBytes;
 }
-
-ON_DLL_LOAD("engine.dll", ExploitFixes_LZSS, (CModule module))
-{
-	o_CLZSS__SafeDecompress = module.Offset(0x432A10).RCast<unsigned int (*)(void*, const unsigned char*, unsigned char*, unsigned int)>();
-	HookAttach(&(PVOID&)o_CLZSS__SafeDecompress, (PVOID)h_CLZSS__SafeDecompress);
-}
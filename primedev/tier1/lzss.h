@@ -0,0 +1,5 @@
+#pragma once
+
+constexpr unsigned int LZSS_ID = 0x53535A4C; // 'LZSS'
+
+unsigned int LZSS_SafeDecompress(const unsigned char* pInput, unsigned char* pOutput, unsigned int unBufSize);
@@ -0,0 +1,190 @@
+#include "tier1/ratelimiter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+// First 12 bytes of an IPv4-mapped IPv6 address ( ::ffff:a.b.c.d )
+static const uint8_t s_V4MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes a 16 byte key
+// Input  : &nKey -
+//          nSeed -
+//-----------------------------------------------------------------------------
+static uint64_t HashKey(const uint64_t (&nKey)[2], uint64_t nSeed)
+{
+	uint64_t h = nSeed ^ (nKey[0] * 0x9E3779B97F4A7C15ull);
+	h ^= nKey[1] + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+
+	// splitmix64 finalizer
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBull;
+	h ^= h >> 31;
+
+	return h;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+// Input  : nAddressSets - Number of sets for single addresses, power of two
+//          nSubnetSets - Number of sets for subnets, power of two
+//-----------------------------------------------------------------------------
+CAddressRateLimiter::CAddressRateLimiter(size_t nAddressSets, size_t nSubnetSets)
+{
+	std::random_device rd;
+	m_nSeed = (static_cast<uint64_t>(rd()) << 32) | rd();
+
+	InitTable(m_AddressTable, nAddressSets);
+	InitTable(m_SubnetTable, nSubnetSets);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Allocates a table, all entries start out unused
+// Input  : &table -
+//          nSets -
+//-----------------------------------------------------------------------------
+void CAddressRateLimiter::InitTable(Table_t& table, size_t nSets)
+{
+	// Round up to a power of two so we can mask instead of mod
+	size_t nPow2 = 1;
+	while (nPow2 < nSets)
+		nPow2 <<= 1;
+
+	table.vEntries.assign(nPow2 * SET_SIZE, Entry_t {});
+	table.vHands.assign(nPow2, 0);
+	table.nSetMask = nPow2 - 1;
+	table.nEvictions = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Forgets every address
+//-----------------------------------------------------------------------------
+void CAddressRateLimiter::Clear()
+{
+	InitTable(m_AddressTable, m_AddressTable.vHands.size());
+	InitTable(m_SubnetTable, m_SubnetTable.vHands.size());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds the entry for a key, creating it with a full bucket if it
+//          doesn't exist yet
+// Input  : &table -
+//          &nKey -
+//          flTime -
+//          flBurst -
+//-----------------------------------------------------------------------------
+CAddressRateLimiter::Entry_t* CAddressRateLimiter::FindOrInsert(Table_t& table, const uint64_t (&nKey)[2], double flTime, float flBurst)
+{
+	size_t nSet = HashKey(nKey, m_nSeed) & table.nSetMask;
+	Entry_t* pSet = &table.vEntries[nSet * SET_SIZE];
+
+	Entry_t* pFree = nullptr;
+	for (int i = 0; i < SET_SIZE; i++)
+	{
+		Entry_t* pEntry = &pSet[i];
+		if (!pEntry->bUsed)
+		{
+			if (!pFree)
+				pFree = pEntry;
+
+			continue;
+		}
+
+		if (pEntry->nKey[0] == nKey[0] && pEntry->nKey[1] == nKey[1])
+		{
+			pEntry->bReferenced = true;
+			return pEntry;
+		}
+	}
+
+	if (!pFree)
+	{
+		// Set is full, sweep the hand past recently used entries and take the first one that
+		// wasn't touched since the last sweep. New entries start unreferenced so a flood of
+		// one-off addresses only ever evicts itself
+		uint8_t& nHand = table.vHands[nSet];
+		while (pSet[nHand].bReferenced)
+		{
+			pSet[nHand].bReferenced = false;
+			nHand = (nHand + 1) & (SET_SIZE - 1);
+		}
+
+		pFree = &pSet[nHand];
+		nHand = (nHand + 1) & (SET_SIZE - 1);
+
+		table.nEvictions++;
+	}
+
+	pFree->nKey[0] = nKey[0];
+	pFree->nKey[1] = nKey[1];
+	pFree->flLastUpdate = flTime;
+	pFree->flBlockedUntil = -1.0;
+	pFree->flTokens = flBurst;
+	pFree->bUsed = true;
+	pFree->bReferenced = false;
+
+	return pFree;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Refills a bucket for the time that passed and takes a token
+// Input  : *pEntry -
+//          flTime -
+//          flRate -
+//          flBurst -
+// Output : False if the bucket is empty
+//-----------------------------------------------------------------------------
+bool CAddressRateLimiter::TakeToken(Entry_t* pEntry, double flTime, float flRate, float flBurst)
+{
+	double flElapsed = std::max(0.0, flTime - pEntry->flLastUpdate);
+	pEntry->flTokens = static_cast<float>(std::min<double>(flBurst, pEntry->flTokens + flElapsed * flRate));
+	pEntry->flLastUpdate = flTime;
+
+	if (pEntry->flTokens < 1.0f)
+		return false;
+
+	pEntry->flTokens -= 1.0f;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks if a packet from an address should be processed
+// Input  : *pAddress - 16 byte IPv6 or IPv4-mapped address
+//          flTime - Current time in seconds
+//          &params -
+//-----------------------------------------------------------------------------
+eRateLimit CAddressRateLimiter::Check(const uint8_t* pAddress, double flTime, const RateLimitParams_t& params)
+{
+	uint64_t nAddressKey[2];
+	memcpy(nAddressKey, pAddress, sizeof(nAddressKey));
+
+	Entry_t* pEntry = FindOrInsert(m_AddressTable, nAddressKey, flTime, params.flBurst);
+
+	if (flTime < pEntry->flBlockedUntil)
+		return eRateLimit::BLOCKED;
+
+	if (!TakeToken(pEntry, flTime, params.flRate, params.flBurst))
+	{
+		pEntry->flBlockedUntil = flTime + params.flPenalty;
+		return eRateLimit::LIMITED;
+	}
+
+	// Aggregate on /24 for IPv4 and /64 for IPv6
+	uint8_t subnet[16] = {};
+	if (!memcmp(pAddress, s_V4MappedPrefix, sizeof(s_V4MappedPrefix)))
+		memcpy(subnet, pAddress, 15);
+	else
+		memcpy(subnet, pAddress, 8);
+
+	uint64_t nSubnetKey[2];
+	memcpy(nSubnetKey, subnet, sizeof(nSubnetKey));
+
+	Entry_t* pSubnet = FindOrInsert(m_SubnetTable, nSubnetKey, flTime, params.flSubnetBurst);
+	if (!TakeToken(pSubnet, flTime, params.flSubnetRate, params.flSubnetBurst))
+		return eRateLimit::SUBNET_LIMITED;
+
+	return eRateLimit::ALLOWED;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Limits for CAddressRateLimiter, rates are in tokens per second
+struct RateLimitParams_t
+{
+	float flRate;
+	float flBurst;
+
+	// Shared by every address in the same /24 (IPv4) or /64 (IPv6)
+	float flSubnetRate;
+	float flSubnetBurst;
+
+	// How long an address that ran out of tokens stays blocked, in seconds
+	double flPenalty;
+};
+
+//-----------------------------------------------------------------------------
+// Result of CAddressRateLimiter::Check
+enum class eRateLimit : int
+{
+	ALLOWED = 0,
+	LIMITED = 1, // Address just ran out of tokens, it's blocked from now on
+	BLOCKED = 2, // Address is still serving its penalty
+	SUBNET_LIMITED = 3 // Address is fine but its subnet ran out of tokens
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Per source address token buckets with subnet aggregates
+// Note   : Entries live in fixed size sets, an address hashes to one set and
+//          a full set evicts with a clock hand, so memory use and lookup cost
+//          don't grow when someone floods us from spoofed addresses
+//-----------------------------------------------------------------------------
+class CAddressRateLimiter
+{
+  public:
+	// Number of entries in each set, must be a power of two
+	static constexpr int SET_SIZE = 8;
+
+	CAddressRateLimiter(size_t nAddressSets = 8192, size_t nSubnetSets = 2048);
+
+	eRateLimit Check(const uint8_t* pAddress, double flTime, const RateLimitParams_t& params);
+	void Clear();
+
+	uint64_t GetNumEvictions() const
+	{
+		return m_AddressTable.nEvictions + m_SubnetTable.nEvictions;
+	}
+
+  private:
+	struct Entry_t
+	{
+		uint64_t nKey[2];
+		double flLastUpdate;
+		double flBlockedUntil;
+		float flTokens;
+		bool bUsed;
+		bool bReferenced;
+	};
+
+	struct Table_t
+	{
+		std::vector<Entry_t> vEntries;
+		std::vector<uint8_t> vHands;
+		size_t nSetMask;
+		uint64_t nEvictions;
+	};
+
+	static void InitTable(Table_t& table, size_t nSets);
+	Entry_t* FindOrInsert(Table_t& table, const uint64_t (&nKey)[2], double flTime, float flBurst);
+	static bool TakeToken(Entry_t* pEntry, double flTime, float flRate, float flBurst);
+
+	Table_t m_AddressTable;
+	Table_t m_SubnetTable;
+
+	// Random per instance so nobody can pick addresses that all land in one set
+	uint64_t m_nSeed;
+};
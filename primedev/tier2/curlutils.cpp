@@ -28,20 +28,32 @@ CURL* CURLInitRequest(const char* pszUrl, const char* pszRequest, std::string& s
 
 	if (pMime)
 	{
-		curl_mime* mime = curl_mime_init(curl);
-		curl_mimepart* part = curl_mime_addpart(mime);
-
-		curl_mime_data(part, pMime->svData.c_str(), pMime->svData.size());
-		curl_mime_name(part, pMime->svName.c_str());
-		curl_mime_filename(part, pMime->svFileName.c_str());
-		curl_mime_type(part, pMime->svType.c_str());
-
-		curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
+		CURLInitMime(curl, pMime);
 	}
 
 	return curl;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Attaches a single part mime post to a request
+// Output : The mime handle, caller is responsible for freeing it after the
+//          transfer finished
+//-----------------------------------------------------------------------------
+curl_mime* CURLInitMime(CURL* curl, CURLMime* pMime)
+{
+	curl_mime* mime = curl_mime_init(curl);
+	curl_mimepart* part = curl_mime_addpart(mime);
+
+	curl_mime_data(part, pMime->svData.c_str(), pMime->svData.size());
+	curl_mime_name(part, pMime->svName.c_str());
+	curl_mime_filename(part, pMime->svFileName.c_str());
+	curl_mime_type(part, pMime->svType.c_str());
+
+	curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
+
+	return mime;
+}
+
 CURLcode CURLSubmitRequest(CURL* curl)
 {
 	return curl_easy_perform(curl);
@@ -0,0 +1,231 @@
+#include "tier2/httpclient.h"
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+//-----------------------------------------------------------------------------
+CHttpClient::CHttpClient() : m_pMulti(nullptr), m_pShare(nullptr), m_bRunning(false), m_nActiveTransfers(0), m_nNewConnections(0), m_nCompletedTransfers(0)
+{
+	Init();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Destructor
+//-----------------------------------------------------------------------------
+CHttpClient::~CHttpClient()
+{
+	Shutdown();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the multi and share handles and starts the io thread
+//-----------------------------------------------------------------------------
+void CHttpClient::Init()
+{
+	if (m_bRunning)
+	{
+		return;
+	}
+
+	m_pShare = curl_share_init();
+	curl_share_setopt(m_pShare, CURLSHOPT_LOCKFUNC, ShareLock);
+	curl_share_setopt(m_pShare, CURLSHOPT_UNLOCKFUNC, ShareUnlock);
+	curl_share_setopt(m_pShare, CURLSHOPT_USERDATA, this);
+	curl_share_setopt(m_pShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(m_pShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	curl_share_setopt(m_pShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+	m_pMulti = curl_multi_init();
+	// Multiplex over HTTP/2 when atlas supports it, otherwise keep connections alive
+	curl_multi_setopt(m_pMulti, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(m_pMulti, CURLMOPT_MAX_HOST_CONNECTIONS, 8L);
+
+	m_bRunning = true;
+	m_Thread = std::thread(&CHttpClient::Thread_Run, this);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the io thread, fails all unfinished transfers and frees
+//          the handles
+//-----------------------------------------------------------------------------
+void CHttpClient::Shutdown()
+{
+	if (!m_bRunning)
+	{
+		return;
+	}
+
+	m_bRunning = false;
+	curl_multi_wakeup(m_pMulti);
+
+	if (m_Thread.joinable())
+	{
+		m_Thread.join();
+	}
+
+	// Anything still in flight or pending never finishes, let the callers know
+	Thread_AddPending();
+
+	for (Transfer_t* pTransfer : m_vActive)
+	{
+		curl_multi_remove_handle(m_pMulti, pTransfer->pCurl);
+
+		pTransfer->result.nResult = CURLE_ABORTED_BY_CALLBACK;
+		pTransfer->fnCallback(pTransfer->result);
+
+		curl_easy_cleanup(pTransfer->pCurl);
+		curl_mime_free(pTransfer->pMime);
+		delete pTransfer;
+	}
+	m_vActive.clear();
+
+	curl_multi_cleanup(m_pMulti);
+	curl_share_cleanup(m_pShare);
+
+	m_pMulti = nullptr;
+	m_pShare = nullptr;
+	m_nActiveTransfers = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a request, fnCallback is invoked on the io thread
+// Input  : *pszUrl -
+//          *pszRequest - GET, POST, ...
+//          &parms -
+//          *pMime - Optional, data is copied
+//          fnCallback -
+//-----------------------------------------------------------------------------
+void CHttpClient::SubmitRequest(const char* pszUrl, const char* pszRequest, CURLParms& parms, CURLMime* pMime, HttpCallbackFn fnCallback)
+{
+	Transfer_t* pTransfer = new Transfer_t;
+	pTransfer->fnCallback = fnCallback;
+	pTransfer->pMime = nullptr;
+
+	// Responses are always read into a string
+	parms.pWriteFunc = CURLWriteStringCallback;
+
+	pTransfer->pCurl = CURLInitRequest(pszUrl, pszRequest, pTransfer->result.svResponse, parms);
+	if (pMime)
+	{
+		pTransfer->pMime = CURLInitMime(pTransfer->pCurl, pMime);
+	}
+
+	curl_easy_setopt(pTransfer->pCurl, CURLOPT_SHARE, m_pShare);
+	curl_easy_setopt(pTransfer->pCurl, CURLOPT_PRIVATE, pTransfer);
+	curl_easy_setopt(pTransfer->pCurl, CURLOPT_NOSIGNAL, 1L);
+
+	{
+		std::lock_guard<std::mutex> guard(m_PendingMutex);
+		m_vPending.push_back(pTransfer);
+	}
+
+	m_nActiveTransfers++;
+	curl_multi_wakeup(m_pMulti);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues a request
+// Output : Future that becomes ready once the transfer finished
+//-----------------------------------------------------------------------------
+std::future<HttpResult_t> CHttpClient::SubmitRequest(const char* pszUrl, const char* pszRequest, CURLParms& parms, CURLMime* pMime)
+{
+	std::shared_ptr<std::promise<HttpResult_t>> pPromise = std::make_shared<std::promise<HttpResult_t>>();
+	std::future<HttpResult_t> future = pPromise->get_future();
+
+	SubmitRequest(pszUrl, pszRequest, parms, pMime, [pPromise](HttpResult_t& result) { pPromise->set_value(std::move(result)); });
+
+	return future;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: IO thread
+//-----------------------------------------------------------------------------
+void CHttpClient::Thread_Run()
+{
+	while (m_bRunning)
+	{
+		Thread_AddPending();
+
+		int nRunning = 0;
+		curl_multi_perform(m_pMulti, &nRunning);
+
+		Thread_ReadCompleted();
+
+		// Sleeps until a socket is ready, a timeout expires or we get woken up by a new request
+		curl_multi_poll(m_pMulti, nullptr, 0, 1000, nullptr);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves submitted transfers into the multi handle
+//-----------------------------------------------------------------------------
+void CHttpClient::Thread_AddPending()
+{
+	std::vector<Transfer_t*> vPending;
+	{
+		std::lock_guard<std::mutex> guard(m_PendingMutex);
+		vPending.swap(m_vPending);
+	}
+
+	for (Transfer_t* pTransfer : vPending)
+	{
+		curl_multi_add_handle(m_pMulti, pTransfer->pCurl);
+		m_vActive.insert(pTransfer);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs callbacks for finished transfers and frees them
+//-----------------------------------------------------------------------------
+void CHttpClient::Thread_ReadCompleted()
+{
+	int nMessages = 0;
+	while (CURLMsg* pMsg = curl_multi_info_read(m_pMulti, &nMessages))
+	{
+		if (pMsg->msg != CURLMSG_DONE)
+		{
+			continue;
+		}
+
+		CURL* pCurl = pMsg->easy_handle;
+
+		Transfer_t* pTransfer = nullptr;
+		curl_easy_getinfo(pCurl, CURLINFO_PRIVATE, &pTransfer);
+
+		pTransfer->result.nResult = pMsg->data.result;
+		pTransfer->result.nResponse = CURLGetResponse(pCurl);
+
+		long nConnects = 0;
+		curl_easy_getinfo(pCurl, CURLINFO_NUM_CONNECTS, &nConnects);
+		m_nNewConnections += nConnects;
+
+		curl_multi_remove_handle(m_pMulti, pCurl);
+		m_vActive.erase(pTransfer);
+
+		pTransfer->fnCallback(pTransfer->result);
+
+		curl_easy_cleanup(pTransfer->pCurl);
+		curl_mime_free(pTransfer->pMime);
+		delete pTransfer;
+
+		m_nActiveTransfers--;
+		m_nCompletedTransfers++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Share handle locking
+//-----------------------------------------------------------------------------
+void CHttpClient::ShareLock(CURL* pCurl, curl_lock_data nData, curl_lock_access nAccess, void* pUserPtr)
+{
+	NOTE_UNUSED(pCurl);
+	NOTE_UNUSED(nAccess);
+
+	static_cast<CHttpClient*>(pUserPtr)->m_ShareMutex[nData].lock();
+}
+
+void CHttpClient::ShareUnlock(CURL* pCurl, curl_lock_data nData, void* pUserPtr)
+{
+	NOTE_UNUSED(pCurl);
+
+	static_cast<CHttpClient*>(pUserPtr)->m_ShareMutex[nData].unlock();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <future>
+
+#include "tier2/curlutils.h"
+
+//-----------------------------------------------------------------------------
+// Result of a request submitted to the shared http client
+struct HttpResult_t
+{
+	HttpResult_t() : nResult(CURLE_OK), nResponse(0), svResponse("") {}
+
+	CURLcode nResult;
+	long nResponse;
+	std::string svResponse;
+};
+
+// Called on the http client thread once the transfer finished
+typedef std::function<void(HttpResult_t& result)> HttpCallbackFn;
+
+//-----------------------------------------------------------------------------
+// Purpose: Shared http engine, drives a curl multi handle on its own thread
+//          and shares dns, connection and tls session caches between all
+//          transfers so repeated requests to the same host skip the handshake
+//-----------------------------------------------------------------------------
+class CHttpClient
+{
+  public:
+	CHttpClient();
+	~CHttpClient();
+
+	void Init();
+	void Shutdown();
+
+	void SubmitRequest(const char* pszUrl, const char* pszRequest, CURLParms& parms, CURLMime* pMime, HttpCallbackFn fnCallback);
+	std::future<HttpResult_t> SubmitRequest(const char* pszUrl, const char* pszRequest, CURLParms& parms, CURLMime* pMime = nullptr);
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Stats
+	//-----------------------------------------------------------------------------
+	int GetNumActiveTransfers() const
+	{
+		return m_nActiveTransfers;
+	}
+
+	int GetNumNewConnections() const
+	{
+		return m_nNewConnections;
+	}
+
+	int GetNumCompletedTransfers() const
+	{
+		return m_nCompletedTransfers;
+	}
+
+  private:
+	struct Transfer_t
+	{
+		CURL* pCurl;
+		curl_mime* pMime;
+		HttpCallbackFn fnCallback;
+		HttpResult_t result;
+	};
+
+	void Thread_Run();
+	void Thread_AddPending();
+	void Thread_ReadCompleted();
+
+	static void ShareLock(CURL* pCurl, curl_lock_data nData, curl_lock_access nAccess, void* pUserPtr);
+	static void ShareUnlock(CURL* pCurl, curl_lock_data nData, void* pUserPtr);
+
+	CURLM* m_pMulti;
+	CURLSH* m_pShare;
+
+	std::mutex m_ShareMutex[CURL_LOCK_DATA_LAST];
+
+	// Transfers submitted from other threads waiting to be added to the multi handle
+	std::mutex m_PendingMutex;
+	std::vector<Transfer_t*> m_vPending;
+
+	// Transfers owned by the multi handle, only touched on the io thread
+	std::unordered_set<Transfer_t*> m_vActive;
+
+	std::thread m_Thread;
+	std::atomic_bool m_bRunning;
+
+	std::atomic_int m_nActiveTransfers;
+	std::atomic_int m_nNewConnections;
+	std::atomic_int m_nCompletedTransfers;
+};
+
+inline CHttpClient* g_pHttpClient = nullptr;
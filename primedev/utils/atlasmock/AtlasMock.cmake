@@ -0,0 +1,40 @@
+# AtlasMock
+
+option(NS_BUILD_ATLASMOCK "Build atlasmock, a local atlas master server for offline load testing" OFF)
+
+if (NS_BUILD_ATLASMOCK)
+	find_package(libcurl REQUIRED)
+	find_package(nlohmann_json REQUIRED)
+
+	add_executable(AtlasMock
+	               "utils/atlasmock/loadtest.cpp"
+	               "utils/atlasmock/loadtest.h"
+	               "utils/atlasmock/main.cpp"
+	               "utils/atlasmock/mockserver.cpp"
+	               "utils/atlasmock/mockserver.h"
+	               "networksystem/heartbeat.cpp"
+	               "networksystem/heartbeat.h"
+	               "networksystem/persistencedelta.cpp"
+	               "networksystem/persistencedelta.h"
+	)
+
+	target_link_libraries(AtlasMock PRIVATE
+	                      libcurl
+	                      nlohmann_json
+	                      ws2_32.lib
+	                      psapi.lib
+	)
+
+	target_compile_definitions(AtlasMock PRIVATE
+	                           _CRT_SECURE_NO_WARNINGS
+	                           WIN32_LEAN_AND_MEAN
+	                           NOMINMAX
+	)
+
+	set_target_properties(AtlasMock PROPERTIES
+	                      RUNTIME_OUTPUT_DIRECTORY ${NS_BINARY_DIR}/bin
+	                      OUTPUT_NAME atlasmock
+	                      COMPILE_FLAGS "/W4"
+	                      LINK_FLAGS "/MANIFEST:NO /DEBUG /SUBSYSTEM:CONSOLE"
+	)
+endif()
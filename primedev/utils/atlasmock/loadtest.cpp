@@ -0,0 +1,354 @@
+#include "loadtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+// Same size CAtlasServer pushes
+constexpr size_t PERSISTENCE_PUSH_SIZE = 56306;
+
+//-----------------------------------------------------------------------------
+// Latencies of one endpoint
+struct EndpointResults_t
+{
+	std::vector<double> vLatencies;
+	uint64_t nFailures = 0;
+};
+
+typedef std::map<std::string, EndpointResults_t> LoadTestResults_t;
+
+//-----------------------------------------------------------------------------
+// Purpose: One simulated game server or client, makes requests the way
+//          CAtlasServer and CAtlasClient do over a single kept alive
+//          connection
+//-----------------------------------------------------------------------------
+class CLoadTestWorker
+{
+  public:
+	CLoadTestWorker(const std::string& svUrl) : m_svUrl(svUrl), m_pCurl(curl_easy_init()) {}
+	~CLoadTestWorker()
+	{
+		curl_easy_cleanup(m_pCurl);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Makes a request and records its latency under its endpoint
+	// Input  : *pszMethod -
+	//          *pszEndpoint - Path without the query
+	//          &svQuery -
+	//          *pszMimeName - Multipart field, nullptr to send no body
+	//          *pszMimeType -
+	//          &svMimeData -
+	//          &svResponse -
+	// Output : false on a transport error or a non 200 response
+	//-----------------------------------------------------------------------------
+	bool Request(const char* pszMethod, const char* pszEndpoint, const std::string& svQuery, const char* pszMimeName, const char* pszMimeType, const std::string& svMimeData, std::string& svResponse)
+	{
+		std::string svUrl = m_svUrl + pszEndpoint + (svQuery.empty() ? "" : "?" + svQuery);
+
+		svResponse.clear();
+		curl_easy_reset(m_pCurl);
+		curl_easy_setopt(m_pCurl, CURLOPT_URL, svUrl.c_str());
+		curl_easy_setopt(m_pCurl, CURLOPT_CUSTOMREQUEST, pszMethod);
+		curl_easy_setopt(m_pCurl, CURLOPT_TIMEOUT, 30L);
+		curl_easy_setopt(m_pCurl, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(m_pCurl, CURLOPT_WRITEDATA, &svResponse);
+		curl_easy_setopt(m_pCurl, CURLOPT_WRITEFUNCTION,
+						 +[](char* pData, size_t nSize, size_t nCount, void* pUser) -> size_t
+						 {
+							 static_cast<std::string*>(pUser)->append(pData, nSize * nCount);
+							 return nSize * nCount;
+						 });
+
+		curl_mime* pMime = nullptr;
+		if (pszMimeName)
+		{
+			pMime = curl_mime_init(m_pCurl);
+			curl_mimepart* pPart = curl_mime_addpart(pMime);
+			curl_mime_name(pPart, pszMimeName);
+			curl_mime_filename(pPart, pszMimeName);
+			curl_mime_type(pPart, pszMimeType);
+			curl_mime_data(pPart, svMimeData.data(), svMimeData.size());
+			curl_easy_setopt(m_pCurl, CURLOPT_MIMEPOST, pMime);
+		}
+
+		auto tStart = std::chrono::steady_clock::now();
+		CURLcode nResult = curl_easy_perform(m_pCurl);
+		double flMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+		long nResponse = 0;
+		curl_easy_getinfo(m_pCurl, CURLINFO_RESPONSE_CODE, &nResponse);
+
+		if (pMime)
+			curl_mime_free(pMime);
+
+		EndpointResults_t& results = m_Results[pszEndpoint];
+		results.vLatencies.push_back(flMs);
+
+		bool bSuccess = nResult == CURLE_OK && nResponse == 200;
+		results.nFailures += !bSuccess;
+
+		return bSuccess;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Registers a game server
+	// Output : Server id, empty on failure
+	//-----------------------------------------------------------------------------
+	std::string AddServer(int nIndex)
+	{
+		std::string svResponse;
+		std::string svQuery = "port=" + std::to_string(37015 + nIndex) + "&authPort=udp&name=Load%20Test%20" + std::to_string(nIndex) + "&description=&map=mp_forwardbase_kodai&playlist=aitdm&maxPlayers=16&password=";
+		if (!Request("POST", "/server/add_server", svQuery, "modinfo", "application/json", GetModInfo(), svResponse))
+			return std::string();
+
+		nlohmann::json jsResponse = nlohmann::json::parse(svResponse, nullptr, false);
+		return jsResponse.is_object() ? jsResponse.value("id", "") : std::string();
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Sends one heartbeat for a game server
+	//-----------------------------------------------------------------------------
+	void HeartBeat(const std::string& svServerID, int nPlayerCount)
+	{
+		std::string svResponse;
+		std::string svQuery = "id=" + svServerID + "&port=37015&authPort=udp&name=Load%20Test&description=&map=mp_forwardbase_kodai&playlist=aitdm&playerCount=" + std::to_string(nPlayerCount) + "&maxPlayers=16&password=";
+		Request("POST", "/server/update_values", svQuery, "modinfo", "application/json", GetModInfo(), svResponse);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: A client joining a game server, both sides of it
+	// Output : false if any step failed, the rest are skipped
+	//-----------------------------------------------------------------------------
+	bool Connect(const std::string& svUID, const std::string& svServerID)
+	{
+		std::string svResponse;
+
+		// Client
+		if (!Request("GET", "/client/origin_auth", "id=" + svUID + "&token=loadtest", nullptr, nullptr, "", svResponse))
+			return false;
+
+		std::string svToken = nlohmann::json::parse(svResponse, nullptr, false).value("token", "");
+
+		if (!Request("GET", "/client/servers", "", nullptr, nullptr, "", svResponse))
+			return false;
+
+		if (!Request("POST", "/client/auth_with_server", "id=" + svUID + "&playerToken=" + svToken + "&server=" + svServerID + "&password=", nullptr, nullptr, "", svResponse))
+			return false;
+
+		// Game server, atlas hands it this token in a connectionless packet
+		std::string svAuthToken = nlohmann::json::parse(svResponse, nullptr, false).value("authToken", "");
+
+		if (!Request("GET", "/server/connect", "serverId=" + svServerID + "&token=" + svAuthToken, nullptr, nullptr, "", svResponse))
+			return false;
+
+		// Push it back like a disconnect would
+		svResponse.resize(PERSISTENCE_PUSH_SIZE);
+		std::string svPersistence = std::move(svResponse);
+		return Request("POST", "/accounts/write_persistence", "id=" + svUID + "&serverId=" + svServerID, "pdata", "application/octet-stream", svPersistence, svResponse);
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Unregisters a game server
+	//-----------------------------------------------------------------------------
+	void RemoveServer(const std::string& svServerID)
+	{
+		std::string svResponse;
+		Request("DELETE", "/server/remove_server", "id=" + svServerID, nullptr, nullptr, "", svResponse);
+	}
+
+	LoadTestResults_t& GetResults()
+	{
+		return m_Results;
+	}
+
+  private:
+	//-----------------------------------------------------------------------------
+	// Purpose: Mod list like GetModInfo sends, sized like a small modded server
+	//-----------------------------------------------------------------------------
+	static const std::string& GetModInfo()
+	{
+		static const std::string s_svModInfo = []()
+		{
+			nlohmann::json jsModList;
+			for (int i = 0; i < 20; i++)
+				jsModList["Mods"].push_back({{"Name", "LoadTest.Mod" + std::to_string(i)}, {"Version", "1.0.0"}, {"RequiredOnClient", i % 2 == 0}});
+
+			return jsModList.dump();
+		}();
+
+		return s_svModInfo;
+	}
+
+	std::string m_svUrl;
+	CURL* m_pCurl;
+	LoadTestResults_t m_Results;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the mock's resident memory from /mock/stats
+// Output : 0 if it couldn't be fetched
+//-----------------------------------------------------------------------------
+static size_t GetMockMemory(const std::string& svUrl)
+{
+	CLoadTestWorker worker(svUrl);
+
+	std::string svResponse;
+	if (!worker.Request("GET", "/mock/stats", "", nullptr, nullptr, "", svResponse))
+		return 0;
+
+	nlohmann::json jsStats = nlohmann::json::parse(svResponse, nullptr, false);
+	return jsStats.is_object() ? jsStats.value("memory", static_cast<size_t>(0)) : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets a percentile of sorted latencies
+// Input  : &vSorted -
+//          flPercentile - 0 to 1
+//-----------------------------------------------------------------------------
+static double GetPercentile(const std::vector<double>& vSorted, double flPercentile)
+{
+	if (vSorted.empty())
+		return 0.0;
+
+	size_t nIndex = static_cast<size_t>(flPercentile * static_cast<double>(vSorted.size() - 1) + 0.5);
+	return vSorted[std::min(nIndex, vSorted.size() - 1)];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Registers servers, runs heartbeats and connects against the mock
+//          from every thread at once, removes the servers and prints
+//          throughput and latencies
+// Input  : &options -
+// Output : false if no server could be registered
+//-----------------------------------------------------------------------------
+bool RunLoadTest(const LoadTestOptions_t& options)
+{
+	int nThreads = std::max(1, options.nThreads);
+
+	std::vector<std::unique_ptr<CLoadTestWorker>> vWorkers;
+	for (int i = 0; i < nThreads; i++)
+		vWorkers.push_back(std::make_unique<CLoadTestWorker>(options.svUrl));
+
+	size_t nMemoryBefore = GetMockMemory(options.svUrl);
+
+	// Register
+	std::vector<std::string> vServers(options.nServers);
+	std::atomic_int nNextServer = 0;
+
+	auto RunOnWorkers = [&](auto fnWork)
+	{
+		std::vector<std::thread> vThreads;
+		for (int i = 0; i < nThreads; i++)
+			vThreads.emplace_back([&fnWork, &vWorkers, i]() { fnWork(*vWorkers[i], i); });
+
+		for (std::thread& thread : vThreads)
+			thread.join();
+	};
+
+	RunOnWorkers(
+		[&](CLoadTestWorker& worker, int nWorker)
+		{
+			(void)nWorker;
+			for (int i; (i = nNextServer++) < options.nServers;)
+				vServers[i] = worker.AddServer(i);
+		});
+
+	vServers.erase(std::remove(vServers.begin(), vServers.end(), std::string()), vServers.end());
+	if (vServers.empty())
+	{
+		fprintf(stderr, "No server could be registered with %s\n", options.svUrl.c_str());
+		return false;
+	}
+
+	// Heartbeats and connects interleaved like a busy master server sees them
+	std::atomic_int nHeartbeatsLeft = options.nHeartbeats;
+	std::atomic_int nConnectsLeft = options.nConnects;
+	std::atomic_int nNextUID = 1;
+	std::atomic_int nConnectsDone = 0;
+
+	auto tStart = std::chrono::steady_clock::now();
+
+	RunOnWorkers(
+		[&](CLoadTestWorker& worker, int nWorker)
+		{
+			std::mt19937 random(nWorker);
+			double flConnectShare = options.nHeartbeats + options.nConnects ? static_cast<double>(options.nConnects) / (options.nHeartbeats + options.nConnects) : 0.0;
+
+			while (true)
+			{
+				bool bConnect = std::uniform_real_distribution<double>(0.0, 1.0)(random) < flConnectShare;
+
+				if (bConnect && nConnectsLeft-- > 0)
+				{
+					const std::string& svServer = vServers[random() % vServers.size()];
+					if (worker.Connect(std::to_string(1000000000000 + nNextUID++), svServer))
+						nConnectsDone++;
+				}
+				else if (nHeartbeatsLeft-- > 0)
+				{
+					worker.HeartBeat(vServers[random() % vServers.size()], static_cast<int>(random() % 17));
+				}
+				else if (nConnectsLeft <= 0)
+				{
+					break;
+				}
+			}
+		});
+
+	double flSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+	size_t nMemoryAfter = GetMockMemory(options.svUrl);
+
+	// Unregister
+	std::atomic_size_t nNextRemove = 0;
+	RunOnWorkers(
+		[&](CLoadTestWorker& worker, int nWorker)
+		{
+			(void)nWorker;
+			for (size_t i; (i = nNextRemove++) < vServers.size();)
+				worker.RemoveServer(vServers[i]);
+		});
+
+	// Merge and report
+	LoadTestResults_t results;
+	for (std::unique_ptr<CLoadTestWorker>& pWorker : vWorkers)
+	{
+		for (auto& [svEndpoint, endpoint] : pWorker->GetResults())
+		{
+			EndpointResults_t& merged = results[svEndpoint];
+			merged.vLatencies.insert(merged.vLatencies.end(), endpoint.vLatencies.begin(), endpoint.vLatencies.end());
+			merged.nFailures += endpoint.nFailures;
+		}
+	}
+
+	uint64_t nRequests = 0;
+	printf("%-28s %8s %8s %9s %9s %9s\n", "endpoint", "requests", "failed", "p50 ms", "p99 ms", "max ms");
+	for (auto& [svEndpoint, endpoint] : results)
+	{
+		std::sort(endpoint.vLatencies.begin(), endpoint.vLatencies.end());
+		nRequests += endpoint.vLatencies.size();
+
+		printf("%-28s %8zu %8llu %9.2f %9.2f %9.2f\n", svEndpoint.c_str(), endpoint.vLatencies.size(), static_cast<unsigned long long>(endpoint.nFailures), GetPercentile(endpoint.vLatencies, 0.5),
+			   GetPercentile(endpoint.vLatencies, 0.99), endpoint.vLatencies.empty() ? 0.0 : endpoint.vLatencies.back());
+	}
+
+	int nHeartbeats = options.nHeartbeats - std::max(0, nHeartbeatsLeft.load());
+	printf("\n%i threads, %zu servers, %.2f s\n", nThreads, vServers.size(), flSeconds);
+	printf("throughput: %.0f requests/s, %.0f heartbeats/s, %.0f connects/s (%i of %i succeeded)\n", nRequests / flSeconds, nHeartbeats / flSeconds, nConnectsDone / flSeconds, nConnectsDone.load(), options.nConnects);
+
+	if (nMemoryAfter)
+		printf("mock memory: %.1f MB before, %.1f MB after\n", nMemoryBefore / (1024.0 * 1024.0), nMemoryAfter / (1024.0 * 1024.0));
+
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+//-----------------------------------------------------------------------------
+// What the load test drives against the mock
+struct LoadTestOptions_t
+{
+	// Base url of the mock, like atlas_hostname
+	std::string svUrl;
+	// Concurrent simulated game servers and clients, one connection each
+	int nThreads = 16;
+	// Game servers registered before the run and removed after it
+	int nServers = 100;
+	// Full connect sequences: origin_auth, servers, auth_with_server, connect
+	// and write_persistence
+	int nConnects = 5000;
+	// update_values requests, spread over the registered servers
+	int nHeartbeats = 20000;
+};
+
+bool RunLoadTest(const LoadTestOptions_t& options);
@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// atlasmock, local stand in for the atlas master server
+//
+//   atlasmock serve [--port 8080] [--latency ms] [--jitter ms] [--error-rate 0-1] [--record file]
+//                   [--persistence-batch 0|1] [--heartbeat-delta 0|1]
+//     Serves the atlas endpoints until killed, point atlas_hostname at
+//     http://127.0.0.1:<port> to run a client or dedicated server against it.
+//     --persistence-batch 0 and --heartbeat-delta 0 hide write_persistence_batch
+//     and partial heartbeats like older atlas
+//
+//   atlasmock bench [--url url] [--threads 16] [--servers 100] [--connects 5000] [--heartbeats 20000]
+//                   [--latency ms] [--jitter ms] [--error-rate 0-1] [--record file]
+//     Drives heartbeats and connects against a mock and prints throughput,
+//     p50/p99 latencies and memory. Without --url a mock is started in process
+//
+// Only needs libcurl and nlohmann json. Built by cmake with -DNS_BUILD_ATLASMOCK=ON,
+// on Linux build it directly from primedev:
+//   g++ -std=c++17 -O2 -I. utils/atlasmock/*.cpp networksystem/heartbeat.cpp networksystem/persistencedelta.cpp -lcurl -lpthread
+//-----------------------------------------------------------------------------
+#include "mockserver.h"
+#include "loadtest.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include <curl/curl.h>
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the value of an option
+// Input  : argc -
+//          *argv[] -
+//          *pszName -
+//          *pszDefault -
+//-----------------------------------------------------------------------------
+static const char* GetOption(int argc, char* argv[], const char* pszName, const char* pszDefault)
+{
+	for (int i = 2; i < argc - 1; i++)
+	{
+		if (!strcmp(argv[i], pszName))
+			return argv[i + 1];
+	}
+
+	return pszDefault;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || (strcmp(argv[1], "serve") && strcmp(argv[1], "bench")))
+	{
+		fprintf(stderr, "usage: %s serve|bench [options], see main.cpp\n", argv[0]);
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+
+	MockOptions_t mockOptions;
+	mockOptions.nLatencyMs = atoi(GetOption(argc, argv, "--latency", "0"));
+	mockOptions.nJitterMs = atoi(GetOption(argc, argv, "--jitter", "0"));
+	mockOptions.flErrorRate = atof(GetOption(argc, argv, "--error-rate", "0"));
+	mockOptions.svRecordPath = GetOption(argc, argv, "--record", "");
+	mockOptions.bPersistenceBatch = atoi(GetOption(argc, argv, "--persistence-batch", "1")) != 0;
+	mockOptions.bHeartBeatDelta = atoi(GetOption(argc, argv, "--heartbeat-delta", "1")) != 0;
+
+	int nResult = 0;
+
+	if (!strcmp(argv[1], "serve"))
+	{
+		CAtlasMockServer server(mockOptions);
+		if (!server.Start(atoi(GetOption(argc, argv, "--port", "8080"))))
+			return 1;
+
+		printf("atlasmock listening on http://127.0.0.1:%i\n", server.GetPort());
+
+		while (true)
+			std::this_thread::sleep_for(std::chrono::hours(1));
+	}
+	else
+	{
+		LoadTestOptions_t loadOptions;
+		loadOptions.svUrl = GetOption(argc, argv, "--url", "");
+		loadOptions.nThreads = atoi(GetOption(argc, argv, "--threads", "16"));
+		loadOptions.nServers = atoi(GetOption(argc, argv, "--servers", "100"));
+		loadOptions.nConnects = atoi(GetOption(argc, argv, "--connects", "5000"));
+		loadOptions.nHeartbeats = atoi(GetOption(argc, argv, "--heartbeats", "20000"));
+
+		std::unique_ptr<CAtlasMockServer> pServer;
+		if (loadOptions.svUrl.empty())
+		{
+			pServer = std::make_unique<CAtlasMockServer>(mockOptions);
+			if (!pServer->Start(0))
+				return 1;
+
+			loadOptions.svUrl = "http://127.0.0.1:" + std::to_string(pServer->GetPort());
+		}
+
+		nResult = RunLoadTest(loadOptions) ? 0 : 1;
+
+		if (pServer)
+			pServer->Stop();
+	}
+
+	curl_global_cleanup();
+	return nResult;
+}
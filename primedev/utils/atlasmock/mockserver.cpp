@@ -0,0 +1,953 @@
+#include "mockserver.h"
+
+#include "networksystem/heartbeat.h"
+#include "networksystem/persistencedelta.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#include <psapi.h>
+#define CloseMockSocket closesocket
+#define SHUTDOWN_BOTH SD_BOTH
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define CloseMockSocket close
+#define SHUTDOWN_BOTH SHUT_RDWR
+#define INVALID_SOCKET (-1)
+#endif
+
+// Requests bigger than this get the connection dropped
+constexpr size_t MAX_REQUEST_SIZE = 4 * 1024 * 1024;
+
+// What connect hands out for players that never wrote persistence, same size
+// the game server pushes back
+constexpr size_t DEFAULT_PERSISTENCE_SIZE = 56306;
+
+//-----------------------------------------------------------------------------
+// Purpose: Decodes a percent encoded query component
+// Input  : svValue -
+//-----------------------------------------------------------------------------
+static std::string UrlDecode(const std::string& svValue)
+{
+	std::string svDecoded;
+	svDecoded.reserve(svValue.size());
+
+	for (size_t i = 0; i < svValue.size(); i++)
+	{
+		if (svValue[i] == '%' && i + 2 < svValue.size() && isxdigit(static_cast<unsigned char>(svValue[i + 1])) && isxdigit(static_cast<unsigned char>(svValue[i + 2])))
+		{
+			svDecoded.push_back(static_cast<char>(std::stoi(svValue.substr(i + 1, 2), nullptr, 16)));
+			i += 2;
+		}
+		else if (svValue[i] == '+')
+		{
+			svDecoded.push_back(' ');
+		}
+		else
+		{
+			svDecoded.push_back(svValue[i]);
+		}
+	}
+
+	return svDecoded;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets a query parameter
+// Input  : &request -
+//          *pszName -
+//-----------------------------------------------------------------------------
+template <typename Request> static std::string GetParam(const Request& request, const char* pszName)
+{
+	auto it = request.mapQuery.find(pszName);
+	return it == request.mapQuery.end() ? std::string() : it->second;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends all of a buffer
+// Input  : hSocket -
+//          &svData -
+//-----------------------------------------------------------------------------
+static bool SendAll(MockSocket_t hSocket, const std::string& svData)
+{
+	size_t nSent = 0;
+	while (nSent < svData.size())
+	{
+		int nResult = send(hSocket, svData.data() + nSent, static_cast<int>(std::min<size_t>(svData.size() - nSent, 1 << 20)), 0);
+		if (nResult <= 0)
+			return false;
+
+		nSent += static_cast<size_t>(nResult);
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Constructor
+// Input  : &options -
+//-----------------------------------------------------------------------------
+CAtlasMockServer::CAtlasMockServer(const MockOptions_t& options) : m_Options(options), m_hListenSocket(INVALID_SOCKET), m_Random(std::random_device()())
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Destructor
+//-----------------------------------------------------------------------------
+CAtlasMockServer::~CAtlasMockServer()
+{
+	Stop();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts listening on localhost
+// Input  : nPort - 0 picks a free one, see GetPort
+//-----------------------------------------------------------------------------
+bool CAtlasMockServer::Start(int nPort)
+{
+	if (!m_Options.svRecordPath.empty())
+	{
+		m_pRecordFile = fopen(m_Options.svRecordPath.c_str(), "ab");
+		if (!m_pRecordFile)
+		{
+			fprintf(stderr, "Failed opening record file '%s'\n", m_Options.svRecordPath.c_str());
+			return false;
+		}
+	}
+
+	m_hListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_hListenSocket == INVALID_SOCKET)
+		return false;
+
+	int nReuse = 1;
+	setsockopt(m_hListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&nReuse), sizeof(nReuse));
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(static_cast<uint16_t>(nPort));
+
+	if (bind(m_hListenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(m_hListenSocket, 512) != 0)
+	{
+		fprintf(stderr, "Failed listening on port %i\n", nPort);
+		CloseMockSocket(m_hListenSocket);
+		m_hListenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	socklen_t nLength = sizeof(addr);
+	getsockname(m_hListenSocket, reinterpret_cast<sockaddr*>(&addr), &nLength);
+	m_nPort = ntohs(addr.sin_port);
+
+	m_bRunning = true;
+	m_AcceptThread = std::thread(&CAtlasMockServer::Thread_Accept, this);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes every connection and waits for their threads to finish
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Stop()
+{
+	if (!m_bRunning.exchange(false))
+		return;
+
+	// Unblocks accept
+	shutdown(m_hListenSocket, SHUTDOWN_BOTH);
+	if (m_AcceptThread.joinable())
+		m_AcceptThread.join();
+
+	CloseMockSocket(m_hListenSocket);
+	m_hListenSocket = INVALID_SOCKET;
+
+	// Unblocks recv, connection threads close their own sockets
+	{
+		std::unique_lock<std::mutex> lock(m_ConnectionsMutex);
+		for (MockSocket_t hSocket : m_vConnections)
+			shutdown(hSocket, SHUTDOWN_BOTH);
+
+		m_cvConnectionClosed.wait(lock, [this]() { return m_vConnections.empty(); });
+	}
+
+	if (m_pRecordFile)
+	{
+		fclose(m_pRecordFile);
+		m_pRecordFile = nullptr;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns a copy of the per endpoint counters
+//-----------------------------------------------------------------------------
+std::map<std::string, MockEndpointStats_t> CAtlasMockServer::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_mapStats;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Accepts connections until stopped
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Thread_Accept()
+{
+	while (m_bRunning)
+	{
+		MockSocket_t hSocket = accept(m_hListenSocket, nullptr, nullptr);
+		if (hSocket == INVALID_SOCKET)
+			continue;
+
+		// Responses are small and latency is what we measure
+		int nNoDelay = 1;
+		setsockopt(hSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nNoDelay), sizeof(nNoDelay));
+
+		std::lock_guard<std::mutex> lock(m_ConnectionsMutex);
+		if (!m_bRunning)
+		{
+			CloseMockSocket(hSocket);
+			break;
+		}
+
+		m_vConnections.push_back(hSocket);
+		std::thread(&CAtlasMockServer::Thread_Connection, this, hSocket).detach();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Serves requests on a connection until the client closes it
+// Input  : hSocket -
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Thread_Connection(MockSocket_t hSocket)
+{
+	thread_local std::mt19937 s_Random(std::random_device {}());
+
+	std::string svBuffer;
+	Request_t request;
+
+	while (m_bRunning && ReadRequest(hSocket, svBuffer, request))
+	{
+		auto tStart = std::chrono::steady_clock::now();
+
+		Response_t response;
+		bool bInjected = false;
+
+		// Our own endpoints never fail
+		if (request.svPath.rfind("/mock/", 0) != 0 && m_Options.flErrorRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(s_Random) < m_Options.flErrorRate)
+		{
+			Fail(response, 500, "MOCK_INJECTED_ERROR", "Error injected by atlasmock");
+			bInjected = true;
+		}
+		else
+		{
+			Handle(request, response);
+		}
+
+		int nDelayMs = m_Options.nLatencyMs;
+		if (m_Options.nJitterMs > 0)
+			nDelayMs += std::uniform_int_distribution<int>(0, m_Options.nJitterMs)(s_Random);
+
+		if (nDelayMs > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(nDelayMs));
+
+		const char* pszReason = response.nStatus == 200 ? "OK" : response.nStatus == 404 ? "Not Found" : response.nStatus == 500 ? "Internal Server Error" : "Error";
+		char szHeader[256];
+		snprintf(szHeader, sizeof(szHeader), "HTTP/1.1 %i %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: keep-alive\r\n\r\n", response.nStatus, pszReason, response.svContentType.c_str(),
+				 response.svBody.size());
+
+		if (!SendAll(hSocket, szHeader) || !SendAll(hSocket, response.svBody))
+			break;
+
+		Record(request, response, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count(), bInjected);
+	}
+
+	std::lock_guard<std::mutex> lock(m_ConnectionsMutex);
+	m_vConnections.erase(std::remove(m_vConnections.begin(), m_vConnections.end(), hSocket), m_vConnections.end());
+	CloseMockSocket(hSocket);
+	m_cvConnectionClosed.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads one request off a connection
+// Input  : hSocket -
+//          &svBuffer - Bytes read but not consumed yet, kept between calls
+//          &request -
+// Output : false if the connection closed or sent garbage
+//-----------------------------------------------------------------------------
+bool CAtlasMockServer::ReadRequest(MockSocket_t hSocket, std::string& svBuffer, Request_t& request)
+{
+	char szChunk[16384];
+
+	auto Receive = [&]() -> bool
+	{
+		int nResult = recv(hSocket, szChunk, sizeof(szChunk), 0);
+		if (nResult <= 0 || svBuffer.size() + nResult > MAX_REQUEST_SIZE)
+			return false;
+
+		svBuffer.append(szChunk, nResult);
+		return true;
+	};
+
+	size_t nHeaderEnd;
+	while ((nHeaderEnd = svBuffer.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (!Receive())
+			return false;
+	}
+
+	request = Request_t();
+
+	// Request line
+	size_t nLineEnd = svBuffer.find("\r\n");
+	std::string svLine = svBuffer.substr(0, nLineEnd);
+
+	size_t nFirstSpace = svLine.find(' ');
+	size_t nSecondSpace = svLine.find(' ', nFirstSpace + 1);
+	if (nFirstSpace == std::string::npos || nSecondSpace == std::string::npos)
+		return false;
+
+	request.svMethod = svLine.substr(0, nFirstSpace);
+	std::string svTarget = svLine.substr(nFirstSpace + 1, nSecondSpace - nFirstSpace - 1);
+
+	size_t nQuestion = svTarget.find('?');
+	request.svPath = svTarget.substr(0, nQuestion);
+	if (nQuestion != std::string::npos)
+	{
+		request.svQuery = svTarget.substr(nQuestion + 1);
+
+		for (size_t nStart = 0; nStart < request.svQuery.size();)
+		{
+			size_t nAmp = request.svQuery.find('&', nStart);
+			if (nAmp == std::string::npos)
+				nAmp = request.svQuery.size();
+
+			std::string svPair = request.svQuery.substr(nStart, nAmp - nStart);
+			size_t nEquals = svPair.find('=');
+			if (nEquals != std::string::npos)
+				request.mapQuery[UrlDecode(svPair.substr(0, nEquals))] = UrlDecode(svPair.substr(nEquals + 1));
+			else if (!svPair.empty())
+				request.mapQuery[UrlDecode(svPair)] = "";
+
+			nStart = nAmp + 1;
+		}
+	}
+
+	// Headers, names lowercased
+	for (size_t nStart = nLineEnd + 2; nStart < nHeaderEnd;)
+	{
+		size_t nEnd = svBuffer.find("\r\n", nStart);
+		std::string svHeader = svBuffer.substr(nStart, nEnd - nStart);
+		nStart = nEnd + 2;
+
+		size_t nColon = svHeader.find(':');
+		if (nColon == std::string::npos)
+			continue;
+
+		std::string svName = svHeader.substr(0, nColon);
+		std::transform(svName.begin(), svName.end(), svName.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+		size_t nValue = svHeader.find_first_not_of(' ', nColon + 1);
+		request.mapHeaders[svName] = nValue == std::string::npos ? "" : svHeader.substr(nValue);
+	}
+
+	svBuffer.erase(0, nHeaderEnd + 4);
+
+	auto itExpect = request.mapHeaders.find("expect");
+	if (itExpect != request.mapHeaders.end() && itExpect->second == "100-continue")
+	{
+		if (!SendAll(hSocket, "HTTP/1.1 100 Continue\r\n\r\n"))
+			return false;
+	}
+
+	auto itEncoding = request.mapHeaders.find("transfer-encoding");
+	if (itEncoding != request.mapHeaders.end() && itEncoding->second == "chunked")
+	{
+		while (true)
+		{
+			size_t nSizeEnd;
+			while ((nSizeEnd = svBuffer.find("\r\n")) == std::string::npos)
+			{
+				if (!Receive())
+					return false;
+			}
+
+			size_t nChunkSize = strtoul(svBuffer.c_str(), nullptr, 16);
+			while (svBuffer.size() < nSizeEnd + 2 + nChunkSize + 2)
+			{
+				if (!Receive())
+					return false;
+			}
+
+			request.svBody.append(svBuffer, nSizeEnd + 2, nChunkSize);
+			svBuffer.erase(0, nSizeEnd + 2 + nChunkSize + 2);
+
+			// Trailers aren't supported, curl doesn't send any
+			if (!nChunkSize)
+				return true;
+		}
+	}
+
+	size_t nContentLength = 0;
+	auto itLength = request.mapHeaders.find("content-length");
+	if (itLength != request.mapHeaders.end())
+		nContentLength = strtoull(itLength->second.c_str(), nullptr, 10);
+
+	if (nContentLength > MAX_REQUEST_SIZE)
+		return false;
+
+	while (svBuffer.size() < nContentLength)
+	{
+		if (!Receive())
+			return false;
+	}
+
+	request.svBody = svBuffer.substr(0, nContentLength);
+	svBuffer.erase(0, nContentLength);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Routes a request to its endpoint
+// Input  : &request -
+//          &response -
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Handle(const Request_t& request, Response_t& response)
+{
+	typedef void (CAtlasMockServer::*EndpointFn)(const Request_t&, Response_t&);
+
+	// clang-format off
+	static const std::unordered_map<std::string, EndpointFn> s_mapEndpoints =
+	{
+		{ "/client/origin_auth",               &CAtlasMockServer::OriginAuth },
+		{ "/client/servers",                   &CAtlasMockServer::ServerList },
+		{ "/client/auth_with_server",          &CAtlasMockServer::AuthWithServer },
+		{ "/client/auth_with_self",            &CAtlasMockServer::AuthWithSelf },
+		{ "/server/add_server",                &CAtlasMockServer::AddServer },
+		{ "/server/update_values",             &CAtlasMockServer::UpdateValues },
+		{ "/server/keepalive",                 &CAtlasMockServer::KeepAlive },
+		{ "/server/remove_server",             &CAtlasMockServer::RemoveServer },
+		{ "/server/connect",                   &CAtlasMockServer::Connect },
+		{ "/accounts/write_persistence",       &CAtlasMockServer::WritePersistence },
+		{ "/accounts/write_persistence_batch", &CAtlasMockServer::WritePersistenceBatch },
+		{ "/mock/stats",                       &CAtlasMockServer::Stats }
+	};
+	// clang-format on
+
+	auto it = s_mapEndpoints.find(request.svPath);
+	if (it == s_mapEndpoints.end())
+	{
+		Fail(response, 404, "NOT_FOUND", "Unknown endpoint");
+		return;
+	}
+
+	(this->*it->second)(request, response);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Counts a request and appends it to the record file
+// Input  : &request -
+//          &response -
+//          flMs - Time it took to answer, including injected latency
+//          bInjected -
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Record(const Request_t& request, const Response_t& response, double flMs, bool bInjected)
+{
+	if (request.svPath == "/mock/stats")
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	MockEndpointStats_t& stats = m_mapStats[request.svPath];
+	stats.nRequests++;
+	stats.nInjectedErrors += bInjected;
+	stats.nFailures += response.nStatus != 200 && !bInjected;
+	stats.nBytesIn += request.svBody.size();
+	stats.nBytesOut += response.svBody.size();
+
+	if (!m_pRecordFile)
+		return;
+
+	nlohmann::json jsRecord;
+	jsRecord["time"] = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	jsRecord["method"] = request.svMethod;
+	jsRecord["path"] = request.svPath;
+	jsRecord["query"] = request.svQuery;
+	jsRecord["status"] = response.nStatus;
+	jsRecord["injected"] = bInjected;
+	jsRecord["bytesIn"] = request.svBody.size();
+	jsRecord["bytesOut"] = response.svBody.size();
+	jsRecord["ms"] = flMs;
+
+	// Query strings carry whatever clients put in them
+	std::string svLine = jsRecord.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+	svLine.push_back('\n');
+	fwrite(svLine.data(), 1, svLine.size(), m_pRecordFile);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /client/origin_auth, hands out the token clients authenticate with
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::OriginAuth(const Request_t& request, Response_t& response)
+{
+	std::string svUID = GetParam(request, "id");
+	if (svUID.empty())
+	{
+		Fail(response, 400, "BAD_REQUEST", "Missing id");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::string svToken = CreateToken();
+	m_mapPlayerTokens[svUID] = svToken;
+
+	response.svBody = nlohmann::json({{"success", true}, {"token", svToken}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /client/servers
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::ServerList(const Request_t& request, Response_t& response)
+{
+	(void)request;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	nlohmann::json jsServers = nlohmann::json::array();
+	for (const auto& [svID, server] : m_mapServers)
+	{
+		nlohmann::json jsServer;
+		jsServer["id"] = server.svID;
+		jsServer["name"] = server.svName;
+		jsServer["description"] = server.svDescription;
+		jsServer["map"] = server.svMap;
+		jsServer["playlist"] = server.svPlaylist;
+		jsServer["region"] = "Mock";
+		jsServer["playerCount"] = server.nPlayerCount;
+		jsServer["maxPlayers"] = server.nMaxPlayers;
+		jsServer["hasPassword"] = !server.svPassword.empty();
+
+		nlohmann::json jsModInfo = nlohmann::json::parse(server.svModInfo, nullptr, false);
+		jsServer["modInfo"] = jsModInfo.is_object() ? jsModInfo : nlohmann::json({{"Mods", nlohmann::json::array()}});
+
+		jsServers.push_back(std::move(jsServer));
+	}
+
+	response.svBody = jsServers.dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /client/auth_with_server, the token returned is the one the game
+//          server presents to /server/connect
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::AuthWithServer(const Request_t& request, Response_t& response)
+{
+	std::string svUID = GetParam(request, "id");
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto itToken = m_mapPlayerTokens.find(svUID);
+	if (itToken == m_mapPlayerTokens.end() || itToken->second != GetParam(request, "playerToken"))
+	{
+		Fail(response, 401, "UNAUTHORIZED_PWD", "Invalid player token");
+		return;
+	}
+
+	auto itServer = m_mapServers.find(GetParam(request, "server"));
+	if (itServer == m_mapServers.end())
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	if (itServer->second.svPassword != GetParam(request, "password"))
+	{
+		Fail(response, 401, "UNAUTHORIZED_PWD", "Wrong password");
+		return;
+	}
+
+	std::string svAuthToken = CreateToken();
+	m_mapPendingConnects[svAuthToken] = {svUID, itServer->first};
+
+	response.svBody = nlohmann::json({{"success", true}, {"ip", "127.0.0.1"}, {"port", itServer->second.nPort}, {"authToken", svAuthToken}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /client/auth_with_self
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::AuthWithSelf(const Request_t& request, Response_t& response)
+{
+	std::string svUID = GetParam(request, "id");
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto itToken = m_mapPlayerTokens.find(svUID);
+	if (itToken == m_mapPlayerTokens.end() || itToken->second != GetParam(request, "playerToken"))
+	{
+		Fail(response, 401, "UNAUTHORIZED_PWD", "Invalid player token");
+		return;
+	}
+
+	auto itPersistence = m_mapPersistence.find(svUID);
+	std::string svPersistence = itPersistence == m_mapPersistence.end() ? std::string(DEFAULT_PERSISTENCE_SIZE, '\0') : itPersistence->second;
+
+	nlohmann::json jsPersistence = nlohmann::json::array();
+	for (char c : svPersistence)
+		jsPersistence.push_back(static_cast<int8_t>(c));
+
+	response.svBody = nlohmann::json({{"success", true}, {"id", svUID}, {"authToken", CreateToken()}, {"persistentData", std::move(jsPersistence)}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /server/add_server, mod info comes as a multipart form
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::AddServer(const Request_t& request, Response_t& response)
+{
+	GameServer_t server;
+	server.svName = GetParam(request, "name");
+	server.svDescription = GetParam(request, "description");
+	server.svMap = GetParam(request, "map");
+	server.svPlaylist = GetParam(request, "playlist");
+	server.svPassword = GetParam(request, "password");
+	server.svModInfo = GetMultipartData(request);
+	server.nPort = atoi(GetParam(request, "port").c_str());
+	server.nPlayerCount = 0;
+	server.nMaxPlayers = atoi(GetParam(request, "maxPlayers").c_str());
+
+	if (!server.nPort)
+	{
+		Fail(response, 400, "BAD_REQUEST", "Missing port");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	server.svID = "mock" + std::to_string(m_nNextServerID++);
+	server.svAuthToken = CreateToken();
+
+	nlohmann::json jsResponse = {{"success", true}, {"id", server.svID}, {"serverAuthToken", server.svAuthToken}};
+	jsResponse["capabilities"] = nlohmann::json::array();
+	if (m_Options.bPersistenceBatch)
+		jsResponse["capabilities"].push_back(PERSISTENCE_BATCH_CAPABILITY);
+	if (m_Options.bHeartBeatDelta)
+		jsResponse["capabilities"].push_back(HEARTBEAT_DELTA_CAPABILITY);
+
+	response.svBody = jsResponse.dump();
+	m_mapServers.emplace(server.svID, std::move(server));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /server/update_values, the heartbeat. With partial heartbeats on
+//          only the fields passed change, otherwise missing ones are cleared
+//          like older atlas does
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::UpdateValues(const Request_t& request, Response_t& response)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapServers.find(GetParam(request, "id"));
+	if (it == m_mapServers.end())
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	auto Update = [&](std::string& svValue, const char* pszName)
+	{
+		if (!m_Options.bHeartBeatDelta || request.mapQuery.count(pszName))
+			svValue = GetParam(request, pszName);
+	};
+
+	auto UpdateInt = [&](int& nValue, const char* pszName)
+	{
+		if (!m_Options.bHeartBeatDelta || request.mapQuery.count(pszName))
+			nValue = atoi(GetParam(request, pszName).c_str());
+	};
+
+	GameServer_t& server = it->second;
+	Update(server.svName, "name");
+	Update(server.svDescription, "description");
+	Update(server.svMap, "map");
+	Update(server.svPlaylist, "playlist");
+	Update(server.svPassword, "password");
+	UpdateInt(server.nPlayerCount, "playerCount");
+	UpdateInt(server.nMaxPlayers, "maxPlayers");
+
+	std::string svModInfo = GetMultipartData(request);
+	if (!svModInfo.empty())
+		server.svModInfo = std::move(svModInfo);
+
+	response.svBody = nlohmann::json({{"success", true}, {"id", server.svID}, {"serverAuthToken", server.svAuthToken}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /server/keepalive, a heartbeat where nothing changed
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::KeepAlive(const Request_t& request, Response_t& response)
+{
+	if (!m_Options.bHeartBeatDelta)
+	{
+		Fail(response, 404, "NOT_FOUND", "Unknown endpoint");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapServers.find(GetParam(request, "id"));
+	if (it == m_mapServers.end())
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	response.svBody = nlohmann::json({{"success", true}, {"id", it->second.svID}, {"serverAuthToken", it->second.svAuthToken}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /server/remove_server
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::RemoveServer(const Request_t& request, Response_t& response)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_mapServers.erase(GetParam(request, "id")))
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	response.svBody = nlohmann::json({{"success", true}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /server/connect, returns the player's raw persistence. With reject
+//          set the connect is cancelled instead
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Connect(const Request_t& request, Response_t& response)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_mapPendingConnects.find(GetParam(request, "token"));
+	if (it == m_mapPendingConnects.end() || it->second.svServerID != GetParam(request, "serverId"))
+	{
+		Fail(response, 404, "PLAYER_NOT_FOUND", "No pending connect with that token");
+		return;
+	}
+
+	std::string svUID = it->second.svUID;
+	m_mapPendingConnects.erase(it);
+
+	if (request.mapQuery.count("reject"))
+	{
+		response.svBody = nlohmann::json({{"success", true}}).dump();
+		return;
+	}
+
+	auto itPersistence = m_mapPersistence.find(svUID);
+	response.svContentType = "application/octet-stream";
+	response.svBody = itPersistence == m_mapPersistence.end() ? std::string(DEFAULT_PERSISTENCE_SIZE, '\0') : itPersistence->second;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /accounts/write_persistence, pdata comes as a multipart form
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::WritePersistence(const Request_t& request, Response_t& response)
+{
+	std::string svData = GetMultipartData(request);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_mapServers.count(GetParam(request, "serverId")))
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	if (svData.empty())
+	{
+		Fail(response, 400, "BAD_REQUEST", "Missing pdata");
+		return;
+	}
+
+	m_mapPersistence[GetParam(request, "id")] = std::move(svData);
+	response.svBody = nlohmann::json({{"success", true}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /accounts/write_persistence_batch, several players' pdata in one
+//          multipart form, each either full or a delta against what we have
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::WritePersistenceBatch(const Request_t& request, Response_t& response)
+{
+	if (!m_Options.bPersistenceBatch)
+	{
+		Fail(response, 404, "NOT_FOUND", "Unknown endpoint");
+		return;
+	}
+
+	std::string svBatch = GetMultipartData(request);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_mapServers.count(GetParam(request, "serverId")))
+	{
+		Fail(response, 404, "SERVER_NOT_FOUND", "No server with that id");
+		return;
+	}
+
+	std::vector<PersistenceBatchEntry_t> vEntries;
+	if (!PersistenceBatch_Parse(svBatch, vEntries) || vEntries.empty())
+	{
+		Fail(response, 400, "BAD_REQUEST", "Malformed pdata batch");
+		return;
+	}
+
+	nlohmann::json jsResults = nlohmann::json::object();
+	for (const PersistenceBatchEntry_t& entry : vEntries)
+	{
+		std::string svUID(entry.svUID);
+
+		if (entry.eEncoding == ePersistenceEncoding::FULL)
+		{
+			m_mapPersistence[svUID] = std::string(entry.svPayload);
+			jsResults[svUID] = {{"success", true}};
+			continue;
+		}
+
+		// Players that never wrote pdata have what connect hands out
+		auto itPersistence = m_mapPersistence.find(svUID);
+		std::string svBase = itPersistence == m_mapPersistence.end() ? std::string(DEFAULT_PERSISTENCE_SIZE, '\0') : itPersistence->second;
+
+		std::string svData;
+		if (!PersistenceDelta_Decode(svBase, entry.svPayload, svData))
+		{
+			jsResults[svUID] = {{"success", false}, {"error", {{"enum", "PERSISTENCE_STALE_BASE"}, {"msg", "Delta doesn't apply to the stored pdata"}}}};
+			continue;
+		}
+
+		m_mapPersistence[svUID] = std::move(svData);
+		jsResults[svUID] = {{"success", true}};
+	}
+
+	response.svBody = nlohmann::json({{"success", true}, {"results", std::move(jsResults)}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: /mock/stats, counters and memory so remote load tests can report them
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Stats(const Request_t& request, Response_t& response)
+{
+	(void)request;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	nlohmann::json jsStats;
+	for (const auto& [svPath, stats] : m_mapStats)
+	{
+		jsStats["endpoints"][svPath] = {{"requests", stats.nRequests},
+										{"injectedErrors", stats.nInjectedErrors},
+										{"failures", stats.nFailures},
+										{"bytesIn", stats.nBytesIn},
+										{"bytesOut", stats.nBytesOut}};
+	}
+
+	jsStats["servers"] = m_mapServers.size();
+	jsStats["players"] = m_mapPlayerTokens.size();
+	jsStats["pendingConnects"] = m_mapPendingConnects.size();
+	jsStats["memory"] = GetProcessMemoryUsage();
+
+	response.svBody = jsStats.dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills in an error response the way atlas formats them
+// Input  : &response -
+//          nStatus -
+//          *pszEnum -
+//          *pszMsg -
+//-----------------------------------------------------------------------------
+void CAtlasMockServer::Fail(Response_t& response, int nStatus, const char* pszEnum, const char* pszMsg)
+{
+	response.nStatus = nStatus;
+	response.svContentType = "application/json";
+	response.svBody = nlohmann::json({{"success", false}, {"error", {{"enum", pszEnum}, {"msg", pszMsg}}}}).dump();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the contents of the first part of a multipart form, that's
+//          all atlas requests ever send
+// Input  : &request -
+//-----------------------------------------------------------------------------
+std::string CAtlasMockServer::GetMultipartData(const Request_t& request)
+{
+	auto it = request.mapHeaders.find("content-type");
+	if (it == request.mapHeaders.end())
+		return std::string();
+
+	size_t nBoundary = it->second.find("boundary=");
+	if (nBoundary == std::string::npos)
+		return std::string();
+
+	std::string svBoundary = "--" + it->second.substr(nBoundary + 9);
+	if (svBoundary.size() > 4 && svBoundary[2] == '"')
+		svBoundary = "--" + svBoundary.substr(3, svBoundary.size() - 4);
+
+	size_t nStart = request.svBody.find(svBoundary);
+	if (nStart == std::string::npos)
+		return std::string();
+
+	size_t nDataStart = request.svBody.find("\r\n\r\n", nStart);
+	if (nDataStart == std::string::npos)
+		return std::string();
+
+	nDataStart += 4;
+
+	size_t nDataEnd = request.svBody.find("\r\n" + svBoundary, nDataStart);
+	if (nDataEnd == std::string::npos)
+		return std::string();
+
+	return request.svBody.substr(nDataStart, nDataEnd - nDataStart);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates a random token, m_Mutex must be held
+//-----------------------------------------------------------------------------
+std::string CAtlasMockServer::CreateToken()
+{
+	char szToken[33];
+	snprintf(szToken, sizeof(szToken), "%016llx%016llx", static_cast<unsigned long long>(m_Random()), static_cast<unsigned long long>(m_Random()));
+	return szToken;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the resident memory of this process in bytes, 0 if unknown
+//-----------------------------------------------------------------------------
+size_t GetProcessMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+
+	return 0;
+#else
+	FILE* pFile = fopen("/proc/self/statm", "r");
+	if (!pFile)
+		return 0;
+
+	unsigned long nPages = 0;
+	unsigned long nResident = 0;
+	int nRead = fscanf(pFile, "%lu %lu", &nPages, &nResident);
+	fclose(pFile);
+
+	return nRead == 2 ? static_cast<size_t>(nResident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET MockSocket_t;
+#else
+typedef int MockSocket_t;
+#endif
+
+//-----------------------------------------------------------------------------
+// How the mock misbehaves
+struct MockOptions_t
+{
+	// Added to every response
+	int nLatencyMs = 0;
+	// Up to this much more, uniformly distributed
+	int nJitterMs = 0;
+	// Share of requests answered with a 500, 0 to 1
+	double flErrorRate = 0.0;
+	// Every request gets appended here as a json line, empty to disable
+	std::string svRecordPath;
+	// Advertise and serve write_persistence_batch
+	bool bPersistenceBatch = true;
+	// Advertise partial update_values and serve keepalive
+	bool bHeartBeatDelta = true;
+};
+
+//-----------------------------------------------------------------------------
+// Per endpoint counters, served on /mock/stats
+struct MockEndpointStats_t
+{
+	uint64_t nRequests = 0;
+	uint64_t nInjectedErrors = 0;
+	uint64_t nFailures = 0;
+	uint64_t nBytesIn = 0;
+	uint64_t nBytesOut = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Local stand in for the atlas master server
+// Note   : Implements the endpoints CAtlasClient and CAtlasServer call with
+//          the same request and response formats, keeping servers, player
+//          tokens and persistence in memory. One thread per connection,
+//          connections are kept alive like curl expects
+//-----------------------------------------------------------------------------
+class CAtlasMockServer
+{
+  public:
+	CAtlasMockServer(const MockOptions_t& options);
+	~CAtlasMockServer();
+
+	bool Start(int nPort);
+	void Stop();
+
+	int GetPort() const
+	{
+		return m_nPort;
+	}
+
+	std::map<std::string, MockEndpointStats_t> GetStats();
+
+  private:
+	struct Request_t
+	{
+		std::string svMethod;
+		std::string svPath;
+		std::string svQuery;
+		std::unordered_map<std::string, std::string> mapQuery;
+		std::unordered_map<std::string, std::string> mapHeaders;
+		std::string svBody;
+	};
+
+	struct Response_t
+	{
+		int nStatus = 200;
+		std::string svContentType = "application/json";
+		std::string svBody;
+	};
+
+	struct GameServer_t
+	{
+		std::string svID;
+		std::string svAuthToken;
+		std::string svName;
+		std::string svDescription;
+		std::string svMap;
+		std::string svPlaylist;
+		std::string svPassword;
+		std::string svModInfo;
+		int nPort;
+		int nPlayerCount;
+		int nMaxPlayers;
+	};
+
+	struct PendingConnect_t
+	{
+		std::string svUID;
+		std::string svServerID;
+	};
+
+	void Thread_Accept();
+	void Thread_Connection(MockSocket_t hSocket);
+
+	bool ReadRequest(MockSocket_t hSocket, std::string& svBuffer, Request_t& request);
+	void Handle(const Request_t& request, Response_t& response);
+	void Record(const Request_t& request, const Response_t& response, double flMs, bool bInjected);
+
+	void OriginAuth(const Request_t& request, Response_t& response);
+	void ServerList(const Request_t& request, Response_t& response);
+	void AuthWithServer(const Request_t& request, Response_t& response);
+	void AuthWithSelf(const Request_t& request, Response_t& response);
+	void AddServer(const Request_t& request, Response_t& response);
+	void UpdateValues(const Request_t& request, Response_t& response);
+	void KeepAlive(const Request_t& request, Response_t& response);
+	void RemoveServer(const Request_t& request, Response_t& response);
+	void Connect(const Request_t& request, Response_t& response);
+	void WritePersistence(const Request_t& request, Response_t& response);
+	void WritePersistenceBatch(const Request_t& request, Response_t& response);
+	void Stats(const Request_t& request, Response_t& response);
+
+	static void Fail(Response_t& response, int nStatus, const char* pszEnum, const char* pszMsg);
+	static std::string GetMultipartData(const Request_t& request);
+	std::string CreateToken();
+
+	MockOptions_t m_Options;
+
+	MockSocket_t m_hListenSocket;
+	int m_nPort = 0;
+	std::atomic_bool m_bRunning {false};
+	std::thread m_AcceptThread;
+
+	// Connection threads are detached, Stop waits for this to empty
+	std::mutex m_ConnectionsMutex;
+	std::condition_variable m_cvConnectionClosed;
+	std::vector<MockSocket_t> m_vConnections;
+
+	std::mutex m_Mutex;
+	std::mt19937_64 m_Random;
+	uint64_t m_nNextServerID = 1;
+	std::map<std::string, GameServer_t> m_mapServers;
+	// UID : token handed out by origin_auth
+	std::unordered_map<std::string, std::string> m_mapPlayerTokens;
+	// auth_with_server token : who it was handed to
+	std::unordered_map<std::string, PendingConnect_t> m_mapPendingConnects;
+	// UID : persistence
+	std::unordered_map<std::string, std::string> m_mapPersistence;
+
+	std::map<std::string, MockEndpointStats_t> m_mapStats;
+	FILE* m_pRecordFile = nullptr;
+};
+
+size_t GetProcessMemoryUsage();
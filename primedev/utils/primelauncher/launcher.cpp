@@ -282,6 +282,12 @@ void CNorthstarLauncher::InjectNorthstar()
 		TerminateProcess(GetCurrentProcess(), EXIT_FAILURE);
 	}
 
+	// Get 'NorthstarPrime_FlushLogs', lets the crash handler write out queued log lines
+	bool (*NorthstarPrime_FlushLogs)(int nTimeoutMs);
+	NorthstarPrime_FlushLogs = reinterpret_cast<bool (*)(int)>(GetProcAddress(hNorthstar, "NorthstarPrime_FlushLogs"));
+
+	g_pCrashHandler->SetFlushLogsFn(NorthstarPrime_FlushLogs);
+
 	//------------------------------------------------------
 	// Print some debug information
 	//------------------------------------------------------
@@ -364,6 +370,9 @@ void CNorthstarLauncher::InjectNorthstar()
 	LauncherMain = reinterpret_cast<int (*)(HINSTANCE, HINSTANCE, PWSTR, int)>(GetProcAddress(hLauncher, "LauncherMain"));
 
 	LauncherMain(NULL, NULL, NULL, 0);
+
+	// Game exited normally, don't lose what's still queued
+	g_pCrashHandler->FlushLogs(-1);
 #endif
 }
 
@@ -0,0 +1,96 @@
+# Tests
+
+option(NS_BUILD_TESTS "Build standalone tests for the parts of Northstar that don't need the game" OFF)
+
+if (NS_BUILD_TESTS)
+	find_package(nlohmann_json REQUIRED)
+	find_package(libcurl REQUIRED)
+
+	# Adds a test executable, run by ctest
+	function(ns_add_test name)
+		add_executable(${name} ${ARGN})
+
+		target_compile_definitions(${name} PRIVATE
+		                           _CRT_SECURE_NO_WARNINGS
+		                           WIN32_LEAN_AND_MEAN
+		                           NOMINMAX
+		)
+
+		if (MSVC)
+			target_compile_options(${name} PRIVATE /W4)
+		endif()
+
+		set_target_properties(${name} PROPERTIES
+		                      RUNTIME_OUTPUT_DIRECTORY ${NS_BINARY_DIR}/tests
+		)
+
+		add_test(NAME ${name} COMMAND ${name})
+	endfunction()
+
+	ns_add_test(AddressPrefixTrieTest
+	            "tier1/addressprefixtrie.cpp"
+	            "tier1/addressprefixtrie.h"
+	            "utils/tests/addressprefixtrie_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	if (WIN32)
+		target_link_libraries(AddressPrefixTrieTest PRIVATE ws2_32.lib)
+	endif()
+
+	ns_add_test(BcryptTest
+	            "networksystem/bcrypt.cpp"
+	            "networksystem/bcrypt.h"
+	            "utils/tests/bcrypt_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	ns_add_test(BitBufTest
+	            "mathlib/bitbuf.cpp"
+	            "mathlib/bitbuf.h"
+	            "utils/tests/bitbuf_test.cpp"
+	            "utils/tests/stdafx.h"
+	            "utils/tests/test.h"
+	)
+
+	target_precompile_headers(BitBufTest PRIVATE utils/tests/stdafx.h)
+
+	ns_add_test(HeartBeatTest
+	            "networksystem/heartbeat.cpp"
+	            "networksystem/heartbeat.h"
+	            "utils/tests/heartbeat_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	target_link_libraries(HeartBeatTest PRIVATE nlohmann_json)
+
+	ns_add_test(HttpCacheTest
+	            "game/shared/vscript_httpcache.cpp"
+	            "game/shared/vscript_httpcache.h"
+	            "utils/tests/httpcache_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	target_link_libraries(HttpCacheTest PRIVATE libcurl)
+
+	ns_add_test(LzssTest
+	            "tier1/lzss.cpp"
+	            "tier1/lzss.h"
+	            "utils/tests/lzss_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	ns_add_test(PersistenceDeltaTest
+	            "networksystem/persistencedelta.cpp"
+	            "networksystem/persistencedelta.h"
+	            "utils/tests/persistencedelta_test.cpp"
+	            "utils/tests/test.h"
+	)
+
+	ns_add_test(RateLimiterTest
+	            "tier1/ratelimiter.cpp"
+	            "tier1/ratelimiter.h"
+	            "utils/tests/ratelimiter_test.cpp"
+	            "utils/tests/test.h"
+	)
+endif()
@@ -0,0 +1,181 @@
+//-----------------------------------------------------------------------------
+// Checks CAddressPrefixTrie at prefix edges and against a brute force
+// match over random prefixes
+//-----------------------------------------------------------------------------
+#include "tier1/addressprefixtrie.h"
+#include "utils/tests/test.h"
+
+#include <cstring>
+#include <random>
+
+static bool Contains(const CAddressPrefixTrie& trie, const char* pszAddress)
+{
+	uint8_t address[16];
+	if (!CAddressPrefixTrie::ParseAddress(pszAddress, address))
+	{
+		fprintf(stderr, "couldn't parse %s\n", pszAddress);
+		return false;
+	}
+
+	return trie.Contains(address);
+}
+
+static void TestParse()
+{
+	CAddressPrefixTrie trie;
+	TEST_CHECK(trie.Insert("10.0.0.0/8"));
+	TEST_CHECK(trie.Insert("fc00::/7"));
+	TEST_CHECK(trie.Insert("192.0.2.1"));
+	TEST_CHECK(trie.Insert("::1"));
+	TEST_CHECK(trie.Insert("0.0.0.0/0"));
+	TEST_CHECK(trie.Insert("::/128"));
+
+	TEST_CHECK(!trie.Insert("10.0.0.0/33"));
+	TEST_CHECK(!trie.Insert("::/129"));
+	TEST_CHECK(!trie.Insert("10.0.0.0/-1"));
+	TEST_CHECK(!trie.Insert("10.0.0.0/"));
+	TEST_CHECK(!trie.Insert("10.0.0.0/8x"));
+	TEST_CHECK(!trie.Insert("/8"));
+	TEST_CHECK(!trie.Insert("10.0.0/8"));
+	TEST_CHECK(!trie.Insert("256.0.0.0/8"));
+	TEST_CHECK(!trie.Insert("fc00:::/7"));
+	TEST_CHECK(!trie.Insert("not an address"));
+	TEST_CHECK(!trie.Insert(""));
+	TEST_CHECK(!trie.Insert(std::string(100, '1').c_str()));
+
+	uint8_t address[16];
+	TEST_CHECK(CAddressPrefixTrie::ParseAddress("1.2.3.4", address));
+	const uint8_t mapped[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 1, 2, 3, 4};
+	TEST_CHECK(!memcmp(address, mapped, sizeof(mapped)));
+}
+
+static void TestEdges()
+{
+	CAddressPrefixTrie trie;
+
+	// Nothing is blocked until something is inserted
+	TEST_CHECK(!Contains(trie, "0.0.0.0") && !Contains(trie, "::"));
+
+	trie.Insert("10.0.0.0/8");
+	TEST_CHECK(!Contains(trie, "9.255.255.255"));
+	TEST_CHECK(Contains(trie, "10.0.0.0") && Contains(trie, "10.255.255.255"));
+	TEST_CHECK(!Contains(trie, "11.0.0.0"));
+
+	// Prefixes that don't end on a byte
+	trie.Insert("172.16.0.0/12");
+	TEST_CHECK(!Contains(trie, "172.15.255.255") && Contains(trie, "172.16.0.0") && Contains(trie, "172.31.255.255") && !Contains(trie, "172.32.0.0"));
+
+	trie.Insert("100.64.0.0/10");
+	TEST_CHECK(!Contains(trie, "100.63.255.255") && Contains(trie, "100.64.0.0") && Contains(trie, "100.127.255.255") && !Contains(trie, "100.128.0.0"));
+
+	trie.Insert("fe80::/10");
+	TEST_CHECK(!Contains(trie, "fe7f:ffff:ffff:ffff:ffff:ffff:ffff:ffff") && Contains(trie, "fe80::") && Contains(trie, "febf:ffff:ffff:ffff:ffff:ffff:ffff:ffff") && !Contains(trie, "fec0::"));
+
+	trie.Insert("fc00::/7");
+	TEST_CHECK(!Contains(trie, "fbff:ffff:ffff:ffff:ffff:ffff:ffff:ffff") && Contains(trie, "fc00::") && Contains(trie, "fdff::1") && !Contains(trie, "fe00::"));
+
+	// Full length prefixes only match themselves
+	trie.Insert("192.0.2.1/32");
+	TEST_CHECK(Contains(trie, "192.0.2.1") && !Contains(trie, "192.0.2.0") && !Contains(trie, "192.0.2.2"));
+
+	trie.Insert("::1/128");
+	TEST_CHECK(Contains(trie, "::1") && !Contains(trie, "::") && !Contains(trie, "::2"));
+
+	// Host bits in the rule don't matter
+	trie.Insert("198.51.100.77/24");
+	TEST_CHECK(Contains(trie, "198.51.100.0") && Contains(trie, "198.51.100.255") && !Contains(trie, "198.51.101.0"));
+
+	// v4 rules cover the mapped form, not other v6 addresses with the same low bits
+	TEST_CHECK(Contains(trie, "::ffff:10.1.2.3"));
+	TEST_CHECK(!Contains(trie, "::10.1.2.3") && !Contains(trie, "64:ff9b::10.1.2.3"));
+}
+
+static void TestOverlap()
+{
+	// Longer prefix first, then one that covers it
+	CAddressPrefixTrie trie;
+	trie.Insert("10.1.2.0/24");
+	TEST_CHECK(!Contains(trie, "10.1.3.0"));
+	trie.Insert("10.0.0.0/8");
+	TEST_CHECK(Contains(trie, "10.1.2.3") && Contains(trie, "10.1.3.0") && Contains(trie, "10.200.0.1"));
+
+	// Shorter first, the longer one changes nothing
+	CAddressPrefixTrie other;
+	other.Insert("10.0.0.0/8");
+	other.Insert("10.1.2.0/24");
+	TEST_CHECK(Contains(other, "10.1.3.0") && !Contains(other, "11.0.0.0"));
+
+	// Siblings
+	CAddressPrefixTrie siblings;
+	siblings.Insert("192.168.0.0/17");
+	siblings.Insert("192.168.128.0/17");
+	TEST_CHECK(Contains(siblings, "192.168.0.1") && Contains(siblings, "192.168.255.255") && !Contains(siblings, "192.169.0.0"));
+
+	// v4 /0 is every mapped address and nothing else
+	CAddressPrefixTrie allV4;
+	allV4.Insert("0.0.0.0/0");
+	TEST_CHECK(Contains(allV4, "0.0.0.0") && Contains(allV4, "255.255.255.255") && !Contains(allV4, "2001:db8::1") && !Contains(allV4, "::"));
+
+	CAddressPrefixTrie all;
+	all.Insert("::/0");
+	TEST_CHECK(Contains(all, "1.2.3.4") && Contains(all, "2001:db8::1") && Contains(all, "::"));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Random prefixes and addresses against a plain prefix compare,
+//          addresses are made near the prefixes so matches aren't rare
+//-----------------------------------------------------------------------------
+static void TestRandom()
+{
+	std::mt19937 random(1);
+
+	for (int nRound = 0; nRound < 50; nRound++)
+	{
+		struct Prefix_t
+		{
+			uint8_t address[16];
+			int nLength;
+		};
+
+		std::vector<Prefix_t> vPrefixes(1 + random() % 40);
+		CAddressPrefixTrie trie;
+
+		for (Prefix_t& prefix : vPrefixes)
+		{
+			for (uint8_t& nByte : prefix.address)
+				nByte = static_cast<uint8_t>(random() % 4);
+
+			prefix.nLength = static_cast<int>(random() % 129);
+			trie.Insert(prefix.address, prefix.nLength);
+		}
+
+		for (int i = 0; i < 2000; i++)
+		{
+			uint8_t address[16];
+			for (uint8_t& nByte : address)
+				nByte = static_cast<uint8_t>(random() % 4);
+
+			bool bExpected = false;
+			for (const Prefix_t& prefix : vPrefixes)
+			{
+				bool bMatch = true;
+				for (int nBit = 0; nBit < prefix.nLength && bMatch; nBit++)
+					bMatch = ((address[nBit / 8] ^ prefix.address[nBit / 8]) >> (7 - nBit % 8) & 1) == 0;
+
+				bExpected |= bMatch;
+			}
+
+			TEST_CHECK(trie.Contains(address) == bExpected);
+		}
+	}
+}
+
+int main()
+{
+	TEST_RUN(TestParse);
+	TEST_RUN(TestEdges);
+	TEST_RUN(TestOverlap);
+	TEST_RUN(TestRandom);
+
+	return Test_Result();
+}
@@ -0,0 +1,151 @@
+//-----------------------------------------------------------------------------
+// Checks SHA-256 against the FIPS 180-2 vectors and HMAC-SHA256 against the
+// RFC 4231 ones
+//-----------------------------------------------------------------------------
+#include "networksystem/bcrypt.h"
+#include "utils/tests/test.h"
+
+#include <string>
+
+static std::string ToHex(const uint8_t* pData, size_t nSize)
+{
+	static const char s_szHex[] = "0123456789abcdef";
+
+	std::string svHex;
+	for (size_t i = 0; i < nSize; i++)
+	{
+		svHex.push_back(s_szHex[pData[i] >> 4]);
+		svHex.push_back(s_szHex[pData[i] & 0xF]);
+	}
+
+	return svHex;
+}
+
+static std::string Sha256(std::string_view svData)
+{
+	uint8_t hash[HMACSHA256_LEN];
+	CSHA256 sha;
+	sha.Update(svData.data(), svData.size());
+	sha.Final(hash);
+
+	return ToHex(hash, sizeof(hash));
+}
+
+static std::string HmacSha256(std::string_view svKey, std::string_view svData)
+{
+	uint8_t hash[HMACSHA256_LEN];
+	CHMACSHA256 hmac;
+	hmac.SetKey(svKey);
+	hmac.Compute(svData, hash);
+
+	return ToHex(hash, sizeof(hash));
+}
+
+static void TestSha256()
+{
+	TEST_CHECK(Sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	TEST_CHECK(Sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	TEST_CHECK(Sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	TEST_CHECK(Sha256("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu") ==
+			   "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+	TEST_CHECK(Sha256(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Feeding the message in pieces gives the same digest, splits land
+//          on both sides of every block and padding boundary
+//-----------------------------------------------------------------------------
+static void TestIncremental()
+{
+	std::string svData;
+	for (int i = 0; i < 200; i++)
+		svData.push_back(static_cast<char>(i * 7 + 3));
+
+	for (size_t nSize = 0; nSize <= svData.size(); nSize++)
+	{
+		std::string_view svMessage(svData.data(), nSize);
+		std::string svExpected = Sha256(svMessage);
+
+		for (size_t nSplit = 0; nSplit <= nSize; nSplit += 7)
+		{
+			uint8_t hash[HMACSHA256_LEN];
+			CSHA256 sha;
+			sha.Update(svMessage.data(), nSplit);
+			sha.Update(svMessage.data() + nSplit, nSize - nSplit);
+			sha.Final(hash);
+
+			TEST_CHECK(ToHex(hash, sizeof(hash)) == svExpected);
+		}
+	}
+
+	// One byte at a time across several blocks
+	uint8_t hash[HMACSHA256_LEN];
+	CSHA256 sha;
+	for (char c : svData)
+		sha.Update(&c, 1);
+	sha.Final(hash);
+	TEST_CHECK(ToHex(hash, sizeof(hash)) == Sha256(svData));
+}
+
+static void TestHmacSha256()
+{
+	// Cases 1, 2, 3, 6 and 7
+	TEST_CHECK(InitHMACSHA256());
+
+	// Case 4
+	std::string svKey;
+	for (char c = 1; c <= 25; c++)
+		svKey.push_back(c);
+	TEST_CHECK(HmacSha256(svKey, std::string(50, '\xcd')) == "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+
+	// Case 5, the RFC only gives the first 128 bits
+	TEST_CHECK(HmacSha256(std::string(20, '\x0c'), "Test With Truncation").substr(0, 32) == "a3b6167473100ee06e0c796c2955552b");
+
+	// Keys of exactly a block aren't hashed, one byte more is
+	TEST_CHECK(HmacSha256(std::string(64, 'k'), "data") != HmacSha256(std::string(65, 'k'), "data"));
+	TEST_CHECK(HmacSha256(std::string(64, 'k'), "data") != HmacSha256(std::string(63, 'k'), "data"));
+}
+
+static void TestVerify()
+{
+	CHMACSHA256 hmac;
+	hmac.SetKey("Jefe");
+
+	uint8_t hash[HMACSHA256_LEN];
+	hmac.Compute("what do ya want for nothing?", hash);
+	std::string svSig(reinterpret_cast<const char*>(hash), sizeof(hash));
+
+	// The keyed state is reused, every verify starts from it
+	for (int i = 0; i < 3; i++)
+		TEST_CHECK(hmac.Verify(svSig, "what do ya want for nothing?"));
+
+	TEST_CHECK(!hmac.Verify(svSig, "what do ya want for nothing!"));
+	TEST_CHECK(!hmac.Verify(svSig.substr(0, 31), "what do ya want for nothing?"));
+	TEST_CHECK(!hmac.Verify(svSig + '\0', "what do ya want for nothing?"));
+
+	for (size_t i = 0; i < svSig.size(); i++)
+	{
+		std::string svBad = svSig;
+		svBad[i] ^= 0x01;
+		TEST_CHECK(!hmac.Verify(svBad, "what do ya want for nothing?"));
+	}
+
+	// Rekeying replaces the old key
+	hmac.SetKey("other");
+	TEST_CHECK(!hmac.Verify(svSig, "what do ya want for nothing?"));
+	TEST_CHECK(VerifyHMACSHA256("Jefe", svSig, "what do ya want for nothing?"));
+
+	TEST_CHECK(ConstantTimeCompare("abc", "abc", 3));
+	TEST_CHECK(!ConstantTimeCompare("abc", "abd", 3));
+	TEST_CHECK(ConstantTimeCompare("abc", "xyz", 0));
+}
+
+int main()
+{
+	TEST_RUN(TestSha256);
+	TEST_RUN(TestIncremental);
+	TEST_RUN(TestHmacSha256);
+	TEST_RUN(TestVerify);
+
+	return Test_Result();
+}
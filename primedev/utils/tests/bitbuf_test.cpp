@@ -0,0 +1,242 @@
+//-----------------------------------------------------------------------------
+// Checks the CBitRead/CBitWrite varints round trip at every bit offset, and
+// that the byte aligned ReadBits and ReadString paths read the same data and
+// leave the reader in the same state as reading byte by byte
+//-----------------------------------------------------------------------------
+#include "mathlib/bitbuf.h"
+#include "utils/tests/test.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes values after nPrefixBits bits, then reads them back
+//-----------------------------------------------------------------------------
+template <typename T, typename Write, typename Read>
+static void RoundTrip(const std::vector<T>& vValues, Write fnWrite, Read fnRead)
+{
+	for (int nPrefixBits = 0; nPrefixBits < 8; nPrefixBits++)
+	{
+		uint32 buffer[512] = {};
+		CBitWrite write(buffer, sizeof(buffer));
+		write.WriteUBitLong(0x55, nPrefixBits);
+
+		for (T value : vValues)
+			fnWrite(write, value);
+		TEST_CHECK(!write.IsOverflowed());
+
+		CBitRead read(buffer, BitByte(write.GetNumBitsWritten()));
+		TEST_CHECK(read.ReadUBitLong(nPrefixBits) == (0x55u & ((1u << nPrefixBits) - 1)));
+
+		for (T value : vValues)
+			TEST_CHECK(fnRead(read) == value);
+
+		TEST_CHECK(!read.IsOverflowed());
+		TEST_CHECK(read.Tell() == write.GetNumBitsWritten());
+	}
+}
+
+static void TestVarInt()
+{
+	std::mt19937_64 rng(42);
+
+	std::vector<uint32> v32 = {0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000, 0xFFFFFFF, 0x10000000, 0xFFFFFFFF};
+	std::vector<uint64> v64 = {0, 1, 0x7F, 0x80, 0xFFFFFFFF, 0x100000000, 0x7FFFFFFFFFFFFFFF, 0x8000000000000000, 0xFFFFFFFFFFFFFFFF};
+	std::vector<int32> vS32 = {0, 1, -1, 63, -64, 64, -65, INT32_MAX, INT32_MIN};
+	std::vector<int64> vS64 = {0, 1, -1, INT64_MAX, INT64_MIN, int64(INT32_MIN) - 1};
+	std::vector<uint32> vUBitVar = {0, 0xF, 0x10, 0xFF, 0x100, 0xFFF, 0x1000, 0x3FFFFFFF, 0x40000000, 0xFFFFFFFF};
+
+	for (int i = 0; i < 200; i++)
+	{
+		// Random values of every length, not just 64 bit ones
+		uint64 value = rng() >> (rng() % 64);
+		v32.push_back(uint32(value));
+		v64.push_back(value);
+		vS32.push_back(int32(value));
+		vS64.push_back(int64(value));
+		vUBitVar.push_back(uint32(value));
+	}
+
+	RoundTrip(v32, [](CBitWrite& write, uint32 value) { write.WriteVarInt32(value); }, [](CBitRead& read) { return read.ReadVarInt32(); });
+	RoundTrip(v64, [](CBitWrite& write, uint64 value) { write.WriteVarInt64(value); }, [](CBitRead& read) { return read.ReadVarInt64(); });
+	RoundTrip(vS32, [](CBitWrite& write, int32 value) { write.WriteSignedVarInt32(value); }, [](CBitRead& read) { return read.ReadSignedVarInt32(); });
+	RoundTrip(vS64, [](CBitWrite& write, int64 value) { write.WriteSignedVarInt64(value); }, [](CBitRead& read) { return read.ReadSignedVarInt64(); });
+	RoundTrip(vUBitVar, [](CBitWrite& write, uint32 value) { write.WriteUBitVar(value); }, [](CBitRead& read) { return read.ReadUBitVar(); });
+
+	// Same bytes as protobuf, 7 bits per byte and small signed values stay small
+	uint32 buffer[4] = {};
+	CBitWrite write(buffer, sizeof(buffer));
+	write.WriteVarInt32(300);
+	write.WriteSignedVarInt32(-1);
+	write.WriteVarInt64(0xFFFFFFFFFFFFFFFF);
+	TEST_CHECK(write.GetNumBitsWritten() == (2 + 1 + 10) * 8);
+
+	const uint8* pBytes = reinterpret_cast<const uint8*>(buffer);
+	TEST_CHECK(pBytes[0] == 0xAC && pBytes[1] == 0x02 && pBytes[2] == 0x01 && pBytes[12] == 0x01);
+
+	// Sizes of the UBitVar buckets
+	for (uint32 value : {0xFu, 0xFFu, 0xFFFu, 0xFFFFFFFFu})
+	{
+		uint32 varBuffer[4] = {};
+		CBitWrite varWrite(varBuffer, sizeof(varBuffer));
+		varWrite.WriteUBitVar(value);
+		TEST_CHECK(varWrite.GetNumBitsWritten() == (value == 0xF ? 6 : value == 0xFF ? 10 : value == 0xFFF ? 14 : 34));
+	}
+
+	// A varint that runs off the end reads as overflowed rather than past the buffer
+	alignas(4) uint8 truncated[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+	CBitRead read(truncated, sizeof(truncated));
+	read.ReadVarInt64();
+	TEST_CHECK(read.IsOverflowed());
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A buffer of exactly nBytes, so reading past it trips the sanitizers
+//-----------------------------------------------------------------------------
+static std::unique_ptr<uint8[]> MakeBuffer(size_t nBytes, std::mt19937& rng, bool bNoZeros = false)
+{
+	std::unique_ptr<uint8[]> pBuffer(new uint8[nBytes]);
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		pBuffer[i] = uint8(rng());
+		if (bNoZeros && !pBuffer[i])
+			pBuffer[i] = 'z';
+	}
+
+	return pBuffer;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the rest of both buffers in odd sized pieces, they should
+//          agree on every value and on where they are
+//-----------------------------------------------------------------------------
+static void CheckSameState(CBitRead& read, CBitRead& reference)
+{
+	TEST_CHECK(read.Tell() == reference.Tell());
+	TEST_CHECK(read.IsOverflowed() == reference.IsOverflowed());
+
+	for (int i = 0; i < 8; i++)
+	{
+		int nBits = 1 + i * 4;
+		TEST_CHECK(read.ReadUBitLong(nBits) == reference.ReadUBitLong(nBits));
+		TEST_CHECK(read.Tell() == reference.Tell());
+		TEST_CHECK(read.IsOverflowed() == reference.IsOverflowed());
+	}
+}
+
+static void TestAlignedReadBits()
+{
+	std::mt19937 rng(7);
+
+	for (size_t nBytes = 1; nBytes <= 70; nBytes++)
+	{
+		std::unique_ptr<uint8[]> pBuffer = MakeBuffer(nBytes, rng);
+
+		for (int64 nStart = 0; nStart <= int64(nBytes * 8); nStart += (nStart < 40 ? 1 : 8))
+		{
+			for (int nBits : {64, 65, 71, 72, 96, 129, 200, 8 * int(nBytes)})
+			{
+				if (nBits < 64)
+					continue;
+
+				CBitRead read(pBuffer.get(), int(nBytes));
+				CBitRead reference(pBuffer.get(), int(nBytes));
+				read.Seek(nStart);
+				reference.Seek(nStart);
+
+				// Output one byte off dword alignment, ReadBits realigns it afterwards
+				uint8 out[80] = {}, expected[80] = {};
+				read.ReadBits(out + 1, nBits);
+
+				for (int i = 0; i < nBits / 8; i++)
+					expected[i + 1] = uint8(reference.ReadUBitLong(8));
+				if (nBits & 7)
+					expected[nBits / 8 + 1] = uint8(reference.ReadUBitLong(nBits & 7));
+
+				// What an overflowed read leaves in the output depends on the chunk size it was read in
+				TEST_CHECK(reference.IsOverflowed() || !memcmp(out, expected, sizeof(out)));
+				CheckSameState(read, reference);
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The char by char loop ReadString uses when it isn't byte aligned
+//-----------------------------------------------------------------------------
+static bool ReferenceReadString(CBitRead& read, char* pStr, int maxLen, bool bLine, int* pOutNumChars)
+{
+	bool bTooSmall = false;
+	int iChar = 0;
+
+	for (;;)
+	{
+		char val = char(read.ReadChar());
+		if (val == 0 || (bLine && val == '\n'))
+			break;
+
+		if (iChar < (maxLen - 1))
+			pStr[iChar++] = val;
+		else
+			bTooSmall = true;
+	}
+
+	pStr[iChar] = '\0';
+	*pOutNumChars = iChar;
+
+	return !read.IsOverflowed() && !bTooSmall;
+}
+
+static void TestAlignedReadString()
+{
+	std::mt19937 rng(11);
+
+	for (size_t nBytes = 1; nBytes <= 40; nBytes++)
+	{
+		// Strings and newlines at random spots, sometimes no terminator at all
+		std::unique_ptr<uint8[]> pBuffer = MakeBuffer(nBytes, rng, true);
+		for (size_t i = 0; i < nBytes; i++)
+		{
+			if (rng() % 6 == 0)
+				pBuffer[i] = 0;
+			else if (rng() % 10 == 0)
+				pBuffer[i] = '\n';
+		}
+
+		for (int64 nStart = 0; nStart < int64(nBytes * 8); nStart += (nStart % 8 ? 7 : 1))
+		{
+			for (int maxLen : {1, 4, 64})
+			{
+				for (bool bLine : {false, true})
+				{
+					CBitRead read(pBuffer.get(), int(nBytes));
+					CBitRead reference(pBuffer.get(), int(nBytes));
+					read.Seek(nStart);
+					reference.Seek(nStart);
+
+					char str[64], expected[64];
+					int nChars = -1, nExpectedChars = -2;
+
+					bool bRead = read.ReadString(str, maxLen, bLine, &nChars);
+					bool bExpected = ReferenceReadString(reference, expected, maxLen, bLine, &nExpectedChars);
+
+					TEST_CHECK(bRead == bExpected);
+					TEST_CHECK(nChars == nExpectedChars);
+					TEST_CHECK(std::string(str) == std::string(expected));
+					CheckSameState(read, reference);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TEST_RUN(TestVarInt);
+	TEST_RUN(TestAlignedReadBits);
+	TEST_RUN(TestAlignedReadString);
+
+	return Test_Result();
+}
@@ -0,0 +1,217 @@
+//-----------------------------------------------------------------------------
+// Checks which fields CHeartBeatState sends, and prints bytes and CPU per
+// heartbeat for a server with 200 mods loaded
+//-----------------------------------------------------------------------------
+#include "networksystem/heartbeat.h"
+#include "utils/tests/test.h"
+
+#include <chrono>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+static HeartBeatValues_t MakeValues()
+{
+	HeartBeatValues_t values;
+	values.svName = "Test Server #1";
+	values.svDescription = "Friendly & fun";
+	values.svMap = "mp_forwardbase_kodai";
+	values.svPlaylist = "aitdm";
+	values.svMaxPlayers = "16";
+	values.svPassword = "";
+	values.nPort = 37015;
+	values.nPlayerCount = 0;
+	values.nModGeneration = 1;
+	return values;
+}
+
+static bool HasParam(const std::string& svUrl, const char* pszParam)
+{
+	return svUrl.find(std::string("&") + pszParam + "=") != std::string::npos;
+}
+
+static void TestEscape()
+{
+	std::string svOut;
+	CHeartBeatState::AppendEscaped(svOut, "Az09-._~ /&=%+\xC3\xBC");
+	TEST_CHECK(svOut == "Az09-._~%20%2F%26%3D%25%2B%C3%BC");
+}
+
+static void TestFull()
+{
+	CHeartBeatState state;
+	state.Update(MakeValues());
+
+	HeartBeatRequest_t request;
+	state.Build("http://atlas", "server1", false, request);
+	TEST_CHECK(request.svUrl == "http://atlas/server/update_values?id=server1&name=Test%20Server%20%231&description=Friendly%20%26%20fun&map=mp_forwardbase_kodai&playlist=aitdm&playerCount=0&maxPlayers=16&password=&port=37015&authPort=udp");
+	TEST_CHECK(request.bModInfo);
+	TEST_CHECK(request.nFields == HEARTBEAT_ALL);
+
+	// Older atlas gets everything every time
+	std::string svFirst = request.svUrl;
+	state.Update(MakeValues());
+	state.Build("http://atlas", "server1", false, request);
+	TEST_CHECK(request.svUrl == svFirst && request.bModInfo);
+
+	HeartBeatValues_t values = MakeValues();
+	values.nPlayerCount = 5;
+	state.Update(values);
+	state.Build("http://atlas", "server1", false, request);
+	TEST_CHECK(HasParam(request.svUrl, "playerCount") && request.svUrl.find("playerCount=5") != std::string::npos && HasParam(request.svUrl, "map"));
+}
+
+static void TestDelta()
+{
+	CHeartBeatState state;
+	HeartBeatValues_t values = MakeValues();
+	state.Update(values);
+
+	// Everything goes out first
+	HeartBeatRequest_t request;
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.nFields == HEARTBEAT_ALL && request.bModInfo);
+	TEST_CHECK(HasParam(request.svUrl, "name") && HasParam(request.svUrl, "port") && HasParam(request.svUrl, "password"));
+
+	// Nothing changed
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.svUrl == "http://atlas/server/keepalive?id=server1");
+	TEST_CHECK(!request.nFields && !request.bModInfo);
+
+	// Only the player count
+	values.nPlayerCount = 3;
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.svUrl == "http://atlas/server/update_values?id=server1&playerCount=3");
+	TEST_CHECK(request.nFields == HEARTBEAT_PLAYER_COUNT && !request.bModInfo);
+
+	// Map and playlist at once
+	values.svMap = "mp_glitch";
+	values.svPlaylist = "ctf";
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.svUrl == "http://atlas/server/update_values?id=server1&map=mp_glitch&playlist=ctf");
+
+	// Mods only, the url has no fields but the form is attached
+	values.nModGeneration++;
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.svUrl == "http://atlas/server/update_values?id=server1" && request.bModInfo);
+
+	// A failed heartbeat's fields go out again, along with newer changes
+	values.nPlayerCount = 4;
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	state.Failed(request.nFields);
+	values.svPassword = "hunter2";
+	state.Update(values);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(request.nFields == (HEARTBEAT_PLAYER_COUNT | HEARTBEAT_PASSWORD));
+
+	// Failing a keepalive doesn't resend anything
+	state.Build("http://atlas", "server1", true, request);
+	state.Failed(request.nFields);
+	state.Build("http://atlas", "server1", true, request);
+	TEST_CHECK(!request.nFields);
+
+	// Registered again, atlas knows nothing about us
+	state.Build("http://atlas", "server2", true, request);
+	TEST_CHECK(request.nFields == HEARTBEAT_ALL && request.bModInfo);
+
+	state.Build("http://other", "server2", true, request);
+	TEST_CHECK(request.nFields == HEARTBEAT_ALL);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: An hour of heartbeats, players come and go every half minute and
+//          the map changes every 10 minutes
+//-----------------------------------------------------------------------------
+static void TestBench()
+{
+	std::vector<std::pair<std::string, std::string>> vMods;
+	for (int i = 0; i < 200; i++)
+		vMods.push_back({"Author.SomeLongerModName" + std::to_string(i), std::to_string(i % 4) + "." + std::to_string(i % 10) + ".0"});
+
+	auto SerialiseMods = [&]()
+	{
+		nlohmann::json jsModList;
+		for (const auto& [svName, svVersion] : vMods)
+			jsModList["Mods"].push_back({{"Name", svName}, {"Version", svVersion}, {"RequiredOnClient", true}});
+
+		return jsModList.dump();
+	};
+
+	const std::string svModInfo = SerialiseMods();
+	const int nBeats = 720;
+
+	auto ValuesAt = [](int nBeat)
+	{
+		HeartBeatValues_t values = MakeValues();
+		values.nPlayerCount = (nBeat / 6) % 16;
+		values.svMap = (nBeat / 120) % 2 ? "mp_glitch" : "mp_forwardbase_kodai";
+		return values;
+	};
+
+	printf("  %-28s %12s %12s\n", "200 mods", "bytes/beat", "us/beat");
+
+	// What every beat used to do, rebuild the mod list and the url
+	{
+		size_t nBytes = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < nBeats; i++)
+		{
+			HeartBeatValues_t values = ValuesAt(i);
+			std::string svUrl = "http://atlas/server/update_values?id=server1";
+			CHeartBeatState::AppendEscaped(svUrl, values.svName);
+			CHeartBeatState::AppendEscaped(svUrl, values.svDescription);
+			CHeartBeatState::AppendEscaped(svUrl, values.svMap);
+			CHeartBeatState::AppendEscaped(svUrl, values.svPlaylist);
+			CHeartBeatState::AppendEscaped(svUrl, values.svPassword);
+			nBytes += svUrl.size() + SerialiseMods().size();
+		}
+		double flUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		printf("  %-28s %12zu %12.2f\n", "rebuilt every beat", nBytes / nBeats, flUs / nBeats);
+	}
+
+	size_t nDeltaBytes = 0;
+	for (bool bDelta : {false, true})
+	{
+		CHeartBeatState state;
+		size_t nBytes = 0;
+		int nKeepAlives = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < nBeats; i++)
+		{
+			state.Update(ValuesAt(i));
+
+			HeartBeatRequest_t request;
+			state.Build("http://atlas", "server1", bDelta, request);
+
+			nBytes += request.svUrl.size() + (request.bModInfo ? svModInfo.size() : 0);
+			nKeepAlives += !request.nFields;
+		}
+		double flUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		printf("  %-28s %12zu %12.2f   %i keepalives\n", bDelta ? "dirty fields and keepalive" : "cached, full every beat", nBytes / nBeats, flUs / nBeats, nKeepAlives);
+
+		if (bDelta)
+			nDeltaBytes = nBytes;
+		else
+			TEST_CHECK(nBytes > svModInfo.size() * nBeats);
+	}
+
+	// The mod list only goes out once
+	TEST_CHECK(nDeltaBytes < svModInfo.size() + nBeats * 100);
+}
+
+int main()
+{
+	TEST_RUN(TestEscape);
+	TEST_RUN(TestFull);
+	TEST_RUN(TestDelta);
+	TEST_RUN(TestBench);
+
+	return Test_Result();
+}
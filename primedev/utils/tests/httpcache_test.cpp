@@ -0,0 +1,302 @@
+//-----------------------------------------------------------------------------
+// Checks the script http cache against canned responses, freshness,
+// revalidation, dedup, the disk tier and the per mod limits
+//-----------------------------------------------------------------------------
+#include "game/shared/vscript_httpcache.h"
+#include "utils/tests/test.h"
+
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+static std::string Headers(const char* pszHeaders)
+{
+	return std::string("HTTP/1.1 200 OK\r\n") + pszHeaders + "\r\n";
+}
+
+static void TestFreshness()
+{
+	CScriptHttpCache cache;
+
+	cache.Store("a", "body a", Headers("Cache-Control: max-age=60\r\n"), 100.0, fs::path());
+	CachedHttpResponsePtr pResponse = cache.GetFresh("a", 159.0);
+	TEST_CHECK(pResponse && pResponse->svBody == "body a");
+	TEST_CHECK(!cache.GetFresh("a", 160.0));
+
+	// Age counts against max-age
+	cache.Store("b", "body b", Headers("Cache-Control: public, max-age=\"60\"\r\nAge: 50\r\n"), 100.0, fs::path());
+	TEST_CHECK(cache.GetFresh("b", 109.0) && !cache.GetFresh("b", 110.0));
+
+	// Expires is measured against Date
+	cache.Store("c", "body c", Headers("Date: Sun, 18 Oct 2026 00:00:00 GMT\r\nExpires: Sun, 18 Oct 2026 00:00:30 GMT\r\n"), 100.0, fs::path());
+	TEST_CHECK(cache.GetFresh("c", 129.0) && !cache.GetFresh("c", 130.0));
+
+	cache.Store("d", "body d", Headers("Cache-Control: no-store, max-age=60\r\n"), 100.0, fs::path());
+	TEST_CHECK(!cache.GetFresh("d", 100.0));
+
+	// Storing over an entry the server no longer allows caching drops it
+	cache.Store("a", "body a", Headers("Cache-Control: no-store\r\n"), 100.0, fs::path());
+	TEST_CHECK(!cache.GetFresh("a", 100.0));
+
+	// Only the last response of a redirect counts
+	cache.Store("e", "body e", "HTTP/1.1 301 Moved\r\nCache-Control: max-age=600\r\n\r\nHTTP/1.1 200 OK\r\nCache-Control: no-cache\r\n\r\n", 100.0, fs::path());
+	TEST_CHECK(!cache.GetFresh("e", 100.0));
+}
+
+static void TestRevalidate()
+{
+	CScriptHttpCache cache;
+	std::string svETag, svLastModified;
+
+	// Nothing to revalidate without a validator
+	cache.Store("a", "body a", Headers("Cache-Control: max-age=10\r\n"), 100.0, fs::path());
+	TEST_CHECK(!cache.GetStale("a", svETag, svLastModified));
+
+	cache.Store("b", "body b", Headers("Cache-Control: no-cache\r\nETag: \"v1\"\r\nLast-Modified: Sat, 17 Oct 2026 00:00:00 GMT\r\n"), 100.0, fs::path());
+	TEST_CHECK(!cache.GetFresh("b", 100.0));
+
+	CachedHttpResponsePtr pStale = cache.GetStale("b", svETag, svLastModified);
+	TEST_CHECK(pStale && pStale->svBody == "body b");
+	TEST_CHECK(svETag == "\"v1\"" && svLastModified == "Sat, 17 Oct 2026 00:00:00 GMT");
+
+	// A 304 can make it fresh and change the validators
+	cache.Revalidate("b", pStale, "HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=30\r\nETag: \"v2\"\r\n\r\n", 200.0);
+	TEST_CHECK(cache.GetFresh("b", 229.0) && !cache.GetFresh("b", 230.0));
+	TEST_CHECK(cache.GetStale("b", svETag, svLastModified) && svETag == "\"v2\"");
+
+	// Without a lifetime the old one is kept
+	pStale = cache.GetStale("b", svETag, svLastModified);
+	cache.Revalidate("b", pStale, "HTTP/1.1 304 Not Modified\r\n\r\n", 300.0);
+	TEST_CHECK(cache.GetFresh("b", 329.0) && !cache.GetFresh("b", 330.0));
+
+	// A newer response stored while the conditional request was in flight wins
+	pStale = cache.GetStale("b", svETag, svLastModified);
+	cache.Store("b", "body b2", Headers("Cache-Control: max-age=5\r\nETag: \"v3\"\r\n"), 400.0, fs::path());
+	cache.Revalidate("b", pStale, "HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=1000\r\n\r\n", 400.0);
+	CachedHttpResponsePtr pFresh = cache.GetFresh("b", 404.0);
+	TEST_CHECK(pFresh && pFresh->svBody == "body b2" && !cache.GetFresh("b", 405.0));
+
+	pStale = cache.GetStale("b", svETag, svLastModified);
+	cache.Revalidate("b", pStale, "HTTP/1.1 304 Not Modified\r\nCache-Control: no-store\r\n\r\n", 500.0);
+	TEST_CHECK(!cache.GetStale("b", svETag, svLastModified));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The entry gets evicted while its conditional request is in flight
+//-----------------------------------------------------------------------------
+static void TestRevalidateEvicted()
+{
+	CScriptHttpCache cache;
+	std::string svETag, svLastModified;
+
+	cache.Store("a", "body a", Headers("Cache-Control: max-age=0\r\nETag: \"v1\"\r\n"), 100.0, fs::path());
+	CachedHttpResponsePtr pStale = cache.GetStale("a", svETag, svLastModified);
+	TEST_CHECK(pStale);
+
+	std::string svBig(CScriptHttpCache::MAX_ENTRY_SIZE - 1024, 'x');
+	for (int i = 0; i < 10; i++)
+		cache.Store("big" + std::to_string(i), svBig, Headers("Cache-Control: max-age=60\r\n"), 100.0, fs::path());
+
+	TEST_CHECK(!cache.GetStale("a", svETag, svLastModified));
+
+	// The pinned response answers the 304 and goes back in with its validators
+	TEST_CHECK(pStale->svBody == "body a");
+	cache.Revalidate("a", pStale, "HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=30\r\n\r\n", 200.0);
+
+	CachedHttpResponsePtr pFresh = cache.GetFresh("a", 210.0);
+	TEST_CHECK(pFresh && pFresh->svBody == "body a");
+	TEST_CHECK(cache.GetStale("a", svETag, svLastModified) && svETag == "\"v1\"");
+
+	// Cleared entries can come back the same way
+	pStale = cache.GetStale("a", svETag, svLastModified);
+	cache.Clear();
+	cache.Revalidate("a", pStale, "HTTP/1.1 304 Not Modified\r\n\r\n", 300.0);
+	TEST_CHECK(cache.GetStale("a", svETag, svLastModified) && !cache.GetFresh("a", 300.0));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Scripts polling a few urls, hits once each is cached and the
+//          least recently used ones go first when it's full
+//-----------------------------------------------------------------------------
+static void TestHitRatio()
+{
+	CScriptHttpCache cache;
+	std::mt19937 random(1);
+
+	std::string svBody(512 * 1024, 'x');
+	int nHits = 0;
+	int nRequests = 0;
+
+	// 40 urls of 512 kb don't fit in 16 mb, the 8 hot ones always should
+	for (int i = 0; i < 4000; i++)
+	{
+		int nUrl = random() % 4 ? static_cast<int>(random() % 8) : 8 + static_cast<int>(random() % 32);
+		std::string svKey = "url" + std::to_string(nUrl);
+
+		nRequests++;
+		if (cache.GetFresh(svKey, i * 0.01))
+			nHits++;
+		else
+			cache.Store(svKey, svBody, Headers("Cache-Control: max-age=3600\r\n"), i * 0.01, fs::path());
+	}
+
+	printf("  %i of %i requests hit\n", nHits, nRequests);
+	TEST_CHECK(nHits > nRequests * 3 / 4);
+
+	for (int i = 0; i < 8; i++)
+		TEST_CHECK(cache.GetFresh("url" + std::to_string(i), 40.0));
+}
+
+static void TestDedup()
+{
+	CScriptHttpCache cache;
+
+	TEST_CHECK(!cache.JoinInFlight("a", 1, ScriptContext(0)));
+	for (int i = 2; i <= 20; i++)
+		TEST_CHECK(cache.JoinInFlight("a", i, ScriptContext(i % 3)));
+
+	// A different request makes its own transfer
+	TEST_CHECK(!cache.JoinInFlight("b", 21, ScriptContext(0)));
+
+	std::vector<HttpWaiter_t> vWaiters = cache.FinishInFlight("a");
+	TEST_CHECK(vWaiters.size() == 19);
+	TEST_CHECK(!vWaiters.empty() && vWaiters.front().nHandle == 2 && vWaiters.back().nHandle == 20);
+
+	// Finished, the next one starts a transfer again
+	TEST_CHECK(cache.FinishInFlight("a").empty());
+	TEST_CHECK(!cache.JoinInFlight("a", 22, ScriptContext(0)));
+	TEST_CHECK(cache.FinishInFlight("b").empty());
+}
+
+static void TestDisk()
+{
+	fs::path diskDir = fs::temp_directory_path() / "nshttpcache_test";
+	fs::remove_all(diskDir);
+
+	{
+		CScriptHttpCache cache;
+		TEST_CHECK(cache.Store("a", "body a", Headers("Cache-Control: max-age=3600\r\n"), 100.0, diskDir));
+		TEST_CHECK(cache.Store("b", "body b", Headers("Cache-Control: no-cache\r\nETag: \"v1\"\r\n"), 100.0, diskDir));
+		TEST_CHECK(!cache.Store("c", "body c", Headers("Cache-Control: no-store\r\n"), 100.0, diskDir));
+		TEST_CHECK(fs::exists(CScriptHttpCache::GetDiskFile("a", diskDir)));
+	}
+
+	// Next session, Plat_FloatTime started over
+	{
+		CScriptHttpCache cache;
+		TEST_CHECK(cache.LoadFromDisk("a", diskDir, 5.0));
+		CachedHttpResponsePtr pResponse = cache.GetFresh("a", 5.0);
+		TEST_CHECK(pResponse && pResponse->svBody == "body a");
+
+		// Already in memory
+		TEST_CHECK(!cache.LoadFromDisk("a", diskDir, 5.0));
+
+		std::string svETag, svLastModified;
+		TEST_CHECK(cache.LoadFromDisk("b", diskDir, 5.0));
+		TEST_CHECK(!cache.GetFresh("b", 5.0) && cache.GetStale("b", svETag, svLastModified) && svETag == "\"v1\"");
+
+		TEST_CHECK(!cache.LoadFromDisk("c", diskDir, 5.0));
+		TEST_CHECK(!cache.LoadFromDisk("missing", diskDir, 5.0));
+
+		// no-store removes what was there
+		cache.Store("a", "body a", Headers("Cache-Control: no-store\r\n"), 10.0, diskDir);
+		TEST_CHECK(!fs::exists(CScriptHttpCache::GetDiskFile("a", diskDir)));
+	}
+
+	// Truncated or foreign files are ignored
+	{
+		fs::path file = CScriptHttpCache::GetDiskFile("b", diskDir);
+		std::string svData;
+		{
+			std::ifstream stream(file, std::ios::binary);
+			svData.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+
+		for (size_t nSize : {size_t(0), size_t(3), svData.size() / 2, svData.size() - 1})
+		{
+			std::ofstream(file, std::ios::binary | std::ios::trunc).write(svData.data(), nSize);
+			CScriptHttpCache cache;
+			TEST_CHECK(!cache.LoadFromDisk("b", diskDir, 5.0));
+		}
+
+		// Written for another key
+		std::ofstream(file, std::ios::binary | std::ios::trunc).write(svData.data(), svData.size());
+		fs::copy_file(file, CScriptHttpCache::GetDiskFile("other", diskDir));
+		CScriptHttpCache cache;
+		TEST_CHECK(!cache.LoadFromDisk("other", diskDir, 5.0));
+		TEST_CHECK(cache.LoadFromDisk("b", diskDir, 5.0));
+	}
+
+	// The folder stays under its cap, oldest files go first
+	{
+		CScriptHttpCache cache;
+		std::string svBody(CScriptHttpCache::MAX_ENTRY_SIZE - 4096, 'x');
+		for (int i = 0; i < 10; i++)
+			TEST_CHECK(cache.Store("big" + std::to_string(i), svBody, Headers("Cache-Control: max-age=3600\r\n"), 100.0, diskDir));
+
+		uintmax_t nTotal = 0;
+		for (const fs::directory_entry& entry : fs::directory_iterator(diskDir))
+			nTotal += entry.file_size();
+
+		TEST_CHECK(nTotal <= CScriptHttpCache::MAX_DISK_SIZE);
+		TEST_CHECK(fs::exists(CScriptHttpCache::GetDiskFile("big9", diskDir)) && !fs::exists(CScriptHttpCache::GetDiskFile("big0", diskDir)));
+	}
+
+	fs::remove_all(diskDir);
+}
+
+static void TestModLimiter()
+{
+	CScriptHttpModLimiter limiter;
+	int nStarted = 0;
+	auto fnStart = [&nStarted]() { nStarted++; };
+
+	for (int i = 0; i < 4; i++)
+		TEST_CHECK(limiter.Acquire("mod", 4, fnStart) == eHttpSlot::START);
+
+	// Other mods have their own slots
+	TEST_CHECK(limiter.Acquire("other", 4, fnStart) == eHttpSlot::START);
+
+	for (size_t i = 0; i < CScriptHttpModLimiter::MAX_QUEUED; i++)
+		TEST_CHECK(limiter.Acquire("mod", 4, fnStart) == eHttpSlot::QUEUED);
+	TEST_CHECK(limiter.Acquire("mod", 4, fnStart) == eHttpSlot::FULL);
+
+	// Every release hands its slot to the next queued transfer
+	for (size_t i = 0; i < CScriptHttpModLimiter::MAX_QUEUED; i++)
+	{
+		std::function<void()> fnNext = limiter.Release("mod");
+		TEST_CHECK(fnNext != nullptr);
+		if (fnNext)
+			fnNext();
+	}
+	TEST_CHECK(nStarted == static_cast<int>(CScriptHttpModLimiter::MAX_QUEUED));
+
+	for (int i = 0; i < 4; i++)
+		TEST_CHECK(!limiter.Release("mod"));
+	TEST_CHECK(limiter.Acquire("mod", 1, fnStart) == eHttpSlot::START);
+	TEST_CHECK(limiter.Acquire("mod", 0, fnStart) == eHttpSlot::START);
+
+	// A second of bandwidth goes out at once, after that transfers wait
+	TEST_CHECK(limiter.Consume("mod", 1000, 10.0, 1000.0) == 0.0);
+	TEST_CHECK(limiter.Consume("mod", 500, 10.0, 1000.0) == 0.5);
+	TEST_CHECK(limiter.Consume("mod", 500, 11.0, 1000.0) == 0.0);
+	TEST_CHECK(limiter.Consume("other", 1000, 11.0, 1000.0) == 0.0);
+	TEST_CHECK(limiter.Consume("mod", 1000000, 11.0, 0.0) == 0.0);
+
+	// Refills stop at a second worth
+	TEST_CHECK(limiter.Consume("mod", 1500, 100.0, 1000.0) == 0.5);
+}
+
+int main()
+{
+	TEST_RUN(TestFreshness);
+	TEST_RUN(TestRevalidate);
+	TEST_RUN(TestRevalidateEvicted);
+	TEST_RUN(TestHitRatio);
+	TEST_RUN(TestDedup);
+	TEST_RUN(TestDisk);
+	TEST_RUN(TestModLimiter);
+
+	return Test_Result();
+}
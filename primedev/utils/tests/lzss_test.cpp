@@ -0,0 +1,294 @@
+//-----------------------------------------------------------------------------
+// Checks LZSS_SafeDecompress round trips what the engine's compressor writes,
+// matches the original byte at a time loop, and never writes past the output
+// buffer however the stream is mangled
+//-----------------------------------------------------------------------------
+#include "tier1/lzss.h"
+#include "utils/tests/test.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static constexpr unsigned int LZSS_WINDOW = 4096;
+static constexpr unsigned int LZSS_MAX_MATCH = 16;
+
+//-----------------------------------------------------------------------------
+// Purpose: Greedy compressor writing the same format as CLZSS::Compress
+//-----------------------------------------------------------------------------
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> out(8);
+	uint32_t id = LZSS_ID;
+	uint32_t size = static_cast<uint32_t>(data.size());
+	memcpy(out.data(), &id, 4);
+	memcpy(out.data() + 4, &size, 4);
+
+	size_t nCmd = 0;
+	int nBit = 8;
+
+	auto Token = [&](bool bMatch)
+	{
+		if (nBit == 8)
+		{
+			nCmd = out.size();
+			out.push_back(0);
+			nBit = 0;
+		}
+
+		if (bMatch)
+			out[nCmd] |= 1 << nBit;
+		nBit++;
+	};
+
+	for (size_t i = 0; i < data.size();)
+	{
+		unsigned int nBestLength = 0;
+		unsigned int nBestPosition = 0;
+
+		for (unsigned int nPosition = 1; nPosition <= LZSS_WINDOW && nPosition <= i; nPosition++)
+		{
+			unsigned int nLength = 0;
+			while (nLength < LZSS_MAX_MATCH && i + nLength < data.size() && data[i + nLength] == data[i + nLength - nPosition])
+				nLength++;
+
+			if (nLength > nBestLength)
+			{
+				nBestLength = nLength;
+				nBestPosition = nPosition;
+			}
+		}
+
+		if (nBestLength >= 2)
+		{
+			Token(true);
+			out.push_back(static_cast<uint8_t>((nBestPosition - 1) >> 4));
+			out.push_back(static_cast<uint8_t>(((nBestPosition - 1) & 0xF) << 4 | (nBestLength - 1)));
+			i += nBestLength;
+		}
+		else
+		{
+			Token(false);
+			out.push_back(data[i++]);
+		}
+	}
+
+	// A match of length 1 ends the stream
+	Token(true);
+	out.push_back(0);
+	out.push_back(0);
+
+	return out;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The decompressor before literals and matches were copied in chunks
+//-----------------------------------------------------------------------------
+static unsigned int ReferenceDecompress(const uint8_t* pInput, uint8_t* pOutput, unsigned int unBufSize)
+{
+	uint32_t id, actualSize;
+	memcpy(&id, pInput, 4);
+	memcpy(&actualSize, pInput + 4, 4);
+
+	if (!actualSize || id != LZSS_ID || actualSize > unBufSize)
+		return 0;
+
+	pInput += 8;
+
+	unsigned int totalBytes = 0;
+	int getCmdByte = 0;
+	int cmdByte = 0;
+
+	for (;;)
+	{
+		if (!getCmdByte)
+			cmdByte = *pInput++;
+
+		getCmdByte = (getCmdByte + 1) & 0x07;
+
+		if (cmdByte & 0x01)
+		{
+			unsigned int position = *pInput++ << 4;
+			position |= (*pInput >> 4);
+			position += 1;
+			unsigned int count = (*pInput++ & 0x0F) + 1;
+			if (count == 1)
+				break;
+
+			if (position > totalBytes)
+				return 0;
+
+			totalBytes += count;
+			if (totalBytes > unBufSize)
+				return 0;
+
+			uint8_t* pSource = pOutput - position;
+			for (unsigned int i = 0; i < count; i++)
+				*pOutput++ = *pSource++;
+		}
+		else
+		{
+			totalBytes++;
+			if (totalBytes > unBufSize)
+				return 0;
+
+			*pOutput++ = *pInput++;
+		}
+		cmdByte = cmdByte >> 1;
+	}
+
+	if (totalBytes != actualSize)
+		return 0;
+
+	return totalBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs both decompressors into buffers of exactly unBufSize bytes
+// Note   : The stream carries no length, so the input is padded with enough
+//          zeros to hold the longest stream that could fill unBufSize
+//-----------------------------------------------------------------------------
+static bool DecompressBoth(std::vector<uint8_t> input, unsigned int unBufSize, std::vector<uint8_t>* pResult = nullptr)
+{
+	input.resize(input.size() + 8 + unBufSize * 3 + 16);
+
+	std::vector<uint8_t> output(unBufSize);
+	std::vector<uint8_t> reference(unBufSize);
+
+	unsigned int nSize = LZSS_SafeDecompress(input.data(), output.data(), unBufSize);
+	unsigned int nReferenceSize = ReferenceDecompress(input.data(), reference.data(), unBufSize);
+
+	TEST_CHECK(nSize == nReferenceSize);
+	TEST_CHECK(nSize <= unBufSize);
+
+	if (nSize && nSize == nReferenceSize)
+		TEST_CHECK(!memcmp(output.data(), reference.data(), nSize));
+
+	if (pResult)
+	{
+		output.resize(nSize);
+		*pResult = output;
+	}
+
+	return nSize != 0;
+}
+
+static void TestRoundTrip()
+{
+	std::mt19937 rng(1234);
+	std::vector<std::vector<uint8_t>> vInputs;
+
+	vInputs.push_back({'a'});
+	vInputs.push_back(std::vector<uint8_t>(10000, 'x'));
+
+	// Runs and repeats of every length around the 8 and 16 byte copies
+	for (unsigned int nPeriod = 1; nPeriod <= 40; nPeriod++)
+	{
+		std::vector<uint8_t> data;
+		for (unsigned int i = 0; i < 600; i++)
+			data.push_back(static_cast<uint8_t>(i % nPeriod));
+		vInputs.push_back(data);
+	}
+
+	// Incompressible, and text like with a small alphabet
+	for (unsigned int nSize : {7u, 8u, 9u, 15u, 16u, 17u, 1000u, 5000u})
+	{
+		std::vector<uint8_t> random(nSize), text(nSize);
+		for (unsigned int i = 0; i < nSize; i++)
+		{
+			random[i] = static_cast<uint8_t>(rng());
+			text[i] = static_cast<uint8_t>('a' + rng() % 6);
+		}
+		vInputs.push_back(random);
+		vInputs.push_back(text);
+	}
+
+	for (const std::vector<uint8_t>& data : vInputs)
+	{
+		std::vector<uint8_t> compressed = Compress(data);
+		std::vector<uint8_t> result;
+
+		TEST_CHECK(DecompressBoth(compressed, static_cast<unsigned int>(data.size()), &result));
+		TEST_CHECK(result == data);
+
+		// A bigger buffer is fine, one byte too small isn't
+		TEST_CHECK(DecompressBoth(compressed, static_cast<unsigned int>(data.size()) + 100));
+		TEST_CHECK(!DecompressBoth(compressed, static_cast<unsigned int>(data.size()) - 1));
+	}
+}
+
+static void TestMalformed()
+{
+	std::vector<uint8_t> compressed = Compress(std::vector<uint8_t>(100, 'q'));
+
+	// Bad id, empty, claims more than the buffer holds
+	std::vector<uint8_t> bad = compressed;
+	bad[0] ^= 1;
+	TEST_CHECK(!DecompressBoth(bad, 100));
+
+	bad = compressed;
+	memset(bad.data() + 4, 0, 4);
+	TEST_CHECK(!DecompressBoth(bad, 100));
+
+	TEST_CHECK(!DecompressBoth(compressed, 50));
+
+	// A match reaching back before the start of the output
+	std::vector<uint8_t> before = {0x4C, 0x5A, 0x53, 0x53, 16, 0, 0, 0, 0x01, 0x00, 0x1F};
+	TEST_CHECK(!DecompressBoth(before, 16));
+
+	// A match running past the end of the output
+	std::vector<uint8_t> past = {0x4C, 0x5A, 0x53, 0x53, 4, 0, 0, 0, 0x02, 'a', 0x00, 0x0F};
+	TEST_CHECK(!DecompressBoth(past, 4));
+
+	TEST_CHECK(!LZSS_SafeDecompress(nullptr, nullptr, 0));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Flips bits and bytes in valid streams and throws random ones at it
+//-----------------------------------------------------------------------------
+static void TestFuzz()
+{
+	std::mt19937 rng(5678);
+
+	for (int nRound = 0; nRound < 3000; nRound++)
+	{
+		unsigned int nSize = 1 + rng() % 300;
+		std::vector<uint8_t> data(nSize);
+		for (uint8_t& c : data)
+			c = static_cast<uint8_t>('a' + rng() % (1 + nRound % 8));
+
+		std::vector<uint8_t> compressed = Compress(data);
+
+		int nMutations = 1 + rng() % 4;
+		for (int i = 0; i < nMutations; i++)
+		{
+			size_t nAt = 8 + rng() % (compressed.size() - 8);
+			if (rng() % 2)
+				compressed[nAt] ^= static_cast<uint8_t>(1 << (rng() % 8));
+			else
+				compressed[nAt] = static_cast<uint8_t>(rng());
+		}
+
+		// Sometimes the buffer is smaller than the header says
+		unsigned int unBufSize = rng() % 4 ? nSize : 1 + rng() % nSize;
+		DecompressBoth(compressed, unBufSize);
+
+		std::vector<uint8_t> random(8 + rng() % 64);
+		for (uint8_t& c : random)
+			c = static_cast<uint8_t>(rng());
+		memcpy(random.data(), &LZSS_ID, 4);
+		uint32_t nClaimed = 1 + rng() % 64;
+		memcpy(random.data() + 4, &nClaimed, 4);
+		DecompressBoth(random, 64);
+	}
+}
+
+int main()
+{
+	TEST_RUN(TestRoundTrip);
+	TEST_RUN(TestMalformed);
+	TEST_RUN(TestFuzz);
+
+	return Test_Result();
+}
@@ -0,0 +1,278 @@
+//-----------------------------------------------------------------------------
+// Round trips pdata through the persistence delta and batch format, and
+// prints what a match end costs on the wire compared to full pushes
+//-----------------------------------------------------------------------------
+#include "networksystem/persistencedelta.h"
+#include "utils/tests/test.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+// Size of pdata the game server pushes
+constexpr size_t PDATA_SIZE = 56306;
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes something shaped like pdata, long zeroed stretches between
+//          filled ones
+//-----------------------------------------------------------------------------
+static std::string MakePData(std::mt19937& random)
+{
+	std::string svData(PDATA_SIZE, '\0');
+
+	size_t i = 0;
+	while (i < svData.size())
+	{
+		size_t nFilled = std::min<size_t>(random() % 512, svData.size() - i);
+		for (size_t j = 0; j < nFilled; j++)
+			svData[i + j] = static_cast<char>(random());
+
+		i += nFilled + random() % 256;
+	}
+
+	return svData;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds to a little endian int in pdata
+//-----------------------------------------------------------------------------
+static void AddToInt(std::string& svData, size_t nOffset, uint32_t nAdd)
+{
+	uint32_t nValue;
+	memcpy(&nValue, svData.data() + nOffset, sizeof(nValue));
+	nValue += nAdd;
+	memcpy(svData.data() + nOffset, &nValue, sizeof(nValue));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: What a match does to pdata, xp and currency, per weapon counters,
+//          a match history record and a few unlock flags
+// Input  : nWeapons - How many weapons got used
+//-----------------------------------------------------------------------------
+static std::string PlayMatch(std::string svData, std::mt19937& random, int nWeapons)
+{
+	for (int i = 0; i < 8; i++)
+		AddToInt(svData, 64 + i * 4, random() % 5000);
+
+	// 6 counters per weapon, weapon stats start a few kb in
+	for (int i = 0; i < nWeapons; i++)
+	{
+		size_t nWeapon = 4096 + (random() % 120) * 96;
+		for (int j = 0; j < 6; j++)
+			AddToInt(svData, nWeapon + j * 4, random() % 300);
+	}
+
+	size_t nHistory = 20000 + (random() % 20) * 64;
+	for (size_t i = 0; i < 64; i++)
+		svData[nHistory + i] = static_cast<char>(random());
+
+	for (int i = 0; i < 16; i++)
+		svData[30000 + random() % 20000] ^= static_cast<char>(1 << (random() % 8));
+
+	return svData;
+}
+
+static bool RoundTrip(const std::string& svBase, const std::string& svTarget, size_t* pDeltaSize = nullptr)
+{
+	std::string svDelta;
+	PersistenceDelta_Encode(svBase, svTarget, svDelta);
+
+	if (pDeltaSize)
+		*pDeltaSize = svDelta.size();
+
+	std::string svDecoded;
+	return PersistenceDelta_Decode(svBase, svDelta, svDecoded) && svDecoded == svTarget;
+}
+
+static void TestRoundTrip()
+{
+	std::mt19937 random(1);
+	std::string svBase = MakePData(random);
+
+	// Unchanged is just the header
+	size_t nDeltaSize = 0;
+	TEST_CHECK(RoundTrip(svBase, svBase, &nDeltaSize));
+	TEST_CHECK(nDeltaSize == 24);
+
+	// Single bytes at the edges
+	std::string svTarget = svBase;
+	svTarget.front() ^= 1;
+	svTarget.back() ^= 1;
+	TEST_CHECK(RoundTrip(svBase, svTarget));
+
+	// Gaps right at and around the shortest run worth its own pair
+	for (size_t nGap = 0; nGap < 8; nGap++)
+	{
+		svTarget = svBase;
+		svTarget[1000] ^= 0x55;
+		svTarget[1001 + nGap] ^= 0x55;
+		TEST_CHECK(RoundTrip(svBase, svTarget));
+	}
+
+	// Nothing in common
+	svTarget = MakePData(random);
+	TEST_CHECK(RoundTrip(svBase, svTarget));
+
+	// Sizes differ, missing base bytes count as 0
+	TEST_CHECK(RoundTrip(svBase.substr(0, 1000), svTarget));
+	TEST_CHECK(RoundTrip(svBase, svTarget.substr(0, 1000)));
+	TEST_CHECK(RoundTrip(std::string(), svTarget));
+	TEST_CHECK(RoundTrip(svBase, std::string()));
+
+	// Long runs need multi byte lengths
+	svTarget = svBase;
+	for (size_t i = 100; i < 40000; i++)
+		svTarget[i] = static_cast<char>(~svTarget[i]);
+	TEST_CHECK(RoundTrip(svBase, svTarget));
+}
+
+static void TestRejects()
+{
+	std::mt19937 random(2);
+	std::string svBase = MakePData(random);
+	std::string svTarget = PlayMatch(svBase, random, 10);
+
+	std::string svDelta;
+	PersistenceDelta_Encode(svBase, svTarget, svDelta);
+
+	std::string svDecoded;
+
+	// Atlas has different pdata than the one the delta was made against
+	std::string svOtherBase = svBase;
+	svOtherBase[5] ^= 1;
+	TEST_CHECK(!PersistenceDelta_Decode(svOtherBase, svDelta, svDecoded));
+
+	// Truncated anywhere
+	for (size_t i = 0; i < svDelta.size(); i++)
+		TEST_CHECK(!PersistenceDelta_Decode(svBase, std::string_view(svDelta).substr(0, i), svDecoded));
+
+	// Any flipped byte past the header is caught by the target hash or the bounds checks
+	for (size_t i = 24; i < svDelta.size(); i++)
+	{
+		std::string svCorrupt = svDelta;
+		svCorrupt[i] ^= 0x10;
+		TEST_CHECK(!PersistenceDelta_Decode(svBase, svCorrupt, svDecoded));
+	}
+
+	TEST_CHECK(!PersistenceDelta_Decode(svBase, "not a delta", svDecoded));
+}
+
+static void TestFuzz()
+{
+	std::mt19937 random(3);
+	std::string svBase = MakePData(random);
+	std::string svDecoded;
+
+	// Random garbage behind a valid header must never write out of bounds
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string svDelta;
+		PersistenceDelta_Encode(svBase, svBase, svDelta);
+
+		size_t nSize = random() % 64;
+		for (size_t j = 0; j < nSize; j++)
+			svDelta.push_back(static_cast<char>(random()));
+
+		PersistenceDelta_Decode(svBase, svDelta, svDecoded);
+	}
+
+	// Random edits round trip
+	for (int i = 0; i < 500; i++)
+	{
+		std::string svTarget = svBase;
+		int nEdits = static_cast<int>(random() % 200);
+		for (int j = 0; j < nEdits; j++)
+			svTarget[random() % svTarget.size()] = static_cast<char>(random());
+
+		TEST_CHECK(RoundTrip(svBase, svTarget));
+	}
+}
+
+static void TestBatch()
+{
+	std::string svBatch;
+	PersistenceBatch_Begin(svBatch);
+	TEST_CHECK(PersistenceBatch_Add(svBatch, "1000000001", ePersistenceEncoding::FULL, std::string(PDATA_SIZE, 'x')));
+	TEST_CHECK(PersistenceBatch_Add(svBatch, "1000000002", ePersistenceEncoding::DELTA, "delta"));
+	TEST_CHECK(PersistenceBatch_Add(svBatch, "1000000003", ePersistenceEncoding::FULL, ""));
+	TEST_CHECK(!PersistenceBatch_Add(svBatch, "", ePersistenceEncoding::FULL, "x"));
+	TEST_CHECK(!PersistenceBatch_Add(svBatch, std::string(256, '1'), ePersistenceEncoding::FULL, "x"));
+
+	std::vector<PersistenceBatchEntry_t> vEntries;
+	TEST_CHECK(PersistenceBatch_Parse(svBatch, vEntries));
+	TEST_CHECK(vEntries.size() == 3);
+
+	if (vEntries.size() == 3)
+	{
+		TEST_CHECK(vEntries[0].svUID == "1000000001" && vEntries[0].eEncoding == ePersistenceEncoding::FULL && vEntries[0].svPayload.size() == PDATA_SIZE);
+		TEST_CHECK(vEntries[1].svUID == "1000000002" && vEntries[1].eEncoding == ePersistenceEncoding::DELTA && vEntries[1].svPayload == "delta");
+		TEST_CHECK(vEntries[2].svUID == "1000000003" && vEntries[2].svPayload.empty());
+	}
+
+	// Cutting at an entry boundary leaves a valid but shorter batch
+	for (size_t i = 0; i < svBatch.size(); i++)
+		TEST_CHECK(!PersistenceBatch_Parse(std::string_view(svBatch).substr(0, i), vEntries) || vEntries.size() < 3);
+
+	std::string svBadEncoding = svBatch;
+	svBadEncoding[4 + 1 + 10] = 7;
+	TEST_CHECK(!PersistenceBatch_Parse(svBadEncoding, vEntries));
+	TEST_CHECK(!PersistenceBatch_Parse("PDB0", vEntries));
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bytes on the wire for 16 players leaving at match end
+//-----------------------------------------------------------------------------
+static void TestMatchEnd()
+{
+	std::mt19937 random(4);
+
+	const struct
+	{
+		const char* pszName;
+		int nWeapons;
+	} scenarios[] = {{"short match", 3}, {"average match", 10}, {"long match", 40}};
+
+	printf("  %-14s %10s %10s %8s %10s\n", "scenario", "full", "batch", "ratio", "encode us");
+
+	for (const auto& scenario : scenarios)
+	{
+		std::string svFull;
+		std::string svBatch;
+		PersistenceBatch_Begin(svBatch);
+
+		double flEncodeUs = 0.0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			std::string svBase = MakePData(random);
+			std::string svTarget = PlayMatch(svBase, random, scenario.nWeapons);
+
+			auto start = std::chrono::steady_clock::now();
+			std::string svDelta;
+			PersistenceDelta_Encode(svBase, svTarget, svDelta);
+			flEncodeUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+			std::string svDecoded;
+			TEST_CHECK(PersistenceDelta_Decode(svBase, svDelta, svDecoded) && svDecoded == svTarget);
+
+			svFull += svTarget;
+			PersistenceBatch_Add(svBatch, std::to_string(1000000000 + i), ePersistenceEncoding::DELTA, svDelta);
+		}
+
+		printf("  %-14s %10zu %10zu %7.2f%% %10.1f\n", scenario.pszName, svFull.size(), svBatch.size(), 100.0 * svBatch.size() / svFull.size(), flEncodeUs / 16);
+
+		// A match end should cost a few percent of pushing everyone in full
+		TEST_CHECK(svBatch.size() * 20 < svFull.size());
+	}
+}
+
+int main()
+{
+	TEST_RUN(TestRoundTrip);
+	TEST_RUN(TestRejects);
+	TEST_RUN(TestFuzz);
+	TEST_RUN(TestBatch);
+	TEST_RUN(TestMatchEnd);
+
+	return Test_Result();
+}
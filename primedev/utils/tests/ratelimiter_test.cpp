@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Checks CAddressRateLimiter's buckets, subnet aggregates and how full sets
+// evict under a flood of addresses
+//-----------------------------------------------------------------------------
+#include "tier1/ratelimiter.h"
+#include "utils/tests/test.h"
+
+#include <cstring>
+
+struct Address_t
+{
+	uint8_t bytes[16];
+};
+
+static Address_t V4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+	Address_t address = {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, a, b, c, d}};
+	return address;
+}
+
+static Address_t V6(uint16_t nPrefix, uint16_t nSubnet, uint16_t nHost)
+{
+	Address_t address = {};
+	address.bytes[0] = static_cast<uint8_t>(nPrefix >> 8);
+	address.bytes[1] = static_cast<uint8_t>(nPrefix);
+	address.bytes[6] = static_cast<uint8_t>(nSubnet >> 8);
+	address.bytes[7] = static_cast<uint8_t>(nSubnet);
+	address.bytes[14] = static_cast<uint8_t>(nHost >> 8);
+	address.bytes[15] = static_cast<uint8_t>(nHost);
+	return address;
+}
+
+// 5 packets at once, then 1 a second, subnets are generous unless a test says otherwise
+static const RateLimitParams_t s_Params = {1.0f, 5.0f, 1000.0f, 1000.0f, 10.0};
+
+static void TestBucket()
+{
+	CAddressRateLimiter limiter(16, 16);
+	Address_t address = V4(1, 2, 3, 4);
+
+	for (int i = 0; i < 5; i++)
+		TEST_CHECK(limiter.Check(address.bytes, 0.0, s_Params) == eRateLimit::ALLOWED);
+
+	// Out of tokens, blocked for the penalty no matter how much refills
+	TEST_CHECK(limiter.Check(address.bytes, 0.0, s_Params) == eRateLimit::LIMITED);
+	TEST_CHECK(limiter.Check(address.bytes, 5.0, s_Params) == eRateLimit::BLOCKED);
+	TEST_CHECK(limiter.Check(address.bytes, 9.99, s_Params) == eRateLimit::BLOCKED);
+
+	// The bucket refilled while blocked, but only up to the burst
+	for (int i = 0; i < 5; i++)
+		TEST_CHECK(limiter.Check(address.bytes, 10.0, s_Params) == eRateLimit::ALLOWED);
+	TEST_CHECK(limiter.Check(address.bytes, 10.0, s_Params) == eRateLimit::LIMITED);
+
+	// Other addresses have their own bucket
+	Address_t other = V4(1, 2, 3, 5);
+	TEST_CHECK(limiter.Check(other.bytes, 10.0, s_Params) == eRateLimit::ALLOWED);
+
+	// Steady traffic at the rate never runs out
+	Address_t steady = V4(5, 6, 7, 8);
+	for (int i = 0; i < 100; i++)
+		TEST_CHECK(limiter.Check(steady.bytes, 100.0 + i, s_Params) == eRateLimit::ALLOWED);
+
+	// Time going backwards doesn't refill
+	Address_t backwards = V4(9, 9, 9, 9);
+	for (int i = 0; i < 5; i++)
+		TEST_CHECK(limiter.Check(backwards.bytes, 50.0, s_Params) == eRateLimit::ALLOWED);
+	TEST_CHECK(limiter.Check(backwards.bytes, 40.0, s_Params) == eRateLimit::LIMITED);
+}
+
+static void TestSubnet()
+{
+	RateLimitParams_t params = s_Params;
+	params.flSubnetRate = 1.0f;
+	params.flSubnetBurst = 3.0f;
+
+	CAddressRateLimiter limiter(64, 64);
+
+	// One /24 shares a bucket
+	for (uint8_t i = 0; i < 3; i++)
+		TEST_CHECK(limiter.Check(V4(10, 0, 0, i).bytes, 0.0, params) == eRateLimit::ALLOWED);
+	TEST_CHECK(limiter.Check(V4(10, 0, 0, 200).bytes, 0.0, params) == eRateLimit::SUBNET_LIMITED);
+	TEST_CHECK(limiter.Check(V4(10, 0, 1, 0).bytes, 0.0, params) == eRateLimit::ALLOWED);
+
+	// The address itself isn't blocked by its subnet running dry
+	TEST_CHECK(limiter.Check(V4(10, 0, 0, 200).bytes, 1.0, params) == eRateLimit::ALLOWED);
+
+	// One /64 shares a bucket
+	for (uint16_t i = 0; i < 3; i++)
+		TEST_CHECK(limiter.Check(V6(0x2001, 1, i).bytes, 0.0, params) == eRateLimit::ALLOWED);
+	TEST_CHECK(limiter.Check(V6(0x2001, 1, 999).bytes, 0.0, params) == eRateLimit::SUBNET_LIMITED);
+	TEST_CHECK(limiter.Check(V6(0x2001, 2, 0).bytes, 0.0, params) == eRateLimit::ALLOWED);
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A single set for each table, so every new address past 8 evicts
+//-----------------------------------------------------------------------------
+static void TestEviction()
+{
+	CAddressRateLimiter limiter(1, 1);
+	Address_t abuser = V4(6, 6, 6, 6);
+
+	for (int i = 0; i < 5; i++)
+		limiter.Check(abuser.bytes, 0.0, s_Params);
+	TEST_CHECK(limiter.Check(abuser.bytes, 0.0, s_Params) == eRateLimit::LIMITED);
+
+	// An address that keeps sending stays blocked through a flood of one-off
+	// addresses, they only ever evict each other
+	uint32_t nFlood = 0;
+	for (int i = 0; i < 1000; i++)
+	{
+		for (int j = 0; j < 7; j++, nFlood++)
+			limiter.Check(V4(100, static_cast<uint8_t>(nFlood >> 16), static_cast<uint8_t>(nFlood >> 8), static_cast<uint8_t>(nFlood)).bytes, 1.0, s_Params);
+
+		TEST_CHECK(limiter.Check(abuser.bytes, 1.0, s_Params) == eRateLimit::BLOCKED);
+	}
+
+	TEST_CHECK(limiter.GetNumEvictions() > 0);
+
+	// Gone quiet, the flood pushes it out and it comes back with a full bucket
+	for (int i = 0; i < 64; i++, nFlood++)
+		limiter.Check(V4(100, static_cast<uint8_t>(nFlood >> 16), static_cast<uint8_t>(nFlood >> 8), static_cast<uint8_t>(nFlood)).bytes, 2.0, s_Params);
+
+	TEST_CHECK(limiter.Check(abuser.bytes, 2.0, s_Params) == eRateLimit::ALLOWED);
+
+	// Every address checked past the first 8 of a set evicts something
+	CAddressRateLimiter counted(1, 1);
+	for (uint8_t i = 0; i < 20; i++)
+		counted.Check(V4(1, 1, i, 1).bytes, 0.0, s_Params);
+
+	TEST_CHECK(counted.GetNumEvictions() == (20 - 8) * 2);
+}
+
+static void TestClear()
+{
+	CAddressRateLimiter limiter(16, 16);
+	Address_t address = V4(1, 2, 3, 4);
+
+	for (int i = 0; i < 6; i++)
+		limiter.Check(address.bytes, 0.0, s_Params);
+	TEST_CHECK(limiter.Check(address.bytes, 0.0, s_Params) == eRateLimit::BLOCKED);
+
+	limiter.Clear();
+	TEST_CHECK(limiter.Check(address.bytes, 0.0, s_Params) == eRateLimit::ALLOWED);
+	TEST_CHECK(limiter.GetNumEvictions() == 0);
+}
+
+int main()
+{
+	TEST_RUN(TestBucket);
+	TEST_RUN(TestSubnet);
+	TEST_RUN(TestEviction);
+	TEST_RUN(TestClear);
+
+	return Test_Result();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// The parts of core/stdafx.h that don't need the game, for test targets built
+// from sources that expect the precompiled header
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#define ARRAY_SIZE(arr) ((sizeof(arr) / sizeof(*arr)))
+
+#define NOTE_UNUSED(var) (void)(var)
+
+#ifdef _MSC_VER
+#define FORCEINLINE __forceinline
+#define FORCEINLINE_TEMPLATE __forceinline
+#else
+#define FORCEINLINE inline
+#define FORCEINLINE_TEMPLATE inline
+#endif
+
+#include "core/assert.h"
+#include "core/basetypes.h"
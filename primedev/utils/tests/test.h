@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+
+//-----------------------------------------------------------------------------
+// Minimal checks for the standalone tests, a test executable returns
+// Test_Result() from main so ctest sees failures
+//-----------------------------------------------------------------------------
+inline int g_nTestChecks = 0;
+inline int g_nTestFailures = 0;
+
+#define TEST_CHECK(expr)                                                             \
+	do                                                                               \
+	{                                                                                \
+		g_nTestChecks++;                                                             \
+		if (!(expr))                                                                 \
+		{                                                                            \
+			fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #expr); \
+			g_nTestFailures++;                                                       \
+		}                                                                            \
+	} while (0)
+
+#define TEST_RUN(fn)                  \
+	do                                \
+	{                                 \
+		printf("running %s\n", #fn); \
+		fn();                         \
+	} while (0)
+
+inline int Test_Result()
+{
+	printf("%i checks, %i failed\n", g_nTestChecks, g_nTestFailures);
+	return g_nTestFailures ? 1 : 0;
+}